@@ -0,0 +1,98 @@
+<#
+    ~ Cabinet expansion throughput
+
+    This script measures how fast 'Expand-Cabinet' decodes a fixed
+    corpus, in MB/s per core, so changes to the native decoders can
+    be compared between builds.
+    The corpus is generated from a fixed seed, so every run works
+    over the same bytes. Each corpus is compressed into a single-folder
+    cabinet, which is expanded in memory by a single worker. Only the
+    expansion is timed, not writing the corpus or the expanded files.
+
+    Usage:
+        .\Measure-CabinetThroughput.ps1 -ModulePath .\Release\WindowsUtils -CompressionType MSZip
+#>
+
+param (
+    [string]$ModulePath = '.\Release\WindowsUtils',
+    [ValidateSet('None', 'MSZip', 'LZXLow', 'LZXHigh')]
+    [string]$CompressionType = 'MSZip',
+    [int]$SizeMB = 64,
+    [int]$Iterations = 5,
+    [int]$Seed = 0x5743
+)
+
+Import-Module $ModulePath -Force
+
+$workDir = Join-Path ([System.IO.Path]::GetTempPath()) "WuCabBench-$([guid]::NewGuid())"
+[void](New-Item -Path $workDir -ItemType Directory)
+
+# Fixed corpora. Text compresses well, random data doesn't compress at all,
+# and runs stress the short-distance match copies.
+function New-CorpusFile {
+    param ([string]$Path, [string]$Kind, [int]$Size)
+
+    $random = [System.Random]::new($Seed)
+    $buffer = [byte[]]::new($Size)
+    switch ($Kind) {
+        'Text' {
+            # One random byte picks each word, about one in twelve ends the line.
+            # Indexing with the whole byte array keeps the loop out of the script.
+            $words = 'cabinet', 'folder', 'the', 'data', 'block', 'window', 'decoder', 'a', 'of', 'history', 'match', 'literal'
+            $tokens = foreach ($i in 0..255) { $words[$i % $words.Count] + $(if ($i -lt 21) { "`r`n" } else { ' ' }) }
+            $indexes = [byte[]]::new([System.Math]::Max(1, [int]($Size / 6)))
+            $builder = [System.Text.StringBuilder]::new($Size + $indexes.Length)
+            while ($builder.Length -lt $Size) {
+                $random.NextBytes($indexes)
+                [void]$builder.Append(-join $tokens[$indexes])
+            }
+            $buffer = [System.Text.Encoding]::ASCII.GetBytes($builder.ToString(0, $Size))
+        }
+        'Random' { $random.NextBytes($buffer) }
+        'Runs' {
+            # Each run is copied from a filled pattern, instead of byte by byte.
+            $patterns = foreach ($value in 0..3) { , [byte[]](, $value * 300) }
+            $offset = 0
+            while ($offset -lt $Size) {
+                $length = [System.Math]::Min($random.Next(1, 300), $Size - $offset)
+                [System.Buffer]::BlockCopy($patterns[$random.Next(4)], 0, $buffer, $offset, $length)
+                $offset += $length
+            }
+        }
+    }
+
+    [System.IO.File]::WriteAllBytes($Path, $buffer)
+}
+
+try {
+    $results = foreach ($kind in 'Text', 'Random', 'Runs') {
+        $sourceDir = Join-Path $workDir "$kind-Source"
+        $cabDir = Join-Path $workDir "$kind-Cab"
+        [void](New-Item -Path $sourceDir, $cabDir -ItemType Directory)
+
+        New-CorpusFile -Path (Join-Path $sourceDir "$kind.bin") -Kind $kind -Size ($SizeMB * 1MB)
+        New-Cabinet -Path $sourceDir -Destination $cabDir -NamePrefix $kind -CompressionType $CompressionType
+        $cabinet = Get-ChildItem -Path $cabDir -Filter '*.cab' | Select-Object -First 1
+
+        # In memory, so the disk isn't part of the result.
+        $timings = for ($i = 0; $i -lt $Iterations; $i++) {
+            (Measure-Command { $null = Expand-Cabinet -Path $cabinet.FullName -InMemory -ThrottleLimit 1 }).TotalSeconds
+        }
+
+        # Median, so a cold cache or a busy machine doesn't skew the result.
+        $median = ($timings | Sort-Object)[[int][System.Math]::Floor($Iterations / 2)]
+        [PSCustomObject]@{
+            Corpus          = $kind
+            CompressionType = $CompressionType
+            SizeMB          = $SizeMB
+            CompressedMB    = [System.Math]::Round($cabinet.Length / 1MB, 2)
+            MedianSeconds   = [System.Math]::Round($median, 3)
+            MBPerSecPerCore = [System.Math]::Round($SizeMB / $median, 1)
+        }
+    }
+
+    $results | Format-Table -AutoSize
+}
+finally {
+    Remove-Item -Path $workDir -Recurse -Force -ErrorAction SilentlyContinue
+}
@@ -0,0 +1,92 @@
+<#
+    ~ Directory enumeration scaling
+
+    This script measures how the native directory enumeration used by
+    'New-Cabinet' scales with the number of workers.
+    Without 'Path' it generates a tree from a fixed seed, so every run
+    works over the same directories. Point 'Path' to a file server
+    share to measure the case the workers are meant for, where each
+    directory costs a round trip.
+    A single worker is the serial enumeration, and the baseline for the
+    speedup.
+
+    Usage:
+        .\Measure-DirectoryEnumeration.ps1 -ModulePath .\Release\WindowsUtils
+        .\Measure-DirectoryEnumeration.ps1 -Path '\\FileServer\Share' -ThreadCount 1, 8, 32, 64
+#>
+
+param (
+    [string]$ModulePath = '.\Release\WindowsUtils',
+    [string]$Path,
+    [int[]]$ThreadCount,
+    [int]$DirectoryCount = 5000,
+    [int]$FilesPerDirectory = 20,
+    [int]$Iterations = 5,
+    [int]$Seed = 0x5743
+)
+
+Import-Module $ModulePath -Force
+
+# One, then powers of two up to the processor count.
+if (!$ThreadCount) {
+    $ThreadCount = @(1)
+    for ($count = 2; $count -lt [System.Environment]::ProcessorCount; $count *= 2) { $ThreadCount += $count }
+    $ThreadCount += [System.Environment]::ProcessorCount
+}
+
+# Each directory lands under a random existing one, so the tree is both wide and deep.
+function New-DirectoryTree {
+    param ([string]$Root)
+
+    $random = [System.Random]::new($Seed)
+    $directories = [System.Collections.Generic.List[string]]::new()
+    $directories.Add($Root)
+    for ($i = 0; $i -lt $DirectoryCount; $i++) {
+        $parent = $directories[$random.Next($directories.Count)]
+        $directories.Add([System.IO.Directory]::CreateDirectory((Join-Path $parent "Directory$i")).FullName)
+    }
+
+    foreach ($directory in $directories) {
+        for ($i = 0; $i -lt $FilesPerDirectory; $i++) {
+            [System.IO.File]::WriteAllBytes((Join-Path $directory "File$i.bin"), [byte[]]::new($random.Next(64)))
+        }
+    }
+}
+
+$workDir = $null
+if (!$Path) {
+    $workDir = Join-Path ([System.IO.Path]::GetTempPath()) "WuEnumBench-$([guid]::NewGuid())"
+    [void](New-Item -Path $workDir -ItemType Directory)
+    New-DirectoryTree -Root $workDir
+    $Path = $workDir
+}
+
+try {
+    # Warms up the file system cache, so the first thread count doesn't pay for it.
+    $entryCount = [WindowsUtils.Wrappers.UtilitiesWrapper]::CountFileSystemEntries($Path, 0)
+
+    $baseline = $null
+    $results = foreach ($count in $ThreadCount) {
+        $timings = for ($i = 0; $i -lt $Iterations; $i++) {
+            (Measure-Command { [void][WindowsUtils.Wrappers.UtilitiesWrapper]::CountFileSystemEntries($Path, $count) }).TotalSeconds
+        }
+
+        # Median, so a busy machine doesn't skew the result.
+        $median = ($timings | Sort-Object)[[int][System.Math]::Floor($Iterations / 2)]
+        if ($null -eq $baseline) { $baseline = $median }
+        [PSCustomObject]@{
+            Threads          = $count
+            Entries          = $entryCount
+            MedianSeconds    = [System.Math]::Round($median, 3)
+            EntriesPerSecond = [System.Math]::Round($entryCount / $median)
+            Speedup          = [System.Math]::Round($baseline / $median, 2)
+        }
+    }
+
+    $results | Format-Table -AutoSize
+}
+finally {
+    if ($workDir) {
+        Remove-Item -Path $workDir -Recurse -Force -ErrorAction SilentlyContinue
+    }
+}
@@ -11,6 +11,10 @@ namespace WindowsUtils.Commands
     /// <para type="description">It also manages automatically files that spans through multiple cabinet files.</para>
     /// <para type="description">The Cmdlet creates the same folder structure from within the cabinet, relatively to the destination.</para>
     /// <para type="description">If a file with the same name already exists it's overwritten by default.</para>
+    /// <para type="description">Cabinet folders are independent from each other, and with 'ThrottleLimit' they're expanded in parallel.</para>
+    /// <para type="description">With 'Include' and 'Exclude' only the matching files are extracted, and cabinet folders without matching files are not decompressed.</para>
+    /// <para type="description">With 'InMemory' nothing is written to disk. Each file is written to the pipeline, with its content as a byte array.</para>
+    /// <para type="description">With 'UseIndex' the cabinet set layout is kept in a '.cabidx' file next to the cabinet, so opening it again doesn't need to read all file entries.</para>
     /// <example>
     ///     <para></para>
     ///     <code>Expand-Cabinet -Path "$env:SystemDrive\Path\To\Cabinet.cab" -Destination "$env:SystemDrive\Path\To\Destination"</code>
@@ -23,8 +27,33 @@ namespace WindowsUtils.Commands
     ///     <para>Extract files from all cabinet files from 'C:\CabinetSource' that matches 'MultipleCab*'.</para>
     ///     <para></para>
     /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Expand-Cabinet -Path 'C:\CabinetSource\Cabinet.cab' -Destination 'C:\Path\To\Destination' -ThrottleLimit 8</code>
+    ///     <para>Extracts files from 'Cabinet.cab' using up to 8 threads, one cabinet folder per thread.</para>
+    ///     <para></para>
+    /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Expand-Cabinet -Path 'C:\CabinetSource\Cabinet.cab' -Destination 'C:\Path\To\Destination' -Include '*.inf' -Exclude 'Test*'</code>
+    ///     <para>Extracts the INF files from 'Cabinet.cab', except the ones starting with 'Test'.</para>
+    ///     <para></para>
+    /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Expand-Cabinet -Path 'C:\CabinetSource\Cabinet.cab' -Destination 'C:\Path\To\Destination' -UseIndex</code>
+    ///     <para>Extracts files from 'Cabinet.cab' using the index 'C:\CabinetSource\Cabinet.cabidx', creating it if it doesn't exist or is out of date.</para>
+    ///     <para></para>
+    /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>[System.Text.Encoding]::UTF8.GetString((Expand-Cabinet -Path 'C:\CabinetSource\Cabinet.cab' -Include 'update.mum' -InMemory).Content)</code>
+    ///     <para>Reads 'update.mum' from 'Cabinet.cab' without writing it to disk. 'OpenStream()' gives a stream over the content.</para>
+    ///     <para></para>
+    /// </example>
     /// </summary>
-    [Cmdlet(VerbsData.Expand, "Cabinet")]
+    [Cmdlet(VerbsData.Expand, "Cabinet", DefaultParameterSetName = "byPath")]
+    [OutputType(typeof(CabinetFileContent), ParameterSetName = new string[] { "byPathInMemory", "byLiteralInMemory" })]
     public class ExpandCabinetCommand : CoreCommandBase
     {
         private readonly List<string> _validPaths = new();
@@ -43,6 +72,13 @@ namespace WindowsUtils.Commands
             ParameterSetName = "byPath",
             HelpMessage = "The object(s) path."
         )]
+        [Parameter(
+            Position = 0,
+            ValueFromPipeline = true,
+            ValueFromPipelineByPropertyName = true,
+            ParameterSetName = "byPathInMemory",
+            HelpMessage = "The object(s) path."
+        )]
         [ValidateNotNullOrEmpty]
         [SupportsWildcards]
         public string[] Path {
@@ -60,6 +96,13 @@ namespace WindowsUtils.Commands
             ParameterSetName = "byLiteral",
             HelpMessage = "The object(s) literal path."
         )]
+        [Parameter(
+            Mandatory = true,
+            ValueFromPipeline = false,
+            ValueFromPipelineByPropertyName = true,
+            ParameterSetName = "byLiteralInMemory",
+            HelpMessage = "The object(s) literal path."
+        )]
         [Alias("PSPath")]
         [ValidateNotNullOrEmpty]
         public string[] LiteralPath {
@@ -75,7 +118,13 @@ namespace WindowsUtils.Commands
         /// </summary>
         [Parameter(
             Mandatory = true,
-            Position = 1
+            Position = 1,
+            ParameterSetName = "byPath"
+        )]
+        [Parameter(
+            Mandatory = true,
+            Position = 1,
+            ParameterSetName = "byLiteral"
         )]
         [ValidateNotNullOrEmpty]
         public string Destination {
@@ -92,6 +141,46 @@ namespace WindowsUtils.Commands
             }
         }
 
+        /// <summary>
+        /// <para type="description">Extracts only the files matching any of these wildcards.</para>
+        /// <para type="description">Patterns with a '\' are matched against the path inside the cabinet, the others against the file name.</para>
+        /// </summary>
+        [Parameter()]
+        [ValidateNotNullOrEmpty]
+        [SupportsWildcards]
+        public string[] Include { get; set; }
+
+        /// <summary>
+        /// <para type="description">Skips the files matching any of these wildcards.</para>
+        /// <para type="description">Patterns with a '\' are matched against the path inside the cabinet, the others against the file name.</para>
+        /// </summary>
+        [Parameter()]
+        [ValidateNotNullOrEmpty]
+        [SupportsWildcards]
+        public string[] Exclude { get; set; }
+
+        /// <summary>
+        /// <para type="description">The maximum number of cabinet folders expanded in parallel.</para>
+        /// </summary>
+        [Parameter()]
+        [ValidateRange(1, 64)]
+        public int ThrottleLimit { get; set; } = 1;
+
+        /// <summary>
+        /// <para type="description">Opens the cabinet set using the '.cabidx' index next to the cabinet.</para>
+        /// <para type="description">The index is created, or rebuilt, if it doesn't exist or the cabinet changed.</para>
+        /// </summary>
+        [Parameter()]
+        public SwitchParameter UseIndex { get; set; }
+
+        /// <summary>
+        /// <para type="description">Writes the files to the pipeline instead of a destination folder, with their content in memory.</para>
+        /// <para type="description">Meant for small files, like manifests. Folders with compression types only the system can expand are not supported.</para>
+        /// </summary>
+        [Parameter(Mandatory = true, ParameterSetName = "byPathInMemory")]
+        [Parameter(Mandatory = true, ParameterSetName = "byLiteralInMemory")]
+        public SwitchParameter InMemory { get; set; }
+
         protected override void ProcessRecord()
         {
             _path ??= new[] { ".\\*" };
@@ -128,7 +217,10 @@ namespace WindowsUtils.Commands
             foreach (string path in _validPaths)
             {
                 try {
-                    Containers.ExpandArchiveFile(path, Destination, ArchiveFileType.Cabinet);
+                    if (InMemory)
+                        Containers.ExpandArchiveFileToMemory(path, Include, Exclude, ThrottleLimit, UseIndex, ArchiveFileType.Cabinet);
+                    else
+                        Containers.ExpandArchiveFile(path, Destination, Include, Exclude, ThrottleLimit, UseIndex, ArchiveFileType.Cabinet);
                 }
                 // Error already written to the stream.
                 catch (NativeException) { }
@@ -0,0 +1,101 @@
+﻿using System.Management.Automation;
+using WindowsUtils.Engine;
+using WindowsUtils.Wrappers;
+
+namespace WindowsUtils.Commands
+{
+#pragma warning disable CS8618
+    /// <summary>
+    /// <para type="synopsis">Lists the files in a cabinet file.</para>
+    /// <para type="description">This Cmdlet lists the file entries of a cabinet file, or cabinet set, without extracting them.</para>
+    /// <para type="description">Entries are read from the cabinet one at a time and written to the pipeline as they're read.</para>
+    /// <para type="description">Files spanning multiple cabinets have one entry in each cabinet they're stored in, and 'Span' tells how they continue.</para>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Get-CabinetContent -Path 'C:\CabinetSource\Cabinet.cab'</code>
+    ///     <para>Lists all files in 'Cabinet.cab', and the cabinets in the same set.</para>
+    ///     <para></para>
+    /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Get-CabinetContent -Path 'C:\CabinetSource\Cabinet.cab' | Where-Object { $_.Name -like '*.inf' } | Select-Object -First 1</code>
+    ///     <para>Returns the first INF file in 'Cabinet.cab'. The listing stops as soon as it's found.</para>
+    ///     <para></para>
+    /// </example>
+    /// </summary>
+    [Cmdlet(VerbsCommon.Get, "CabinetContent")]
+    [OutputType(typeof(CabinetFileInfo))]
+    public class GetCabinetContentCommand : CoreCommandBase
+    {
+        private string[] _path;
+        private bool _shouldExpandWildcards = true;
+
+        /// <summary>
+        /// <para type="description">The cabinet path.</para>
+        /// </summary>
+        [Parameter(
+            Mandatory = true,
+            Position = 0,
+            ValueFromPipeline = true,
+            ValueFromPipelineByPropertyName = true,
+            ParameterSetName = "byPath",
+            HelpMessage = "The cabinet(s) path."
+        )]
+        [ValidateNotNullOrEmpty]
+        [SupportsWildcards]
+        public string[] Path {
+            get { return _path; }
+            set { _path = value; }
+        }
+
+        /// <summary>
+        /// <para type="description">Provider-aware file system object path.</para>
+        /// </summary>
+        [Parameter(
+            Mandatory = true,
+            ValueFromPipeline = false,
+            ValueFromPipelineByPropertyName = true,
+            ParameterSetName = "byLiteral",
+            HelpMessage = "The cabinet(s) literal path."
+        )]
+        [Alias("PSPath")]
+        [ValidateNotNullOrEmpty]
+        public string[] LiteralPath {
+            get { return _path; }
+            set {
+                _shouldExpandWildcards = false;
+                _path = value;
+            }
+        }
+
+        protected override void ProcessRecord()
+        {
+            List<string> resolvedPaths = new();
+            foreach (string path in _path)
+            {
+                ProviderInfo providerInfo;
+                if (_shouldExpandWildcards)
+                    resolvedPaths.AddRange(GetResolvedProviderPathFromPSPath(path, out providerInfo));
+                else
+                    resolvedPaths.Add(SessionState.Path.GetUnresolvedProviderPathFromPSPath(path, out providerInfo, out _));
+
+                if (providerInfo.Name != "FileSystem")
+                    throw new InvalidOperationException("Only the file system provider is allowed with this Cmdlet.");
+            }
+
+            foreach (string path in resolvedPaths)
+            {
+                if (!File.Exists(path)) {
+                    WriteWarning($"File '{path}' not found.");
+                    continue;
+                }
+
+                try {
+                    Containers.GetArchiveFileContent(path, ArchiveFileType.Cabinet);
+                }
+                // Error already written to the stream.
+                catch (NativeException) { }
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -11,6 +11,9 @@ namespace WindowsUtils.Commands
     /// <para type="description">If the path is a directory it looks recursively for all files.</para>
     /// <para type="description">You can use the 'MaxCabSize'(Kb) parameter if you want to split in multiple cabs, and the 'NamePrefix' to chose a prefix name.</para>
     /// <para type="description">Important! Cabinet files accepts only files smaller than 2Gb, and the maximum size for a cabinet file is 2Gb.</para>
+    /// <para type="description">With 'None' and 'MSZip' files are grouped in cabinet folders, and with 'ThrottleLimit' the folders are compressed in parallel.</para>
+    /// <para type="description">With 'Deduplicate' files with the same content are stored once, and the copies point to the same data.</para>
+    /// <para type="description">With 'Update' an existing cabinet gets the new and changed files, without compressing again what's already in it.</para>
     /// <example>
     ///     <para></para>
     ///     <code>New-Cabinet -Path 'C:\Path\To\Files' -Destination 'C:\Path\To\Destination'</code>
@@ -24,6 +27,24 @@ namespace WindowsUtils.Commands
     ///     <para>If the size exceeds 20Mb, files will span over multiple cabs, following the pattern 'CoolCab01.cab', 'CoolCab02.cab'...</para>
     ///     <para></para>
     /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>New-Cabinet -Path 'C:\Path\To\Files' -Destination 'C:\Path\To\Destination' -ThrottleLimit 8</code>
+    ///     <para>Compresses all files in 'C:\Path\To\Files' using up to 8 threads, one cabinet folder per thread.</para>
+    ///     <para></para>
+    /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>New-Cabinet -Path 'C:\Path\To\DriverBundle' -Destination 'C:\Path\To\Destination' -Deduplicate -ThrottleLimit 8</code>
+    ///     <para>Compresses the bundle storing each distinct file once. Identical files are found using up to 8 threads.</para>
+    ///     <para></para>
+    /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>New-Cabinet -Path 'C:\Path\To\Patches' -Destination 'C:\Path\To\Destination' -NamePrefix 'Patches' -Update</code>
+    ///     <para>Adds the new and changed files in 'C:\Path\To\Patches' to 'Patches01.cab'. The files already in it are not compressed again.</para>
+    ///     <para></para>
+    /// </example>
     /// </summary>
     [Cmdlet(VerbsCommon.New, "Cabinet")]
     public class CompressArchiveFileCommand : CoreCommandBase
@@ -90,10 +111,44 @@ namespace WindowsUtils.Commands
         [Parameter()]
         public CabinetCompressionType CompressionType { get; set; } = CabinetCompressionType.MSZip;
 
+        /// <summary>
+        /// <para type="description">The maximum number of cabinet folders compressed in parallel.</para>
+        /// <para type="description">LZX compression always uses a single thread.</para>
+        /// </summary>
+        [Parameter()]
+        [ValidateRange(1, 64)]
+        public int ThrottleLimit { get; set; } = 1;
+
+        /// <summary>
+        /// <para type="description">Stores files with the same content once. Files with the same size are hashed, in parallel with 'ThrottleLimit'.</para>
+        /// <para type="description">Only with 'None' and 'MSZip' compression. Some older extraction tools might not expect files sharing data.</para>
+        /// </summary>
+        [Parameter()]
+        public SwitchParameter Deduplicate { get; set; }
+
+        /// <summary>
+        /// <para type="description">If the cabinet exists, adds the new files, and the ones changed since they were stored, to it.</para>
+        /// <para type="description">Folders already in the cabinet are kept as they are, only the new files are compressed.</para>
+        /// <para type="description">Files not in 'Path' stay in the cabinet. Only single cabinets, with 'None' or 'MSZip' compression. Signed cabinets can't be updated.</para>
+        /// <para type="description">'Deduplicate' and 'MaxCabSize' are ignored when updating an existing cabinet.</para>
+        /// </summary>
+        [Parameter()]
+        public SwitchParameter Update { get; set; }
+
         protected override void ProcessRecord()
         {
             try {
-                Containers.CompressArchiveFile(Path, _destination, NamePrefix, (MaxCabSize * 1024), CompressionType, ArchiveFileType.Cabinet);
+                if (Update && File.Exists(System.IO.Path.Combine(_destination, $"{NamePrefix}01.cab"))) {
+                    if (Deduplicate.IsPresent)
+                        WriteWarning("'-Deduplicate' was used with '-Update' on an existing cabinet. Deduplicate will be ignored.");
+
+                    if (MyInvocation.BoundParameters.ContainsKey(nameof(MaxCabSize)))
+                        WriteWarning("'-MaxCabSize' was used with '-Update' on an existing cabinet. MaxCabSize will be ignored.");
+
+                    Containers.UpdateArchiveFile(Path, _destination, NamePrefix, CompressionType, ThrottleLimit, ArchiveFileType.Cabinet);
+                }
+                else
+                    Containers.CompressArchiveFile(Path, _destination, NamePrefix, (MaxCabSize * 1024), CompressionType, ThrottleLimit, Deduplicate, ArchiveFileType.Cabinet);
             }
             // Exception already written to the stream.
             catch (NativeException) { }
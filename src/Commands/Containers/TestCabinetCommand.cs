@@ -0,0 +1,109 @@
+﻿using System.Management.Automation;
+using WindowsUtils.Engine;
+using WindowsUtils.Wrappers;
+
+namespace WindowsUtils.Commands
+{
+#pragma warning disable CS8618
+    /// <summary>
+    /// <para type="synopsis">Verifies the integrity of a cabinet file.</para>
+    /// <para type="description">This Cmdlet checks a cabinet file, or cabinet set, without extracting it. Nothing is written to disk.</para>
+    /// <para type="description">Every data block is read, its checksum verified, and decoded to memory to make sure it decompresses. The decoded size of each folder is checked against its file entries.</para>
+    /// <para type="description">It writes one object per cabinet set, with the throughput and the first corrupt block of each folder. 'IsValid' is true if no folder has errors.</para>
+    /// <para type="description">Cabinet folders are independent from each other, and with 'ThrottleLimit' they're verified in parallel.</para>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Test-Cabinet -Path 'C:\CabinetSource\Cabinet.cab'</code>
+    ///     <para>Verifies 'Cabinet.cab', and the cabinets in the same set.</para>
+    ///     <para></para>
+    /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Get-ChildItem -Path 'C:\Vendor\*.cab' | Test-Cabinet -ThrottleLimit 8 | Where-Object { !$_.IsValid } | Select-Object -ExpandProperty Errors</code>
+    ///     <para>Verifies all cabinets in 'C:\Vendor' using up to 8 threads, and lists the corrupt folders.</para>
+    ///     <para></para>
+    /// </example>
+    /// </summary>
+    [Cmdlet(VerbsDiagnostic.Test, "Cabinet")]
+    [OutputType(typeof(CabinetTestInfo))]
+    public class TestCabinetCommand : CoreCommandBase
+    {
+        private string[] _path;
+        private bool _shouldExpandWildcards = true;
+
+        /// <summary>
+        /// <para type="description">The cabinet path.</para>
+        /// </summary>
+        [Parameter(
+            Mandatory = true,
+            Position = 0,
+            ValueFromPipeline = true,
+            ValueFromPipelineByPropertyName = true,
+            ParameterSetName = "byPath",
+            HelpMessage = "The cabinet(s) path."
+        )]
+        [ValidateNotNullOrEmpty]
+        [SupportsWildcards]
+        public string[] Path {
+            get { return _path; }
+            set { _path = value; }
+        }
+
+        /// <summary>
+        /// <para type="description">Provider-aware file system object path.</para>
+        /// </summary>
+        [Parameter(
+            Mandatory = true,
+            ValueFromPipeline = false,
+            ValueFromPipelineByPropertyName = true,
+            ParameterSetName = "byLiteral",
+            HelpMessage = "The cabinet(s) literal path."
+        )]
+        [Alias("PSPath")]
+        [ValidateNotNullOrEmpty]
+        public string[] LiteralPath {
+            get { return _path; }
+            set {
+                _shouldExpandWildcards = false;
+                _path = value;
+            }
+        }
+
+        /// <summary>
+        /// <para type="description">The maximum number of cabinet folders verified in parallel.</para>
+        /// </summary>
+        [Parameter()]
+        [ValidateRange(1, 64)]
+        public int ThrottleLimit { get; set; } = 1;
+
+        protected override void ProcessRecord()
+        {
+            List<string> resolvedPaths = new();
+            foreach (string path in _path)
+            {
+                ProviderInfo providerInfo;
+                if (_shouldExpandWildcards)
+                    resolvedPaths.AddRange(GetResolvedProviderPathFromPSPath(path, out providerInfo));
+                else
+                    resolvedPaths.Add(SessionState.Path.GetUnresolvedProviderPathFromPSPath(path, out providerInfo, out _));
+
+                if (providerInfo.Name != "FileSystem")
+                    throw new InvalidOperationException("Only the file system provider is allowed with this Cmdlet.");
+            }
+
+            foreach (string path in resolvedPaths)
+            {
+                if (!File.Exists(path)) {
+                    WriteWarning($"File '{path}' not found.");
+                    continue;
+                }
+
+                try {
+                    Containers.TestArchiveFile(path, ThrottleLimit, ArchiveFileType.Cabinet);
+                }
+                // Error already written to the stream.
+                catch (NativeException) { }
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -35,6 +35,12 @@ namespace WindowsUtils.Commands
     ///     <para>Measure statistics to 'learn.microsoft.com' and 'google.com' on port 80 and 443, with a single probe.</para>
     ///     <para></para>
     /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Start-Tcping (Get-Content -Path 'C:\Servers.txt') -p 443, 3389 -Parallel -Continuous</code>
+    ///     <para>Monitor every server in the list on port 443 and 3389 at the same time, until Ctrl + C.</para>
+    ///     <para></para>
+    /// </example>
     /// </summary>
     [Cmdlet(VerbsLifecycle.Start, "Tcping")]
     [OutputType(typeof(TcpingProbeInfo), typeof(TcpingStatistics))]
@@ -202,6 +208,13 @@ namespace WindowsUtils.Commands
         [Parameter()]
         public SwitchParameter Force { get; set; }
 
+        /// <summary>
+        /// <para type="description">Probes every destination on every port at the same time, instead of one after the other.</para>
+        /// <para type="description">Each destination and port has its own statistics.</para>
+        /// </summary>
+        [Parameter()]
+        public SwitchParameter Parallel { get; set; }
+
         // File parameters
 
         /// <summary>
@@ -231,6 +244,17 @@ namespace WindowsUtils.Commands
 
         protected override void ProcessRecord()
         {
+            if (Parallel.IsPresent)
+            {
+                if (!string.IsNullOrEmpty(OutputFile))
+                    throw new ArgumentException("'-OutputFile' cannot be used with '-Parallel'.");
+
+                Network.StartTcpPingParallel(Destination, Port, Count, Timeout, Interval, FailedThreshold, Continuous,
+                    IncludeJitter, PrintFqdn, Force, !_ignoreSingle && Single, out _);
+
+                return;
+            }
+
             if ((Destination.Length > 1 || Port.Length > 1) && _continuous)
                 WriteWarning("'-Continuous' was used with multiple destination or ports. Only the first will be processed.");
 
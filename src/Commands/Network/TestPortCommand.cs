@@ -29,6 +29,12 @@ namespace WindowsUtils.Commands
     ///     <para>Tests if the TCP ports 80, 443, and UDP ports 67, 68, and 69 are opened at 'SUPERSERVER.contoso.com'.</para>
     ///     <para></para>
     /// </example>
+    /// <example>
+    ///     <para></para>
+    ///     <code>Test-Port 'SERVER01', 'SERVER02' -TcpPort (1..1024) -Scan -ThrottleLimit 512</code>
+    ///     <para>Tests the TCP ports 1 to 1024 on 'SERVER01' and 'SERVER02', with up to 512 connections at a time.</para>
+    ///     <para></para>
+    /// </example>
     /// </summary>
     [Cmdlet(VerbsDiagnostic.Test, "Port")]
     [Alias("testport")]
@@ -96,26 +102,52 @@ namespace WindowsUtils.Commands
         [ValidateRange(1, int.MaxValue)]
         public int Timeout { get; set; } = 2;
 
+        /// <summary>
+        /// <para type="description">Tests the TCP ports on every destination at the same time, instead of one after the other.</para>
+        /// <para type="description">Results are written as each port answers or times out, so they're not in order. UDP ports are still tested one at a time.</para>
+        /// </summary>
+        [Parameter()]
+        public SwitchParameter Scan { get; set; }
+
+        /// <summary>
+        /// <para type="description">The maximum number of connections in flight with '-Scan'.</para>
+        /// </summary>
+        [Parameter()]
+        [ValidateRange(1, 4096)]
+        public int ThrottleLimit { get; set; } = 256;
+
         protected override void ProcessRecord()
         {
             if (_portList.Count == 0)
                 throw new ArgumentException("You need to input at least one port.");
 
-            foreach (string destination in _destination)
+            IEnumerable<SingleTestInfo> singlePorts = _portList;
+            if (Scan.IsPresent)
             {
-                foreach (SingleTestInfo port in _portList)
+                int[] tcpPorts = _portList
+                    .Where(p => p.Protocol == TransportProtocol.Tcp && IsPortInRange(p))
+                    .Select(p => p.Port)
+                    .ToArray();
+
+                if (tcpPorts.Length > 0)
                 {
-                    if (port.Port < 0 || port.Port > ushort.MaxValue)
-                    {
-                        WriteError(new(
-                            new ArgumentOutOfRangeException($"Port cannot be smaller than 0, or bigger than 65535. Was '{port.Port}'."),
-                            "PortOutOfRange",
-                            ErrorCategory.InvalidArgument,
-                            port
-                        ));
+                    try {
+                        Network.ScanNetworkPorts(_destination, tcpPorts, (uint)Timeout, ThrottleLimit);
+                    }
+                    // Error already written to the stream.
+                    catch (NativeException) { }
+                }
 
+                // There's no connection to scan with UDP.
+                singlePorts = _portList.Where(p => p.Protocol == TransportProtocol.Udp);
+            }
+
+            foreach (string destination in _destination)
+            {
+                foreach (SingleTestInfo port in singlePorts)
+                {
+                    if (!IsPortInRange(port))
                         continue;
-                    }
 
                     try {
                         Network.TestNetworkPort(destination, (uint)port.Port, port.Protocol, (uint)Timeout);
@@ -125,5 +157,22 @@ namespace WindowsUtils.Commands
                 }
             }
         }
+
+        private bool IsPortInRange(SingleTestInfo port)
+        {
+            if (port.Port < 0 || port.Port > ushort.MaxValue)
+            {
+                WriteError(new(
+                    new ArgumentOutOfRangeException($"Port cannot be smaller than 0, or bigger than 65535. Was '{port.Port}'."),
+                    "PortOutOfRange",
+                    ErrorCategory.InvalidArgument,
+                    port
+                ));
+
+                return false;
+            }
+
+            return true;
+        }
     }
 }
\ No newline at end of file
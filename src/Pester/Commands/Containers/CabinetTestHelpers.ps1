@@ -0,0 +1,30 @@
+# Shared by the cabinet tests, dot-sourced from their BeforeAll.
+
+# Writes files with seeded random content named 'Random<n>.bin', and returns the directory.
+# Random data doesn't compress, so the cabinet sizes follow the file sizes.
+function New-RandomFiles {
+
+    [CmdletBinding()]
+    param (
+        [Parameter(Mandatory)]
+        [string]$Path,
+
+        [Parameter(Mandatory)]
+        [int]$Count,
+
+        [Parameter(Mandatory)]
+        [int]$Size,
+
+        [int]$Seed = 42
+    )
+
+    $random = [System.Random]::new($Seed)
+    $directory = [System.IO.Directory]::CreateDirectory($Path).FullName
+    for ($i = 0; $i -lt $Count; $i++) {
+        $content = [byte[]]::new($Size)
+        $random.NextBytes($content)
+        [System.IO.File]::WriteAllBytes((Join-Path -Path $directory -ChildPath "Random$i.bin"), $content)
+    }
+
+    return $directory
+}
\ No newline at end of file
@@ -1,4 +1,105 @@
 BeforeAll {
+    # Builds a single volume, single folder, uncompressed cabinet by hand.
+    # Blocks have no checksum, and files are stored in the order given.
+    function New-SyntheticCabinet {
+
+        [CmdletBinding()]
+        param (
+            [Parameter(Mandatory)]
+            [string]$Path,
+
+            [Parameter(Mandatory)]
+            [System.Collections.Specialized.OrderedDictionary]$Files
+        )
+
+        $entries = [System.Collections.Generic.List[object]]::new()
+        $payload = [System.IO.MemoryStream]::new()
+        $fileTableSize = 0
+        foreach ($name in $Files.Keys) {
+            $content = [byte[]]$Files[$name]
+            $nameBytes = [System.Text.Encoding]::ASCII.GetBytes($name)
+            $entries.Add([pscustomobject]@{ Name = $nameBytes; Offset = $payload.Length; Size = $content.Length })
+            $payload.Write($content, 0, $content.Length)
+            $fileTableSize += 16 + $nameBytes.Length + 1
+        }
+
+        $data = $payload.ToArray()
+        $blockCount = [Math]::Ceiling($data.Length / 32768)
+        $fileOffset = 36 + 8
+        $dataOffset = $fileOffset + $fileTableSize
+        $cabinetSize = $dataOffset + ($blockCount * 8) + $data.Length
+
+        $stream = [System.IO.MemoryStream]::new()
+        $writer = [System.IO.BinaryWriter]::new($stream)
+
+        # CFHEADER.
+        $writer.Write([System.Text.Encoding]::ASCII.GetBytes('MSCF'))
+        $writer.Write([uint32]0)
+        $writer.Write([uint32]$cabinetSize)
+        $writer.Write([uint32]0)
+        $writer.Write([uint32]$fileOffset)
+        $writer.Write([uint32]0)
+        $writer.Write([byte]3)
+        $writer.Write([byte]1)
+        $writer.Write([uint16]1)
+        $writer.Write([uint16]$entries.Count)
+        $writer.Write([uint16]0)
+        $writer.Write([uint16]0)
+        $writer.Write([uint16]0)
+
+        # CFFOLDER.
+        $writer.Write([uint32]$dataOffset)
+        $writer.Write([uint16]$blockCount)
+        $writer.Write([uint16]0)
+
+        # CFFILE. 2024-01-01 00:00:00, archive.
+        foreach ($entry in $entries) {
+            $writer.Write([uint32]$entry.Size)
+            $writer.Write([uint32]$entry.Offset)
+            $writer.Write([uint16]0)
+            $writer.Write([uint16]22561)
+            $writer.Write([uint16]0)
+            $writer.Write([uint16]0x20)
+            $writer.Write($entry.Name)
+            $writer.Write([byte]0)
+        }
+
+        # CFDATA.
+        for ($i = 0; $i -lt $blockCount; $i++) {
+            $start = $i * 32768
+            $length = [Math]::Min(32768, $data.Length - $start)
+            $writer.Write([uint32]0)
+            $writer.Write([uint16]$length)
+            $writer.Write([uint16]$length)
+            $writer.Write($data, $start, $length)
+        }
+
+        $writer.Flush()
+        [System.IO.File]::WriteAllBytes($Path, $stream.ToArray())
+    }
+
+    # Seeded random content for 'New-SyntheticCabinet', keyed by file name in the order given.
+    function New-SyntheticFiles {
+
+        [CmdletBinding()]
+        param (
+            [Parameter(Mandatory)]
+            [System.Collections.Specialized.OrderedDictionary]$Sizes,
+
+            [int]$Seed = 42
+        )
+
+        $random = [System.Random]::new($Seed)
+        $files = [ordered]@{}
+        foreach ($name in $Sizes.Keys) {
+            $content = [byte[]]::new($Sizes[$name])
+            $random.NextBytes($content)
+            $files[$name] = $content
+        }
+
+        return $files
+    }
+
     function Test-ExpandCabOutputMetadata {
 
         [CmdletBinding()]
@@ -36,6 +137,38 @@ BeforeAll {
         return $compliant
     }
 
+    # Compresses random data and repeated text with 'New-Cabinet', expands it back and compares the hashes.
+    # Random data exercises stored blocks, repeated text the matches and the history between blocks.
+    function Test-CompressedCabinetRoundTrip {
+
+        [CmdletBinding()]
+        param (
+            [Parameter(Mandatory)]
+            [string]$CompressionType
+        )
+
+        $random = [System.Random]::new(42)
+        $source = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath "$CompressionType-Source") -ItemType Directory).FullName
+        $cabDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath "$CompressionType-Cab") -ItemType Directory).FullName
+        $destination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath "$CompressionType-Expanded") -ItemType Directory).FullName
+
+        $randomContent = [byte[]]::new(100000)
+        $random.NextBytes($randomContent)
+        [System.IO.File]::WriteAllBytes((Join-Path -Path $source -ChildPath 'Random.bin'), $randomContent)
+        [System.IO.File]::WriteAllText((Join-Path -Path $source -ChildPath 'Text.txt'), ('The quick brown fox jumps over the lazy dog. ' * 5000))
+
+        New-Cabinet -Path $source -Destination $cabDestination -NamePrefix $CompressionType -CompressionType $CompressionType
+        Get-ChildItem -Path $cabDestination -Filter '*.cab' | Select-Object -First 1 | Expand-Cabinet -Destination $destination
+
+        $compliant = $true
+        foreach ($file in Get-ChildItem -Path $source -File) {
+            $expanded = Get-ChildItem -Path $destination -Filter $file.Name -Recurse -File
+            $compliant = $compliant -band ($null -ne $expanded -and (Get-FileHash -Path $expanded.FullName).Hash -eq (Get-FileHash -Path $file.FullName).Hash)
+        }
+
+        return $compliant
+    }
+
     $utilitiesRoot = Get-ItemProperty -Path "$PSScriptRoot\..\..\Utilities"
     $Global:cabPath = Get-ChildItem -Path ([System.IO.Path]::Combine($utilitiesRoot.FullName, 'PesterTestCab02.cab')) -ErrorAction Stop
     $metadataPath = [System.IO.Path]::Combine($utilitiesRoot.FullName, 'PesterTestCabMetadata.json')
@@ -50,6 +183,13 @@ BeforeAll {
 }
 
 Describe 'Expand-Cabinet' {
+    BeforeAll {
+        # A file spanning blocks, one in a folder and an empty one. Shared by the tests that only read the cabinet.
+        $Global:syntheticFiles = New-SyntheticFiles -Sizes ([ordered]@{ 'Spanning.bin' = 70000; 'Folder\Small.bin' = 100; 'Empty.txt' = 0 })
+        $Global:syntheticCab = Join-Path -Path $TestDrive -ChildPath 'Synthetic.cab'
+        New-SyntheticCabinet -Path $Global:syntheticCab -Files $Global:syntheticFiles
+    }
+
     It "Expand one or more cabinet files with explicit 'Path' parameter" {
         Expand-Cabinet -Path $Global:cabPath.FullName -Destination $Global:tempFolderInfo.FullName
         Test-ExpandCabOutputMetadata -Destination $Global:tempFolderInfo.FullName -Metadata $Global:cabMetadata | Should -Be $true
@@ -67,6 +207,77 @@ Describe 'Expand-Cabinet' {
         Test-ExpandCabOutputMetadata -Destination $Global:tempFolderInfo.FullName -Metadata $Global:cabMetadata | Should -Be $true
         Remove-Item -Path $Global:globbedTempFolder -Force
     }
+
+    It "Expand one or more cabinet files in parallel with 'ThrottleLimit'" {
+        Expand-Cabinet -Path $Global:cabPath.FullName -Destination $Global:tempFolderInfo.FullName -ThrottleLimit 4
+        Test-ExpandCabOutputMetadata -Destination $Global:tempFolderInfo.FullName -Metadata $Global:cabMetadata | Should -Be $true
+        Remove-Item -Path $Global:globbedTempFolder -Force
+    }
+
+    It 'Expand a synthetic uncompressed cabinet' {
+        $syntheticDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Synthetic') -ItemType Directory).FullName
+
+        Expand-Cabinet -Path $Global:syntheticCab -Destination $syntheticDestination
+        foreach ($name in $Global:syntheticFiles.Keys) {
+            $expanded = [System.IO.File]::ReadAllBytes((Join-Path -Path $syntheticDestination -ChildPath $name))
+            [System.Linq.Enumerable]::SequenceEqual($expanded, [byte[]]$Global:syntheticFiles[$name]) | Should -Be $true
+        }
+    }
+
+    It "Expand only the files matching 'Include' and 'Exclude'" {
+        $files = New-SyntheticFiles -Sizes ([ordered]@{ 'First.bin' = 70000; 'Folder\Second.bin' = 100; 'Folder\Third.txt' = 200 })
+
+        $filteredCab = Join-Path -Path $TestDrive -ChildPath 'Filtered.cab'
+        $filteredDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Filtered') -ItemType Directory).FullName
+        New-SyntheticCabinet -Path $filteredCab -Files $files
+
+        Expand-Cabinet -Path $filteredCab -Destination $filteredDestination -Include 'Folder\*' -Exclude '*.txt'
+        @(Get-ChildItem -Path $filteredDestination -Recurse -File).Count | Should -Be 1
+        [System.Linq.Enumerable]::SequenceEqual([System.IO.File]::ReadAllBytes((Join-Path -Path $filteredDestination -ChildPath 'Folder\Second.bin')), [byte[]]$files['Folder\Second.bin']) | Should -Be $true
+    }
+
+    It "Expand a cabinet with 'UseIndex', and rebuild the index when the cabinet changes" {
+        $files = New-SyntheticFiles -Sizes ([ordered]@{ 'Indexed.bin' = 50000 })
+
+        $indexedCab = Join-Path -Path $TestDrive -ChildPath 'Indexed.cab'
+        $indexPath = Join-Path -Path $TestDrive -ChildPath 'Indexed.cabidx'
+        New-SyntheticCabinet -Path $indexedCab -Files $files
+
+        # First run creates the index, second one loads it.
+        foreach ($run in 1..2) {
+            $indexedDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath "Indexed$run") -ItemType Directory).FullName
+            Expand-Cabinet -Path $indexedCab -Destination $indexedDestination -UseIndex
+            [System.IO.File]::Exists($indexPath) | Should -Be $true
+            [System.Linq.Enumerable]::SequenceEqual([System.IO.File]::ReadAllBytes((Join-Path -Path $indexedDestination -ChildPath 'Indexed.bin')), [byte[]]$files['Indexed.bin']) | Should -Be $true
+        }
+
+        $files = New-SyntheticFiles -Sizes ([ordered]@{ 'Changed.bin' = 60000 }) -Seed 43
+        New-SyntheticCabinet -Path $indexedCab -Files $files
+
+        $changedDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'IndexedChanged') -ItemType Directory).FullName
+        Expand-Cabinet -Path $indexedCab -Destination $changedDestination -UseIndex
+        [System.Linq.Enumerable]::SequenceEqual([System.IO.File]::ReadAllBytes((Join-Path -Path $changedDestination -ChildPath 'Changed.bin')), [byte[]]$files['Changed.bin']) | Should -Be $true
+    }
+
+    It "Expand to the pipeline with 'InMemory'" {
+        $output = @(Expand-Cabinet -Path $Global:syntheticCab -InMemory -ThrottleLimit 2)
+        $output.Count | Should -Be 3
+        foreach ($file in $output) {
+            [System.Linq.Enumerable]::SequenceEqual($file.Content, [byte[]]$Global:syntheticFiles[$file.Name]) | Should -Be $true
+            $file.OpenStream().Length | Should -Be $file.Size
+        }
+
+        $filtered = Expand-Cabinet -Path $Global:syntheticCab -InMemory -Include 'Folder\*'
+        $filtered.Name | Should -Be 'Folder\Small.bin'
+    }
+
+    It 'Expand a cabinet compressed with MSZip' {
+        Test-CompressedCabinetRoundTrip -CompressionType MSZip | Should -Be $true
+    }
+
+    It 'Expand a cabinet compressed with LZX' {
+        Test-CompressedCabinetRoundTrip -CompressionType LZXHigh | Should -Be $true
+    }
 }
 
 AfterAll {
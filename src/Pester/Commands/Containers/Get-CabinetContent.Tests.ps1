@@ -0,0 +1,38 @@
+BeforeAll {
+    . "$PSScriptRoot\CabinetTestHelpers.ps1"
+
+    # Random files don't compress, so a small 'MaxCabSize' gets us a set with files spanning volumes.
+    # LZX goes through FCI, which splits files between volumes.
+    $Global:contentSource = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Source') -ItemType Directory).FullName
+    New-RandomFiles -Path (Join-Path -Path $Global:contentSource -ChildPath 'Sub Folder') -Count 10 -Size 30000 | Out-Null
+
+    $Global:contentDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Cabinet') -ItemType Directory).FullName
+    New-Cabinet -Path $Global:contentSource -Destination $Global:contentDestination -NamePrefix 'Content' -MaxCabSize 100 -CompressionType LZXLow
+}
+
+Describe 'Get-CabinetContent' {
+    It 'List all files in a cabinet set' {
+        $cabinets = @(Get-ChildItem -Path $Global:contentDestination -Filter '*.cab')
+        $cabinets.Count | Should -BeGreaterThan 1
+
+        # Starting from the last volume still lists the whole set.
+        $content = @(Get-CabinetContent -Path ($cabinets | Sort-Object -Property Name | Select-Object -Last 1).FullName)
+        $content.Count | Should -BeGreaterOrEqual 10
+        $content[0].CabinetIndex | Should -Be 1
+
+        foreach ($file in Get-ChildItem -Path $Global:contentSource -Recurse -File) {
+            $relativePath = $file.FullName.Substring($Global:contentSource.Length + 1)
+            $entries = @($content | Where-Object { $_.Name -eq $relativePath })
+            $entries.Count | Should -BeGreaterThan 0
+            $entries | ForEach-Object { $_.Size | Should -Be $file.Length }
+        }
+
+        @($content | Where-Object { $_.Span -ne 'None' }).Count | Should -BeGreaterThan 0
+    }
+
+    It 'Stop listing when the pipeline stops' {
+        $first = Get-CabinetContent -Path (Join-Path -Path $Global:contentDestination -ChildPath 'Content01.cab') | Select-Object -First 1
+        $first.Name | Should -Not -BeNullOrEmpty
+        $first.Cabinet | Should -Be 'Content01.cab'
+    }
+}
@@ -0,0 +1,143 @@
+BeforeAll {
+    . "$PSScriptRoot\CabinetTestHelpers.ps1"
+
+    # Random files are stored as is, text files compress. Small enough to get many folders with a small 'MaxCabSize'.
+    function New-CabinetSource {
+
+        [CmdletBinding()]
+        param (
+            [Parameter(Mandatory)]
+            [string]$Path
+        )
+
+        $source = New-RandomFiles -Path $Path -Count 40 -Size 20000
+        $subFolder = (New-Item -Path (Join-Path -Path $source -ChildPath 'Sub Folder') -ItemType Directory).FullName
+        for ($i = 0; $i -lt 40; $i++) {
+            [System.IO.File]::WriteAllText((Join-Path -Path $subFolder -ChildPath "Text$i.txt"), ("Line $i of the cabinet test. " * (100 * $i)))
+        }
+
+        [System.IO.File]::WriteAllText((Join-Path -Path $subFolder -ChildPath 'Empty.txt'), '')
+
+        return $source
+    }
+
+    function Test-CabinetContent {
+
+        [CmdletBinding()]
+        param (
+            [Parameter(Mandatory)]
+            [string]$Source,
+
+            [Parameter(Mandatory)]
+            [string]$CabinetPath,
+
+            [Parameter(Mandatory)]
+            [string]$Destination
+        )
+
+        $Destination = (New-Item -Path $Destination -ItemType Directory -Force).FullName
+        Expand-Cabinet -Path $CabinetPath -Destination $Destination
+
+        $compliant = $true
+        foreach ($file in Get-ChildItem -Path $Source -Recurse -File) {
+            $expanded = Join-Path -Path $Destination -ChildPath $file.FullName.Substring($Source.Length)
+            $compliant = $compliant -band ([System.IO.File]::Exists($expanded) -and (Get-FileHash -Path $expanded).Hash -eq (Get-FileHash -Path $file.FullName).Hash)
+        }
+
+        return $compliant
+    }
+
+    $Global:cabSource = New-CabinetSource -Path (Join-Path -Path $TestDrive -ChildPath 'Source')
+}
+
+Describe 'New-Cabinet' {
+    It 'Create a cabinet with MSZip compression' {
+        $destination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Single') -ItemType Directory).FullName
+        New-Cabinet -Path $Global:cabSource -Destination $destination -NamePrefix 'Single'
+
+        Test-CabinetContent -Source $Global:cabSource -CabinetPath (Join-Path -Path $destination -ChildPath 'Single01.cab') -Destination (Join-Path -Path $TestDrive -ChildPath 'SingleExpanded') | Should -Be $true
+    }
+
+    It "Create the same cabinet in parallel with 'ThrottleLimit'" {
+        $serialDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Serial') -ItemType Directory).FullName
+        $parallelDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Parallel') -ItemType Directory).FullName
+        New-Cabinet -Path $Global:cabSource -Destination $serialDestination -NamePrefix 'Split' -MaxCabSize 200
+        New-Cabinet -Path $Global:cabSource -Destination $parallelDestination -NamePrefix 'Split' -MaxCabSize 200 -ThrottleLimit 4
+
+        $serial = @(Get-ChildItem -Path $serialDestination -Filter '*.cab' | Sort-Object -Property Name)
+        $parallel = @(Get-ChildItem -Path $parallelDestination -Filter '*.cab' | Sort-Object -Property Name)
+        $parallel.Count | Should -BeGreaterThan 1
+        $parallel.Count | Should -Be $serial.Count
+        for ($i = 0; $i -lt $serial.Count; $i++) {
+            $parallel[$i].Length | Should -BeLessOrEqual (200 * 1024)
+            (Get-FileHash -Path $parallel[$i].FullName).Hash | Should -Be (Get-FileHash -Path $serial[$i].FullName).Hash
+        }
+
+        Test-CabinetContent -Source $Global:cabSource -CabinetPath $parallel[0].FullName -Destination (Join-Path -Path $TestDrive -ChildPath 'ParallelExpanded') | Should -Be $true
+    }
+
+    It "Create an uncompressed cabinet in parallel with 'ThrottleLimit'" {
+        $destination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'None') -ItemType Directory).FullName
+        New-Cabinet -Path $Global:cabSource -Destination $destination -NamePrefix 'None' -CompressionType None -ThrottleLimit 4
+
+        Test-CabinetContent -Source $Global:cabSource -CabinetPath (Join-Path -Path $destination -ChildPath 'None01.cab') -Destination (Join-Path -Path $TestDrive -ChildPath 'NoneExpanded') | Should -Be $true
+    }
+
+    It "Store identical files once with 'Deduplicate'" {
+        $source = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'DedupSource') -ItemType Directory).FullName
+        $content = [byte[]]::new(100000)
+        [System.Random]::new(42).NextBytes($content)
+        foreach ($folder in 'First', 'Second', 'Third') {
+            $path = (New-Item -Path (Join-Path -Path $source -ChildPath $folder) -ItemType Directory).FullName
+            [System.IO.File]::WriteAllBytes((Join-Path -Path $path -ChildPath 'Driver.dll'), $content)
+        }
+
+        $content[0] = $content[0] -bxor 0xFF
+        [System.IO.File]::WriteAllBytes((Join-Path -Path $source -ChildPath 'Different.dll'), $content)
+
+        $plainDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Plain') -ItemType Directory).FullName
+        $dedupDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Dedup') -ItemType Directory).FullName
+        New-Cabinet -Path $source -Destination $plainDestination -NamePrefix 'Plain'
+        New-Cabinet -Path $source -Destination $dedupDestination -NamePrefix 'Dedup' -Deduplicate -ThrottleLimit 4
+
+        # Random data doesn't compress, two of the four copies are gone.
+        $dedupCabinet = Join-Path -Path $dedupDestination -ChildPath 'Dedup01.cab'
+        (Get-Item -Path $dedupCabinet).Length | Should -BeLessThan ((Get-Item -Path (Join-Path -Path $plainDestination -ChildPath 'Plain01.cab')).Length - 190000)
+        (Test-Cabinet -Path $dedupCabinet).IsValid | Should -BeTrue
+
+        Test-CabinetContent -Source $source -CabinetPath $dedupCabinet -Destination (Join-Path -Path $TestDrive -ChildPath 'DedupExpanded') | Should -Be $true
+    }
+
+    It "Add new and changed files to a cabinet with 'Update'" {
+        $source = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'UpdateSource') -ItemType Directory).FullName
+        for ($i = 0; $i -lt 10; $i++) {
+            [System.IO.File]::WriteAllText((Join-Path -Path $source -ChildPath "Text$i.txt"), ("Line $i of the update test. " * (100 * ($i + 1))))
+        }
+
+        $destination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Update') -ItemType Directory).FullName
+        New-Cabinet -Path $source -Destination $destination -NamePrefix 'Update'
+
+        $cabinet = Join-Path -Path $destination -ChildPath 'Update01.cab'
+        $before = [System.IO.File]::ReadAllBytes($cabinet)
+
+        # One changed in place, one new in a new directory.
+        Start-Sleep -Milliseconds 50
+        [System.IO.File]::AppendAllText((Join-Path -Path $source -ChildPath 'Text3.txt'), 'Changed.')
+        $subFolder = (New-Item -Path (Join-Path -Path $source -ChildPath 'Sub Folder') -ItemType Directory).FullName
+        [System.IO.File]::WriteAllText((Join-Path -Path $subFolder -ChildPath 'New.txt'), 'New file.')
+
+        New-Cabinet -Path $source -Destination $destination -NamePrefix 'Update' -Update
+
+        # The existing data is still where it was.
+        $after = [System.IO.File]::ReadAllBytes($cabinet)
+        $firstData = [System.BitConverter]::ToUInt32($before, 36)
+        $oldSize = [System.BitConverter]::ToUInt32($before, 8)
+        [System.Linq.Enumerable]::SequenceEqual([byte[]]$before[$firstData..($oldSize - 1)], [byte[]]$after[$firstData..($oldSize - 1)]) | Should -BeTrue
+
+        $content = Get-CabinetContent -Path $cabinet
+        $content.Count | Should -Be 11
+        (Test-Cabinet -Path $cabinet).IsValid | Should -BeTrue
+
+        Test-CabinetContent -Source $source -CabinetPath $cabinet -Destination (Join-Path -Path $TestDrive -ChildPath 'UpdateExpanded') | Should -Be $true
+    }
+}
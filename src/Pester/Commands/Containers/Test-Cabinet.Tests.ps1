@@ -0,0 +1,34 @@
+BeforeAll {
+    . "$PSScriptRoot\CabinetTestHelpers.ps1"
+
+    $Global:testSource = New-RandomFiles -Path (Join-Path -Path $TestDrive -ChildPath 'Source') -Count 10 -Size 100000
+
+    $Global:testDestination = (New-Item -Path (Join-Path -Path $TestDrive -ChildPath 'Cabinet') -ItemType Directory).FullName
+    New-Cabinet -Path $Global:testSource -Destination $Global:testDestination -NamePrefix 'Test' -CompressionType MSZip
+    $Global:testCabinet = (Get-ChildItem -Path $Global:testDestination -Filter '*.cab' | Select-Object -First 1).FullName
+}
+
+Describe 'Test-Cabinet' {
+    It 'Verify a valid cabinet' {
+        $result = Test-Cabinet -Path $Global:testCabinet -ThrottleLimit 4
+        $result.IsValid | Should -BeTrue
+        $result.FileCount | Should -Be 10
+        $result.UncompressedSize | Should -Be 1000000
+        $result.BlockCount | Should -BeGreaterThan 0
+    }
+
+    It 'Report the first corrupt block' {
+        $corrupt = Join-Path -Path $TestDrive -ChildPath 'Corrupt.cab'
+        $bytes = [System.IO.File]::ReadAllBytes($Global:testCabinet)
+
+        # Random data is stored as is, so the last bytes are in the last block of the last folder.
+        $bytes[$bytes.Length - 10] = $bytes[$bytes.Length - 10] -bxor 0xFF
+        [System.IO.File]::WriteAllBytes($corrupt, $bytes)
+
+        $result = Test-Cabinet -Path $corrupt
+        $result.IsValid | Should -BeFalse
+        $result.Errors.Count | Should -Be 1
+        $result.Errors[0].Cabinet | Should -Be 'Corrupt.cab'
+        $result.Errors[0].BlockIndex | Should -BeGreaterThan 0
+    }
+}
@@ -0,0 +1,40 @@
+Describe 'Start-Tcping' {
+    BeforeAll {
+        $listeners = 1..2 | ForEach-Object {
+            $listener = [System.Net.Sockets.TcpListener]::new([System.Net.IPAddress]::Loopback, 0)
+            $listener.Start()
+            $listener
+        }
+        $ports = $listeners | ForEach-Object { $_.LocalEndpoint.Port }
+    }
+
+    AfterAll {
+        $listeners | ForEach-Object { $_.Stop() }
+    }
+
+    It 'Probes many ports at the same time' {
+        $result = Start-Tcping '127.0.0.1' -Port $ports -Count 3 -Parallel
+        $probes = $result | Where-Object { $_ -is [WindowsUtils.Network.TcpingProbeInfo] }
+        $statistics = $result | Where-Object { $_ -is [WindowsUtils.Network.TcpingStatistics] }
+
+        $probes | Should -HaveCount 6
+        $probes.Status | Should -Not -Contain 'Timeout'
+        $statistics | Should -HaveCount 2
+        $statistics.Port | Sort-Object | Should -Be ($ports | Sort-Object)
+        $statistics | ForEach-Object { $_.Succeeded | Should -Be 3 }
+    }
+
+    It 'Reports ordered percentiles' {
+        $statistics = Start-Tcping '127.0.0.1' -Port $ports[0] -Count 5 -Interval 1 |
+            Where-Object { $_ -is [WindowsUtils.Network.TcpingStatistics] }
+
+        $statistics.Succeeded | Should -Be 5
+        $statistics.P50Rtt | Should -Not -BeNullOrEmpty
+        $statistics.P90Rtt | Should -BeGreaterOrEqual $statistics.P50Rtt
+        $statistics.P99Rtt | Should -BeGreaterOrEqual $statistics.P90Rtt
+        # Recorded to the microsecond.
+        $statistics.P99Rtt | Should -BeLessOrEqual ($statistics.MaxRtt + 0.001)
+        $statistics.Percentiles | Should -Match '^p50: \d+[.,]\d{2}, p90: \d+[.,]\d{2}, p99: \d+[.,]\d{2}, p99\.9: \d+[.,]\d{2}$'
+        $statistics.Interarrival | Should -Match '^Jitter: \d+[.,]\d{2}$'
+    }
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+Describe 'Test-Port' {
+    BeforeAll {
+        $listener = [System.Net.Sockets.TcpListener]::new([System.Net.IPAddress]::Loopback, 0)
+        $listener.Start()
+        $openPort = $listener.LocalEndpoint.Port
+
+        # Nothing listens on a port we just had and gave back.
+        $closedListener = [System.Net.Sockets.TcpListener]::new([System.Net.IPAddress]::Loopback, 0)
+        $closedListener.Start()
+        $closedPort = $closedListener.LocalEndpoint.Port
+        $closedListener.Stop()
+    }
+
+    AfterAll {
+        $listener.Stop()
+    }
+
+    It 'Tests a TCP port' {
+        (Test-Port '127.0.0.1' -TcpPort $openPort).Status | Should -Be 'Open'
+    }
+
+    It 'Scans TCP ports' {
+        $result = Test-Port '127.0.0.1' -TcpPort $openPort, $closedPort -Scan -Timeout 5
+        $result | Should -HaveCount 2
+        ($result | Where-Object Port -EQ $openPort).Status | Should -Be 'Open'
+        ($result | Where-Object Port -EQ $closedPort).Status | Should -Not -Be 'Open'
+    }
+
+    It 'Scans more ports than connections in flight' {
+        $result = Test-Port '127.0.0.1' -TcpPort (, $openPort * 10) -Scan -ThrottleLimit 3
+        $result | Should -HaveCount 10
+        $result.Status | Should -Not -Contain 'Timeout'
+    }
+}
\ No newline at end of file
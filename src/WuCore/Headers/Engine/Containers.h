@@ -1,8 +1,11 @@
 #pragma once
 #pragma unmanaged
 
+#include <deque>
 #include <memory>
+#include <vector>
 #include <variant>
+#include <algorithm>
 
 #include <fci.h>
 #include <fdi.h>
@@ -13,14 +16,26 @@
 #include <strsafe.h>
 
 #include "../Support/WuString.h"
+#include "../Support/CoreUtils.h"
 #include "../Support/Expressions.h"
 #include "../Support/Notification.h"
 #include "../Support/IO.h"
 #include "../Support/WuException.h"
+#include "../Support/SafeHandle.h"
+#include "../Support/WriteBackQueue.h"
+#include "../Support/DirectoryCache.h"
+#include "../Support/TempStore.h"
+#include "../Support/BufferPool.h"
+#include "../Support/Cabinet/CabinetReader.h"
+#include "../Support/Cabinet/CabinetIndexFile.h"
+#include "../Support/Cabinet/CabinetWriter.h"
+#include "../Support/Cabinet/SourcePrefetcher.h"
 
-constexpr WORD cfhdrPREV_CABINET     = 0x0001;
-constexpr WORD cfhdrNEXT_CABINET     = 0x0002;
-constexpr WORD cfhdrRESERVE_PRESENT  = 0x0004;
+// Memory the native cabinet creation keeps compressed folders in, before spilling them to disk.
+constexpr LONG64 CAB_CREATE_MEMORY_BUDGET = 0x8000000;    // 128 MiB.
+
+// Memory the extraction to the pipeline keeps decoded files in, until the Cmdlet writes them.
+constexpr __uint64 CAB_EXPAND_MEMORY_BUDGET = 0x8000000;    // 128 MiB.
 
 namespace WindowsUtils::Core
 {
@@ -38,42 +53,116 @@ namespace WindowsUtils::Core
 		LZXHigh  = tcompTYPE_LZX | tcompLZX_WINDOW_HI
 	};
 
-	struct FDIProgress
+	// How a file entry spans the volumes of a set.
+	enum class CabinetFileSpan : WORD
+	{
+		None,
+		ContinuedFromPrevious,
+		ContinuedToNext,
+		ContinuedPreviousAndNext,
+	};
+
+	// Output of 'Get-CabinetContent'. One for each CFFILE entry, in the order they're stored.
+	// Files spanning volumes have one entry in each volume they're stored in.
+	typedef struct _CABINET_FILE_ENTRY_INFO
+	{
+		WWuString        Name;            // Relative path, with '\' separators.
+		DWORD            Size;
+		WORD             Date;
+		WORD             Time;
+		WORD             Attributes;
+		WORD             FolderIndex;     // In the volume, with the continuation values resolved.
+		DWORD            FolderOffset;
+		WWuString        Cabinet;         // Name of the volume the entry is in.
+		WORD             CabinetIndex;    // One-based position of the volume in the set.
+		CabinetFileSpan  Span;
+
+	} CABINET_FILE_ENTRY_INFO, *PCABINET_FILE_ENTRY_INFO;
+
+	// Output of 'Expand-Cabinet' with 'InMemory'. 'Data' is only valid while the object is being written.
+	typedef struct _CABINET_FILE_CONTENT_INFO
+	{
+		WWuString    Name;            // Relative path, with '\' separators.
+		DWORD        Size;
+		WORD         Date;
+		WORD         Time;
+		WORD         Attributes;
+		WWuString    Cabinet;         // Name of the volume the folder starts in.
+		const BYTE*  Data;
+
+	} CABINET_FILE_CONTENT_INFO, *PCABINET_FILE_CONTENT_INFO;
+
+	// First corrupt block of a folder, found by 'Test-Cabinet'.
+	typedef struct _CABINET_FOLDER_ERROR_INFO
+	{
+		DWORD      FolderIndex;     // In the set, folders continued across volumes count once.
+		DWORD      BlockIndex;      // Decoded blocks from the start of the folder. Past the last block for size mismatches.
+		WWuString  Cabinet;         // Name of the volume the block is in.
+		int        ErrorCode;
+		WWuString  Message;
+
+	} CABINET_FOLDER_ERROR_INFO, *PCABINET_FOLDER_ERROR_INFO;
+
+	// Output of 'Test-Cabinet'. One for each cabinet set.
+	typedef struct _CABINET_TEST_INFO
 	{
-		DWORD      CabinetSetCount;
-		DWORD      CompletedCabinetCount;
-		WWuString  CabinetName;
-		WWuString  CurrentFile;
-		DWORD      CurrentUncompressedSize;
-		__uint64   CompletedSize;
-		__uint64   TotalUncompressedSize;
+		WWuString                          Path;                  // First volume of the set.
+		DWORD                              CabinetCount;
+		DWORD                              FolderCount;
+		DWORD                              FileCount;
+		DWORD                              SkippedFolderCount;    // Compression types we can't decode.
+		__uint64                           BlockCount;
+		__uint64                           UncompressedSize;      // Bytes decoded.
+		double                             ElapsedMilliseconds;
+		WuList<CABINET_FOLDER_ERROR_INFO>  Errors;                // By folder index.
+
+	} CABINET_TEST_INFO, *PCABINET_TEST_INFO;
 
+	// Expansion progress. The container is the cabinet the current file comes from.
+	struct FDIProgress : public ProgressAggregator
+	{
 		FDIProgress(const WuNativeContext* context, const DWORD cabSetCount, const __uint64 totalUncSize);
 		~FDIProgress();
 
-		void Notify();
+		// Accounts for an expanded file. Thread safe.
+		void ReportFile(const WWuString& cabinetName, const DWORD cabinetIndex, const WWuString& file, const DWORD size);
 
-	private:
-		const WuNativeContext* m_context;
+	protected:
+		MAPPED_PROGRESS_DATA GetProgressData(const PROGRESS_STATE& state) const override;
 	};
 
-	struct FCIProgress
+	// Compression progress. The container is the cabinet being written.
+	struct FCIProgress : public ProgressAggregator
 	{
-		WWuString  CabinetName;
-		WWuString  CurrentFile;
-		DWORD      CompletedFileCount;
-		DWORD      TotalFileCount;
-		__uint64   CurrentUncompressedSize;
-		__uint64   CompletedSize;
-		__uint64   TotalUncompressedSize;
-
 		FCIProgress(const WuNativeContext* context, const DWORD totalFileCount, const __uint64 totalUncSize);
 		~FCIProgress();
 
-		void Notify();
+	protected:
+		MAPPED_PROGRESS_DATA GetProgressData(const PROGRESS_STATE& state) const override;
+	};
+
+	// Verification progress. Items are folders.
+	struct CabinetTestProgress : public ProgressAggregator
+	{
+		CabinetTestProgress(const WuNativeContext* context, const DWORD folderCount, const __uint64 totalUncSize);
+		~CabinetTestProgress();
+
+	protected:
+		MAPPED_PROGRESS_DATA GetProgressData(const PROGRESS_STATE& state) const override;
+	};
+
+	// 'Include' and 'Exclude' wildcards. Patterns with a '\' match the path relative to the cabinet, the others the file name.
+	// A file is selected if it matches any 'Include', or there are none, and no 'Exclude'.
+	struct CabinetFileFilter
+	{
+		WuList<WWuString> Include;
+		WuList<WWuString> Exclude;
+
+		bool IsEmpty() const;
+		bool IsMatch(const WWuString& relativePath) const;
 
 	private:
-		const WuNativeContext* m_context;
+		static bool MatchesAny(const WuList<WWuString>& patterns, const WWuString& relativePath, const WWuString& fileName);
 	};
 
 	struct CabinetOperationInfo
@@ -81,6 +170,8 @@ namespace WindowsUtils::Core
 		struct FDI
 		{
 			FDIProgress* Progress;
+			const CabinetFileFilter* Filter;
+			DirectoryCache* Directories;
 			WWuString NextCabinet;
 		};
 
@@ -88,40 +179,154 @@ namespace WindowsUtils::Core
 		{
 			FCIProgress* Progress;
 			const WWuString* NameTemplate;
+			TempStore* TempFiles;
+			SourcePrefetcher* Sources;
 		};
 
 		const CabinetOperation Operation;
 		const WWuString* Destination;
 		std::variant<FDI, FCI> Info;
 
-		CabinetOperationInfo(const WWuString* destination, FDIProgress* progress);
-		CabinetOperationInfo(const WWuString* destination, FCIProgress* progress, const WWuString* nameTemplate);
+		CabinetOperationInfo(const WWuString* destination, FDIProgress* progress, const CabinetFileFilter* filter, DirectoryCache* directories);
+		CabinetOperationInfo(const WWuString* destination, FCIProgress* progress, const WWuString* nameTemplate, TempStore* tempFiles, SourcePrefetcher* sources);
 		~CabinetOperationInfo();
 	};
 
-	struct CabinetProcessingInfo
+	// Files selected in each folder of a set, by offset.
+	typedef std::vector<std::vector<const CABINET_FILE_INFO*>> CABINET_FOLDER_SELECTION;
+
+	// Shared by the workers of a native extraction.
+	// Workers claim folders from 'FolderOrder' until there are none left, or one of them fails.
+	// Folders without selected files are not in 'FolderOrder'.
+	typedef struct _CABINET_EXPAND_DATA
+	{
+		const CabinetSet*             Set;
+		const CabinetSetIndex*        Index;
+		DirectoryCache*               Directories;
+		FDIProgress*                  Progress;
+		CABINET_FOLDER_SELECTION      FolderFiles;
+		std::vector<size_t>           FolderOrder;
+		volatile LONG                 NextFolder;
+		volatile LONG                 IsCancelled;
+		SRWLOCK                       ErrorLock;
+		std::unique_ptr<WuException>  Error;
+
+	} CABINET_EXPAND_DATA, *PCABINET_EXPAND_DATA;
+
+	// A file decoded to memory, waiting for the thread running the Cmdlet to write it.
+	typedef struct _CABINET_MEMORY_FILE
+	{
+		const CABINET_FILE_INFO*        Info;
+		const CabinetVolume*            Volume;
+		DWORD                           VolumeIndex;
+		std::unique_ptr<POOLED_BUFFER>  Buffer;
+
+	} CABINET_MEMORY_FILE, *PCABINET_MEMORY_FILE;
+
+	// Shared by the workers of an extraction to memory.
+	// Workers claim folders like the extraction to disk, and queue each file in 'Ready' when it's complete.
+	// The thread running the Cmdlet writes them, and gives the buffers back to 'Buffers'.
+	typedef struct _CABINET_MEMORY_EXPAND_DATA
+	{
+		const CabinetSet*                Set;
+		const CabinetSetIndex*           Index;
+		BufferPool*                      Buffers;
+		CABINET_FOLDER_SELECTION         FolderFiles;
+		std::vector<size_t>              FolderOrder;
+		SRWLOCK                          ReadyLock;
+		std::deque<CABINET_MEMORY_FILE>  Ready;
+		HANDLE                           ReadyEvent;
+		volatile LONG                    ActiveWorkers;
+		volatile LONG                    NextFolder;
+		volatile LONG                    IsCancelled;
+		SRWLOCK                          ErrorLock;
+		std::unique_ptr<WuException>     Error;
+
+	} CABINET_MEMORY_EXPAND_DATA, *PCABINET_MEMORY_EXPAND_DATA;
+
+	// Shared by the workers of a native cabinet creation.
+	// Workers claim folders in order, and the thread running the Cmdlet writes them to the volumes in the same order.
+	// 'SlotSemaphore' limits how many folders can be compressed and not yet written.
+	typedef struct _CABINET_CREATE_DATA
 	{
-		WWuString  Name;
-		WWuString  Path;
-		WORD       CabinetIndex;
-		WORD       FileCount;
-		DWORD      CFFileOffset;
-		WuString   PreviousCabinet;
-		WuString   NextCabinet;
+		std::vector<CABINET_PLANNED_FOLDER>*  Folders;
+		const WWuString*                      Destination;
+		WORD                                  CompressionType;
+		HANDLE                                SlotSemaphore;
+		HANDLE                                FolderDoneEvent;
+		volatile LONG                         NextFolder;
+		volatile LONG                         IsCancelled;
+		volatile LONG64                       CompletedSize;
+		volatile LONG64                       MemoryBudget;
+		SRWLOCK                               ErrorLock;
+		std::unique_ptr<WuException>          Error;
+
+	} CABINET_CREATE_DATA, *PCABINET_CREATE_DATA;
+
+	// What a worker of 'Test-Cabinet' found in a folder.
+	typedef struct _CABINET_FOLDER_TEST_RESULT
+	{
+		bool                       IsSkipped;
+		bool                       HasError;
+		DWORD                      BlockCount;
+		__uint64                   UncompressedSize;
+		CABINET_FOLDER_ERROR_INFO  Error;
+
+	} CABINET_FOLDER_TEST_RESULT, *PCABINET_FOLDER_TEST_RESULT;
+
+	// Shared by the workers of 'Test-Cabinet'. Each worker writes only the results of the folders it claims.
+	typedef struct _CABINET_TEST_DATA
+	{
+		const CabinetSet*                        Set;
+		CabinetTestProgress*                     Progress;
+		std::vector<size_t>                      FolderOrder;
+		std::vector<CABINET_FOLDER_TEST_RESULT>  Results;
+		volatile LONG                            NextFolder;
+		volatile LONG                            IsCancelled;
+		SRWLOCK                                  ErrorLock;
+		std::unique_ptr<WuException>             Error;
+
+	} CABINET_TEST_DATA, *PCABINET_TEST_DATA;
+
+	// A file being written by the native extraction.
+	struct CabinetOutputFile
+	{
+		const CABINET_FILE_INFO*        Info;
+		WWuString                       FullPath;
+		std::unique_ptr<WriteBackFile>  Writer;
 	};
 
 	class Containers
 	{
 	public:
-		static void ExpandCabinetFile(const WWuString& path, const WWuString& destination, const WuNativeContext* context);
+		static void ExpandCabinetFile(const WWuString& path, const WWuString& destination, const CabinetFileFilter& filter, const DWORD throttleLimit, const bool useIndex, const WuNativeContext* context);
+		static void ExpandCabinetToMemory(const WWuString& path, const CabinetFileFilter& filter, const DWORD throttleLimit, const bool useIndex, const WuNativeContext* context);
+		static void ListCabinetContent(const WWuString& path, const WuNativeContext* context);
+		static void TestCabinetFile(const WWuString& path, const DWORD throttleLimit, const WuNativeContext* context);
 		static void CreateCabinetFile(AbstractPathTree& apt, const WWuString& destination, const WWuString& nameTemplate,
-			const CabinetCompressionType compressionType, ULONG splitSize, const WuNativeContext* context);
+			const CabinetCompressionType compressionType, ULONG splitSize, const DWORD throttleLimit, const bool deduplicate, const WuNativeContext* context);
+		static void UpdateCabinetFile(AbstractPathTree& apt, const WWuString& destination, const WWuString& nameTemplate,
+			const CabinetCompressionType compressionType, const DWORD throttleLimit, const WuNativeContext* context);
 
 	private:
-		static std::tuple<__uint64, WWuString> GetCabinetTotalUncompressedSize(const WWuString& path, const WWuString& directory, WuList<CabinetProcessingInfo>& cabInfoList);
-		static CabinetProcessingInfo GetCabinetInformation(const MemoryMappedFile& mappedFile);
-		static bool TryGetInfoByPath(const WWuString& path, const WuList<CabinetProcessingInfo>& list, CabinetProcessingInfo& info);
-		static bool TryGetInfoByName(const WWuString& name, const WuList<CabinetProcessingInfo>& list, CabinetProcessingInfo& info);
+		static void ExpandCabinetSet(const CabinetSet& cabinetSet, const CabinetSetIndex& index, CABINET_FOLDER_SELECTION& folderFiles, DirectoryCache& directories, const DWORD throttleLimit, FDIProgress& progress);
+		static __uint64 SelectFiles(const CabinetSet& cabinetSet, const CabinetFileFilter& filter, CABINET_FOLDER_SELECTION& folderFiles);
+		static DWORD WINAPI ExpandFolderWorker(LPVOID params);
+		static void ExpandFolder(const size_t folderIndex, CABINET_EXPAND_DATA& expandData, WriteBackQueue& writeBack);
+		static void CloseOutputFile(CabinetOutputFile& file, WriteBackQueue& writeBack, const CabinetVolume& volume, const DWORD volumeIndex, FDIProgress& progress);
+		static WWuString CreateTargetPath(const WWuString& relativePath, DirectoryCache& directories);
+
+		static DWORD WINAPI ExpandFolderToMemoryWorker(LPVOID params);
+		static void ExpandFolderToMemory(const size_t folderIndex, CABINET_MEMORY_EXPAND_DATA& expandData);
+		static void WriteMemoryFiles(CABINET_MEMORY_EXPAND_DATA& expandData, FDIProgress& progress, const WuNativeContext* context);
+
+		static DWORD WINAPI TestFolderWorker(LPVOID params);
+		static void TestFolder(const size_t folderIndex, CABINET_TEST_DATA& testData);
+
+		static void CreateCabinetSet(std::vector<CABINET_PLANNED_FOLDER>& folders, CabinetFolderWriter& writer, const WWuString& destination,
+			const CabinetCompressionType compressionType, const DWORD throttleLimit, FCIProgress& progress);
+		static DWORD WINAPI CompressFolderWorker(LPVOID params);
+		static bool IsSourceChanged(const WWuString& path, const CABINET_FILE_INFO& stored, const FILETIME& cabinetWriteTime);
 
 		static INT_PTR OnCabinetInfo(PFDINOTIFICATION cabInfo);
 		static INT_PTR OnCopyFile(PFDINOTIFICATION cabInfo);
@@ -136,6 +341,11 @@ namespace WindowsUtils::Core
 		static long __cdecl CabSeek(INT_PTR hf, long dist, int seektype);
 		static INT_PTR __cdecl CabNotify(FDINOTIFICATIONTYPE fdint, PFDINOTIFICATION pfdin);
 
+		static INT_PTR __cdecl FciOpen(char* pszFile, int oflag, int pmode, int* err, void* pv);
+		static UINT __cdecl FciRead(INT_PTR hf, void* memory, UINT cb, int* err, void* pv);
+		static UINT __cdecl FciWrite(INT_PTR hf, void* memory, UINT cb, int* err, void* pv);
+		static int __cdecl FciClose(INT_PTR hf, int* err, void* pv);
+		static long __cdecl FciSeek(INT_PTR hf, long dist, int seektype, int* err, void* pv);
 		static BOOL __cdecl FciGetTempFile(char* tempName, int cbTemp, void* pv);
 		static int __cdecl FciFilePlaced(PCCAB pccab, char* fileName, long cbFile, BOOL isContinuation, void* pv);
 		static int __cdecl FciDelete(char* fileName, int* err, void* pv);
@@ -10,6 +10,9 @@
 #include "../Support/SafeHandle.h"
 #include "../Support/IO.h"
 #include "../Support/WuException.h"
+#include "../Support/SpscRing.h"
+#include "../Support/TimerWheel.h"
+#include "../Support/LatencyHistogram.h"
 
 #include <WinSock2.h>
 #include <ws2def.h>
@@ -17,16 +20,24 @@
 #include <iphlpapi.h>
 #include <ip2string.h>
 #include <unordered_map>
-#include <queue>
+#include <deque>
 #include <memory>
+#include <vector>
 #include <WinDNS.h>
 #include <lmcons.h>
 #include <LMShare.h>
 #include <lmerr.h>
 #include <LMAPIbuf.h>
 #include <WS2tcpip.h>
+#include <MSWSock.h>
 #include <cmath>
 
+constexpr ULONG TCPING_QUEUE_CAPACITY       = 64;     // Outputs the probe worker can get ahead of the printing thread.
+constexpr DWORD TCPING_COMPLETION_THREADS   = 2;      // Completions are cheap, a couple of threads keep up with hundreds of targets.
+constexpr DWORD TCPING_WHEEL_SLOTS          = 512;
+constexpr DWORD TCPING_WHEEL_TICK           = 10;     // Milliseconds. With 512 slots the wheel turns every ~5 seconds.
+constexpr ULONG TESTPORT_SCAN_BATCH         = 64;     // Completions taken from the port at a time.
+
 namespace WindowsUtils::Core
 {
 	/*
@@ -70,6 +81,8 @@ namespace WindowsUtils::Core
 
 	typedef struct _TCPING_STATISTICS
 	{
+		WWuString Destination;
+		DWORD   Port;
 		DWORD   Sent;
 		DWORD   Successful;
 		DWORD   Failed;
@@ -82,12 +95,25 @@ namespace WindowsUtils::Core
 		double  AvgJitter;
 		double  TotalJitter;
 		double  TotalMilliseconds;
+		double  P50Rtt;
+		double  P90Rtt;
+		double  P99Rtt;
+		double  P999Rtt;
+		double  InterarrivalJitter;     // RFC 3550, from one successful probe to the next.
+		double  LastRtt;
+		LatencyHistogram RttHistogram;
 
 		_TCPING_STATISTICS();
 
 		_TCPING_STATISTICS(DWORD sent, DWORD success, DWORD failed, double failPercent, double minRtt, double maxRtt, double avgRtt,
 			double minJitter, double maxJitter, double avgJitter, double totalJitter, double totalMilliseconds);
 
+		// A successful probe. Call after the deviation jitter, it uses the totals before this one.
+		void AddRoundTrip(const double milliseconds);
+
+		// Percentages, averages and percentiles, once probing is done.
+		void Summarize();
+
 	} TCPING_STATISTICS, *PTCPING_STATISTICS;
 
 	typedef struct _TCPING_OUTPUT
@@ -150,7 +176,11 @@ namespace WindowsUtils::Core
 		static inline BOOL WINAPI CtrlHandlerRoutine(DWORD fdwCtrlType);
 		static const bool IsCtrlCHit();
 
+		// Ctrl+C, or the caller stopping the worker.
+		const bool IsCancelled() const;
+
 		WuStopWatch StopWatch;
+		SafeObjectHandle CancelEvent;				// Set on the first Ctrl+C or by the caller, so waits don't have to poll.
 		WCHAR PortAsString[6] = { 0 };
 		WWuString DisplayName;
 		TCPING_STATISTICS Statistics;
@@ -201,10 +231,86 @@ namespace WindowsUtils::Core
 	typedef struct _TCPING_WORKER_DATA
 	{
 		TcpingForm* WorkForm;
-		std::queue<QUEUED_DATA>* Queue;
-		bool IsComplete;
+		SpscRing<QUEUED_DATA>* Queue;
 	} TCPING_WORKER_DATA, * PTCPING_WORKER_DATA;
 
+	// A destination and port probed by the parallel engine, with its probe in flight.
+	typedef struct _TCPING_TARGET
+	{
+		WWuString           Destination;
+		WWuString           DisplayName;
+		DWORD               Port;
+		SOCKADDR_STORAGE    Address;
+		int                 AddressLength;
+		TCPING_STATISTICS   Statistics;
+
+		WSAOVERLAPPED       Overlapped;
+		SOCKET              Socket;         // Guarded by 'Lock', the timer thread cancels it.
+		DWORD               Sequence;       // Guarded by 'Lock'.
+		bool                IsTimedOut;     // Guarded by 'Lock'.
+		ULONGLONG           ProbeStart;
+		WuStopWatch         StopWatch;
+		SRWLOCK             Lock;
+
+	} TCPING_TARGET, *PTCPING_TARGET;
+
+	/// <summary>
+	/// Probes many targets at the same time from a few threads.
+	/// </summary>
+	/// <remarks>
+	/// Connections are started with 'ConnectEx' on overlapped sockets bound to one I/O completion port.
+	/// A timer thread drives a timer wheel with the next probe and the connect timeout of each target,
+	/// and a couple of threads take the completions, update the statistics of the target, and schedule its next probe.
+	/// A target has at most one probe in flight. Probes start every 'SecondsInterval', or right away if the last one took longer.
+	/// Outputs are written by the thread calling 'Run', since that's the one that can talk to PowerShell.
+	/// </remarks>
+	class TcpingEngine
+	{
+	public:
+		TcpingEngine(TcpingForm& workForm, std::vector<TCPING_TARGET>& targets);
+		~TcpingEngine();
+
+		TcpingEngine(const TcpingEngine&) = delete;
+		TcpingEngine& operator=(const TcpingEngine&) = delete;
+
+		// Probes until every target is done, or Ctrl+C. Then writes the statistics, unless 'Single'.
+		void Run(WuNativeContext* context);
+
+	private:
+		enum class TimerKind : DWORD
+		{
+			Probe,
+			Timeout,
+		};
+
+		TcpingForm& m_form;
+		std::vector<TCPING_TARGET>& m_targets;
+		TimerWheel m_wheel;
+		LPFN_CONNECTEX m_connectEx[2];      // IPv4 and IPv6, the pointers can differ between providers.
+		SafeObjectHandle m_port;
+		SafeObjectHandle m_stopEvent;
+		SafeObjectHandle m_wakeEvent;
+		SafeObjectHandle m_outputEvent;
+		SafeObjectHandle m_doneEvent;
+		SafeObjectHandle m_idleEvent;
+		HANDLE m_timerThread;
+		std::vector<HANDLE> m_completionThreads;
+		volatile LONG m_remaining;
+		volatile LONG m_inFlight;
+		volatile LONG m_isStopping;
+
+		SRWLOCK m_outputLock;
+		std::vector<TCPING_OUTPUT> m_outputs;
+
+		static DWORD WINAPI TimerThread(LPVOID params);
+		static DWORD WINAPI CompletionThread(LPVOID params);
+		void StartProbe(const size_t index);
+		void TimeOutProbe(const size_t index, const DWORD sequence);
+		void FinishProbe(const size_t index, const DWORD error, const double milliseconds);
+		void Schedule(const ULONGLONG due, const size_t index, const TimerKind kind, const DWORD sequence);
+		void Stop();
+	};
+
 
 	/*
 	* ~ Get-NetworkFile
@@ -273,6 +379,70 @@ namespace WindowsUtils::Core
 		WCHAR m_portAsString[6];
 	};
 
+	typedef struct _PORT_SCAN_HOST
+	{
+		WWuString         Destination;
+		WWuString         DisplayName;
+		SOCKADDR_STORAGE  Address;          // No port, each probe sets its own.
+		int               AddressLength;
+
+	} PORT_SCAN_HOST, *PPORT_SCAN_HOST;
+
+	/// <summary>
+	/// Tests every port on every host, with a bounded number of connections in flight.
+	/// </summary>
+	/// <remarks>
+	/// Everything runs on the thread calling 'Run'. Connections are started with 'ConnectEx' on overlapped sockets
+	/// bound to one I/O completion port, and results are written as they complete, not in the order they started.
+	/// Every connection has the same timeout, so deadlines expire in the order they were set, and a queue is enough to find
+	/// the ones overdue. Those are cancelled, and come back as timed out. Ports go around the hosts, so one host doesn't get all the connections.
+	/// Sockets are closed with a reset, so a big scan doesn't leave thousands of them in TIME_WAIT.
+	/// </remarks>
+	class PortScanner
+	{
+	public:
+		PortScanner(const std::vector<DWORD>& ports, const DWORD timeoutSec, const DWORD maxInFlight);
+		~PortScanner();
+
+		PortScanner(const PortScanner&) = delete;
+		PortScanner& operator=(const PortScanner&) = delete;
+
+		void AddHost(const WWuString& destination, const WWuString& displayName, const SOCKADDR* address, const int addressLength);
+		void Run(WuNativeContext* context);
+
+	private:
+		typedef struct _PORT_SCAN_PROBE
+		{
+			WSAOVERLAPPED  Overlapped;
+			SOCKET         Socket;
+			size_t         Host;
+			DWORD          Port;
+			DWORD          Sequence;       // So a deadline left from an earlier connection doesn't cancel this one.
+
+		} PORT_SCAN_PROBE, *PPORT_SCAN_PROBE;
+
+		typedef struct _PORT_SCAN_DEADLINE
+		{
+			ULONGLONG  Due;
+			DWORD      Probe;
+			DWORD      Sequence;
+
+		} PORT_SCAN_DEADLINE, *PPORT_SCAN_DEADLINE;
+
+		std::vector<DWORD> m_ports;
+		DWORD m_timeout;
+		std::vector<PORT_SCAN_HOST> m_hosts;
+		std::vector<PORT_SCAN_PROBE> m_probes;
+		std::vector<DWORD> m_freeProbes;
+		std::deque<PORT_SCAN_DEADLINE> m_deadlines;
+		LPFN_CONNECTEX m_connectEx[2];      // IPv4 and IPv6.
+		SafeObjectHandle m_port;
+		DWORD m_inFlight;
+
+		void StartProbe(const size_t host, const DWORD port, WuNativeContext* context);
+		void FinishProbe(const DWORD index, const DWORD error, WuNativeContext* context);
+	};
+
 
 	/*
 	* ~ Get-NetworkStatistics
@@ -338,6 +508,9 @@ namespace WindowsUtils::Core
 
 		static void StartTcpPing(TcpingForm& workForm, WuNativeContext* context);
 
+		// Probes every destination on every port at the same time, with 'TcpingEngine'.
+		static void StartParallelTcpPing(TcpingForm& workForm, const std::vector<WWuString>& destinations, const std::vector<DWORD>& ports, WuNativeContext* context);
+
 		// Get-NetworkFile (PsFile)
 
 		static void ListNetworkFiles(const WWuString& computerName, const WWuString& basePath, const WWuString& userName, WuList<NETWORK_FILE_INFO>& result);
@@ -351,6 +524,9 @@ namespace WindowsUtils::Core
 
 		static void TestNetworkPort(const TestPortForm& workForm, WuNativeContext* context);
 
+		// Tests every TCP port on every destination, with up to 'maxInFlight' connections at a time.
+		static void ScanNetworkPorts(const std::vector<WWuString>& destinations, const std::vector<DWORD>& ports, const DWORD timeoutSec, const DWORD maxInFlight, WuNativeContext* context);
+
 		// Get-NetworkStatistics
 		
 		static void GetTcpTables(bool includeModuleName, WuList<GETNETSTAT_MAIN_OUTPUT>& output, std::unordered_map<DWORD, WWuString>& processList, WuNativeContext* context);
@@ -369,7 +545,7 @@ namespace WindowsUtils::Core
 	private:
 		// Utilities
 		static void PerformSingleTestProbe(ADDRINFOW* singleInfo, TcpingForm* workForm, const WWuString& displayName,
-			PTCPING_STATISTICS statistics, std::queue<QUEUED_DATA>* infoQueue, DWORD& result);
+			PTCPING_STATISTICS statistics, SpscRing<QUEUED_DATA>* infoQueue, DWORD& result);
 
 		static void ProcessStatistics(TcpingForm* workForm, WuNativeContext* context);
 
@@ -10,6 +10,10 @@ namespace WindowsUtils
 	{
 		Expand,
 		Compress,
+		List,
+		Test,
+		ExpandToMemory,
+		Update,
 	};
 }
 
@@ -21,19 +25,54 @@ namespace WindowsUtils::Stubs
 	{
 	public:
 		template <ContainersOperation Operation>
-		static typename std::enable_if<Operation == ContainersOperation::Expand, void>::type Dispatch(const WWuString& path, const WWuString& destination, const WuNativeContext* context)
+		static typename std::enable_if<Operation == ContainersOperation::Expand, void>::type Dispatch(const WWuString& path, const WWuString& destination, const CabinetFileFilter& filter,
+			const DWORD throttleLimit, const bool useIndex, const WuNativeContext* context)
 		{
 			_WU_START_TRY
-				Core::Containers::ExpandCabinetFile(path, destination, context);
+				Core::Containers::ExpandCabinetFile(path, destination, filter, throttleLimit, useIndex, context);
+			_WU_MARSHAL_CATCH(context)
+		}
+
+		template <ContainersOperation Operation>
+		static typename std::enable_if<Operation == ContainersOperation::ExpandToMemory, void>::type Dispatch(const WWuString& path, const CabinetFileFilter& filter,
+			const DWORD throttleLimit, const bool useIndex, const WuNativeContext* context)
+		{
+			_WU_START_TRY
+				Core::Containers::ExpandCabinetToMemory(path, filter, throttleLimit, useIndex, context);
 			_WU_MARSHAL_CATCH(context)
 		}
 
 		template <ContainersOperation Operation>
 		static typename std::enable_if<Operation == ContainersOperation::Compress, void>::type Dispatch(AbstractPathTree& apt, const WWuString& destination, const WWuString& namePrefix,
-			const int maxCabSize, const Core::CabinetCompressionType compressionType, const WuNativeContext* context)
+			const int maxCabSize, const Core::CabinetCompressionType compressionType, const DWORD throttleLimit, const bool deduplicate, const WuNativeContext* context)
+		{
+			_WU_START_TRY
+				Core::Containers::CreateCabinetFile(apt, destination, namePrefix, compressionType, maxCabSize, throttleLimit, deduplicate, context);
+			_WU_MARSHAL_CATCH(context)
+		}
+
+		template <ContainersOperation Operation>
+		static typename std::enable_if<Operation == ContainersOperation::Update, void>::type Dispatch(AbstractPathTree& apt, const WWuString& destination, const WWuString& namePrefix,
+			const Core::CabinetCompressionType compressionType, const DWORD throttleLimit, const WuNativeContext* context)
+		{
+			_WU_START_TRY
+				Core::Containers::UpdateCabinetFile(apt, destination, namePrefix, compressionType, throttleLimit, context);
+			_WU_MARSHAL_CATCH(context)
+		}
+
+		template <ContainersOperation Operation>
+		static typename std::enable_if<Operation == ContainersOperation::List, void>::type Dispatch(const WWuString& path, const WuNativeContext* context)
+		{
+			_WU_START_TRY
+				Core::Containers::ListCabinetContent(path, context);
+			_WU_MARSHAL_CATCH(context)
+		}
+
+		template <ContainersOperation Operation>
+		static typename std::enable_if<Operation == ContainersOperation::Test, void>::type Dispatch(const WWuString& path, const DWORD throttleLimit, const WuNativeContext* context)
 		{
 			_WU_START_TRY
-				Core::Containers::CreateCabinetFile(apt, destination, namePrefix, compressionType, maxCabSize, context);
+				Core::Containers::TestCabinetFile(path, throttleLimit, context);
 			_WU_MARSHAL_CATCH(context)
 		}
 	};
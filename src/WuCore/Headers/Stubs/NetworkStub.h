@@ -9,9 +9,11 @@ namespace WindowsUtils
 	enum class NetworkOperation
 	{
 		Tcping,
+		TcpingParallel,
 		ListFiles,
 		CloseFile,
 		TestPort,
+		ScanPorts,
 		TcpTables,
 		UdpTables,
 		IfStats,
@@ -40,6 +42,14 @@ namespace WindowsUtils::Stubs
 			_WU_MARSHAL_CATCH(context)
 		}
 
+		template <NetworkOperation Opr, std::enable_if_t<Opr == NetworkOperation::TcpingParallel, int> = 0, class... TArgs>
+		static void Dispatch(Core::WuNativeContext* context, TArgs&&... args)
+		{
+			_WU_START_TRY
+				Core::Network::StartParallelTcpPing(std::forward<TArgs>(args)..., context);
+			_WU_MARSHAL_CATCH(context)
+		}
+
 		template <NetworkOperation Opr, std::enable_if_t<Opr == NetworkOperation::ListFiles, int> = 0, class... TArgs>
 		static void Dispatch(Core::WuNativeContext* context, TArgs&&... args)
 		{
@@ -64,6 +74,14 @@ namespace WindowsUtils::Stubs
 			_WU_MARSHAL_CATCH(context)
 		}
 
+		template <NetworkOperation Opr, std::enable_if_t<Opr == NetworkOperation::ScanPorts, int> = 0, class... TArgs>
+		static void Dispatch(Core::WuNativeContext* context, TArgs&&... args)
+		{
+			_WU_START_TRY
+				Core::Network::ScanNetworkPorts(std::forward<TArgs>(args)..., context);
+			_WU_MARSHAL_CATCH(context)
+		}
+
 		template <NetworkOperation Opr, std::enable_if_t<Opr == NetworkOperation::TcpTables, int> = 0, class... TArgs>
 		static void Dispatch(Core::WuNativeContext* context, TArgs&&... args)
 		{
@@ -0,0 +1,56 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <vector>
+
+#include "WuException.h"
+
+constexpr DWORD BUFFER_POOL_GRANULARITY = 0x10000;    // 64 KiB.
+
+namespace WindowsUtils::Core
+{
+	typedef struct _POOLED_BUFFER
+	{
+		std::unique_ptr<BYTE[]>  Data;
+		__uint64                 Capacity;
+
+	} POOLED_BUFFER, *PPOOLED_BUFFER;
+
+	/// <summary>
+	/// Buffers handed out by producer threads and given back by a consumer, with a bound on the memory in use.
+	/// </summary>
+	/// <remarks>
+	/// A request takes the smallest free buffer that fits, or allocates one rounded up to 'BUFFER_POOL_GRANULARITY'.
+	/// Free buffers are dropped when keeping them would go over the budget.
+	/// Producers waiting for room must not hold buffers, otherwise two of them could wait for each other forever.
+	/// Those holding buffers ask without waiting, and the budget can be exceeded by what they're holding.
+	/// A request bigger than the budget is served when no other buffer is in use. Thread safe.
+	/// </remarks>
+	class BufferPool
+	{
+	public:
+		BufferPool(const __uint64 budget);
+		~BufferPool();
+
+		BufferPool(const BufferPool&) = delete;
+		BufferPool& operator=(const BufferPool&) = delete;
+
+		// Returns null if the pool is cancelled while waiting.
+		std::unique_ptr<POOLED_BUFFER> Acquire(const __uint64 size, const bool canWait);
+		void Release(std::unique_ptr<POOLED_BUFFER> buffer);
+
+		// Wakes up the waiting producers, and makes the next requests fail.
+		void Cancel();
+
+	private:
+		__uint64 m_budget;
+		__uint64 m_inUseSize;
+		__uint64 m_freeSize;
+		std::vector<std::unique_ptr<POOLED_BUFFER>> m_free;
+		bool m_isCancelled;
+
+		SRWLOCK m_lock;
+		CONDITION_VARIABLE m_released;
+	};
+}
\ No newline at end of file
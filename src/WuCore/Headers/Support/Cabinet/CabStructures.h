@@ -0,0 +1,108 @@
+#pragma once
+#pragma unmanaged
+
+#include "../Expressions.h"
+
+/*
+*	~ Cabinet file format ~
+*
+*	On-disk layout of a cabinet volume, as described in [MS-CAB].
+*	All values are little-endian and structures are byte-packed.
+*
+*	CFHEADER
+*	[CFHEADER reserved area]
+*	[szCabinetPrev, szDiskPrev]
+*	[szCabinetNext, szDiskNext]
+*	CFFOLDER[cFolders]
+*	CFFILE[cFiles]
+*	CFDATA[...]
+*/
+
+// CFHEADER flags.
+constexpr WORD cfhdrPREV_CABINET     = 0x0001;
+constexpr WORD cfhdrNEXT_CABINET     = 0x0002;
+constexpr WORD cfhdrRESERVE_PRESENT  = 0x0004;
+
+// Special CFFILE folder indexes for files that span cabinets.
+constexpr WORD cffileCONTINUED_FROM_PREV      = 0xFFFD;
+constexpr WORD cffileCONTINUED_TO_NEXT        = 0xFFFE;
+constexpr WORD cffileCONTINUED_PREV_AND_NEXT  = 0xFFFF;
+
+// Compression type mask for CFFOLDER 'typeCompress'.
+constexpr WORD cffoldCOMPTYPE_MASK  = 0x000F;
+
+// Size limits.
+constexpr DWORD CAB_SIGNATURE             = 0x4643534D;          // 'MSCF'.
+constexpr DWORD CAB_MAX_BLOCK_UNCOMPRESSED  = 0x8000;            // 32 KiB.
+constexpr DWORD CAB_MAX_BLOCK_COMPRESSED    = 0x8000 + 6144;     // Block plus worst case codec overhead.
+constexpr DWORD CAB_MAX_FILE_NAME           = 256;
+
+namespace WindowsUtils::Core
+{
+#pragma pack(push, 1)
+
+	// CFHEADER fixed part.
+	typedef struct _CAB_HEADER
+	{
+		DWORD  Signature;
+		DWORD  Reserved1;
+		DWORD  CabinetSize;
+		DWORD  Reserved2;
+		DWORD  FirstFileOffset;
+		DWORD  Reserved3;
+		BYTE   VersionMinor;
+		BYTE   VersionMajor;
+		WORD   FolderCount;
+		WORD   FileCount;
+		WORD   Flags;
+		WORD   SetId;
+		WORD   CabinetIndex;
+
+	} CAB_HEADER, *PCAB_HEADER;
+
+	// Present after CFHEADER when 'cfhdrRESERVE_PRESENT' is set.
+	typedef struct _CAB_HEADER_RESERVE
+	{
+		WORD  HeaderReserveSize;
+		BYTE  FolderReserveSize;
+		BYTE  DataReserveSize;
+
+	} CAB_HEADER_RESERVE, *PCAB_HEADER_RESERVE;
+
+	// CFFOLDER fixed part. Followed by 'FolderReserveSize' bytes.
+	typedef struct _CAB_FOLDER_ENTRY
+	{
+		DWORD  FirstDataOffset;
+		WORD   DataBlockCount;
+		WORD   CompressionType;
+
+	} CAB_FOLDER_ENTRY, *PCAB_FOLDER_ENTRY;
+
+	// CFFILE fixed part. Followed by the null-terminated file name.
+	typedef struct _CAB_FILE_ENTRY
+	{
+		DWORD  UncompressedSize;
+		DWORD  FolderOffset;
+		WORD   FolderIndex;
+		WORD   Date;
+		WORD   Time;
+		WORD   Attributes;
+
+	} CAB_FILE_ENTRY, *PCAB_FILE_ENTRY;
+
+	// CFDATA fixed part. Followed by 'DataReserveSize' bytes and the compressed data.
+	typedef struct _CAB_DATA_BLOCK
+	{
+		DWORD  Checksum;
+		WORD   CompressedSize;
+		WORD   UncompressedSize;
+
+	} CAB_DATA_BLOCK, *PCAB_DATA_BLOCK;
+
+#pragma pack(pop)
+
+	static_assert(sizeof(CAB_HEADER) == 36, "CFHEADER must be 36 bytes.");
+	static_assert(sizeof(CAB_FOLDER_ENTRY) == 8, "CFFOLDER must be 8 bytes.");
+	static_assert(sizeof(CAB_FILE_ENTRY) == 16, "CFFILE must be 16 bytes.");
+	static_assert(sizeof(CAB_DATA_BLOCK) == 8, "CFDATA must be 8 bytes.");
+}
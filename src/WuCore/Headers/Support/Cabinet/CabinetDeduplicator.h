@@ -0,0 +1,58 @@
+#pragma once
+#pragma unmanaged
+
+#include <vector>
+
+#include <bcrypt.h>
+
+#include "../WuString.h"
+#include "../IO.h"
+#include "../WuException.h"
+#include "../SafeHandle.h"
+
+constexpr DWORD CAB_DEDUP_HASH_SIZE  = 32;          // SHA-256.
+constexpr DWORD CAB_DEDUP_READ_SIZE  = 0x100000;    // 1 MiB.
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// Finds the files of a tree with the same content, so a cabinet can store them once.
+	/// </summary>
+	/// <remarks>
+	/// Only files with the same size as another file are read. These are hashed with SHA-256 by a pool of threads,
+	/// and files with the same size and hash are taken as the same. The first one in the tree order is the original.
+	/// Empty files are never duplicates, there's nothing to save.
+	/// Files that can't be read are left alone, the compressor reports them.
+	/// </remarks>
+	class CabinetDeduplicator
+	{
+	public:
+		static constexpr DWORD NotDuplicate = MAXDWORD;
+
+		// For each entry of the tree, the index of the first entry with the same content, or 'NotDuplicate'.
+		static std::vector<DWORD> FindDuplicates(const AbstractPathTree& apt, const DWORD threadCount);
+
+	private:
+		typedef struct _DEDUP_CANDIDATE
+		{
+			DWORD     Index;
+			__uint64  Size;
+			bool      IsHashed;
+			BYTE      Hash[CAB_DEDUP_HASH_SIZE];
+
+		} DEDUP_CANDIDATE, *PDEDUP_CANDIDATE;
+
+		// Shared by the hashing workers, each claims the next candidate.
+		typedef struct _DEDUP_DATA
+		{
+			const AbstractPathTree*        Tree;
+			std::vector<DEDUP_CANDIDATE>*  Candidates;
+			BCRYPT_ALG_HANDLE              Algorithm;
+			volatile LONG                  NextCandidate;
+
+		} DEDUP_DATA, *PDEDUP_DATA;
+
+		static DWORD WINAPI HashWorker(LPVOID params);
+		static bool TryHashFile(const WWuString& path, const BCRYPT_ALG_HANDLE algorithm, BYTE* buffer, BYTE* hash);
+	};
+}
\ No newline at end of file
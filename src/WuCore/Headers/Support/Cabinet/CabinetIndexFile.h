@@ -0,0 +1,108 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <vector>
+
+#include "../WuString.h"
+#include "../IO.h"
+#include "../WuException.h"
+
+#include "CabinetReader.h"
+
+/*
+*	~ Cabinet index file ~
+*
+*	Sidecar file with the parsed layout of a cabinet set, stored next to the cabinet as 'Name.cabidx'.
+*	All values are little-endian and structures are byte-packed.
+*
+*	CAB_INDEX_HEADER
+*	{ CAB_INDEX_VOLUME, WCHAR Name[NameLength] }[VolumeCount]
+*	{ CAB_INDEX_FOLDER, CAB_INDEX_SEGMENT[SegmentCount], { CAB_INDEX_FILE, CHAR Name[NameLength] }[FileCount] }[FolderCount]
+*	DWORD Checksum    // Cabinet checksum of everything before it.
+*/
+
+constexpr DWORD CAB_INDEX_SIGNATURE  = 0x58494357;    // 'WCIX'.
+constexpr DWORD CAB_INDEX_VERSION    = 1;
+
+namespace WindowsUtils::Core
+{
+#pragma pack(push, 1)
+
+	typedef struct _CAB_INDEX_HEADER
+	{
+		DWORD     Signature;
+		DWORD     Version;
+		DWORD     VolumeCount;
+		DWORD     FolderCount;
+		DWORD     FileCount;
+		__uint64  TotalUncompressedSize;
+
+	} CAB_INDEX_HEADER, *PCAB_INDEX_HEADER;
+
+	// What the index was built from. Any difference means the index is stale.
+	typedef struct _CAB_INDEX_VOLUME
+	{
+		__uint64  Size;
+		FILETIME  LastWriteTime;
+		DWORD     HeaderChecksum;    // Over CFHEADER up to the first CFFILE entry.
+		WORD      NameLength;        // In characters.
+
+	} CAB_INDEX_VOLUME, *PCAB_INDEX_VOLUME;
+
+	typedef struct _CAB_INDEX_FOLDER
+	{
+		__uint64  UncompressedSize;
+		__uint64  Offset;             // Of the folder's first byte in the set's uncompressed data.
+		DWORD     FileCount;
+		WORD      CompressionType;
+		WORD      SegmentCount;
+
+	} CAB_INDEX_FOLDER, *PCAB_INDEX_FOLDER;
+
+	typedef struct _CAB_INDEX_SEGMENT
+	{
+		DWORD  FirstDataOffset;
+		WORD   VolumeIndex;
+		WORD   FolderIndex;
+
+	} CAB_INDEX_SEGMENT, *PCAB_INDEX_SEGMENT;
+
+	typedef struct _CAB_INDEX_FILE
+	{
+		DWORD  Size;
+		DWORD  FolderOffset;
+		WORD   FolderIndex;
+		WORD   Date;
+		WORD   Time;
+		WORD   Attributes;
+		WORD   NameLength;
+
+	} CAB_INDEX_FILE, *PCAB_INDEX_FILE;
+
+#pragma pack(pop)
+
+	/// <summary>
+	/// Loads and saves the sidecar index of a cabinet set.
+	/// </summary>
+	/// <remarks>
+	/// Loading maps the volumes, but skips walking their CFFILE tables and rebuilding the folders.
+	/// The index is validated against each volume's size, last write time and header checksum,
+	/// and a stale or damaged index is rebuilt. The index is a cache, failing to write it is not an error.
+	/// </remarks>
+	class CabinetIndexFile
+	{
+	public:
+		// Opens the set 'path' belongs to from the index next to it, rebuilding the index if needed.
+		static std::unique_ptr<CabinetSet> OpenSet(const WWuString& path);
+
+		// Returns null if the index doesn't exist or doesn't match the volumes anymore.
+		static std::unique_ptr<CabinetSet> Load(const WWuString& indexPath, const WWuString& directory);
+		static void Save(const CabinetSet& cabinetSet, const WWuString& indexPath);
+
+		static WWuString GetIndexPath(const WWuString& path);
+
+	private:
+		static void GetVolumeStamp(const CabinetVolume& volume, CAB_INDEX_VOLUME& stamp);
+	};
+}
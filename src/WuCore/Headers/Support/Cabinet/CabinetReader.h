@@ -0,0 +1,253 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <vector>
+#include <string_view>
+#include <unordered_map>
+
+#include "../WuString.h"
+#include "../WuList.h"
+#include "../IO.h"
+#include "../Expressions.h"
+#include "../WuException.h"
+
+#include "CabStructures.h"
+
+namespace WindowsUtils::Core
+{
+	// Decoded CFFILE entry.
+	typedef struct _CABINET_FILE_INFO
+	{
+		WuString  Name;            // As stored in the cabinet.
+		DWORD     Size;
+		DWORD     FolderOffset;
+		WORD      FolderIndex;     // Raw 'iFolder', including the continuation values.
+		WORD      Date;
+		WORD      Time;
+		WORD      Attributes;
+
+		// The name converted to UTF-16, honoring '_A_NAME_IS_UTF', with '\' separators.
+		WWuString GetRelativePath() const;
+
+	} CABINET_FILE_INFO, *PCABINET_FILE_INFO;
+
+	/// <summary>
+	/// A single cabinet file, parsed in place over its memory-mapped view.
+	/// </summary>
+	/// <remarks>
+	/// Only the header strings are copied out of the view. CFFOLDER and CFFILE entries are
+	/// decoded on demand, and CFDATA payloads are handed to the decompressors straight from the view.
+	/// The memory constructor works over a caller-owned buffer, useful for synthetic cabinets.
+	/// </remarks>
+	class CabinetVolume
+	{
+	public:
+		CabinetVolume(const WWuString& path);
+		CabinetVolume(const BYTE* data, const __uint64 size, const WWuString& name);
+		~CabinetVolume();
+
+		CabinetVolume(const CabinetVolume&) = delete;
+		CabinetVolume& operator=(const CabinetVolume&) = delete;
+
+		const WWuString& Path() const;
+		const WWuString& Name() const;
+		const CAB_HEADER& Header() const;
+		const WuString& PreviousCabinet() const;
+		const WuString& NextCabinet() const;
+		const BYTE DataReserveSize() const;
+		const BYTE* Data() const;
+		const __uint64 Size() const;
+
+		const CAB_FOLDER_ENTRY& GetFolder(const WORD index) const;
+
+		// Decodes the CFFILE entry at 'offset' and advances 'offset' to the next one.
+		// The first entry is at 'Header().FirstFileOffset'.
+		void ReadFileEntry(DWORD& offset, CABINET_FILE_INFO& info) const;
+
+		// Returns a pointer to 'count' bytes at 'offset', making sure they're inside the view.
+		const BYTE* At(const __uint64 offset, const __uint64 count) const;
+
+	private:
+		std::unique_ptr<MemoryMappedFile> m_mappedFile;
+		const BYTE* m_data;
+		__uint64 m_size;
+		WWuString m_path;
+		WWuString m_name;
+		const CAB_HEADER* m_header;
+		WuString m_previousCabinet;
+		WuString m_nextCabinet;
+		DWORD m_folderTableOffset;
+		BYTE m_folderReserveSize;
+		BYTE m_dataReserveSize;
+
+		void Parse();
+		DWORD ReadString(const DWORD offset, WuString& value) const;
+	};
+
+	// The part of a folder stored in a single volume.
+	typedef struct _CABINET_FOLDER_SEGMENT
+	{
+		const CabinetVolume* Volume;
+		WORD FolderIndex;
+
+	} CABINET_FOLDER_SEGMENT, *PCABINET_FOLDER_SEGMENT;
+
+	// A folder as seen by the whole cabinet set. Folders continued across
+	// volumes are merged into a single folder with one segment per volume.
+	typedef struct _CABINET_FOLDER
+	{
+		WORD                            CompressionType;
+		__uint64                        UncompressedSize;   // End of the last file in the folder.
+		WuList<CABINET_FOLDER_SEGMENT>  Segments;
+		WuList<CABINET_FILE_INFO>       Files;              // Files starting in this folder, by offset.
+
+	} CABINET_FOLDER, *PCABINET_FOLDER;
+
+	/// <summary>
+	/// All volumes of a cabinet set, opened and mapped, with the folders merged across volumes.
+	/// </summary>
+	class CabinetSet
+	{
+	public:
+		// Opens the set 'path' belongs to, walking back to the first volume.
+		CabinetSet(const WWuString& path);
+
+		// Builds a set from volumes already in order.
+		CabinetSet(std::vector<std::unique_ptr<CabinetVolume>>&& volumes);
+
+		// Builds a set from volumes already in order, and folders decoded from a sidecar index.
+		CabinetSet(std::vector<std::unique_ptr<CabinetVolume>>&& volumes, WuList<CABINET_FOLDER>&& folders);
+		~CabinetSet();
+
+		const std::vector<std::unique_ptr<CabinetVolume>>& Volumes() const;
+		const WuList<CABINET_FOLDER>& Folders() const;
+		const DWORD FileCount() const;
+		const __uint64 TotalUncompressedSize() const;
+
+		// Combines a volume name with the directory of the set.
+		static WWuString GetSiblingPath(const WWuString& directory, const WWuString& name);
+
+	private:
+		std::vector<std::unique_ptr<CabinetVolume>> m_volumes;
+		WuList<CABINET_FOLDER> m_folders;
+		DWORD m_fileCount;
+		__uint64 m_totalUncompressedSize;
+
+		void Build();
+	};
+
+	// Hashes cabinet and file names by content.
+	struct CabinetNameHash
+	{
+		size_t operator()(const WuString& value) const { return std::hash<std::string_view>{ }(std::string_view(value.Raw(), value.Length())); }
+		size_t operator()(const WWuString& value) const { return std::hash<std::wstring_view>{ }(std::wstring_view(value.Raw(), value.Length())); }
+	};
+
+	/// <summary>
+	/// Lookup tables over an opened cabinet set, built in a single pass over its folders and volumes.
+	/// </summary>
+	/// <remarks>
+	/// Names are matched exactly, like FDI does. A file name stored more than once in the set
+	/// is indexed, and counted for the total size, once, pointing to its first entry.
+	/// The index points into the set, which must outlive it.
+	/// </remarks>
+	class CabinetSetIndex
+	{
+	public:
+		CabinetSetIndex(const CabinetSet& cabinetSet);
+		~CabinetSetIndex();
+
+		CabinetSetIndex(const CabinetSetIndex&) = delete;
+		CabinetSetIndex& operator=(const CabinetSetIndex&) = delete;
+
+		// Number of distinct file names, and the sum of their sizes.
+		const DWORD FileCount() const;
+		const __uint64 TotalUncompressedSize() const;
+
+		// Returns null if there's no file or volume with this name.
+		const CABINET_FILE_INFO* FindFile(const WuString& name) const;
+		const CabinetVolume* FindVolume(const WWuString& name) const;
+
+		// One-based index of the volume where the folder starts.
+		const DWORD GetFolderVolumeIndex(const size_t folderIndex) const;
+
+		// Offset of the folder's first byte in the uncompressed data of the whole set.
+		const __uint64 GetFolderOffset(const size_t folderIndex) const;
+
+	private:
+		std::unordered_map<WuString, const CABINET_FILE_INFO*, CabinetNameHash> m_files;
+		std::unordered_map<WWuString, const CabinetVolume*, CabinetNameHash> m_volumes;
+		std::vector<DWORD> m_folderVolumes;
+		std::vector<__uint64> m_folderOffsets;
+		__uint64 m_totalUncompressedSize;
+	};
+
+	/// <summary>
+	/// Decompresses the CFDATA blocks of one folder.
+	/// </summary>
+	/// <remarks>
+	/// One instance per folder being decoded. 'Reset' discards the history between folders.
+	/// </remarks>
+	class CabinetDecompressor
+	{
+	public:
+		virtual ~CabinetDecompressor() { }
+
+		virtual void Reset() = 0;
+
+		// Decodes a whole CFDATA payload into 'output', which holds the block's 'outputSize' uncompressed bytes.
+		// Returns where the decoded data is: 'output', a buffer owned by the decompressor (e.g., its window),
+		// or 'input' when data is stored as is. The pointer is valid until the next call.
+		virtual const BYTE* Decompress(const BYTE* input, const DWORD inputSize, BYTE* output, const DWORD outputSize) = 0;
+
+		static bool IsSupported(const WORD compressionType);
+		static std::unique_ptr<CabinetDecompressor> Create(const WORD compressionType);
+	};
+
+	// 'tcompTYPE_NONE'. Data is handed back straight from the view.
+	class StoredDecompressor : public CabinetDecompressor
+	{
+	public:
+		void Reset() override;
+		const BYTE* Decompress(const BYTE* input, const DWORD inputSize, BYTE* output, const DWORD outputSize) override;
+	};
+
+	/// <summary>
+	/// Walks the CFDATA blocks of a folder in order, across volumes, decoding one block at a time.
+	/// </summary>
+	/// <remarks>
+	/// Blocks split at a volume boundary are joined before decoding.
+	/// Stored checksums are verified, blocks with checksum zero are not.
+	/// </remarks>
+	class CabinetFolderReader
+	{
+	public:
+		CabinetFolderReader(const CABINET_FOLDER& folder);
+		~CabinetFolderReader();
+
+		// Decodes the next block. 'data' is valid until the next call.
+		// Returns false after the last block.
+		bool Read(const BYTE** data, DWORD* size);
+
+		// Folder offset of the next block to be decoded.
+		const __uint64 Position() const;
+
+		// Segment of the block being read. After the last block, the last segment.
+		const CABINET_FOLDER_SEGMENT& CurrentSegment() const;
+
+		static DWORD ComputeChecksum(const BYTE* data, const DWORD size, DWORD seed);
+
+	private:
+		const CABINET_FOLDER& m_folder;
+		std::unique_ptr<CabinetDecompressor> m_decompressor;
+		std::unique_ptr<BYTE[]> m_output;
+		std::unique_ptr<BYTE[]> m_joinBuffer;
+		size_t m_segment;
+		WORD m_block;
+		DWORD m_blockOffset;
+		__uint64 m_position;
+
+		const CAB_DATA_BLOCK* NextRawBlock(const BYTE** payload);
+	};
+}
@@ -0,0 +1,216 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <vector>
+
+#include "../WuString.h"
+#include "../IO.h"
+#include "../WuException.h"
+#include "../SafeHandle.h"
+#include "../SpillBuffer.h"
+
+#include "CabStructures.h"
+#include "CabinetReader.h"
+#include "CabinetDeduplicator.h"
+#include "MsZipEncoder.h"
+
+// Folder planning.
+constexpr __uint64 CAB_WRITER_FOLDER_THRESHOLD  = 0x800000;    // 8 MiB uncompressed. Bigger files get a folder of their own.
+constexpr DWORD    CAB_WRITER_MAX_FOLDER_FILES  = 0x1000;      // Keeps folders of small files from getting too big to balance.
+constexpr WORD     CAB_WRITER_SET_ID            = 666;
+
+namespace WindowsUtils::Core
+{
+	// A file as it's going to be written in the cabinet.
+	typedef struct _CABINET_PLANNED_FILE
+	{
+		const AbstractPathTree*            Tree;
+		const AbstractPathTree::AptEntry*  Entry;
+		WuString                           Name;            // ASCII, or UTF-8 with '_A_NAME_IS_UTF'.
+		DWORD                              Size;
+		DWORD                              FolderOffset;
+		WORD                               Date;            // Date, time and the other attributes are set by the compressor.
+		WORD                               Time;
+		WORD                               Attributes;
+		bool                               IsDuplicate;     // Shares the data of an earlier file of the folder, at the same offset.
+
+	} CABINET_PLANNED_FILE, *PCABINET_PLANNED_FILE;
+
+	// A folder of the cabinet being created. Planned up front, compressed
+	// by one of the workers, and written to a volume in order.
+	typedef struct _CABINET_PLANNED_FOLDER
+	{
+		std::vector<CABINET_PLANNED_FILE>  Files;
+		__uint64                           UncompressedSize;
+		DWORD                              BlockCount;
+		std::unique_ptr<SpillBuffer>       Data;            // CFDATA blocks, headers included.
+		volatile LONG                      IsCompressed;
+
+	} CABINET_PLANNED_FOLDER, *PCABINET_PLANNED_FOLDER;
+
+	/// <summary>
+	/// Compresses the files of a planned folder into its CFDATA blocks.
+	/// </summary>
+	/// <remarks>
+	/// Supports 'tcompTYPE_NONE' and 'tcompTYPE_MSZIP'.
+	/// One instance per worker, reused from folder to folder.
+	/// </remarks>
+	class CabinetFolderCompressor
+	{
+	public:
+		CabinetFolderCompressor(const WORD compressionType);
+		~CabinetFolderCompressor();
+
+		CabinetFolderCompressor(const CabinetFolderCompressor&) = delete;
+		CabinetFolderCompressor& operator=(const CabinetFolderCompressor&) = delete;
+
+		// Reads the folder files and writes the blocks to 'folder.Data'.
+		// 'completedSize' is incremented by each block compressed. Returns false if cancelled.
+		bool Compress(CABINET_PLANNED_FOLDER& folder, volatile LONG* isCancelled, volatile LONG64* completedSize);
+
+		static bool IsSupported(const WORD compressionType);
+
+		// The biggest a folder can get, CFDATA headers included.
+		static __uint64 GetWorstCaseSize(const WORD compressionType, const __uint64 uncompressedSize);
+
+	private:
+		WORD m_compressionType;
+		std::unique_ptr<MsZipEncoder> m_encoder;
+		std::unique_ptr<BYTE[]> m_block;
+		std::unique_ptr<BYTE[]> m_output;
+
+		void WriteBlock(CABINET_PLANNED_FOLDER& folder, const DWORD size);
+		static void GetFileInformation(const HANDLE file, CABINET_PLANNED_FILE& info);
+	};
+
+	/// <summary>
+	/// Takes the compressed folders of a cabinet being written, in order.
+	/// </summary>
+	class CabinetFolderWriter
+	{
+	public:
+		virtual ~CabinetFolderWriter() { }
+
+		// Adds the next compressed folder. The folder's data can be released once written.
+		virtual void AddFolder(CABINET_PLANNED_FOLDER& folder) = 0;
+
+		// Writes what's left, after the last folder.
+		virtual void Close() = 0;
+
+		// Name of the volume being written, for the progress.
+		virtual const WWuString& CurrentVolumeName() const = 0;
+	};
+
+	/// <summary>
+	/// Writes compressed folders to the cabinet volumes, in order.
+	/// </summary>
+	/// <remarks>
+	/// Folders don't span volumes. A volume takes folders until the next one doesn't fit in 'splitSize',
+	/// then it's written with its header and the folders' data is released.
+	/// Volumes are named like the FCI ones, 'nameTemplate' followed by the volume number, starting at 01.
+	/// </remarks>
+	class CabinetWriter : public CabinetFolderWriter
+	{
+	public:
+		CabinetWriter(const WWuString& destination, const WWuString& nameTemplate, const WORD compressionType, const ULONG splitSize);
+		~CabinetWriter();
+
+		CabinetWriter(const CabinetWriter&) = delete;
+		CabinetWriter& operator=(const CabinetWriter&) = delete;
+
+		// Splits the files into folders of up to 'threshold' uncompressed bytes, in the tree order.
+		// The plan depends only on the tree, so the cabinet is the same no matter how many workers compress it.
+		// With 'duplicates', from 'CabinetDeduplicator', copies go to the folder of their original and point to its data.
+		// With 'selected', only the entries flagged are planned.
+		static void PlanFolders(AbstractPathTree& apt, const __uint64 threshold, std::vector<CABINET_PLANNED_FOLDER>& folders,
+			const std::vector<DWORD>* duplicates = nullptr, const std::vector<bool>* selected = nullptr);
+
+		// If the folder fits in a volume by itself, even if it doesn't compress at all.
+		bool CanWrite(const CABINET_PLANNED_FOLDER& folder) const;
+
+		// Adds the next compressed folder. Writes the current volume first if the folder doesn't fit.
+		void AddFolder(CABINET_PLANNED_FOLDER& folder) override;
+
+		// Writes the last volume.
+		void Close() override;
+
+		const WWuString& CurrentVolumeName() const override;
+
+	private:
+		WWuString m_destination;
+		WWuString m_nameTemplate;
+		WORD m_compressionType;
+		ULONG m_splitSize;
+
+		// Current volume.
+		WORD m_volumeIndex;
+		WWuString m_volumeName;
+		std::vector<CABINET_PLANNED_FOLDER*> m_folders;
+		DWORD m_fileCount;
+		DWORD m_fileTableSize;
+		__uint64 m_dataSize;
+
+		void WriteVolume(const bool hasNext);
+		DWORD GetHeaderSize(const WORD volumeIndex, const bool hasNext, const size_t folderCount, const DWORD fileTableSize) const;
+		WWuString GetVolumeName(const WORD volumeIndex) const;
+
+		static DWORD GetFileTableSize(const CABINET_PLANNED_FOLDER& folder);
+	};
+
+	/// <summary>
+	/// Adds folders to an existing cabinet, keeping its folders and data byte for byte.
+	/// </summary>
+	/// <remarks>
+	/// New folders are written past the end of the cabinet, followed by the new CFFILE table.
+	/// The header and the CFFOLDER table are written last, so until then the cabinet is the old one.
+	/// [MS-CAB] locates the CFFILE table by 'coffFiles', so it doesn't need to follow the CFFOLDER table,
+	/// and new CFFOLDER entries take the space of the old CFFILE table. What's left of it stays as slack.
+	/// Dropped files are left out of the table, their data stays in the old folders.
+	/// Only single volume cabinets without reserved areas, like signed ones, are supported.
+	/// </remarks>
+	class CabinetAppender : public CabinetFolderWriter
+	{
+	public:
+		CabinetAppender(const WWuString& path, const WORD compressionType);
+		~CabinetAppender();
+
+		CabinetAppender(const CabinetAppender&) = delete;
+		CabinetAppender& operator=(const CabinetAppender&) = delete;
+
+		// The files in the cabinet, as stored.
+		const std::vector<CABINET_FILE_INFO>& Files() const;
+		const FILETIME& LastWriteTime() const;
+
+		// Leaves a file in the cabinet out of the new CFFILE table.
+		void DropFile(const size_t index);
+
+		// How many folders can be added before the CFFOLDER table reaches the data.
+		size_t GetFolderRoom() const;
+
+		// Writes the folder data past the end of the cabinet.
+		void AddFolder(CABINET_PLANNED_FOLDER& folder) override;
+
+		// Writes the CFFILE table, then the header and the CFFOLDER table.
+		void Close() override;
+
+		const WWuString& CurrentVolumeName() const override;
+
+	private:
+		WWuString m_name;
+		WORD m_compressionType;
+		std::unique_ptr<FileHandle> m_file;
+		FILETIME m_lastWriteTime;
+		CAB_HEADER m_header;
+		std::vector<CAB_FOLDER_ENTRY> m_folderEntries;
+		WORD m_existingFolderCount;
+		DWORD m_dataStart;                                 // First CFDATA of the existing folders.
+		std::vector<CABINET_FILE_INFO> m_files;
+		std::vector<bool> m_isDropped;
+		std::vector<const CABINET_PLANNED_FOLDER*> m_folders;
+		__uint64 m_appendOffset;
+
+		static void AppendFileEntry(std::vector<BYTE>& table, const WuString& name, const DWORD size, const DWORD folderOffset,
+			const WORD folderIndex, const WORD date, const WORD time, const WORD attributes);
+	};
+}
@@ -0,0 +1,102 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+
+#include "CabinetReader.h"
+
+// LZX limits, from [MS-PATCH].
+constexpr DWORD LZX_MIN_WINDOW_BITS        = 15;
+constexpr DWORD LZX_MAX_WINDOW_BITS        = 21;
+constexpr DWORD LZX_FRAME_SIZE             = 0x8000;    // 32 KiB, one CFDATA block.
+constexpr DWORD LZX_MAX_POSITION_SLOTS     = 50;
+constexpr DWORD LZX_MAIN_TREE_MAX_SIZE     = 256 + (LZX_MAX_POSITION_SLOTS << 3);
+constexpr DWORD LZX_LENGTH_TREE_SIZE       = 249;
+constexpr DWORD LZX_ALIGNED_TREE_SIZE      = 8;
+constexpr DWORD LZX_PRETREE_SIZE           = 20;
+
+constexpr DWORD LZX_MAIN_TABLE_BITS        = 10;
+constexpr DWORD LZX_LENGTH_TABLE_BITS      = 10;
+constexpr DWORD LZX_ALIGNED_TABLE_BITS     = 7;
+constexpr DWORD LZX_PRETREE_TABLE_BITS     = 8;
+
+// Primary table plus the worst case for the sub-tables. Codes are at most 16 bits long.
+constexpr DWORD LZX_MAIN_TABLE_SIZE        = (1 << LZX_MAIN_TABLE_BITS) + (LZX_MAIN_TREE_MAX_SIZE << (16 - LZX_MAIN_TABLE_BITS));
+constexpr DWORD LZX_LENGTH_TABLE_SIZE      = (1 << LZX_LENGTH_TABLE_BITS) + (LZX_LENGTH_TREE_SIZE << (16 - LZX_LENGTH_TABLE_BITS));
+constexpr DWORD LZX_ALIGNED_TABLE_SIZE     = 1 << LZX_ALIGNED_TABLE_BITS;
+constexpr DWORD LZX_PRETREE_TABLE_SIZE     = (1 << LZX_PRETREE_TABLE_BITS) + (LZX_PRETREE_SIZE << (16 - LZX_PRETREE_TABLE_BITS));
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// 'tcompTYPE_LZX' decoder.
+	/// </summary>
+	/// <remarks>
+	/// Each CFDATA block holds one 32 KiB LZX frame. LZX blocks, the Huffman code lengths,
+	/// the repeated offsets and the window all carry over from frame to frame, so one instance
+	/// decodes a whole folder, a block at a time, keeping only the window in memory.
+	/// Frames are decoded in the window and copied to the caller's buffer, where the
+	/// E8 call translation is undone. The window itself is never translated.
+	/// </remarks>
+	class LzxDecoder : public CabinetDecompressor
+	{
+	public:
+		LzxDecoder(const DWORD windowBits);
+		~LzxDecoder();
+
+		void Reset() override;
+		const BYTE* Decompress(const BYTE* input, const DWORD inputSize, BYTE* output, const DWORD outputSize) override;
+
+		static bool IsValidWindow(const DWORD windowBits);
+
+	private:
+		// Window.
+		std::unique_ptr<BYTE[]> m_window;
+		DWORD m_windowSize;
+		DWORD m_windowPosition;
+		__uint64 m_decodedSize;
+		DWORD m_positionSlots;
+
+		// Block state.
+		bool m_isHeaderRead;
+		DWORD m_blockType;
+		DWORD m_blockSize;
+		DWORD m_blockRemaining;
+		DWORD m_repeatedOffsets[3];
+
+		// E8 call translation state.
+		bool m_isE8Started;
+		LONG m_e8FileSize;
+		DWORD m_e8Position;
+		DWORD m_frameCount;
+
+		// Bit reader. LZX packs bits in 16-bit little-endian words, most significant bit first.
+		const BYTE* m_input;
+		const BYTE* m_inputEnd;
+		unsigned __int64 m_bitBuffer;
+		DWORD m_bitCount;
+		DWORD m_overread;
+
+		// Code lengths carry over from block to block.
+		BYTE m_mainLengths[LZX_MAIN_TREE_MAX_SIZE];
+		BYTE m_lengthLengths[LZX_LENGTH_TREE_SIZE];
+
+		std::unique_ptr<DWORD[]> m_mainTable;
+		std::unique_ptr<DWORD[]> m_lengthTable;
+		std::unique_ptr<DWORD[]> m_pretreeTable;
+		DWORD m_alignedTable[LZX_ALIGNED_TABLE_SIZE];
+
+		void Refill();
+		DWORD GetBits(const DWORD count);
+		DWORD DecodeSymbol(const DWORD* table, const DWORD tableBits);
+		void AlignToBytes();
+
+		void ReadBlockHeader();
+		void ReadLengths(BYTE* lengths, const DWORD first, const DWORD last);
+		void DecodeCompressed(DWORD& position, const DWORD runEnd);
+		void CopyUncompressed(DWORD& position, const DWORD runEnd);
+		void UndoE8Translation(BYTE* data, const DWORD size) const;
+
+		static void BuildTable(const BYTE* lengths, const DWORD count, const DWORD tableBits, DWORD* table, const DWORD tableSize);
+	};
+}
@@ -0,0 +1,66 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+
+#include "CabinetReader.h"
+
+// Deflate limits.
+constexpr DWORD MSZIP_WINDOW_SIZE          = 0x8000;    // 32 KiB history.
+constexpr DWORD MSZIP_LITERAL_TABLE_BITS   = 10;
+constexpr DWORD MSZIP_DISTANCE_TABLE_BITS  = 8;
+constexpr DWORD MSZIP_CODE_TABLE_BITS      = 7;
+
+// Primary table plus the worst case for the sub-tables.
+constexpr DWORD MSZIP_LITERAL_TABLE_SIZE   = (1 << MSZIP_LITERAL_TABLE_BITS) + (288 << (15 - MSZIP_LITERAL_TABLE_BITS));
+constexpr DWORD MSZIP_DISTANCE_TABLE_SIZE  = (1 << MSZIP_DISTANCE_TABLE_BITS) + (32 << (15 - MSZIP_DISTANCE_TABLE_BITS));
+constexpr DWORD MSZIP_CODE_TABLE_SIZE      = 1 << MSZIP_CODE_TABLE_BITS;
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// 'tcompTYPE_MSZIP' decoder.
+	/// </summary>
+	/// <remarks>
+	/// Each CFDATA block is a 'CK' signature followed by a deflate stream that ends in a final block.
+	/// The streams are independent except for the history, which is the last 32 KiB of the folder.
+	/// Blocks are decoded in the window, right after the history, so matches never wrap and no copy
+	/// is needed to hand data out. Huffman codes are decoded with lookup tables, bits come from a
+	/// 64-bit buffer refilled a word at a time, and matches are copied 8 bytes at a time.
+	/// </remarks>
+	class MsZipDecoder : public CabinetDecompressor
+	{
+	public:
+		MsZipDecoder();
+		~MsZipDecoder();
+
+		void Reset() override;
+		const BYTE* Decompress(const BYTE* input, const DWORD inputSize, BYTE* output, const DWORD outputSize) override;
+
+	private:
+		// [history][block][slack for the wide copies].
+		std::unique_ptr<BYTE[]> m_window;
+		DWORD m_historySize;
+
+		const BYTE* m_input;
+		const BYTE* m_inputEnd;
+		unsigned __int64 m_bitBuffer;
+		DWORD m_bitCount;
+		DWORD m_overread;
+
+		std::unique_ptr<DWORD[]> m_literalTable;
+		std::unique_ptr<DWORD[]> m_distanceTable;
+		std::unique_ptr<DWORD[]> m_fixedLiteralTable;
+		std::unique_ptr<DWORD[]> m_fixedDistanceTable;
+
+		void Refill();
+		DWORD GetBits(const DWORD count);
+		DWORD DecodeSymbol(const DWORD* table, const DWORD tableBits);
+
+		void ReadDynamicTables();
+		void InflateStored(BYTE*& output, const BYTE* outputEnd);
+		void InflateHuffman(const DWORD* literalTable, const DWORD* distanceTable, BYTE*& output, const BYTE* outputEnd);
+
+		static void BuildTable(const BYTE* lengths, const DWORD count, const DWORD* symbols, const DWORD tableBits, DWORD* table, const DWORD tableSize);
+	};
+}
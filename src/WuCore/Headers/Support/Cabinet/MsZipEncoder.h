@@ -0,0 +1,77 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+
+#include "CabStructures.h"
+
+// Match finder settings. Roughly zlib's default level.
+constexpr DWORD MSZIP_ENCODER_HASH_BITS     = 15;
+constexpr DWORD MSZIP_ENCODER_MAX_CHAIN     = 128;
+constexpr DWORD MSZIP_ENCODER_GOOD_LENGTH   = 8;       // Matches this long get a shorter chain search.
+constexpr DWORD MSZIP_ENCODER_LAZY_LENGTH   = 16;      // Matches this long are taken without looking one byte ahead.
+constexpr DWORD MSZIP_ENCODER_NICE_LENGTH   = 128;     // Matches this long end the chain search.
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// 'tcompTYPE_MSZIP' encoder.
+	/// </summary>
+	/// <remarks>
+	/// Each block is compressed as one deflate block, with the previous 32 KiB of the folder as history.
+	/// The block type, stored, fixed or dynamic Huffman, is the one with the smaller output, so
+	/// the compressed size never exceeds the block plus a few bytes.
+	/// One instance per folder being compressed. 'Reset' discards the history between folders.
+	/// </remarks>
+	class MsZipEncoder
+	{
+	public:
+		MsZipEncoder();
+		~MsZipEncoder();
+
+		MsZipEncoder(const MsZipEncoder&) = delete;
+		MsZipEncoder& operator=(const MsZipEncoder&) = delete;
+
+		void Reset();
+
+		// Compresses a block of up to 32 KiB into 'output', which must hold 'CAB_MAX_BLOCK_COMPRESSED' bytes.
+		// Returns the compressed size, including the 'CK' signature.
+		DWORD Compress(const BYTE* input, const DWORD inputSize, BYTE* output);
+
+	private:
+		// [history][block][slack for the wide compares].
+		std::unique_ptr<BYTE[]> m_window;
+		DWORD m_historySize;
+		DWORD m_position;
+
+		// Hash chains, by folder offset plus one. Zero is the end of the chain.
+		std::unique_ptr<DWORD[]> m_head;
+		std::unique_ptr<DWORD[]> m_chain;
+
+		// A literal has distance zero, and the byte as length.
+		std::unique_ptr<WORD[]> m_tokenLengths;
+		std::unique_ptr<WORD[]> m_tokenDistances;
+		DWORD m_tokenCount;
+
+		DWORD m_literalFrequencies[286];
+		DWORD m_distanceFrequencies[30];
+
+		BYTE* m_output;
+		unsigned __int64 m_bitBuffer;
+		DWORD m_bitCount;
+
+		void FindMatches(const DWORD blockSize);
+		DWORD InsertHash(const DWORD index);
+		DWORD FindLongestMatch(const DWORD index, DWORD candidate, const DWORD maxLength, const DWORD previousLength, DWORD& distance) const;
+		void AddLiteral(const BYTE literal);
+		void AddMatch(const DWORD length, const DWORD distance);
+
+		void WriteBits(const DWORD value, const DWORD count);
+		void FlushBits();
+		void WriteStored(const BYTE* block, const DWORD size);
+		void WriteTokens(const BYTE* literalLengths, const WORD* literalCodes, const BYTE* distanceLengths, const WORD* distanceCodes);
+
+		static void BuildLengths(const DWORD* frequencies, const DWORD count, const DWORD maxLength, BYTE* lengths);
+		static void BuildCodes(const BYTE* lengths, const DWORD count, WORD* codes);
+	};
+}
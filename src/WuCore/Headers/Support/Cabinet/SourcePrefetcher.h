@@ -0,0 +1,89 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <vector>
+
+#include "../WuString.h"
+#include "../IO.h"
+#include "../WuException.h"
+#include "../SafeHandle.h"
+#include "../BufferPool.h"
+
+constexpr DWORD CAB_PREFETCH_WINDOW       = 16;          // Files opened and read ahead of the compressor.
+constexpr DWORD CAB_PREFETCH_THREADS      = 4;           // It's latency we're hiding, not bandwidth.
+constexpr DWORD CAB_PREFETCH_MAX_READ     = 0x400000;    // 4 MiB. Bigger files have only their start read ahead.
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// Opens and reads the source files of a cabinet ahead of the compressor, so it doesn't wait on I/O.
+	/// </summary>
+	/// <remarks>
+	/// Files are consumed in the order they're given, and a pool of threads keeps up to 'CAB_PREFETCH_WINDOW'
+	/// of them opened, with their first 'CAB_PREFETCH_MAX_READ' bytes in pooled buffers. The rest of a bigger
+	/// file is read from its handle, opened with 'FILE_FLAG_SEQUENTIAL_SCAN' so the system reads ahead of us.
+	/// The window bounds the memory in use, the threads never wait for the pool.
+	/// Handles follow the C runtime file functions, like the ones FCI expects. They're values with the second bit set,
+	/// so they can't be mistaken for kernel handles, multiples of four, or 'TempStore' handles, which are odd.
+	/// Only the thread consuming the files calls 'Open' and the handle functions.
+	/// </remarks>
+	class SourcePrefetcher
+	{
+	public:
+		SourcePrefetcher(std::vector<WWuString>&& paths);
+		~SourcePrefetcher();
+
+		SourcePrefetcher(const SourcePrefetcher&) = delete;
+		SourcePrefetcher& operator=(const SourcePrefetcher&) = delete;
+
+		static bool IsPrefetchHandle(const INT_PTR handle);
+
+		// Waits for the next file. Failures return -1, with the error in 'error'.
+		INT_PTR OpenNext(USHORT* date, USHORT* time, USHORT* attributes, int* error);
+		UINT Read(const INT_PTR handle, void* buffer, const UINT count);
+		long Seek(const INT_PTR handle, const long distance, const int origin);
+		int Close(const INT_PTR handle);
+
+	private:
+		enum class PrefetchState
+		{
+			Pending,
+			Ready,
+			Failed,
+		};
+
+		typedef struct _PREFETCH_ENTRY
+		{
+			WWuString                       Path;
+			PrefetchState                   State;
+			int                             ErrorCode;
+			std::unique_ptr<FileHandle>     Handle;
+			std::unique_ptr<POOLED_BUFFER>  Buffer;
+			__uint64                        Size;
+			DWORD                           PrefixSize;    // Bytes in 'Buffer', the handle is past them. Null handle if that's the whole file.
+			__uint64                        Position;
+			USHORT                          Date;
+			USHORT                          Time;
+			USHORT                          Attributes;
+
+		} PREFETCH_ENTRY, *PPREFETCH_ENTRY;
+
+		std::vector<PREFETCH_ENTRY> m_entries;
+		size_t m_nextToRead;
+		size_t m_nextToOpen;
+		size_t m_closedCount;
+		bool m_isCancelled;
+		BufferPool m_pool;
+		std::vector<HANDLE> m_workers;
+
+		SRWLOCK m_lock;
+		CONDITION_VARIABLE m_entryReady;
+		CONDITION_VARIABLE m_windowMoved;
+
+		static DWORD WINAPI PrefetchWorker(LPVOID params);
+		void Prefetch(PREFETCH_ENTRY& entry);
+		void MoveWindow();
+		static PPREFETCH_ENTRY FromHandle(const INT_PTR handle);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+
+#include "WuString.h"
+#include "WuException.h"
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// A trie of the directories under a root known to exist, so each one costs a single 'CreateDirectory' per operation.
+	/// </summary>
+	/// <remarks>
+	/// The root must exist. Directories are never probed, 'CreateDirectory' either creates them or tells us they exist.
+	/// Names are compared upper-cased, a name the file system folds differently only costs one more 'CreateDirectory'.
+	/// The cache only knows what it created or found, directories removed by someone else during the operation are not recreated.
+	/// Safe to use from multiple threads.
+	/// </remarks>
+	class DirectoryCache
+	{
+	public:
+		DirectoryCache(const WWuString& root);
+		~DirectoryCache();
+
+		DirectoryCache(const DirectoryCache&) = delete;
+		DirectoryCache& operator=(const DirectoryCache&) = delete;
+
+		const WWuString& Root() const;
+
+		// Makes sure the directory 'components', relative to the root, exists. Empty components are skipped.
+		void CreateTree(const WuList<WWuString>& components);
+
+	private:
+		struct NameHash
+		{
+			size_t operator()(const WWuString& value) const { return std::hash<std::wstring_view>{ }(std::wstring_view(value.Raw(), value.Length())); }
+		};
+
+		struct Node
+		{
+			std::unordered_map<WWuString, std::unique_ptr<Node>, NameHash> Children;
+		};
+
+		WWuString m_root;
+		Node m_rootNode;
+		SRWLOCK m_lock;
+
+		bool IsKnown(const WuList<WWuString>& components) const;
+		void CreateMissing(const WuList<WWuString>& components);
+		static WWuString GetKey(const WWuString& name);
+	};
+}
@@ -0,0 +1,86 @@
+#pragma once
+#pragma unmanaged
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "WuString.h"
+#include "WuException.h"
+#include "IO.h"
+
+namespace WindowsUtils::Core
+{
+	// A directory being enumerated. 'Children' has one node for each directory in 'Entries', in the same order.
+	typedef struct _DIRECTORY_NODE
+	{
+		WWuString                                      Path;        // With the trailing '\'.
+		WuList<FS_INFO>                                Entries;
+		std::vector<std::unique_ptr<_DIRECTORY_NODE>>  Children;
+
+	} DIRECTORY_NODE, *PDIRECTORY_NODE;
+
+	/// <summary>
+	/// Enumerates a directory tree with a pool of threads, each directory being a unit of work.
+	/// </summary>
+	/// <remarks>
+	/// Each worker has its own queue of directories. It pushes the directories it finds to its queue, and takes
+	/// the last one pushed. When its queue is empty it steals the oldest directory from another worker's queue,
+	/// which is usually the one with the biggest subtree left.
+	/// Each directory keeps its own entries, and the tree is merged once at the end, in the same order as a
+	/// depth-first enumeration. Entries are moved to the output, never copied.
+	/// Directories we can't open are skipped, same as the serial enumeration.
+	/// </remarks>
+	class DirectoryEnumerator
+	{
+	public:
+		// Zero uses one worker for each processor. The calling thread is one of the workers.
+		DirectoryEnumerator(const DWORD threadCount = 0);
+		~DirectoryEnumerator();
+
+		DirectoryEnumerator(const DirectoryEnumerator&) = delete;
+		DirectoryEnumerator& operator=(const DirectoryEnumerator&) = delete;
+
+		// 'path' must be a directory path ending with '\'.
+		WuList<FS_INFO> Enumerate(const WWuString& path);
+
+	private:
+		typedef struct _WORKER_QUEUE
+		{
+			SRWLOCK                      Lock;
+			std::deque<PDIRECTORY_NODE>  Nodes;
+
+		} WORKER_QUEUE, *PWORKER_QUEUE;
+
+		typedef struct _WORKER_PARAMS
+		{
+			DirectoryEnumerator*  Enumerator;
+			DWORD                 Index;
+
+		} WORKER_PARAMS, *PWORKER_PARAMS;
+
+		DWORD m_threadCount;
+		std::unique_ptr<WORKER_QUEUE[]> m_queues;
+
+		// 'm_pending' counts directories queued or being enumerated, we're done when it gets to zero.
+		volatile LONG m_pending;
+		volatile LONG m_queued;
+		volatile LONG m_idleCount;
+		volatile LONG m_isCancelled;
+		volatile LONG64 m_entryCount;
+		SRWLOCK m_idleLock;
+		CONDITION_VARIABLE m_workAvailable;
+
+		SRWLOCK m_errorLock;
+		std::unique_ptr<WuException> m_error;
+
+		void Push(const DWORD index, PDIRECTORY_NODE node);
+		PDIRECTORY_NODE Take(const DWORD index);
+		bool WaitForWork();
+		void WakeWorkers(const bool all);
+		void RunWorker(const DWORD index);
+		void EnumerateDirectory(const DWORD index, DIRECTORY_NODE& node);
+		void Merge(DIRECTORY_NODE& root, WuList<FS_INFO>& output);
+		static DWORD WINAPI WorkerThread(LPVOID params);
+	};
+}
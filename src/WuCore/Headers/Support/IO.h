@@ -43,7 +43,7 @@ namespace WindowsUtils::Core
 		static void SetFileAttributesAndDate(const WWuString& filePath, USHORT date, USHORT time, USHORT attributes);
 		static void AppendTextToFile(const HANDLE hFile, const WWuString& textS);
 		static __uint64 GetFileSize(const WWuString& filePath);
-		static WuList<FS_INFO> EnumerateFileSystemInfo(WWuString& path);
+		static WuList<FS_INFO> EnumerateFileSystemInfo(WWuString& path, const DWORD threadCount = 0);
 		static bool FileExists(const WWuString& filePath);
 		static WWuString GetFileDosPathFromDevicePath(const WWuString& devicePath);
 		static WWuString GetFileDevicePathFromDosPath(const WWuString& dosPath);
@@ -99,36 +99,52 @@ namespace WindowsUtils::Core
 		HANDLE m_mappedFile;
 	};
 
+	/// <summary>
+	/// The files and directories under a root, as a compact tree.
+	/// </summary>
+	/// <remarks>
+	/// Entries are stored in depth-first order. Each one has the index of its parent, and a slice of
+	/// a shared arena with its name, so a path component is only stored once however many entries are under it.
+	/// Relative and full paths are built on demand from the parent chain.
+	/// </remarks>
 	class AbstractPathTree
 	{
 	public:
+		static constexpr DWORD NoParent = MAXDWORD;
+
 		WWuString RootPath;
 		DWORD FileCount;
 		DWORD DirectoryCount;
 		__uint64 TotalLength;
 		typedef struct _AptEntry
 		{
-			FsObjectType Type;
-			WWuString Name;
-			WWuString RelativePath;
-			WWuString FullPath;
-			__uint64 Length;
-
-			_AptEntry(const WWuString& name, const WWuString& filePath, const WWuString& rootPath, __uint64 length, FsObjectType type);
-			~_AptEntry();
+			FsObjectType  Type;
+			__uint64      Length;
+			DWORD         Parent;        // Index of the parent directory, 'NoParent' for entries directly under the root.
+			DWORD         NameOffset;    // In the name arena.
+			DWORD         NameLength;
+			DWORD         PathLength;    // Relative path length, so paths are built in a single allocation.
 
 		} AptEntry;
 
 		AbstractPathTree();
-		AbstractPathTree(const AbstractPathTree& other);
 		~AbstractPathTree();
 
-		void PushEntry(const AptEntry& entry);
-		std::vector<AptEntry>& GetApt();
+		// Entries must come in depth-first order, with each directory before its contents,
+		// the same order 'IO::EnumerateFileSystemInfo' returns them. 'RootPath' must be set before.
+		void PushEntry(const FS_INFO& info);
+		const std::vector<AptEntry>& GetApt() const;
 
-		AbstractPathTree& operator=(const AbstractPathTree& other);
+		WWuString GetName(const AptEntry& entry) const;
+		WWuString GetRelativePath(const AptEntry& entry) const;
+		WWuString GetFullPath(const AptEntry& entry) const;
 
 	private:
 		std::vector<AptEntry> m_apt;
+		std::vector<WCHAR> m_names;
+		WWuString m_basePath;           // Full paths are this and the relative path.
+
+		DWORD FindParent(const DWORD parentPathLength) const;
+		void CopyRelativePath(const AptEntry& entry, WCHAR* end) const;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#pragma unmanaged
+
+constexpr DWORD LATENCY_SUB_BUCKET_BITS      = 7;                                        // 128 values per power of two, so buckets are at most 1/64 of their value.
+constexpr DWORD LATENCY_HALF_SUB_BUCKETS     = 1 << (LATENCY_SUB_BUCKET_BITS - 1);
+constexpr ULONGLONG LATENCY_MAX_VALUE        = 0xFFFFFFFF;                               // Microseconds, a bit over 71 minutes. Longer is recorded as this.
+constexpr DWORD LATENCY_BUCKET_COUNT         = 32 - LATENCY_SUB_BUCKET_BITS + 2;
+constexpr DWORD LATENCY_COUNTS_LENGTH        = LATENCY_BUCKET_COUNT * LATENCY_HALF_SUB_BUCKETS;
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// Log-bucketed latency histogram in fixed memory, laid out like HdrHistogram.
+	/// </summary>
+	/// <remarks>
+	/// Values are recorded in microseconds. The first bucket counts 0 to 127 exactly, and each bucket after it covers
+	/// twice the range with 64 counters, so the error stays relative to the value instead of growing with it.
+	/// Recording is a bit scan and an increment. Percentiles walk the counters, and are reported as the highest value
+	/// of their counter, never above the highest recorded.
+	/// </remarks>
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+
+		void Record(const double milliseconds);
+
+		// 'percentile' from 0 to 100. In milliseconds, zero if nothing was recorded.
+		double ValueAtPercentile(const double percentile) const;
+		const ULONGLONG Count() const;
+
+	private:
+		DWORD m_counts[LATENCY_COUNTS_LENGTH];
+		ULONGLONG m_count;
+		ULONGLONG m_maxValue;
+
+		static DWORD IndexOf(const ULONGLONG value);
+		static ULONGLONG HighestValueAt(const DWORD index);
+	};
+}
\ No newline at end of file
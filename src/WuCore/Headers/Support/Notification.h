@@ -26,6 +26,9 @@ namespace WindowsUtils::Core
 		WWuString,
 		ProcessModuleInfo,
 		ObjectHandle,
+		CabinetFileInfo,
+		CabinetTestInfo,
+		CabinetFileContent,
 	};
 
 	/// <summary>
@@ -195,4 +198,70 @@ namespace WindowsUtils::Core
 		UnmanagedWriteException m_writeExHook;
 		UnmanagedExceptionMarshaler m_exMarshalerHook;
 	};
+
+	/*
+	*	~ Progress aggregator ~
+	*/
+
+	constexpr DWORD PROGRESS_MIN_INTERVAL = 200;    // Milliseconds, at most five records per second.
+
+	/// <summary>
+	/// A snapshot of the progress of an operation, from which its owner builds the record.
+	/// </summary>
+	typedef struct _PROGRESS_STATE
+	{
+		__uint64   CompletedSize;
+		__uint64   TotalSize;
+		DWORD      CompletedItems;
+		DWORD      TotalItems;
+		DWORD      ContainerIndex;
+		DWORD      ContainerCount;
+		WWuString  Container;
+		WWuString  CurrentItem;
+
+	} PROGRESS_STATE, *PPROGRESS_STATE;
+
+	/// <summary>
+	/// Aggregates the progress of a long-running operation, and writes it at most once every 'interval' milliseconds.
+	/// </summary>
+	/// <remarks>
+	/// Producers, on any thread, add to the counters with interlocked operations, and only lock to replace the current item or container.
+	/// Only the thread running the Cmdlet can write to the host. It calls 'Emit' where it would write progress, and the record
+	/// is only built and marshaled when something changed and the interval elapsed. 'Complete' writes the last state regardless.
+	/// </remarks>
+	class ProgressAggregator
+	{
+	public:
+		ProgressAggregator(const WuNativeContext* context, const __uint64 totalSize, const DWORD totalItems, const DWORD containerCount, const DWORD interval = PROGRESS_MIN_INTERVAL);
+		virtual ~ProgressAggregator();
+
+		ProgressAggregator(const ProgressAggregator&) = delete;
+		ProgressAggregator& operator=(const ProgressAggregator&) = delete;
+
+		// Thread safe.
+		void AddCompleted(const __uint64 size, const DWORD items);
+		void SetCompletedSize(const __uint64 size);
+		void SetCurrentItem(const WWuString& item);
+		void SetContainer(const WWuString& container, const DWORD index);
+
+		// Thread running the Cmdlet only.
+		void Emit();
+		void Complete();
+
+	protected:
+		virtual MAPPED_PROGRESS_DATA GetProgressData(const PROGRESS_STATE& state) const = 0;
+
+	private:
+		const WuNativeContext* m_context;
+		DWORD m_interval;
+		ULONGLONG m_lastEmit;
+		volatile LONG64 m_completedSize;
+		volatile LONG m_completedItems;
+		volatile LONG m_changeCount;
+		LONG m_emittedChangeCount;
+		SRWLOCK m_lock;
+		PROGRESS_STATE m_state;
+
+		void Write();
+	};
 }
\ No newline at end of file
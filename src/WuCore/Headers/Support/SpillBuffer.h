@@ -0,0 +1,51 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <vector>
+
+#include "WuString.h"
+#include "WuException.h"
+#include "SafeHandle.h"
+
+constexpr DWORD SPILL_BUFFER_CHUNK_SIZE = 0x100000;    // 1 MiB.
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// An append-only byte stream kept in memory while there is budget, spilling to a temporary file after that.
+	/// </summary>
+	/// <remarks>
+	/// Memory is taken from a budget shared by all buffers of an operation, in 'SPILL_BUFFER_CHUNK_SIZE' chunks,
+	/// and returned when the buffer is destroyed. Once a buffer spills, everything else written to it goes to the file.
+	/// The temporary file is created in 'directory' and is deleted when the buffer is destroyed.
+	/// Writing to the buffer is not thread safe, the budget is.
+	/// </remarks>
+	class SpillBuffer
+	{
+	public:
+		SpillBuffer(const WWuString& directory, volatile LONG64* memoryBudget);
+		~SpillBuffer();
+
+		SpillBuffer(const SpillBuffer&) = delete;
+		SpillBuffer& operator=(const SpillBuffer&) = delete;
+
+		void Write(const void* data, DWORD size);
+		const __uint64 Size() const;
+		const bool IsSpilled() const;
+
+		// Writes the whole content to 'file', at its current position.
+		void CopyTo(const HANDLE file);
+
+	private:
+		WWuString m_directory;
+		volatile LONG64* m_memoryBudget;
+		std::vector<std::unique_ptr<BYTE[]>> m_chunks;
+		DWORD m_lastChunkSize;
+		std::unique_ptr<FileHandle> m_spillFile;
+		__uint64 m_size;
+
+		bool TryAddChunk();
+		void CreateSpillFile();
+	};
+}
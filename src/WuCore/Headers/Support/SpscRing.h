@@ -0,0 +1,144 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "WuException.h"
+#include "SafeHandle.h"
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// Bounded queue between one producer thread and one consumer thread, without locks.
+	/// </summary>
+	/// <remarks>
+	/// Slots are allocated up front, and items are constructed in place and destroyed when popped.
+	/// The producer only moves the tail and the consumer only moves the head, each published with release semantics.
+	/// A side that has to wait, the consumer on an empty ring or the producer on a full one, flags it before
+	/// checking again and sleeping on its event. The other side only signals when the flag is set,
+	/// so while both keep up there are no kernel calls.
+	/// </remarks>
+	template <class T>
+	class SpscRing
+	{
+	public:
+		// The capacity is rounded up to a power of two.
+		SpscRing(const ULONG capacity)
+			: m_capacity(1), m_head(0), m_tail(0), m_isConsumerWaiting(0), m_isProducerWaiting(0), m_isCancelled(0),
+			m_itemPushed{ CreateEvent(nullptr, FALSE, FALSE, nullptr), true },
+			m_slotFreed{ CreateEvent(nullptr, FALSE, FALSE, nullptr), true }
+		{
+			if (m_itemPushed.Get() == NULL || m_slotFreed.Get() == NULL)
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateEvent", WriteErrorCategory::ResourceUnavailable);
+
+			while (m_capacity < capacity)
+				m_capacity <<= 1;
+
+			m_slots = std::make_unique<SPSC_SLOT[]>(m_capacity);
+		}
+
+		~SpscRing()
+		{
+			for (ULONG index = m_head; index != m_tail; index++)
+				SlotAt(index)->~T();
+		}
+
+		SpscRing(const SpscRing&) = delete;
+		SpscRing& operator=(const SpscRing&) = delete;
+
+		// Producer. Waits while the ring is full. Returns false if the ring was cancelled.
+		template <class... TArgs>
+		bool Emplace(TArgs&&... args)
+		{
+			while (m_tail - ReadULongAcquire(&m_head) == m_capacity) {
+				if (ReadAcquire(&m_isCancelled))
+					return false;
+
+				InterlockedExchange(&m_isProducerWaiting, 1);
+				if (m_tail - ReadULongAcquire(&m_head) < m_capacity || ReadAcquire(&m_isCancelled)) {
+					InterlockedExchange(&m_isProducerWaiting, 0);
+					continue;
+				}
+
+				WaitForSingleObject(m_slotFreed.Get(), INFINITE);
+			}
+
+			new (SlotAt(m_tail)) T(std::forward<TArgs>(args)...);
+			WriteULongRelease(&m_tail, m_tail + 1);
+
+			if (InterlockedCompareExchange(&m_isConsumerWaiting, 0, 1) == 1)
+				SetEvent(m_itemPushed.Get());
+
+			return true;
+		}
+
+		// Consumer. The oldest item, or null if the ring is empty.
+		T* Front()
+		{
+			if (m_head == ReadULongAcquire(&m_tail))
+				return nullptr;
+
+			return SlotAt(m_head);
+		}
+
+		// Consumer. Destroys the oldest item and gives its slot back to the producer.
+		void Pop()
+		{
+			SlotAt(m_head)->~T();
+			WriteULongRelease(&m_head, m_head + 1);
+
+			if (InterlockedCompareExchange(&m_isProducerWaiting, 0, 1) == 1)
+				SetEvent(m_slotFreed.Get());
+		}
+
+		// Consumer. Waits until there's an item, or one of 'handles' is signaled.
+		// Returns like 'WaitForMultipleObjects', 'WAIT_OBJECT_0' for an item and 'WAIT_OBJECT_0 + 1' for the first handle.
+		DWORD Wait(const HANDLE* handles, const DWORD count)
+		{
+			HANDLE waitHandles[MAXIMUM_WAIT_OBJECTS];
+			const DWORD handleCount = min(count, static_cast<DWORD>(MAXIMUM_WAIT_OBJECTS - 1));
+			waitHandles[0] = m_itemPushed.Get();
+			for (DWORD i = 0; i < handleCount; i++)
+				waitHandles[i + 1] = handles[i];
+
+			InterlockedExchange(&m_isConsumerWaiting, 1);
+			if (Front() != nullptr) {
+				InterlockedExchange(&m_isConsumerWaiting, 0);
+				return WAIT_OBJECT_0;
+			}
+
+			const DWORD result = WaitForMultipleObjects(handleCount + 1, waitHandles, FALSE, INFINITE);
+			InterlockedExchange(&m_isConsumerWaiting, 0);
+
+			return result;
+		}
+
+		// Wakes up the producer if it's waiting for a slot, and makes the next 'Emplace' on a full ring fail.
+		void Cancel()
+		{
+			InterlockedExchange(&m_isCancelled, 1);
+			SetEvent(m_slotFreed.Get());
+		}
+
+	private:
+		typedef struct _SPSC_SLOT
+		{
+			alignas(T) BYTE Storage[sizeof(T)];
+
+		} SPSC_SLOT, *PSPSC_SLOT;
+
+		std::unique_ptr<SPSC_SLOT[]> m_slots;
+		ULONG m_capacity;
+		volatile ULONG m_head;
+		volatile ULONG m_tail;
+		volatile LONG m_isConsumerWaiting;
+		volatile LONG m_isProducerWaiting;
+		volatile LONG m_isCancelled;
+		SafeObjectHandle m_itemPushed;
+		SafeObjectHandle m_slotFreed;
+
+		T* SlotAt(const ULONG index) { return reinterpret_cast<T*>(m_slots[index & (m_capacity - 1)].Storage); }
+	};
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+#pragma unmanaged
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "WuString.h"
+#include "WuException.h"
+#include "SafeHandle.h"
+
+constexpr DWORD TEMP_STORE_CHUNK_SIZE      = 0x10000;      // 64 KiB.
+constexpr __uint64 TEMP_STORE_DEFAULT_BUDGET  = 0x8000000;    // 128 MiB.
+
+namespace WindowsUtils::Core
+{
+	/// <summary>
+	/// Scratch streams kept in pooled memory while there is budget, each spilling to its own temporary file after that.
+	/// </summary>
+	/// <remarks>
+	/// Streams are named by the store, the names are not paths and only mean something to 'Open' and 'Delete'.
+	/// Memory comes in 'TEMP_STORE_CHUNK_SIZE' chunks, and chunks from deleted or spilled streams go back to the pool
+	/// for the next stream. A stream that doesn't fit the budget moves to a file created with 'GetTempFileName'
+	/// in the spill directory, so names are never probed, and the file is deleted when the stream is.
+	/// Handles are odd values, so they can't be mistaken for kernel handles, which are multiples of four.
+	/// Streams must be closed before they're deleted. Not thread safe.
+	/// </remarks>
+	class TempStore
+	{
+	public:
+		TempStore(const WWuString& spillDirectory, const __uint64 memoryBudget = TEMP_STORE_DEFAULT_BUDGET);
+		~TempStore();
+
+		TempStore(const TempStore&) = delete;
+		TempStore& operator=(const TempStore&) = delete;
+
+		WuString CreateName();
+		bool IsStoreName(const char* name) const;
+		static bool IsStoreHandle(const INT_PTR handle);
+
+		// These follow the C runtime file functions, failures return -1.
+		INT_PTR Open(const char* name, const bool create);
+		UINT Read(const INT_PTR handle, void* buffer, const UINT count);
+		UINT Write(const INT_PTR handle, const void* buffer, const UINT count);
+		long Seek(const INT_PTR handle, const long distance, const int origin);
+		int Close(const INT_PTR handle);
+		int Delete(const char* name);
+
+	private:
+		typedef struct _TEMP_STORE_STREAM
+		{
+			std::vector<std::unique_ptr<BYTE[]>>  Chunks;
+			__uint64                              Size;
+			std::unique_ptr<FileHandle>           SpillFile;
+
+		} TEMP_STORE_STREAM, *PTEMP_STORE_STREAM;
+
+		typedef struct _TEMP_STORE_HANDLE
+		{
+			PTEMP_STORE_STREAM  Stream;
+			__uint64            Position;
+
+		} TEMP_STORE_HANDLE, *PTEMP_STORE_HANDLE;
+
+		WWuString m_spillDirectory;
+		__uint64 m_memoryBudget;
+		__uint64 m_allocatedSize;
+		std::vector<std::unique_ptr<BYTE[]>> m_pool;
+		std::unordered_map<DWORD, std::unique_ptr<TEMP_STORE_STREAM>> m_streams;
+		DWORD m_nextId;
+
+		bool TryGetId(const char* name, DWORD& id) const;
+		bool TryReserve(TEMP_STORE_STREAM& stream, const __uint64 size);
+		void Spill(TEMP_STORE_STREAM& stream);
+		void ReleaseChunks(TEMP_STORE_STREAM& stream);
+		UINT ReadAt(TEMP_STORE_STREAM& stream, const __uint64 position, void* buffer, const UINT count);
+		void WriteAt(TEMP_STORE_STREAM& stream, const __uint64 position, const void* buffer, const UINT count);
+		static PTEMP_STORE_HANDLE FromHandle(const INT_PTR handle);
+	};
+}
@@ -0,0 +1,48 @@
+#pragma once
+#pragma unmanaged
+
+#include <vector>
+
+namespace WindowsUtils::Core
+{
+	typedef struct _TIMER_WHEEL_ENTRY
+	{
+		ULONGLONG  Due;         // Milliseconds, same clock as 'GetTickCount64'.
+		ULONG_PTR  Key;
+		DWORD      Kind;
+		DWORD      Sequence;    // So the owner can tell a stale timer from the current one.
+
+	} TIMER_WHEEL_ENTRY, *PTIMER_WHEEL_ENTRY;
+
+	/// <summary>
+	/// Hashed timer wheel, for lots of timers with a coarse resolution.
+	/// </summary>
+	/// <remarks>
+	/// Each slot holds the timers due in one tick, and timers further than one turn away share the slot
+	/// and stay there until they're due. Scheduling is constant time, and advancing only looks at the slots
+	/// the clock went through. Timers don't fire early, but can fire up to a tick late.
+	/// Any thread can schedule. Only one thread advances the wheel, and waits for the time it returns.
+	/// </remarks>
+	class TimerWheel
+	{
+	public:
+		TimerWheel(const DWORD slotCount, const DWORD tickMilliseconds);
+
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		// True if this is now the next timer to fire, and the thread advancing the wheel has to wake up sooner.
+		bool Schedule(const ULONGLONG due, const ULONG_PTR key, const DWORD kind, const DWORD sequence);
+
+		// Moves the timers due until 'now' to 'expired'. Returns the milliseconds to the next timer, or 'INFINITE'.
+		DWORD Advance(const ULONGLONG now, std::vector<TIMER_WHEEL_ENTRY>& expired);
+
+	private:
+		std::vector<std::vector<TIMER_WHEEL_ENTRY>> m_slots;
+		DWORD m_tick;
+		ULONGLONG m_currentTick;
+		ULONGLONG m_nextDue;
+		size_t m_count;
+		SRWLOCK m_lock;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#pragma unmanaged
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "WuString.h"
+#include "WuException.h"
+#include "SafeHandle.h"
+
+constexpr DWORD WRITE_BACK_BUFFER_SIZE  = 0x100000;    // 1 MiB.
+constexpr DWORD WRITE_BACK_BUFFER_COUNT = 4;
+
+namespace WindowsUtils::Core
+{
+	class WriteBackFile;
+
+	typedef struct _WRITE_BACK_BUFFER
+	{
+		OVERLAPPED               Overlapped;
+		SafeObjectHandle         Event;
+		std::unique_ptr<BYTE[]>  Data;
+		DWORD                    Size;
+		WriteBackFile*           File;
+
+	} WRITE_BACK_BUFFER, *PWRITE_BACK_BUFFER;
+
+	/// <summary>
+	/// Writes files from a bounded pool of large buffers, with a writer thread flushing them with overlapped I/O.
+	/// </summary>
+	/// <remarks>
+	/// The thread producing the data copies it to a buffer, and hands the buffer to the writer when it's full.
+	/// When all buffers are queued or being written the producer waits, so memory use is bounded, and the producer
+	/// only waits on the disk when it's faster than it.
+	/// Errors from the writer are raised in the producer, on the next call to 'Write' or 'Flush'.
+	/// Only one thread can produce data for a queue. Files must be destroyed before the queue that writes them.
+	/// </remarks>
+	class WriteBackQueue
+	{
+	public:
+		WriteBackQueue(const DWORD bufferCount = WRITE_BACK_BUFFER_COUNT, const DWORD bufferSize = WRITE_BACK_BUFFER_SIZE);
+		~WriteBackQueue();
+
+		WriteBackQueue(const WriteBackQueue&) = delete;
+		WriteBackQueue& operator=(const WriteBackQueue&) = delete;
+
+		// Copies 'data' to the end of the file. Full buffers are handed to the writer.
+		void Write(WriteBackFile& file, const BYTE* data, DWORD size);
+
+		// Hands the last buffer of the file to the writer, and waits until all its data is written.
+		void Flush(WriteBackFile& file);
+
+	private:
+		friend class WriteBackFile;
+
+		DWORD m_bufferSize;
+		std::vector<std::unique_ptr<WRITE_BACK_BUFFER>> m_buffers;
+		size_t m_fillingCount;
+
+		SRWLOCK m_lock;
+		std::deque<PWRITE_BACK_BUFFER> m_free;
+		std::deque<PWRITE_BACK_BUFFER> m_queued;
+		bool m_isStopping;
+
+		SafeObjectHandle m_freeSemaphore;
+		SafeObjectHandle m_queuedEvent;
+		SafeObjectHandle m_writtenEvent;
+		volatile LONG m_error;
+		HANDLE m_writer;
+
+		PWRITE_BACK_BUFFER CreateBuffer();
+		PWRITE_BACK_BUFFER AcquireBuffer();
+		void ReleaseBuffer(PWRITE_BACK_BUFFER buffer);
+		void Submit(WriteBackFile& file);
+		void WaitFile(WriteBackFile& file);
+		void ThrowIfFailed();
+
+		void IssueWrite(PWRITE_BACK_BUFFER buffer, std::deque<PWRITE_BACK_BUFFER>& inFlight);
+		void CompleteWrite(PWRITE_BACK_BUFFER buffer, DWORD error);
+		static DWORD WINAPI WriterThread(LPVOID params);
+	};
+
+	/// <summary>
+	/// A file written through a 'WriteBackQueue'.
+	/// </summary>
+	/// <remarks>
+	/// The file is created for overlapped I/O, and its clusters are reserved up front from the final size.
+	/// Destroying it waits for the writes in flight, but doesn't write data that wasn't flushed.
+	/// </remarks>
+	class WriteBackFile
+	{
+	public:
+		WriteBackFile(WriteBackQueue& queue, const WWuString& path, const __uint64 size);
+		~WriteBackFile();
+
+		WriteBackFile(const WriteBackFile&) = delete;
+		WriteBackFile& operator=(const WriteBackFile&) = delete;
+
+	private:
+		friend class WriteBackQueue;
+
+		WriteBackQueue& m_queue;
+		FileHandle m_handle;
+		__uint64 m_offset;
+		PWRITE_BACK_BUFFER m_current;
+		volatile LONG m_pending;
+	};
+}
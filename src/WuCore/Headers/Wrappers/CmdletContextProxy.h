@@ -3,6 +3,7 @@
 
 #include "../Support/Notification.h"
 #include "../Engine/ProcessAndThread.h"
+#include "../Engine/Containers.h"
 
 #pragma managed
 
@@ -10,6 +11,7 @@
 #include "NativeException.h"
 #include "Types/NetworkTypes.h"
 #include "Types/ProcThreadTypes.h"
+#include "Types/ContainersTypes.h"
 
 namespace WindowsUtils::Core
 {
@@ -176,6 +178,24 @@ namespace WindowsUtils::Core
 						ObjectHandle^ objHandle = gcnew ObjectHandle(*reinterpret_cast<OBJECT_HANDLE*>(obj));
 						m_objectDelegate(objHandle);
 					} break;
+
+					case WriteOutputType::CabinetFileInfo:
+					{
+						CabinetFileInfo^ fileInfo = gcnew CabinetFileInfo(*reinterpret_cast<PCABINET_FILE_ENTRY_INFO>(obj));
+						m_objectDelegate(fileInfo);
+					} break;
+
+					case WriteOutputType::CabinetTestInfo:
+					{
+						CabinetTestInfo^ testInfo = gcnew CabinetTestInfo(*reinterpret_cast<PCABINET_TEST_INFO>(obj));
+						m_objectDelegate(testInfo);
+					} break;
+
+					case WriteOutputType::CabinetFileContent:
+					{
+						CabinetFileContent^ fileContent = gcnew CabinetFileContent(*reinterpret_cast<PCABINET_FILE_CONTENT_INFO>(obj));
+						m_objectDelegate(fileContent);
+					} break;
 				}
 			}
 		}
@@ -17,7 +17,14 @@ namespace WindowsUtils::Wrappers
 		ContainersWrapper(Core::CmdletContextProxy^ context)
 			: WrapperBase(context) { }
 		
-		void ExpandArchiveFile(String^ path, String^ destination, ArchiveFileType type);
-		void CompressArchiveFile(String^ path, String^ destination, String^ namePrefix, int maxCabSize, CabinetCompressionType compressionType, ArchiveFileType type);
+		void ExpandArchiveFile(String^ path, String^ destination, array<String^>^ include, array<String^>^ exclude, int throttleLimit, bool useIndex, ArchiveFileType type);
+		void ExpandArchiveFileToMemory(String^ path, array<String^>^ include, array<String^>^ exclude, int throttleLimit, bool useIndex, ArchiveFileType type);
+		void GetArchiveFileContent(String^ path, ArchiveFileType type);
+		void TestArchiveFile(String^ path, int throttleLimit, ArchiveFileType type);
+		void CompressArchiveFile(String^ path, String^ destination, String^ namePrefix, int maxCabSize, CabinetCompressionType compressionType, int throttleLimit, bool deduplicate, ArchiveFileType type);
+		void UpdateArchiveFile(String^ path, String^ destination, String^ namePrefix, CabinetCompressionType compressionType, int throttleLimit, ArchiveFileType type);
+
+	private:
+		static Core::CabinetFileFilter GetFileFilter(array<String^>^ include, array<String^>^ exclude);
 	};
 }
\ No newline at end of file
@@ -26,6 +26,8 @@ namespace WindowsUtils::Wrappers
 		// Start-Tcping
 		void StartTcpPing(String^ destination, Int32 port, Int32 count, Int32 timeout, Int32 interval, Int32 failThreshold, bool continuous,
 			bool jitter, bool fqdn, bool force, bool single, String^ outFile, bool append, [Out] bool% isCancel);
+		void StartTcpPingParallel(array<String^>^ destination, array<Int32>^ port, Int32 count, Int32 timeout, Int32 interval, Int32 failThreshold, bool continuous,
+			bool jitter, bool fqdn, bool force, bool single, [Out] bool% isCancel);
 
 		// Get-NetworkFile
 		List<NetworkFileInfo^>^ GetNetworkFile(String^ computerName, String^ basePath, String^ userName, bool includeSessionName);
@@ -35,6 +37,7 @@ namespace WindowsUtils::Wrappers
 
 		// Test-Port
 		void TestNetworkPort(String^ destination, UInt32 port, TransportProtocol protocol, UInt32 timeout);
+		void ScanNetworkPorts(array<String^>^ destination, array<Int32>^ port, UInt32 timeout, Int32 throttleLimit);
 
 		// Get-NetworkStatistics
 		void GetIpRouteTable();
@@ -0,0 +1,193 @@
+#pragma once
+#pragma unmanaged
+
+#include "../../Engine/Containers.h"
+
+#pragma managed
+
+/*
+*	Important note about types:
+*
+*	PowerShell for some reason lists the properties in the reverse order than declared here.
+*	An easy way to deal with it is to declare properties 'upside-down'.
+*	This avoids us having to mess with 'format'/'types' files.
+*
+*	For classes with inheritance, it seems to list first the child properties, then
+*	the parent ones.
+*
+*	Remember: what matters is what shows up to the user.
+*/
+
+namespace WindowsUtils
+{
+	using namespace System;
+
+	public enum class CabinetFileSpan
+	{
+		None                      = static_cast<int>(Core::CabinetFileSpan::None),
+		ContinuedFromPrevious     = static_cast<int>(Core::CabinetFileSpan::ContinuedFromPrevious),
+		ContinuedToNext           = static_cast<int>(Core::CabinetFileSpan::ContinuedToNext),
+		ContinuedPreviousAndNext  = static_cast<int>(Core::CabinetFileSpan::ContinuedPreviousAndNext),
+	};
+
+	public ref class CabinetFileInfo
+	{
+	public:
+		property CabinetFileSpan Span { CabinetFileSpan get() { return static_cast<CabinetFileSpan>(m_wrapper->Span); } }
+		property UInt32 FolderOffset { UInt32 get() { return m_wrapper->FolderOffset; } }
+		property UInt16 FolderIndex { UInt16 get() { return m_wrapper->FolderIndex; } }
+		property UInt16 CabinetIndex { UInt16 get() { return m_wrapper->CabinetIndex; } }
+		property String^ Cabinet { String^ get() { return gcnew String(m_wrapper->Cabinet.Raw()); } }
+		property System::IO::FileAttributes Attributes {
+			System::IO::FileAttributes get()
+			{
+				// Only the attributes FCI stores, '_A_EXEC' and '_A_NAME_IS_UTF' have no 'FileAttributes' equivalent.
+				return static_cast<System::IO::FileAttributes>(m_wrapper->Attributes & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_ARCHIVE));
+			}
+		}
+		property DateTime^ LastWriteTime {
+			DateTime^ get()
+			{
+				// Cabinets store the local time.
+				::FILETIME fileTime;
+				if (!DosDateTimeToFileTime(m_wrapper->Date, m_wrapper->Time, &fileTime))
+					return nullptr;
+
+				__int64 timeQuadPart = ULARGE_INTEGER { fileTime.dwLowDateTime, fileTime.dwHighDateTime }.QuadPart;
+				return DateTime::SpecifyKind(DateTime::FromFileTimeUtc(timeQuadPart), DateTimeKind::Local);
+			}
+		}
+		property UInt32 Size { UInt32 get() { return m_wrapper->Size; } }
+		property String^ Name { String^ get() { return gcnew String(m_wrapper->Name.Raw()); } }
+
+		CabinetFileInfo(const Core::CABINET_FILE_ENTRY_INFO& info) { m_wrapper = new Core::CABINET_FILE_ENTRY_INFO(info); }
+		~CabinetFileInfo() { delete m_wrapper; }
+
+	protected:
+		!CabinetFileInfo() { delete m_wrapper; }
+
+	private:
+		Core::PCABINET_FILE_ENTRY_INFO m_wrapper;
+	};
+
+	public ref class CabinetFileContent
+	{
+	public:
+		property array<Byte>^ Content { array<Byte>^ get() { return m_content; } }
+		property String^ Cabinet { String^ get() { return gcnew String(m_wrapper->Cabinet.Raw()); } }
+		property System::IO::FileAttributes Attributes {
+			System::IO::FileAttributes get()
+			{
+				return static_cast<System::IO::FileAttributes>(m_wrapper->Attributes & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM | FILE_ATTRIBUTE_ARCHIVE));
+			}
+		}
+		property DateTime^ LastWriteTime {
+			DateTime^ get()
+			{
+				::FILETIME fileTime;
+				if (!DosDateTimeToFileTime(m_wrapper->Date, m_wrapper->Time, &fileTime))
+					return nullptr;
+
+				__int64 timeQuadPart = ULARGE_INTEGER { fileTime.dwLowDateTime, fileTime.dwHighDateTime }.QuadPart;
+				return DateTime::SpecifyKind(DateTime::FromFileTimeUtc(timeQuadPart), DateTimeKind::Local);
+			}
+		}
+		property UInt32 Size { UInt32 get() { return m_wrapper->Size; } }
+		property String^ Name { String^ get() { return gcnew String(m_wrapper->Name.Raw()); } }
+
+		// A read-only stream over 'Content', nothing is copied.
+		System::IO::MemoryStream^ OpenStream() { return gcnew System::IO::MemoryStream(m_content, false); }
+
+		CabinetFileContent(const Core::CABINET_FILE_CONTENT_INFO& info)
+		{
+			// The native buffer goes back to the pool once we return.
+			m_wrapper = new Core::CABINET_FILE_CONTENT_INFO(info);
+			m_wrapper->Data = nullptr;
+
+			m_content = gcnew array<Byte>(static_cast<int>(info.Size));
+			if (info.Size > 0)
+				System::Runtime::InteropServices::Marshal::Copy(IntPtr(const_cast<BYTE*>(info.Data)), m_content, 0, m_content->Length);
+		}
+
+		~CabinetFileContent() { delete m_wrapper; }
+
+	protected:
+		!CabinetFileContent() { delete m_wrapper; }
+
+	private:
+		Core::PCABINET_FILE_CONTENT_INFO m_wrapper;
+		array<Byte>^ m_content;
+	};
+
+	public ref class CabinetFolderError
+	{
+	public:
+		property String^ Message {
+			String^ get()
+			{
+				if (m_wrapper->Message.Length() > 0)
+					return gcnew String(m_wrapper->Message.Raw());
+
+				return (gcnew System::ComponentModel::Win32Exception(m_wrapper->ErrorCode))->Message;
+			}
+		}
+		property Int32 ErrorCode { Int32 get() { return m_wrapper->ErrorCode; } }
+		property String^ Cabinet { String^ get() { return gcnew String(m_wrapper->Cabinet.Raw()); } }
+		property UInt32 BlockIndex { UInt32 get() { return m_wrapper->BlockIndex; } }
+		property UInt32 FolderIndex { UInt32 get() { return m_wrapper->FolderIndex; } }
+
+		CabinetFolderError(const Core::CABINET_FOLDER_ERROR_INFO& info) { m_wrapper = new Core::CABINET_FOLDER_ERROR_INFO(info); }
+		~CabinetFolderError() { delete m_wrapper; }
+
+	protected:
+		!CabinetFolderError() { delete m_wrapper; }
+
+	private:
+		Core::PCABINET_FOLDER_ERROR_INFO m_wrapper;
+	};
+
+	public ref class CabinetTestInfo
+	{
+	public:
+		property array<CabinetFolderError^>^ Errors { array<CabinetFolderError^>^ get() { return m_errors; } }
+		property UInt32 SkippedFolderCount { UInt32 get() { return m_wrapper->SkippedFolderCount; } }
+		property Double MBPerSecond {
+			Double get()
+			{
+				if (m_wrapper->ElapsedMilliseconds <= 0)
+					return 0;
+
+				return Math::Round((m_wrapper->UncompressedSize / 1048576.0) / (m_wrapper->ElapsedMilliseconds / 1000), 2);
+			}
+		}
+		property TimeSpan Duration { TimeSpan get() { return TimeSpan::FromMilliseconds(m_wrapper->ElapsedMilliseconds); } }
+		property UInt64 UncompressedSize { UInt64 get() { return m_wrapper->UncompressedSize; } }
+		property UInt64 BlockCount { UInt64 get() { return m_wrapper->BlockCount; } }
+		property UInt32 FileCount { UInt32 get() { return m_wrapper->FileCount; } }
+		property UInt32 FolderCount { UInt32 get() { return m_wrapper->FolderCount; } }
+		property UInt32 CabinetCount { UInt32 get() { return m_wrapper->CabinetCount; } }
+		property Boolean IsValid { Boolean get() { return m_errors->Length == 0; } }
+		property String^ Path { String^ get() { return gcnew String(m_wrapper->Path.Raw()); } }
+
+		CabinetTestInfo(const Core::CABINET_TEST_INFO& info)
+		{
+			m_wrapper = new Core::CABINET_TEST_INFO(info);
+
+			m_errors = gcnew array<CabinetFolderError^>(static_cast<int>(info.Errors.Count()));
+			int index = 0;
+			for (const Core::CABINET_FOLDER_ERROR_INFO& error : info.Errors) {
+				m_errors[index] = gcnew CabinetFolderError(error);
+				index++;
+			}
+		}
+
+		~CabinetTestInfo() { delete m_wrapper; }
+
+	protected:
+		!CabinetTestInfo() { delete m_wrapper; }
+
+	private:
+		Core::PCABINET_TEST_INFO m_wrapper;
+		array<CabinetFolderError^>^ m_errors;
+	};
+}
@@ -161,6 +161,8 @@ namespace WindowsUtils::Network
 	public ref class TcpingStatistics sealed
 	{
 	public:
+		property String^ Destination { String^ get() { return gcnew String(m_wrapper->Destination.Raw()); } }
+		property UInt32 Port { UInt32 get() { return m_wrapper->Port; } }
 		property UInt32 Sent { UInt32 get() { return m_wrapper->Sent; } }
 		property UInt32 Succeeded { UInt32 get() { return m_wrapper->Successful; } }
 		property UInt32 Failed { UInt32 get() { return m_wrapper->Failed; } }
@@ -172,6 +174,11 @@ namespace WindowsUtils::Network
 		property Double AvgJitter { Double get() { return m_wrapper->AvgJitter; } }
 		property Double TotalMilliseconds { Double get() { return m_wrapper->TotalMilliseconds; } }
 		property Double TotalJitter { Double get() { return m_wrapper->TotalJitter; } }
+		property Double P50Rtt { Double get() { return m_wrapper->P50Rtt; } }
+		property Double P90Rtt { Double get() { return m_wrapper->P90Rtt; } }
+		property Double P99Rtt { Double get() { return m_wrapper->P99Rtt; } }
+		property Double P999Rtt { Double get() { return m_wrapper->P999Rtt; } }
+		property Double InterarrivalJitter { Double get() { return m_wrapper->InterarrivalJitter; } }
 
 		TcpingStatistics(const Core::TCPING_STATISTICS& info) { m_wrapper = new Core::TCPING_STATISTICS(info); }
 		~TcpingStatistics() { delete m_wrapper; }
@@ -64,6 +64,9 @@ namespace WindowsUtils::Wrappers
 		static WWuString GetWideStringFromSystemString(String^ string);
 		static void GetAptFromPath(String^ path, Core::AbstractPathTree* apt);
 
+		// Tools\Helpers\Measure-DirectoryEnumeration.ps1
+		static Int64 CountFileSystemEntries(String^ path, Int32 threadCount);
+
 		static inline DateTime^ GetDateTimeFromFileTime(const ::FILETIME fileTime)
 		{
 			__int64 ftQuadPart = static_cast<__int64>(fileTime.dwHighDateTime) << 32 | fileTime.dwLowDateTime;
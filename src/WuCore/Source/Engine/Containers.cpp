@@ -5,81 +5,158 @@
 namespace WindowsUtils::Core
 {
 	FDIProgress::FDIProgress(const WuNativeContext* context, const DWORD cabSetCount, const __uint64 totalUncSize)
-		: m_context(context), CabinetSetCount(cabSetCount), CompletedCabinetCount(), CabinetName(), CurrentFile(),
-		CurrentUncompressedSize(), CompletedSize(), TotalUncompressedSize(totalUncSize) { }
+		: ProgressAggregator(context, totalUncSize, 0, cabSetCount) { }
 
 	FDIProgress::~FDIProgress() { }
 
-	void FDIProgress::Notify()
+	void FDIProgress::ReportFile(const WWuString& cabinetName, const DWORD cabinetIndex, const WWuString& file, const DWORD size)
 	{
-		float floatPercent = (static_cast<float>(CompletedSize) / TotalUncompressedSize);
+		SetContainer(cabinetName, cabinetIndex);
+		SetCurrentItem(file);
+		AddCompleted(size, 1);
+	}
+
+	MAPPED_PROGRESS_DATA FDIProgress::GetProgressData(const PROGRESS_STATE& state) const
+	{
+		float floatPercent = state.TotalSize == 0 ? 1 : (static_cast<float>(state.CompletedSize) / state.TotalSize);
 		floatPercent *= 100;
 		long percentComplete = lround(floatPercent);
-		WWuString status = WWuString::Format(L"Cabinet %d/%d: %ws. File: %ws. %ld/%ld", CompletedCabinetCount, CabinetSetCount, CabinetName.Raw(), CurrentFile.Raw(), CompletedSize, TotalUncompressedSize);
+		WWuString status = WWuString::Format(L"Cabinet %d/%d: %ws. File: %ws. %lld/%lld", state.ContainerIndex, state.ContainerCount,
+			state.Container.Raw(), state.CurrentItem.Raw(), state.CompletedSize, state.TotalSize);
 
-		MAPPED_PROGRESS_DATA progressData(
+		return MAPPED_PROGRESS_DATA(
 			L"Expanding cabinet...", 0, nullptr, -1, static_cast<WORD>(percentComplete), ProgressRecordType::Processing, -1, status.Raw()
 		);
-
-		m_context->NativeWriteProgress(&progressData);
 	}
 		
 	FCIProgress::FCIProgress(const WuNativeContext* context, const DWORD totalFileCount, const __uint64 totalUncSize)
-		: m_context(context), CabinetName(), CurrentFile(), CompletedFileCount(), TotalFileCount(totalFileCount),
-		CurrentUncompressedSize(), CompletedSize(), TotalUncompressedSize(totalUncSize) { }
+		: ProgressAggregator(context, totalUncSize, totalFileCount, 0) { }
 
 	FCIProgress::~FCIProgress() { }
 
-	void FCIProgress::Notify()
+	MAPPED_PROGRESS_DATA FCIProgress::GetProgressData(const PROGRESS_STATE& state) const
 	{
-		float floatPercent = (static_cast<float>(CompletedSize) / TotalUncompressedSize);
+		float floatPercent = state.TotalSize == 0 ? 1 : (static_cast<float>(state.CompletedSize) / state.TotalSize);
 		floatPercent *= 100;
 		long percentComplete = lround(floatPercent);
 
 		WWuString status = WWuString::Format(
 			L"File %d/%d: %ws. Cabinet: %ws. %lld/%lld",
-			CompletedFileCount,
-			TotalFileCount,
-			CurrentFile.Raw(),
-			CabinetName.Raw(),
-			CompletedSize,
-			TotalUncompressedSize
+			state.CompletedItems,
+			state.TotalItems,
+			state.CurrentItem.Raw(),
+			state.Container.Raw(),
+			state.CompletedSize,
+			state.TotalSize
 		);
 
-		MAPPED_PROGRESS_DATA progressData(
+		return MAPPED_PROGRESS_DATA(
 			L"Compressing files...", 0, nullptr, -1, static_cast<WORD>(percentComplete), ProgressRecordType::Processing, -1, status.Raw()
 		);
+	}
+
+	CabinetTestProgress::CabinetTestProgress(const WuNativeContext* context, const DWORD folderCount, const __uint64 totalUncSize)
+		: ProgressAggregator(context, totalUncSize, folderCount, 0) { }
 
-		m_context->NativeWriteProgress(&progressData);
+	CabinetTestProgress::~CabinetTestProgress() { }
+
+	MAPPED_PROGRESS_DATA CabinetTestProgress::GetProgressData(const PROGRESS_STATE& state) const
+	{
+		float floatPercent = state.TotalSize == 0 ? 1 : (static_cast<float>(state.CompletedSize) / state.TotalSize);
+		floatPercent *= 100;
+		long percentComplete = lround(floatPercent);
+		WWuString status = WWuString::Format(L"Folder %d/%d. %lld/%lld", state.CompletedItems, state.TotalItems, state.CompletedSize, state.TotalSize);
+
+		return MAPPED_PROGRESS_DATA(
+			L"Testing cabinet...", 0, nullptr, -1, static_cast<WORD>(percentComplete), ProgressRecordType::Processing, -1, status.Raw()
+		);
 	}
 
-	CabinetOperationInfo::CabinetOperationInfo(const WWuString* destination, FDIProgress* progress)
-		: Operation(CabinetOperation::FDI), Destination(destination), Info(FDI{ progress, nullptr }) { }
+	CabinetOperationInfo::CabinetOperationInfo(const WWuString* destination, FDIProgress* progress, const CabinetFileFilter* filter, DirectoryCache* directories)
+		: Operation(CabinetOperation::FDI), Destination(destination), Info(FDI{ progress, filter, directories }) { }
 
-	CabinetOperationInfo::CabinetOperationInfo(const WWuString* destination, FCIProgress* progress, const WWuString* nameTemplate)
-		: Operation(CabinetOperation::FCI), Destination(destination), Info(FCI{ progress, nameTemplate }) { }
+	CabinetOperationInfo::CabinetOperationInfo(const WWuString* destination, FCIProgress* progress, const WWuString* nameTemplate, TempStore* tempFiles, SourcePrefetcher* sources)
+		: Operation(CabinetOperation::FCI), Destination(destination), Info(FCI{ progress, nameTemplate, tempFiles, sources }) { }
 
 	CabinetOperationInfo::~CabinetOperationInfo() { }
 
+	bool CabinetFileFilter::IsEmpty() const
+	{
+		return Include.Count() == 0 && Exclude.Count() == 0;
+	}
+
+	bool CabinetFileFilter::IsMatch(const WWuString& relativePath) const
+	{
+		if (IsEmpty())
+			return true;
+
+		const WWuString fileName = IO::StripPath(relativePath);
+		if (Include.Count() > 0 && !MatchesAny(Include, relativePath, fileName))
+			return false;
+
+		return !MatchesAny(Exclude, relativePath, fileName);
+	}
+
+	bool CabinetFileFilter::MatchesAny(const WuList<WWuString>& patterns, const WWuString& relativePath, const WWuString& fileName)
+	{
+		for (const WWuString& pattern : patterns) {
+			const WWuString& target = pattern.Contains(L'\\') ? relativePath : fileName;
+			if (PathMatchSpec(target.Raw(), pattern.Raw()))
+				return true;
+		}
+
+		return false;
+	}
+
 #pragma region Containers
 
-	void Containers::ExpandCabinetFile(const WWuString& path, const WWuString& destination, const WuNativeContext* context)
+	void Containers::ExpandCabinetFile(const WWuString& path, const WWuString& destination, const CabinetFileFilter& filter, const DWORD throttleLimit, const bool useIndex, const WuNativeContext* context)
 	{
 		if (!PathFileExists(path.Raw()))
 			_WU_RAISE_NATIVE_EXCEPTION(ERROR_FILE_NOT_FOUND, L"PathFileExists", WriteErrorCategory::ObjectNotFound);
 
+		if (!PathIsDirectory(destination.Raw()))
+			_WU_RAISE_NATIVE_EXCEPTION(ERROR_FILE_NOT_FOUND, L"PathIsDirectory", WriteErrorCategory::ObjectNotFound);
+
+		// We decode the cabinet ourselves, straight from the mapped volumes, when we support
+		// all the compression types in the set. Otherwise we fall back to FDI.
+		// The sidecar index saves walking the file tables of sets we open over and over.
+		std::unique_ptr<CabinetSet> cabinetSet = useIndex ? CabinetIndexFile::OpenSet(path) : std::make_unique<CabinetSet>(path);
+		CabinetSetIndex index(*cabinetSet);
+
+		// Remembers the directories created for the files, so we don't probe the same ones for every file.
+		DirectoryCache directories(destination);
+		const auto& folders = cabinetSet->Folders();
+		if (std::all_of(folders.begin(), folders.end(), [](const CABINET_FOLDER& folder) { return CabinetDecompressor::IsSupported(folder.CompressionType); })) {
+			CABINET_FOLDER_SELECTION folderFiles;
+			const __uint64 selectedSize = SelectFiles(*cabinetSet, filter, folderFiles);
+
+			FDIProgress progressInfo{ context, static_cast<DWORD>(cabinetSet->Volumes().size()), selectedSize };
+			ExpandCabinetSet(*cabinetSet, index, folderFiles, directories, throttleLimit, progressInfo);
+
+			return;
+		}
+
 		// Getting directory name.
-		WWuString wideDir = IO::RemoveFileSpec(path, true);
-		
-		WuString directory = wideDir.ToNarrow();
-		WuList<CabinetProcessingInfo> cabInfoList(4);
-		const auto sizeInfo = GetCabinetTotalUncompressedSize(path, wideDir, cabInfoList);
+		WuString directory = IO::RemoveFileSpec(path, true).ToNarrow();
+
+		// FDI skips files it already extracted from a previous cabinet, so we count each name once.
+		__uint64 totalSize = index.TotalUncompressedSize();
+		if (!filter.IsEmpty()) {
+			totalSize = 0;
+			for (const CABINET_FOLDER& folder : folders) {
+				for (const CABINET_FILE_INFO& info : folder.Files) {
+					if (index.FindFile(info.Name) == &info && filter.IsMatch(info.GetRelativePath()))
+						totalSize += info.Size;
+				}
+			}
+		}
 
-		FDIProgress progressInfo{ context, static_cast<DWORD>(cabInfoList.Count()), std::get<0>(sizeInfo) };
+		FDIProgress progressInfo{ context, static_cast<DWORD>(cabinetSet->Volumes().size()), totalSize };
 
-		const WWuString firstCab = std::get<1>(sizeInfo);
+		const WWuString& firstCab = cabinetSet->Volumes().front()->Path();
 
-		CabinetOperationInfo operationInfo{ &destination, &progressInfo };
+		CabinetOperationInfo operationInfo{ &destination, &progressInfo, &filter, &directories };
 
 		HFDI hContext;
 		ERF erfError{ };
@@ -99,9 +176,6 @@ namespace WindowsUtils::Core
 		if (hContext == NULL)
 			_WU_RAISE_NATIVE_FDI_EXCEPTION(erfError.erfOper, L"FDICreate", WriteErrorCategory::OpenError);
 
-		if (!PathIsDirectory(destination.Raw()))
-			_WU_RAISE_NATIVE_EXCEPTION(ERROR_FILE_NOT_FOUND, L"PathIsDirectory", WriteErrorCategory::ObjectNotFound);
-
 		// FDICopy does not manage trailing path separator. It just concatenates
 		// file name and file path.
 		if (!directory.EndsWith('\\')) {
@@ -111,8 +185,9 @@ namespace WindowsUtils::Core
 		WuString filePath = firstCab.ToNarrow();
 		WuString fileName = IO::StripPath(firstCab).ToNarrow();
 		WWuString& nextCabinet = std::get<CabinetOperationInfo::FDI>(operationInfo.Info).NextCabinet;
+		DWORD cabinetIndex = 1;
 		do {
-			progressInfo.CabinetName = fileName.ToWide();
+			progressInfo.SetContainer(fileName.ToWide(), cabinetIndex++);
 			nextCabinet.Clear();
 
 			if (!FDICopy(hContext, fileName.Raw(), directory.Raw(), 0, (PFNFDINOTIFY)CabNotify, nullptr, &operationInfo)) {
@@ -125,29 +200,315 @@ namespace WindowsUtils::Core
 			if (nextCabinet.Length() == 0)
 				break;
 
-			CabinetProcessingInfo nextCabInfo{ };
-			if (!TryGetInfoByName(nextCabinet, cabInfoList, nextCabInfo))
-				_WU_RAISE_NATIVE_EXCEPTION(ERROR_FILE_NOT_FOUND, L"GetInfoByName", WriteErrorCategory::ObjectNotFound);
+			const CabinetVolume* nextVolume = index.FindVolume(nextCabinet);
+			if (nextVolume == nullptr)
+				_WU_RAISE_NATIVE_EXCEPTION(ERROR_FILE_NOT_FOUND, L"CabinetSetIndex::FindVolume", WriteErrorCategory::ObjectNotFound);
 
-			filePath = nextCabInfo.Path.ToNarrow();
-			fileName = IO::StripPath(nextCabInfo.Path).ToNarrow();
+			filePath = nextVolume->Path().ToNarrow();
+			fileName = nextVolume->Name().ToNarrow();
 
 		} while (nextCabinet.Length() != 0);
 
 		if (hContext)
 			FDIDestroy(hContext);
+
+		progressInfo.Complete();
+	}
+
+	void Containers::ExpandCabinetToMemory(const WWuString& path, const CabinetFileFilter& filter, const DWORD throttleLimit, const bool useIndex, const WuNativeContext* context)
+	{
+		if (!PathFileExists(path.Raw()))
+			_WU_RAISE_NATIVE_EXCEPTION(ERROR_FILE_NOT_FOUND, L"PathFileExists", WriteErrorCategory::ObjectNotFound);
+
+		std::unique_ptr<CabinetSet> cabinetSet = useIndex ? CabinetIndexFile::OpenSet(path) : std::make_unique<CabinetSet>(path);
+		CabinetSetIndex index(*cabinetSet);
+
+		CABINET_MEMORY_EXPAND_DATA expandData{ cabinetSet.get(), &index };
+		InitializeSRWLock(&expandData.ReadyLock);
+		InitializeSRWLock(&expandData.ErrorLock);
+		const __uint64 selectedSize = SelectFiles(*cabinetSet, filter, expandData.FolderFiles);
+
+		// There's no FDI fallback, FDI only writes to files.
+		const auto& folders = cabinetSet->Folders();
+		std::vector<__uint64> decodeSize(folders.Count());
+		for (size_t i = 0; i < folders.Count(); i++) {
+			if (expandData.FolderFiles[i].empty())
+				continue;
+
+			if (!CabinetDecompressor::IsSupported(folders[i].CompressionType)) {
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_NOT_SUPPORTED, L"ExpandCabinetToMemory", WriteErrorCategory::NotImplemented,
+					WWuString::Format(L"Cabinet folder %zu uses a compression type that can only be expanded to disk.", i));
+			}
+
+			for (const CABINET_FILE_INFO* info : expandData.FolderFiles[i])
+				decodeSize[i] = max(decodeSize[i], static_cast<__uint64>(info->FolderOffset) + info->Size);
+
+			expandData.FolderOrder.push_back(i);
+		}
+
+		if (expandData.FolderOrder.empty())
+			return;
+
+		std::stable_sort(expandData.FolderOrder.begin(), expandData.FolderOrder.end(), [&decodeSize](const size_t left, const size_t right) {
+			return decodeSize[left] > decodeSize[right];
+		});
+
+		FDIProgress progress{ context, static_cast<DWORD>(cabinetSet->Volumes().size()), selectedSize };
+		BufferPool buffers(CAB_EXPAND_MEMORY_BUDGET);
+		expandData.Buffers = &buffers;
+
+		SafeObjectHandle readyEvent{ CreateEvent(nullptr, FALSE, FALSE, nullptr), true };
+		if (readyEvent.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateEvent", WriteErrorCategory::ResourceUnavailable);
+
+		expandData.ReadyEvent = readyEvent.Get();
+
+		const size_t workerCount = min(min(static_cast<size_t>(max(throttleLimit, 1)), expandData.FolderOrder.size()), static_cast<size_t>(MAXIMUM_WAIT_OBJECTS));
+		expandData.ActiveWorkers = static_cast<LONG>(workerCount);
+
+		DWORD createdCount = 0;
+		HANDLE workers[MAXIMUM_WAIT_OBJECTS]{ };
+		for (; createdCount < workerCount; createdCount++) {
+			DWORD threadId;
+			workers[createdCount] = CreateThread(NULL, 0, ExpandFolderToMemoryWorker, &expandData, 0, &threadId);
+			if (workers[createdCount] == NULL)
+				break;
+		}
+
+		if (createdCount == 0)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+
+		InterlockedAdd(&expandData.ActiveWorkers, -static_cast<LONG>(workerCount - createdCount));
+
+		// Only we can write to the pipeline. Writing can also throw, when the pipeline is stopped for instance.
+		try {
+			WriteMemoryFiles(expandData, progress, context);
+			progress.Complete();
+		}
+		catch (...) {
+			InterlockedExchange(&expandData.IsCancelled, 1);
+			buffers.Cancel();
+
+			// The workers use our stack, they can't outlive us.
+			for (DWORD i = 0; i < createdCount; i++) {
+				WaitForSingleObject(workers[i], INFINITE);
+				CloseHandle(workers[i]);
+			}
+
+			throw;
+		}
+
+		// They're all leaving, or gone.
+		for (DWORD i = 0; i < createdCount; i++) {
+			WaitForSingleObject(workers[i], INFINITE);
+			CloseHandle(workers[i]);
+		}
+
+		if (expandData.Error)
+			throw WuException(*expandData.Error);
+	}
+
+	void Containers::ListCabinetContent(const WWuString& path, const WuNativeContext* context)
+	{
+		if (!PathFileExists(path.Raw()))
+			_WU_RAISE_NATIVE_EXCEPTION(ERROR_FILE_NOT_FOUND, L"PathFileExists", WriteErrorCategory::ObjectNotFound);
+
+		WWuString directory = IO::RemoveFileSpec(path, true);
+
+		// 'Moving' to the first cabinet. We keep a single volume mapped, and
+		// write the entries as we read them, so memory use doesn't depend on the set size.
+		auto volume = std::make_unique<CabinetVolume>(path);
+		for (DWORD count = 0; !WuString::IsNullOrEmpty(volume->PreviousCabinet()); count++) {
+			if (count > 0xFFFF)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"ListCabinetContent", WriteErrorCategory::InvalidData, L"Cabinet set chain is circular.");
+
+			volume = std::make_unique<CabinetVolume>(CabinetSet::GetSiblingPath(directory, volume->PreviousCabinet().ToWide()));
+		}
+
+		CABINET_FILE_INFO info{ };
+		CABINET_FILE_ENTRY_INFO entry{ };
+		for (DWORD cabinetIndex = 1; ; cabinetIndex++) {
+			if (cabinetIndex > 0xFFFF)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"ListCabinetContent", WriteErrorCategory::InvalidData, L"Cabinet set chain is circular.");
+
+			const CAB_HEADER& header = volume->Header();
+			entry.Cabinet = volume->Name();
+			entry.CabinetIndex = static_cast<WORD>(cabinetIndex);
+
+			DWORD offset = header.FirstFileOffset;
+			for (WORD i = 0; i < header.FileCount; i++) {
+				volume->ReadFileEntry(offset, info);
+
+				switch (info.FolderIndex) {
+					case cffileCONTINUED_FROM_PREV:
+						entry.FolderIndex = 0;
+						entry.Span = CabinetFileSpan::ContinuedFromPrevious;
+						break;
+
+					case cffileCONTINUED_TO_NEXT:
+						entry.FolderIndex = header.FolderCount - 1;
+						entry.Span = CabinetFileSpan::ContinuedToNext;
+						break;
+
+					case cffileCONTINUED_PREV_AND_NEXT:
+						entry.FolderIndex = 0;
+						entry.Span = CabinetFileSpan::ContinuedPreviousAndNext;
+						break;
+
+					default:
+						entry.FolderIndex = info.FolderIndex;
+						entry.Span = CabinetFileSpan::None;
+						break;
+				}
+
+				entry.Name          = info.GetRelativePath();
+				entry.Size          = info.Size;
+				entry.Date          = info.Date;
+				entry.Time          = info.Time;
+				entry.Attributes    = info.Attributes;
+				entry.FolderOffset  = info.FolderOffset;
+
+				context->NativeWriteObject(&entry, WriteOutputType::CabinetFileInfo);
+			}
+
+			if (WuString::IsNullOrEmpty(volume->NextCabinet()))
+				break;
+
+			volume = std::make_unique<CabinetVolume>(CabinetSet::GetSiblingPath(directory, volume->NextCabinet().ToWide()));
+		}
+	}
+
+	void Containers::TestCabinetFile(const WWuString& path, const DWORD throttleLimit, const WuNativeContext* context)
+	{
+		if (!PathFileExists(path.Raw()))
+			_WU_RAISE_NATIVE_EXCEPTION(ERROR_FILE_NOT_FOUND, L"PathFileExists", WriteErrorCategory::ObjectNotFound);
+
+		WuStopWatch stopWatch = WuStopWatch::StartNew();
+
+		// Headers and file tables are checked opening the set, a bad one fails the whole set.
+		CabinetSet cabinetSet(path);
+		const auto& folders = cabinetSet.Folders();
+
+		CABINET_TEST_DATA testData{ &cabinetSet };
+		testData.Results.resize(folders.Count());
+		InitializeSRWLock(&testData.ErrorLock);
+
+		__uint64 totalSize = 0;
+		for (size_t i = 0; i < folders.Count(); i++) {
+			testData.FolderOrder.push_back(i);
+			totalSize += folders[i].UncompressedSize;
+		}
+
+		// Biggest folders first, like the extraction.
+		std::stable_sort(testData.FolderOrder.begin(), testData.FolderOrder.end(), [&folders](const size_t left, const size_t right) {
+			return folders[left].UncompressedSize > folders[right].UncompressedSize;
+		});
+
+		CabinetTestProgress progress{ context, static_cast<DWORD>(folders.Count()), totalSize };
+		testData.Progress = &progress;
+
+		const size_t workerCount = min(min(static_cast<size_t>(max(throttleLimit, 1)), max(testData.FolderOrder.size(), 1)), static_cast<size_t>(MAXIMUM_WAIT_OBJECTS));
+
+		DWORD createdCount = 0;
+		HANDLE workers[MAXIMUM_WAIT_OBJECTS]{ };
+		for (; createdCount < workerCount; createdCount++) {
+			DWORD threadId;
+			workers[createdCount] = CreateThread(NULL, 0, TestFolderWorker, &testData, 0, &threadId);
+			if (workers[createdCount] == NULL)
+				break;
+		}
+
+		if (createdCount == 0)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+
+		DWORD waitResult;
+		try {
+			do {
+				waitResult = WaitForMultipleObjects(createdCount, workers, TRUE, PROGRESS_MIN_INTERVAL);
+				progress.Emit();
+
+			} while (waitResult == WAIT_TIMEOUT);
+
+			progress.Complete();
+		}
+		catch (...) {
+			// Writing the progress throws when the pipeline is stopped. The workers use our stack, they can't outlive us.
+			InterlockedExchange(&testData.IsCancelled, 1);
+			for (DWORD i = 0; i < createdCount; i++) {
+				WaitForSingleObject(workers[i], INFINITE);
+				CloseHandle(workers[i]);
+			}
+
+			throw;
+		}
+
+		DWORD waitError = ERROR_SUCCESS;
+		if (waitResult == WAIT_FAILED) {
+			waitError = GetLastError();
+
+			// The workers use our stack, they can't outlive us.
+			InterlockedExchange(&testData.IsCancelled, 1);
+			for (DWORD i = 0; i < createdCount; i++)
+				WaitForSingleObject(workers[i], INFINITE);
+		}
+
+		for (DWORD i = 0; i < createdCount; i++)
+			CloseHandle(workers[i]);
+
+		if (testData.Error)
+			throw WuException(*testData.Error);
+
+		if (waitError != ERROR_SUCCESS)
+			_WU_RAISE_NATIVE_EXCEPTION(waitError, L"WaitForMultipleObjects", WriteErrorCategory::InvalidResult);
+
+		stopWatch.Stop();
+
+		CABINET_TEST_INFO testInfo{ cabinetSet.Volumes().front()->Path() };
+		testInfo.CabinetCount         = static_cast<DWORD>(cabinetSet.Volumes().size());
+		testInfo.FolderCount          = static_cast<DWORD>(folders.Count());
+		testInfo.FileCount            = cabinetSet.FileCount();
+		testInfo.ElapsedMilliseconds  = stopWatch.ElapsedMilliseconds();
+		for (const CABINET_FOLDER_TEST_RESULT& result : testData.Results) {
+			testInfo.BlockCount += result.BlockCount;
+			testInfo.UncompressedSize += result.UncompressedSize;
+			if (result.IsSkipped)
+				testInfo.SkippedFolderCount++;
+
+			if (result.HasError)
+				testInfo.Errors.Add(result.Error);
+		}
+
+		context->NativeWriteObject(&testInfo, WriteOutputType::CabinetTestInfo);
 	}
 
 	void Containers::CreateCabinetFile(AbstractPathTree& apt, const WWuString& destination, const WWuString& nameTemplate,
-		const CabinetCompressionType compressionType, ULONG splitSize, const WuNativeContext* context)
+		const CabinetCompressionType compressionType, ULONG splitSize, const DWORD throttleLimit, const bool deduplicate, const WuNativeContext* context)
 	{
 		FCIProgress progressInfo{ context, apt.FileCount, apt.TotalLength };
 
+		IO::CreateFolderTree(destination);
+
+		// We compress the folders ourselves, in parallel, when we have an encoder for the
+		// compression type and every folder fits in a volume. Otherwise we fall back to FCI.
+		// Only our cabinets can deduplicate, FCI can't point two files to the same data.
+		if (apt.FileCount > 0 && CabinetFolderCompressor::IsSupported(static_cast<WORD>(compressionType))) {
+			std::vector<DWORD> duplicates;
+			if (deduplicate)
+				duplicates = CabinetDeduplicator::FindDuplicates(apt, throttleLimit);
+
+			std::vector<CABINET_PLANNED_FOLDER> folders;
+			CabinetWriter::PlanFolders(apt, min(CAB_WRITER_FOLDER_THRESHOLD, static_cast<__uint64>(splitSize >> 1)), folders, deduplicate ? &duplicates : nullptr);
+
+			CabinetWriter writer(destination, nameTemplate, static_cast<WORD>(compressionType), splitSize);
+			if (std::all_of(folders.begin(), folders.end(), [&writer](const CABINET_PLANNED_FOLDER& folder) { return writer.CanWrite(folder); })) {
+				CreateCabinetSet(folders, writer, destination, compressionType, throttleLimit, progressInfo);
+				return;
+			}
+		}
+
 		CCAB cCab{ };
 		ERF erfError{ };
 
-		IO::CreateFolderTree(destination);
-
 		// Initializing.
 		cCab.cb = splitSize;
 		cCab.cbFolderThresh = 0x7FFFFFFF;
@@ -155,7 +516,22 @@ namespace WindowsUtils::Core
 		cCab.iDisk = 0;
 		cCab.setID = 666;
 
-		CabinetOperationInfo operationInfo{ &destination, &progressInfo, &nameTemplate };
+		// FCI scratch data stays in memory, up to a budget, instead of going through temporary files.
+		WCHAR tempPathBuffer[MAX_PATH + 1];
+		if (!GetTempPath(MAX_PATH + 1, tempPathBuffer))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"GetTempPath", WriteErrorCategory::InvalidResult);
+
+		TempStore tempFiles(tempPathBuffer);
+
+		// Source files are opened and read ahead, in the order they're added.
+		std::vector<WWuString> sourcePaths;
+		for (const AbstractPathTree::AptEntry& aptEntry : apt.GetApt()) {
+			if (aptEntry.Type == FsObjectType::File)
+				sourcePaths.push_back(apt.GetFullPath(aptEntry));
+		}
+
+		SourcePrefetcher sources(std::move(sourcePaths));
+		CabinetOperationInfo operationInfo{ &destination, &progressInfo, &nameTemplate, &tempFiles, &sources };
 
 		FciNextCabinet(&cCab, 0, &operationInfo);
 
@@ -165,11 +541,11 @@ namespace WindowsUtils::Core
 			(PFNFCIFILEPLACED)FciFilePlaced,
 			(PFNFCIALLOC)CabAlloc,
 			(PFNFCIFREE)CabFree,
-			(PFNFCIOPEN)CabOpen,
-			(PFNFCIREAD)CabRead,
-			(PFNFCIWRITE)CabWrite,
-			(PFNFCICLOSE)CabClose,
-			(PFNFCISEEK)CabSeek,
+			(PFNFCIOPEN)FciOpen,
+			(PFNFCIREAD)FciRead,
+			(PFNFCIWRITE)FciWrite,
+			(PFNFCICLOSE)FciClose,
+			(PFNFCISEEK)FciSeek,
 			(PFNFCIDELETE)FciDelete,
 			(PFNFCIGETTEMPFILE)FciGetTempFile,
 			&cCab,
@@ -180,13 +556,13 @@ namespace WindowsUtils::Core
 			_WU_RAISE_NATIVE_FCI_EXCEPTION(erfError.erfOper, L"FCICreate", WriteErrorCategory::OpenError);
 
 		// Adding files to cabinet.
-		for (AbstractPathTree::AptEntry& aptEntry : apt.GetApt()) {
+		for (const AbstractPathTree::AptEntry& aptEntry : apt.GetApt()) {
 			if (aptEntry.Type == FsObjectType::File) {
 
-				progressInfo.CurrentFile = aptEntry.Name;
+				progressInfo.SetCurrentItem(apt.GetName(aptEntry));
 
-				WuString narrFullPath = aptEntry.FullPath.ToMb(CP_UTF8);
-				WuString narrRelPath = aptEntry.RelativePath.ToNarrow();
+				WuString narrFullPath = apt.GetFullPath(aptEntry).ToMb(CP_UTF8);
+				WuString narrRelPath = apt.GetRelativePath(aptEntry).ToNarrow();
 
 				if (!FCIAddFile(
 					hContext,
@@ -202,9 +578,8 @@ namespace WindowsUtils::Core
 					_WU_RAISE_NATIVE_FCI_EXCEPTION(erfError.erfOper, L"FCIAddFile", WriteErrorCategory::WriteError);
 				}
 
-				progressInfo.CompletedSize += aptEntry.Length;
-				progressInfo.CompletedFileCount++;
-				progressInfo.Notify();
+				progressInfo.AddCompleted(aptEntry.Length, 1);
+				progressInfo.Emit();
 			}
 		}
 
@@ -214,6 +589,7 @@ namespace WindowsUtils::Core
 		}
 
 		FCIDestroy(hContext);
+		progressInfo.Complete();
 
 		// Moving files to destination.
 		WCHAR currentDirBuff[MAX_PATH + 1];
@@ -241,211 +617,685 @@ namespace WindowsUtils::Core
 		}
 	}
 
-	std::tuple<__uint64, WWuString> Containers::GetCabinetTotalUncompressedSize(const WWuString& path, const WWuString& directory, WuList<CabinetProcessingInfo>& cabInfoList)
+	void Containers::UpdateCabinetFile(AbstractPathTree& apt, const WWuString& destination, const WWuString& nameTemplate,
+		const CabinetCompressionType compressionType, const DWORD throttleLimit, const WuNativeContext* context)
 	{
-		__uint64 totalSize = 0;
-		HRESULT result = S_OK;
+		if (!CabinetFolderCompressor::IsSupported(static_cast<WORD>(compressionType)))
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_NOT_SUPPORTED, L"UpdateCabinetFile", WriteErrorCategory::NotImplemented, L"Cabinets can only be updated with 'None' or 'MSZip' compression.");
+
+		const WWuString cabinetPath = CabinetSet::GetSiblingPath(destination, nameTemplate + L"01.cab");
+		CabinetAppender appender(cabinetPath, static_cast<WORD>(compressionType));
+
+		// Existing files by path. A name stored more than once is replaced everywhere.
+		const std::vector<CABINET_FILE_INFO>& storedFiles = appender.Files();
+		std::unordered_map<WWuString, std::vector<size_t>, CabinetNameHash> storedIndex;
+		for (size_t i = 0; i < storedFiles.size(); i++)
+			storedIndex[storedFiles[i].GetRelativePath()].push_back(i);
+
+		// New files, and the ones that changed since they were stored, are compressed into new folders.
+		const auto& entries = apt.GetApt();
+		std::vector<bool> selected(entries.size());
+		DWORD selectedCount = 0;
+		__uint64 selectedSize = 0;
+		for (size_t i = 0; i < entries.size(); i++) {
+			if (entries[i].Type != FsObjectType::File)
+				continue;
+
+			const auto stored = storedIndex.find(apt.GetRelativePath(entries[i]));
+			if (stored != storedIndex.end()) {
+				if (!IsSourceChanged(apt.GetFullPath(entries[i]), storedFiles[stored->second.front()], appender.LastWriteTime()))
+					continue;
+
+				for (const size_t storedFile : stored->second)
+					appender.DropFile(storedFile);
+			}
 
-		// 'Moving' to the first cabinet.
-		bool hasPrevious;
-		UINT fileCount = 0;
-		WWuString currentPath = path;
-		CabinetProcessingInfo currentCabInfo{ };
-		do {
-			if (!TryGetInfoByPath(currentPath, cabInfoList, currentCabInfo)) {
-				MemoryMappedFile mappedFile(currentPath);
+			selected[i] = true;
+			selectedCount++;
+			selectedSize += entries[i].Length;
+		}
 
-				currentCabInfo = GetCabinetInformation(mappedFile);
-				currentCabInfo.Path = currentPath;
-				currentCabInfo.Name = IO::StripPath(currentPath);
+		if (selectedCount == 0)
+			return;
+
+		// The folder table grows into the space before the data. If the usual
+		// folders don't fit we try fewer, bigger ones, only split by file count.
+		std::vector<CABINET_PLANNED_FOLDER> folders;
+		CabinetWriter::PlanFolders(apt, CAB_WRITER_FOLDER_THRESHOLD, folders, nullptr, &selected);
+		if (folders.size() > appender.GetFolderRoom()) {
+			folders.clear();
+			CabinetWriter::PlanFolders(apt, MAXULONGLONG, folders, nullptr, &selected);
+			if (folders.size() > appender.GetFolderRoom())
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_INSUFFICIENT_BUFFER, L"UpdateCabinetFile", WriteErrorCategory::LimitsExceeded, L"There's no room for more folders in the cabinet, it needs to be created again.");
+		}
 
-				fileCount += currentCabInfo.FileCount;
-				cabInfoList.Add(currentCabInfo);
-			}
+		for (const CABINET_PLANNED_FOLDER& folder : folders) {
+			if ((folder.UncompressedSize + CAB_MAX_BLOCK_UNCOMPRESSED - 1) / CAB_MAX_BLOCK_UNCOMPRESSED > MAXWORD)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_FILE_TOO_LARGE, L"UpdateCabinetFile", WriteErrorCategory::LimitsExceeded, L"The cabinet would be bigger than 2Gb.");
+		}
 
-			if (!WuString::IsNullOrEmpty(currentCabInfo.PreviousCabinet)) {
-				hasPrevious = true;
+		FCIProgress progressInfo{ context, selectedCount, selectedSize };
+		CreateCabinetSet(folders, appender, destination, compressionType, throttleLimit, progressInfo);
+	}
 
-				// Dir size + file name size + possible '\' + \0
-				size_t pathBufSize = directory.Length() + currentCabInfo.PreviousCabinet.Length() + 2;
-				auto pathBuffer = std::make_unique<WCHAR[]>(pathBufSize);
-				result = PathCchCombine(pathBuffer.get(), pathBufSize, directory.Raw(), currentCabInfo.PreviousCabinet.ToWide().Raw());
-				if (result != S_OK)
-					_WU_RAISE_NATIVE_EXCEPTION(result, L"PathCchCombine", WriteErrorCategory::InvalidResult);
+	void Containers::ExpandCabinetSet(const CabinetSet& cabinetSet, const CabinetSetIndex& index, CABINET_FOLDER_SELECTION& folderFiles, DirectoryCache& directories, const DWORD throttleLimit, FDIProgress& progress)
+	{
+		CABINET_EXPAND_DATA expandData{ &cabinetSet, &index, &directories, &progress, std::move(folderFiles) };
+		InitializeSRWLock(&expandData.ErrorLock);
 
-				currentPath = pathBuffer.get();
-			}
-			else {
-				hasPrevious = false;
+		// Folders are decoded up to the end of their last selected file.
+		std::vector<__uint64> decodeSize(expandData.FolderFiles.size());
+		for (size_t i = 0; i < expandData.FolderFiles.size(); i++) {
+			for (const CABINET_FILE_INFO* info : expandData.FolderFiles[i])
+				decodeSize[i] = max(decodeSize[i], static_cast<__uint64>(info->FolderOffset) + info->Size);
+
+			if (!expandData.FolderFiles[i].empty())
+				expandData.FolderOrder.push_back(i);
+		}
+
+		if (expandData.FolderOrder.empty())
+			return;
+
+		// Biggest folders go first, so a big folder doesn't start
+		// last and keep one worker busy while the others are idle.
+		std::stable_sort(expandData.FolderOrder.begin(), expandData.FolderOrder.end(), [&decodeSize](const size_t left, const size_t right) {
+			return decodeSize[left] > decodeSize[right];
+		});
+
+		// Each worker takes a whole folder, there's no point having more workers than folders.
+		const size_t workerCount = min(min(static_cast<size_t>(max(throttleLimit, 1)), expandData.FolderOrder.size()), static_cast<size_t>(MAXIMUM_WAIT_OBJECTS));
+
+		DWORD createdCount = 0;
+		HANDLE workers[MAXIMUM_WAIT_OBJECTS]{ };
+		for (; createdCount < workerCount; createdCount++) {
+			DWORD threadId;
+			workers[createdCount] = CreateThread(NULL, 0, ExpandFolderWorker, &expandData, 0, &threadId);
+			if (workers[createdCount] == NULL)
 				break;
+		}
+
+		// If we managed to create at least one worker we go with what we have.
+		if (createdCount == 0)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+
+		// Workers can't write to the pipeline, so we write the progress for them while they work.
+		DWORD waitResult;
+		try {
+			do {
+				waitResult = WaitForMultipleObjects(createdCount, workers, TRUE, PROGRESS_MIN_INTERVAL);
+				progress.Emit();
+
+			} while (waitResult == WAIT_TIMEOUT);
+
+			progress.Complete();
+		}
+		catch (...) {
+			// Writing the progress throws when the pipeline is stopped. The workers use our stack, they can't outlive us.
+			InterlockedExchange(&expandData.IsCancelled, 1);
+			for (DWORD i = 0; i < createdCount; i++) {
+				WaitForSingleObject(workers[i], INFINITE);
+				CloseHandle(workers[i]);
 			}
 
-		} while (hasPrevious);
+			throw;
+		}
 
-		// At this point this is the first cab.
-		WWuString filePath = currentCabInfo.Path;
+		DWORD waitError = ERROR_SUCCESS;
+		if (waitResult == WAIT_FAILED) {
+			waitError = GetLastError();
 
-		// Processing each cabinet until there is no next.
-		bool hasNext;
-		WuList<WuString> processedFiles(fileCount);
-		do {
-			__uint64 filePointer = 0;
-			MemoryMappedFile mappedFile(currentPath);
+			// The workers use our stack, they can't outlive us.
+			InterlockedExchange(&expandData.IsCancelled, 1);
+			for (DWORD i = 0; i < createdCount; i++)
+				WaitForSingleObject(workers[i], INFINITE);
+		}
 
-			// Checking list because we might not been through all cabs.
-			if (!TryGetInfoByPath(currentPath, cabInfoList, currentCabInfo)) {
-				MemoryMappedFile mappedFile(currentPath);
+		for (DWORD i = 0; i < createdCount; i++)
+			CloseHandle(workers[i]);
 
-				currentCabInfo = GetCabinetInformation(mappedFile);
-				currentCabInfo.Path = currentPath;
-				currentCabInfo.Name = IO::StripPath(currentPath);
+		if (expandData.Error)
+			throw WuException(*expandData.Error);
 
-				cabInfoList.Add(currentCabInfo);
-			}
+		if (waitError != ERROR_SUCCESS)
+			_WU_RAISE_NATIVE_EXCEPTION(waitError, L"WaitForMultipleObjects", WriteErrorCategory::InvalidResult);
+	}
 
-			// Advancing to the first CFFILE entry.
-			filePointer += currentCabInfo.CFFileOffset;
+	DWORD WINAPI Containers::ExpandFolderWorker(LPVOID params)
+	{
+		auto expandData = reinterpret_cast<PCABINET_EXPAND_DATA>(params);
+		const LONG folderCount = static_cast<LONG>(expandData->FolderOrder.size());
 
-			// Going through each CFFILE entry.
-			for (WORD i = 0; i < currentCabInfo.FileCount; i++) {
-				DWORD currentSize = *reinterpret_cast<LPDWORD>((BYTE*)mappedFile.data() + filePointer);
-				filePointer += 16;
+		std::unique_ptr<WuException> error;
+		try {
+			// Each worker decodes while its own writer flushes what was decoded before.
+			WriteBackQueue writeBack;
 
-				// Reading file name.
-				CHAR currentChar;
-				std::vector<CHAR> fileNameBuffer;
-				do {
-					currentChar = *reinterpret_cast<LPSTR>((BYTE*)mappedFile.data() + filePointer);
-					if (currentChar != '\0')
-						fileNameBuffer.push_back(currentChar);
+			LONG next;
+			while (!expandData->IsCancelled && (next = InterlockedIncrement(&expandData->NextFolder) - 1) < folderCount)
+				ExpandFolder(expandData->FolderOrder[next], *expandData, writeBack);
+		}
+		catch (const WuException& ex) {
+			error = std::make_unique<WuException>(ex);
+		}
+		catch (...) {
+			error = std::make_unique<WuNativeException>(_WU_NEW_NATIVE_EXCEPTION(ERROR_UNHANDLED_EXCEPTION, L"ExpandFolder", WriteErrorCategory::NotSpecified));
+		}
 
-					filePointer++;
+		// First error wins, the other workers stop at the next block.
+		if (error) {
+			AcquireSRWLockExclusive(&expandData->ErrorLock);
+			if (!expandData->Error)
+				expandData->Error = std::move(error);
 
-				} while (currentChar != '\0');
+			ReleaseSRWLockExclusive(&expandData->ErrorLock);
+			InterlockedExchange(&expandData->IsCancelled, 1);
+		}
 
-				fileNameBuffer.push_back('\0');
-				if (std::find(processedFiles.begin(), processedFiles.end(), fileNameBuffer.data()) == processedFiles.end()) {
-					totalSize += currentSize;
-					processedFiles.Add(fileNameBuffer.data());
-				}
+		return 0;
+	}
+
+	DWORD WINAPI Containers::TestFolderWorker(LPVOID params)
+	{
+		auto testData = reinterpret_cast<PCABINET_TEST_DATA>(params);
+		const LONG folderCount = static_cast<LONG>(testData->FolderOrder.size());
+
+		std::unique_ptr<WuException> error;
+		try {
+			LONG next;
+			while (!testData->IsCancelled && (next = InterlockedIncrement(&testData->NextFolder) - 1) < folderCount)
+				TestFolder(testData->FolderOrder[next], *testData);
+		}
+		catch (const WuException& ex) {
+			error = std::make_unique<WuException>(ex);
+		}
+		catch (...) {
+			error = std::make_unique<WuNativeException>(_WU_NEW_NATIVE_EXCEPTION(ERROR_UNHANDLED_EXCEPTION, L"TestFolder", WriteErrorCategory::NotSpecified));
+		}
+
+		// Corrupt data is a result, not an error. Errors here are failures of the test itself.
+		if (error) {
+			AcquireSRWLockExclusive(&testData->ErrorLock);
+			if (!testData->Error)
+				testData->Error = std::move(error);
+
+			ReleaseSRWLockExclusive(&testData->ErrorLock);
+			InterlockedExchange(&testData->IsCancelled, 1);
+		}
+
+		return 0;
+	}
+
+	void Containers::TestFolder(const size_t folderIndex, CABINET_TEST_DATA& testData)
+	{
+		const CABINET_FOLDER& folder = testData.Set->Folders()[folderIndex];
+		CABINET_FOLDER_TEST_RESULT& result = testData.Results[folderIndex];
+		if (!CabinetDecompressor::IsSupported(folder.CompressionType)) {
+			result.IsSkipped = true;
+			testData.Progress->AddCompleted(folder.UncompressedSize, 1);
+			return;
+		}
+
+		// Blocks are decoded to the reader's buffer and dropped, checksums are verified as they're read.
+		CabinetFolderReader reader(folder);
+		try {
+			const BYTE* data;
+			DWORD size;
+			while (!testData.IsCancelled && reader.Read(&data, &size)) {
+				result.BlockCount++;
+				testData.Progress->AddCompleted(size, 0);
 			}
 
-			// Checking if there is a next.
-			if (!WuString::IsNullOrEmpty(currentCabInfo.NextCabinet)) {
-				hasNext = true;
+			if (!testData.IsCancelled && reader.Position() < folder.UncompressedSize) {
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_HANDLE_EOF, L"TestFolder", WriteErrorCategory::InvalidData,
+					WWuString::Format(L"Folder decodes to %llu bytes, but its files end at %llu.", reader.Position(), folder.UncompressedSize));
+			}
+		}
+		catch (const WuException& ex) {
+			// The decoders carry state between blocks, there's no point going past the first bad one.
+			result.HasError = true;
+			result.Error = { static_cast<DWORD>(folderIndex), result.BlockCount, reader.CurrentSegment().Volume->Name(), ex.ErrorCode(), ex.Message() };
+		}
 
-				// Dir size + file name size + possible '\' + \0
-				size_t pathBufSize = directory.Length() + currentCabInfo.NextCabinet.Length() + 2;
-				auto pathBuffer = std::make_unique<WCHAR[]>(pathBufSize);
-				result = PathCchCombine(pathBuffer.get(), pathBufSize, directory.Raw(), currentCabInfo.NextCabinet.ToWide().Raw());
-				if (result != S_OK)
-					_WU_RAISE_NATIVE_EXCEPTION(result, L"PathCchCombine", WriteErrorCategory::InvalidResult);
+		result.UncompressedSize = reader.Position();
+		testData.Progress->AddCompleted(folder.UncompressedSize > reader.Position() ? folder.UncompressedSize - reader.Position() : 0, 1);
+	}
 
-				currentPath = pathBuffer.get();
+	void Containers::ExpandFolder(const size_t folderIndex, CABINET_EXPAND_DATA& expandData, WriteBackQueue& writeBack)
+	{
+		// For progress, the folder belongs to the volume where it starts.
+		const CABINET_FOLDER& folder = expandData.Set->Folders()[folderIndex];
+		const CabinetVolume& volume = *folder.Segments[0].Volume;
+		const DWORD volumeIndex = expandData.Index->GetFolderVolumeIndex(folderIndex);
+
+		CabinetFolderReader reader(folder);
+		std::vector<CabinetOutputFile> openFiles;
+		const auto& files = expandData.FolderFiles[folderIndex];
+		const size_t fileCount = files.size();
+		size_t nextFile = 0;
+
+		// Files can share ranges of the folder, so we keep a list of the files
+		// the current block overlaps, instead of writing one file at a time.
+		__uint64 blockStart = 0;
+		while (nextFile < fileCount || !openFiles.empty()) {
+			if (expandData.IsCancelled)
+				return;
+
+			const BYTE* data = nullptr;
+			DWORD size = 0;
+			const bool endOfFolder = !reader.Read(&data, &size);
+			const __uint64 blockEnd = blockStart + size;
+
+			while (nextFile < fileCount) {
+				const CABINET_FILE_INFO& info = *files[nextFile];
+				if (info.FolderOffset > blockEnd || (info.FolderOffset == blockEnd && info.Size > 0))
+					break;
+
+				CabinetOutputFile file{ &info, CreateTargetPath(info.GetRelativePath(), *expandData.Directories) };
+				file.Writer = std::make_unique<WriteBackFile>(writeBack, file.FullPath, info.Size);
+				openFiles.push_back(std::move(file));
+				nextFile++;
+			}
+
+			for (auto iterator = openFiles.begin(); iterator != openFiles.end();) {
+				const __uint64 fileStart = iterator->Info->FolderOffset;
+				const __uint64 fileEnd = fileStart + iterator->Info->Size;
+				const __uint64 writeStart = max(fileStart, blockStart);
+				const __uint64 writeEnd = min(fileEnd, blockEnd);
+				if (writeEnd > writeStart)
+					writeBack.Write(*iterator->Writer, data + (writeStart - blockStart), static_cast<DWORD>(writeEnd - writeStart));
+
+				if (fileEnd <= blockEnd) {
+					CloseOutputFile(*iterator, writeBack, volume, volumeIndex, *expandData.Progress);
+					iterator = openFiles.erase(iterator);
+				}
+				else
+					iterator++;
 			}
-			else {
-				hasNext = false;
+
+			if (endOfFolder) {
+				if (nextFile < fileCount || !openFiles.empty())
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"ExpandFolder", WriteErrorCategory::InvalidData, L"Cabinet folder ended before all files were extracted.");
+
 				break;
 			}
 
-		} while (hasNext);
+			blockStart = blockEnd;
+		}
+	}
+
+	__uint64 Containers::SelectFiles(const CabinetSet& cabinetSet, const CabinetFileFilter& filter, CABINET_FOLDER_SELECTION& folderFiles)
+	{
+		__uint64 selectedSize = 0;
+		const auto& folders = cabinetSet.Folders();
+		folderFiles.resize(folders.Count());
+		for (size_t i = 0; i < folders.Count(); i++) {
+			for (const CABINET_FILE_INFO& info : folders[i].Files) {
+				if (filter.IsMatch(info.GetRelativePath())) {
+					folderFiles[i].push_back(&info);
+					selectedSize += info.Size;
+				}
+			}
+		}
+
+		return selectedSize;
+	}
+
+	void Containers::CloseOutputFile(CabinetOutputFile& file, WriteBackQueue& writeBack, const CabinetVolume& volume, const DWORD volumeIndex, FDIProgress& progress)
+	{
+		// Attributes and dates are set by path, so all writes must be done and the handle closed.
+		writeBack.Flush(*file.Writer);
+		file.Writer.reset();
+		IO::SetFileAttributesAndDate(file.FullPath, file.Info->Date, file.Info->Time, file.Info->Attributes);
 
-		return { totalSize, filePath };
+		progress.ReportFile(volume.Name(), volumeIndex, file.Info->GetRelativePath(), file.Info->Size);
 	}
 
-	CabinetProcessingInfo Containers::GetCabinetInformation(const MemoryMappedFile& mappedFile)
+	WWuString Containers::CreateTargetPath(const WWuString& relativePath, DirectoryCache& directories)
 	{
-		__uint64 filePointer = 0;
+		auto splitPath = relativePath.Split('\\');
 
-		CHAR signature[5] = { 0 };
-		RtlCopyMemory(signature, mappedFile.data(), 4);
-		if (strcmp(signature, "MSCF") != 0)
-			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"GetCabinetInformation", WriteErrorCategory::InvalidData, L"File is not a cabinet.");
+		const auto& fileName = splitPath.Back();
+		if (IO::ContainsInvalidFileNameChars(fileName))
+			_WU_RAISE_COR_EXCEPTION_WMESS(COR_E_ARGUMENT, L"ContainsInvalidFileNameChars", WriteErrorCategory::InvalidArgument, L"Cabinet file name contains invalid characters.");
 
-		CabinetProcessingInfo cabInfo{ };
+		// The destination exists, only the directories from the cabinet need creating.
+		WuList<WWuString> splitDir(splitPath);
+		splitDir.RemoveBack();
 
-		filePointer += 16;
-		cabInfo.CFFileOffset = *reinterpret_cast<LPDWORD>((BYTE*)mappedFile.data() + filePointer);
+		WWuString relativeDir;
+		IO::CreatePath(splitDir, relativeDir);
+		if (IO::ContainsInvalidPathNameChars(relativeDir))
+			_WU_RAISE_COR_EXCEPTION_WMESS(COR_E_ARGUMENT, L"ContainsInvalidPathNameChars", WriteErrorCategory::InvalidArgument, L"Cabinet destination directory name contains invalid characters.");
 
-		filePointer += 12;
-		cabInfo.FileCount = *reinterpret_cast<LPWORD>((BYTE*)mappedFile.data() + filePointer);
+		directories.CreateTree(splitDir);
 
-		filePointer += 2;
-		WORD flags = *reinterpret_cast<LPWORD>((BYTE*)mappedFile.data() + filePointer);
+		WWuString targetFullName;
+		splitPath.Insert(0, directories.Root());
+		IO::CreatePath(splitPath, targetFullName);
 
-		filePointer += 4;
-		cabInfo.CabinetIndex = *reinterpret_cast<LPWORD>((BYTE*)mappedFile.data() + filePointer);
+		return targetFullName;
+	}
 
-		filePointer += 2;
-		if ((flags & cfhdrRESERVE_PRESENT) > 0) {
-			WORD cbSize = *reinterpret_cast<LPWORD>((BYTE*)mappedFile.data() + filePointer);
-			filePointer = filePointer + cbSize + 2;
+	DWORD WINAPI Containers::ExpandFolderToMemoryWorker(LPVOID params)
+	{
+		auto expandData = reinterpret_cast<PCABINET_MEMORY_EXPAND_DATA>(params);
+		const LONG folderCount = static_cast<LONG>(expandData->FolderOrder.size());
+
+		std::unique_ptr<WuException> error;
+		try {
+			LONG next;
+			while (!expandData->IsCancelled && (next = InterlockedIncrement(&expandData->NextFolder) - 1) < folderCount)
+				ExpandFolderToMemory(expandData->FolderOrder[next], *expandData);
+		}
+		catch (const WuException& ex) {
+			error = std::make_unique<WuException>(ex);
+		}
+		catch (...) {
+			error = std::make_unique<WuNativeException>(_WU_NEW_NATIVE_EXCEPTION(ERROR_UNHANDLED_EXCEPTION, L"ExpandFolderToMemory", WriteErrorCategory::NotSpecified));
 		}
 
-		if ((flags & cfhdrPREV_CABINET) > 0) {
-			std::vector<CHAR> buffer;
-			CHAR currentChar;
-			do {
-				currentChar = *reinterpret_cast<LPSTR>((BYTE*)mappedFile.data() + filePointer);
-				if (currentChar != '\0')
-					buffer.push_back(currentChar);
+		// First error wins. Workers waiting for buffers stop right away, the others at the next block.
+		if (error) {
+			AcquireSRWLockExclusive(&expandData->ErrorLock);
+			if (!expandData->Error)
+				expandData->Error = std::move(error);
+
+			ReleaseSRWLockExclusive(&expandData->ErrorLock);
+			InterlockedExchange(&expandData->IsCancelled, 1);
+			expandData->Buffers->Cancel();
+		}
+
+		// Our files are all queued, the writer can tell we're done.
+		InterlockedDecrement(&expandData->ActiveWorkers);
+		SetEvent(expandData->ReadyEvent);
 
-				filePointer++;
+		return 0;
+	}
+
+	void Containers::ExpandFolderToMemory(const size_t folderIndex, CABINET_MEMORY_EXPAND_DATA& expandData)
+	{
+		const CABINET_FOLDER& folder = expandData.Set->Folders()[folderIndex];
+		const CabinetVolume* volume = folder.Segments[0].Volume;
+		const DWORD volumeIndex = expandData.Index->GetFolderVolumeIndex(folderIndex);
+
+		CabinetFolderReader reader(folder);
+		std::vector<CABINET_MEMORY_FILE> openFiles;
+		const auto& files = expandData.FolderFiles[folderIndex];
+		const size_t fileCount = files.size();
+		size_t nextFile = 0;
+
+		// Same as 'ExpandFolder', but each file is copied to its own buffer.
+		__uint64 blockStart = 0;
+		while (nextFile < fileCount || !openFiles.empty()) {
+			if (expandData.IsCancelled)
+				return;
+
+			const BYTE* data = nullptr;
+			DWORD size = 0;
+			const bool endOfFolder = !reader.Read(&data, &size);
+			const __uint64 blockEnd = blockStart + size;
+
+			while (nextFile < fileCount) {
+				const CABINET_FILE_INFO& info = *files[nextFile];
+				if (info.FolderOffset > blockEnd || (info.FolderOffset == blockEnd && info.Size > 0))
+					break;
+
+				// Only waits for room when we're not holding buffers, see 'BufferPool'.
+				CABINET_MEMORY_FILE file{ &info, volume, volumeIndex, expandData.Buffers->Acquire(info.Size, openFiles.empty()) };
+				if (!file.Buffer)
+					return;
+
+				openFiles.push_back(std::move(file));
+				nextFile++;
+			}
 
-			} while (currentChar != '\0');
+			for (auto iterator = openFiles.begin(); iterator != openFiles.end();) {
+				const __uint64 fileStart = iterator->Info->FolderOffset;
+				const __uint64 fileEnd = fileStart + iterator->Info->Size;
+				const __uint64 writeStart = max(fileStart, blockStart);
+				const __uint64 writeEnd = min(fileEnd, blockEnd);
+				if (writeEnd > writeStart)
+					memcpy(iterator->Buffer->Data.get() + (writeStart - fileStart), data + (writeStart - blockStart), static_cast<size_t>(writeEnd - writeStart));
+
+				if (fileEnd <= blockEnd) {
+					AcquireSRWLockExclusive(&expandData.ReadyLock);
+					expandData.Ready.push_back(std::move(*iterator));
+					ReleaseSRWLockExclusive(&expandData.ReadyLock);
+					SetEvent(expandData.ReadyEvent);
+
+					iterator = openFiles.erase(iterator);
+				}
+				else
+					iterator++;
+			}
 
-			buffer.push_back('\0');
-			cabInfo.PreviousCabinet = buffer.data();
+			if (endOfFolder) {
+				if (nextFile < fileCount || !openFiles.empty())
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"ExpandFolderToMemory", WriteErrorCategory::InvalidData, L"Cabinet folder ended before all files were extracted.");
 
-			// Advancing the file pointer to the end of 'previous disk'.
-			do {
-				currentChar = *reinterpret_cast<LPSTR>((UCHAR*)mappedFile.data() + filePointer);
-				filePointer++;
+				break;
+			}
 
-			} while (currentChar != '\0');
+			blockStart = blockEnd;
 		}
+	}
 
-		if ((flags & cfhdrNEXT_CABINET) > 0) {
-			std::vector<CHAR> buffer;
-			CHAR currentChar;
-			do {
-				currentChar = *reinterpret_cast<LPSTR>((UCHAR*)mappedFile.data() + filePointer);
-				if (currentChar != '\0')
-					buffer.push_back(currentChar);
+	void Containers::WriteMemoryFiles(CABINET_MEMORY_EXPAND_DATA& expandData, FDIProgress& progress, const WuNativeContext* context)
+	{
+		std::deque<CABINET_MEMORY_FILE> ready;
+		CABINET_FILE_CONTENT_INFO content{ };
+		bool isDone;
+		do {
+			if (WaitForSingleObject(expandData.ReadyEvent, PROGRESS_MIN_INTERVAL) == WAIT_FAILED)
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WaitForSingleObject", WriteErrorCategory::InvalidResult);
+
+			// Read before taking the queue. Workers queue their files before leaving, so nothing comes after the last take.
+			isDone = InterlockedCompareExchange(&expandData.ActiveWorkers, 0, 0) == 0;
+
+			AcquireSRWLockExclusive(&expandData.ReadyLock);
+			ready.swap(expandData.Ready);
+			ReleaseSRWLockExclusive(&expandData.ReadyLock);
+
+			// The managed object copies the data, so the buffer can go back to the pool right after.
+			for (CABINET_MEMORY_FILE& file : ready) {
+				if (!expandData.IsCancelled) {
+					content.Name        = file.Info->GetRelativePath();
+					content.Size        = file.Info->Size;
+					content.Date        = file.Info->Date;
+					content.Time        = file.Info->Time;
+					content.Attributes  = file.Info->Attributes;
+					content.Cabinet     = file.Volume->Name();
+					content.Data        = file.Buffer->Data.get();
+
+					context->NativeWriteObject(&content, WriteOutputType::CabinetFileContent);
+					progress.ReportFile(content.Cabinet, file.VolumeIndex, content.Name, content.Size);
+				}
+
+				expandData.Buffers->Release(std::move(file.Buffer));
+			}
+
+			ready.clear();
+			progress.Emit();
+
+		} while (!isDone);
+	}
+
+	void Containers::CreateCabinetSet(std::vector<CABINET_PLANNED_FOLDER>& folders, CabinetFolderWriter& writer, const WWuString& destination,
+		const CabinetCompressionType compressionType, const DWORD throttleLimit, FCIProgress& progress)
+	{
+		CABINET_CREATE_DATA createData{ &folders, &destination, static_cast<WORD>(compressionType) };
+		createData.MemoryBudget = CAB_CREATE_MEMORY_BUDGET;
+		InitializeSRWLock(&createData.ErrorLock);
+
+		// Each worker takes a whole folder, there's no point having more workers than folders.
+		const size_t workerCount = min(min(static_cast<size_t>(max(throttleLimit, 1)), folders.size()), static_cast<size_t>(MAXIMUM_WAIT_OBJECTS));
+
+		// Up to two folders per worker can wait for the writer, so a slow folder doesn't stall the others.
+		const LONG slotCount = static_cast<LONG>(workerCount) * 2;
+		SafeObjectHandle slotSemaphore{ CreateSemaphore(nullptr, slotCount, slotCount, nullptr), true };
+		if (slotSemaphore.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateSemaphore", WriteErrorCategory::ResourceUnavailable);
+
+		SafeObjectHandle folderDoneEvent{ CreateEvent(nullptr, FALSE, FALSE, nullptr), true };
+		if (folderDoneEvent.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateEvent", WriteErrorCategory::ResourceUnavailable);
+
+		createData.SlotSemaphore = slotSemaphore.Get();
+		createData.FolderDoneEvent = folderDoneEvent.Get();
+
+		DWORD createdCount = 0;
+		HANDLE workers[MAXIMUM_WAIT_OBJECTS]{ };
+		for (; createdCount < workerCount; createdCount++) {
+			DWORD threadId;
+			workers[createdCount] = CreateThread(NULL, 0, CompressFolderWorker, &createData, 0, &threadId);
+			if (workers[createdCount] == NULL)
+				break;
+		}
+
+		// If we managed to create at least one worker we go with what we have.
+		if (createdCount == 0)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+
+		// We're the writer. Folders are written in order as they get compressed, and we write the progress for the workers.
+		std::unique_ptr<WuException> writeError;
+		try {
+			for (size_t i = 0; i < folders.size() && !createData.IsCancelled; i++) {
+				CABINET_PLANNED_FOLDER& folder = folders[i];
+				while (!folder.IsCompressed && !createData.IsCancelled) {
+					if (WaitForSingleObject(createData.FolderDoneEvent, PROGRESS_MIN_INTERVAL) == WAIT_FAILED)
+						_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WaitForSingleObject", WriteErrorCategory::InvalidResult);
+
+					progress.SetCompletedSize(static_cast<__uint64>(createData.CompletedSize));
+					progress.Emit();
+				}
+
+				if (createData.IsCancelled)
+					break;
+
+				progress.SetCurrentItem(folder.Files.back().Tree->GetName(*folder.Files.back().Entry));
+				writer.AddFolder(folder);
+				ReleaseSemaphore(createData.SlotSemaphore, 1, nullptr);
+
+				progress.SetContainer(writer.CurrentVolumeName(), 0);
+				progress.AddCompleted(0, static_cast<DWORD>(folder.Files.size()));
+				progress.SetCompletedSize(static_cast<__uint64>(createData.CompletedSize));
+				progress.Emit();
+			}
 
-				filePointer++;
+			if (!createData.IsCancelled) {
+				writer.Close();
+				progress.Complete();
+			}
+		}
+		catch (const WuException& ex) {
+			writeError = std::make_unique<WuException>(ex);
+		}
+		catch (...) {
+			// Anything else, like the pipeline being stopped while writing the progress, goes up as is.
+			// The workers use our stack, they can't outlive us.
+			InterlockedExchange(&createData.IsCancelled, 1);
+			for (DWORD i = 0; i < createdCount; i++) {
+				WaitForSingleObject(workers[i], INFINITE);
+				CloseHandle(workers[i]);
+			}
 
-			} while (currentChar != '\0');
+			throw;
+		}
 
-			buffer.push_back('\0');
-			cabInfo.NextCabinet = buffer.data();
+		// Workers still waiting for a slot, or compressing after an error, stop here.
+		// They use our stack, they can't outlive us.
+		InterlockedExchange(&createData.IsCancelled, 1);
+		if (WaitForMultipleObjects(createdCount, workers, TRUE, INFINITE) == WAIT_FAILED) {
+			for (DWORD i = 0; i < createdCount; i++)
+				WaitForSingleObject(workers[i], INFINITE);
 		}
 
-		return cabInfo;
+		for (DWORD i = 0; i < createdCount; i++)
+			CloseHandle(workers[i]);
+
+		if (createData.Error)
+			throw WuException(*createData.Error);
+
+		if (writeError)
+			throw WuException(*writeError);
 	}
 
-	bool Containers::TryGetInfoByPath(const WWuString& path, const WuList<CabinetProcessingInfo>& list, CabinetProcessingInfo& info)
+	bool Containers::IsSourceChanged(const WWuString& path, const CABINET_FILE_INFO& stored, const FILETIME& cabinetWriteTime)
 	{
-		const auto end = list.end();
-		const auto iterator = std::find_if(list.begin(), end, [&](const CabinetProcessingInfo& item) { return item.Path == path; });
-		if (iterator != end) {
-			info = *iterator;
+		// Files we can't look at are compressed again, the compressor reports the error.
+		WIN32_FILE_ATTRIBUTE_DATA fileData;
+		if (!GetFileAttributesEx(path.Raw(), GetFileExInfoStandard, &fileData))
 			return true;
-		}
 
-		return false;
+		if (fileData.nFileSizeHigh != 0 || fileData.nFileSizeLow != stored.Size)
+			return true;
+
+		// Stored dates are the creation time, like FCI. A file written
+		// in place keeps it, so it's also compared with the cabinet.
+		WORD date, time;
+		FILETIME localTime;
+		if (!FileTimeToLocalFileTime(&fileData.ftCreationTime, &localTime) || !FileTimeToDosDateTime(&localTime, &date, &time))
+			return true;
+
+		if (date != stored.Date || time != stored.Time)
+			return true;
+
+		return CompareFileTime(&fileData.ftLastWriteTime, &cabinetWriteTime) > 0;
 	}
 
-	bool Containers::TryGetInfoByName(const WWuString& name, const WuList<CabinetProcessingInfo>& list, CabinetProcessingInfo& info)
+	DWORD WINAPI Containers::CompressFolderWorker(LPVOID params)
 	{
-		const auto end = list.end();
-		const auto iterator = std::find_if(list.begin(), end, [&](const CabinetProcessingInfo& item) { return item.Name == name; });
-		if (iterator != end) {
-			info = *iterator;
-			return true;
+		auto createData = reinterpret_cast<PCABINET_CREATE_DATA>(params);
+		auto& folders = *createData->Folders;
+		const LONG folderCount = static_cast<LONG>(folders.size());
+
+		std::unique_ptr<WuException> error;
+		try {
+			CabinetFolderCompressor compressor(createData->CompressionType);
+			while (!createData->IsCancelled) {
+				// Waiting for the writer to catch up.
+				const DWORD waitResult = WaitForSingleObject(createData->SlotSemaphore, 200);
+				if (waitResult == WAIT_TIMEOUT)
+					continue;
+
+				if (waitResult != WAIT_OBJECT_0)
+					_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WaitForSingleObject", WriteErrorCategory::InvalidResult);
+
+				// Folders are claimed in order, so the one the writer waits for is always being compressed.
+				const LONG next = InterlockedIncrement(&createData->NextFolder) - 1;
+				if (next >= folderCount) {
+					ReleaseSemaphore(createData->SlotSemaphore, 1, nullptr);
+					break;
+				}
+
+				CABINET_PLANNED_FOLDER& folder = folders[next];
+				folder.Data = std::make_unique<SpillBuffer>(*createData->Destination, &createData->MemoryBudget);
+				if (!compressor.Compress(folder, &createData->IsCancelled, &createData->CompletedSize))
+					break;
+
+				InterlockedExchange(&folder.IsCompressed, 1);
+				SetEvent(createData->FolderDoneEvent);
+			}
+		}
+		catch (const WuException& ex) {
+			error = std::make_unique<WuException>(ex);
+		}
+		catch (...) {
+			error = std::make_unique<WuNativeException>(_WU_NEW_NATIVE_EXCEPTION(ERROR_UNHANDLED_EXCEPTION, L"CompressFolder", WriteErrorCategory::NotSpecified));
 		}
 
-		return false;
+		// First error wins, the writer stops at the next folder.
+		if (error) {
+			AcquireSRWLockExclusive(&createData->ErrorLock);
+			if (!createData->Error)
+				createData->Error = std::move(error);
+
+			ReleaseSRWLockExclusive(&createData->ErrorLock);
+			InterlockedExchange(&createData->IsCancelled, 1);
+			SetEvent(createData->FolderDoneEvent);
+		}
+
+		return 0;
 	}
 
 #pragma region Callbacks
@@ -455,8 +1305,7 @@ namespace WindowsUtils::Core
 		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(cabInfo->pv);
 		auto progressInfo = std::get<CabinetOperationInfo::FDI>(operationInfo->Info).Progress;
 
-		progressInfo->CompletedCabinetCount++;
-		progressInfo->Notify();
+		progressInfo->Emit();
 
 		return 0;
 	}
@@ -468,27 +1317,12 @@ namespace WindowsUtils::Core
 
 		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(cabInfo->pv);
 
-		auto splitPath = relativePath.Split('\\');
-
-		const auto& fileName = splitPath.Back();
-		if (IO::ContainsInvalidFileNameChars(fileName))
-			_WU_RAISE_COR_EXCEPTION_WMESS(COR_E_ARGUMENT, L"ContainsInvalidFileNameChars", WriteErrorCategory::InvalidArgument, L"Cabinet file name contains invalid characters.");
-
-		splitPath.Insert(0,*operationInfo->Destination);
-
-		WuList<WWuString> splitDir(splitPath);
-		splitDir.RemoveBack();
-
-		WWuString targetDir;
-		WWuString targetFullName;
-
-		IO::CreatePath(splitDir, targetDir);
-		if (IO::ContainsInvalidPathNameChars(targetDir))
-			_WU_RAISE_COR_EXCEPTION_WMESS(COR_E_ARGUMENT, L"ContainsInvalidPathNameChars", WriteErrorCategory::InvalidArgument, L"Cabinet destination directory name contains invalid characters.");
-
-		IO::CreateFolderTree(targetDir);
+		// Returning zero tells FDI to skip the file.
+		const CabinetFileFilter* filter = std::get<CabinetOperationInfo::FDI>(operationInfo->Info).Filter;
+		if (filter != nullptr && !filter->IsMatch(relativePath))
+			return 0;
 
-		IO::CreatePath(splitPath, targetFullName);
+		WWuString targetFullName = CreateTargetPath(relativePath, *std::get<CabinetOperationInfo::FDI>(operationInfo->Info).Directories);
 		WuString narrowFullName = targetFullName.ToMb(codePage);
 		INT_PTR hFile = CabOpen(narrowFullName.Raw(), _O_TRUNC | _O_BINARY | _O_CREAT | _O_WRONLY | _O_SEQUENTIAL, _S_IREAD | _S_IWRITE);
 		if (hFile <= 0)
@@ -496,10 +1330,9 @@ namespace WindowsUtils::Core
 
 		auto progressData = std::get<CabinetOperationInfo::FDI>(operationInfo->Info).Progress;
 
-		progressData->CurrentFile = relativePath;
-		progressData->CurrentUncompressedSize = cabInfo->cb;
-		progressData->CompletedSize += cabInfo->cb;
-		progressData->Notify();
+		progressData->SetCurrentItem(relativePath);
+		progressData->AddCompleted(cabInfo->cb, 1);
+		progressData->Emit();
 
 		return hFile;
 	}
@@ -670,32 +1503,104 @@ namespace WindowsUtils::Core
 		return 0;
 	}
 
-	BOOL __cdecl Containers::FciGetTempFile(char* tempName, int cbTemp, void* pv)
+	INT_PTR __cdecl Containers::FciOpen(char* pszFile, int oflag, int pmode, int* err, void* pv)
 	{
-		UNREFERENCED_PARAMETER(pv);
+		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(pv);
+		TempStore* tempFiles = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).TempFiles;
 
-		// Attempting to get temp path.
-		CHAR tempPathBuffer[MAX_PATH + 1];
-		GetTempPathA(MAX_PATH + 1, tempPathBuffer);
+		if (tempFiles->IsStoreName(pszFile)) {
+			INT_PTR result = tempFiles->Open(pszFile, (oflag & _O_CREAT) != 0);
+			if (result == -1)
+				*err = ERROR_FILE_NOT_FOUND;
 
-		// Attempting to get a temporary file name.
-		__int64 index = 0;
-		WuString tempFileName;
-		do {
-			__int64 currentIndex = index;
-			tempFileName = WuString::Format("%sWuCab-%d.tmp", tempPathBuffer, index++);
+			return result;
+		}
 
-			// Check if the file already exists.
-			if (GetFileAttributesA(tempFileName.Raw()) == INVALID_FILE_ATTRIBUTES)
-				break;
+		INT_PTR result = CabOpen(pszFile, oflag, pmode);
+		if (result == -1)
+			*err = GetLastError();
 
-			// Overflowed. We're not going to find a non-existent file name.
-			if (index < currentIndex)
-				_WU_RAISE_COR_EXCEPTION_WMESS(COR_E_OVERFLOW, L"GetTempFile", WriteErrorCategory::LimitsExceeded, L"Could not find a non-existent temporary file name. Clean your %TEMP% location.");
+		return result;
+	}
+
+	UINT __cdecl Containers::FciRead(INT_PTR hf, void* memory, UINT cb, int* err, void* pv)
+	{
+		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(pv);
 
-		} while (true);
+		UINT result;
+		if (TempStore::IsStoreHandle(hf))
+			result = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).TempFiles->Read(hf, memory, cb);
+		else if (SourcePrefetcher::IsPrefetchHandle(hf))
+			result = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).Sources->Read(hf, memory, cb);
+		else
+			result = CabRead(hf, memory, cb);
 
-		strncpy_s(tempName, cbTemp, tempFileName.Raw(), cbTemp);
+		if (result == static_cast<UINT>(-1))
+			*err = GetLastError();
+
+		return result;
+	}
+
+	UINT __cdecl Containers::FciWrite(INT_PTR hf, void* memory, UINT cb, int* err, void* pv)
+	{
+		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(pv);
+
+		UINT result;
+		if (TempStore::IsStoreHandle(hf))
+			result = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).TempFiles->Write(hf, memory, cb);
+		else
+			result = CabWrite(hf, memory, cb);
+
+		if (result == static_cast<UINT>(-1))
+			*err = GetLastError();
+
+		return result;
+	}
+
+	int __cdecl Containers::FciClose(INT_PTR hf, int* err, void* pv)
+	{
+		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(pv);
+
+		int result;
+		if (TempStore::IsStoreHandle(hf))
+			result = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).TempFiles->Close(hf);
+		else if (SourcePrefetcher::IsPrefetchHandle(hf))
+			result = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).Sources->Close(hf);
+		else
+			result = CabClose(hf);
+
+		if (result == -1)
+			*err = GetLastError();
+
+		return result;
+	}
+
+	long __cdecl Containers::FciSeek(INT_PTR hf, long dist, int seektype, int* err, void* pv)
+	{
+		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(pv);
+
+		long result;
+		if (TempStore::IsStoreHandle(hf))
+			result = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).TempFiles->Seek(hf, dist, seektype);
+		else if (SourcePrefetcher::IsPrefetchHandle(hf))
+			result = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).Sources->Seek(hf, dist, seektype);
+		else
+			result = CabSeek(hf, dist, seektype);
+
+		if (result == -1)
+			*err = GetLastError();
+
+		return result;
+	}
+
+	BOOL __cdecl Containers::FciGetTempFile(char* tempName, int cbTemp, void* pv)
+	{
+		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(pv);
+
+		// Store names are short and unique, there's nothing to probe.
+		WuString tempFileName = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).TempFiles->CreateName();
+		if (strcpy_s(tempName, cbTemp, tempFileName.Raw()) != 0)
+			return FALSE;
 
 		return TRUE;
 	}
@@ -707,7 +1612,16 @@ namespace WindowsUtils::Core
 
 	int __cdecl Containers::FciDelete(char* fileName, int* err, void* pv)
 	{
-		UNREFERENCED_PARAMETER(pv);
+		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(pv);
+		TempStore* tempFiles = std::get<CabinetOperationInfo::FCI>(operationInfo->Info).TempFiles;
+		if (tempFiles->IsStoreName(fileName)) {
+			if (tempFiles->Delete(fileName) == -1) {
+				*err = ERROR_FILE_NOT_FOUND;
+				return -1;
+			}
+
+			return 0;
+		}
 
 		int result = 0;
 		if (!DeleteFileA(fileName)) {
@@ -736,8 +1650,8 @@ namespace WindowsUtils::Core
 			pccab->iCab
 		);
 
-		fciInfo.Progress->CabinetName = WuString::ToWide(pccab->szCab);
-		fciInfo.Progress->Notify();
+		fciInfo.Progress->SetContainer(WuString::ToWide(pccab->szCab), pccab->iCab);
+		fciInfo.Progress->Emit();
 
 		return (SUCCEEDED(hr));
 	}
@@ -749,25 +1663,12 @@ namespace WindowsUtils::Core
 
 	INT_PTR __cdecl Containers::FciGetOpenInfo(char* name, USHORT* date, USHORT* time, USHORT* attributes, int* err, void* pv)
 	{
-		INT_PTR hFile;
-		FILETIME fileTime;
-		BY_HANDLE_FILE_INFORMATION fileInfo;
-
-		hFile = CabOpen(name, _O_RDONLY | _O_BINARY, _S_IREAD);
-		if (hFile != -1) {
-			if (GetFileInformationByHandle(reinterpret_cast<HANDLE>(hFile), &fileInfo)
-				&& FileTimeToLocalFileTime(&fileInfo.ftCreationTime, &fileTime)
-				&& FileTimeToDosDateTime(&fileTime, date, time)) {
-				*attributes = static_cast<USHORT>(fileInfo.dwFileAttributes);
-				*attributes &= (_A_RDONLY | _A_HIDDEN | _A_SYSTEM | _A_ARCH);
-			}
-			else {
-				CabClose(hFile);
-				hFile = -1;
-			}
-		}
+		UNREFERENCED_PARAMETER(name);
 
-		return hFile;
+		// FCI asks for the files in the order they're added, the same order they're prefetched.
+		auto operationInfo = reinterpret_cast<CabinetOperationInfo*>(pv);
+
+		return std::get<CabinetOperationInfo::FCI>(operationInfo->Info).Sources->OpenNext(date, time, attributes, err);
 	}
 
 #pragma endregion
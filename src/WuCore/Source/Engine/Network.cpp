@@ -9,13 +9,44 @@ namespace WindowsUtils::Core
 	*/
 
 	_TCPING_STATISTICS::_TCPING_STATISTICS()
-		: Sent(0), Successful(0), Failed(0), FailedPercent(0), MinRtt(0.00), MaxRtt(0.00), AvgRtt(0.00),
-		MinJitter(0.00), MaxJitter(0.00), AvgJitter(0.00), TotalJitter(0.00), TotalMilliseconds(0.00) { }
+		: Port(0), Sent(0), Successful(0), Failed(0), FailedPercent(0), MinRtt(0.00), MaxRtt(0.00), AvgRtt(0.00),
+		MinJitter(0.00), MaxJitter(0.00), AvgJitter(0.00), TotalJitter(0.00), TotalMilliseconds(0.00),
+		P50Rtt(0.00), P90Rtt(0.00), P99Rtt(0.00), P999Rtt(0.00), InterarrivalJitter(0.00), LastRtt(0.00) { }
 
 	_TCPING_STATISTICS::_TCPING_STATISTICS(DWORD sent, DWORD success, DWORD failed, double failPercent, double minRtt, double maxRtt, double avgRtt,
 		double minJitter, double maxJitter, double avgJitter, double totalJitter, double totalMilliseconds)
-		: Sent(sent), Successful(success), Failed(failed), FailedPercent(FailedPercent), MinRtt(minRtt), MaxRtt(maxRtt), AvgRtt(AvgRtt),
-		MinJitter(MinJitter), MaxJitter(maxJitter), AvgJitter(avgJitter), TotalJitter(totalJitter), TotalMilliseconds(TotalMilliseconds) { }
+		: Port(0), Sent(sent), Successful(success), Failed(failed), FailedPercent(failPercent), MinRtt(minRtt), MaxRtt(maxRtt), AvgRtt(avgRtt),
+		MinJitter(minJitter), MaxJitter(maxJitter), AvgJitter(avgJitter), TotalJitter(totalJitter), TotalMilliseconds(totalMilliseconds),
+		P50Rtt(0.00), P90Rtt(0.00), P99Rtt(0.00), P999Rtt(0.00), InterarrivalJitter(0.00), LastRtt(0.00) { }
+
+	void _TCPING_STATISTICS::AddRoundTrip(const double milliseconds)
+	{
+		if (Successful == 0 || milliseconds < MinRtt)
+			MinRtt = milliseconds;
+
+		if (milliseconds > MaxRtt)
+			MaxRtt = milliseconds;
+
+		// J += (|D| - J) / 16. Only the connection is timed, so D is the difference between round trips.
+		if (Successful > 0)
+			InterarrivalJitter += (abs(milliseconds - LastRtt) - InterarrivalJitter) / 16.00;
+
+		RttHistogram.Record(milliseconds);
+		LastRtt = milliseconds;
+		Successful++;
+		TotalMilliseconds += milliseconds;
+	}
+
+	void _TCPING_STATISTICS::Summarize()
+	{
+		FailedPercent = Sent == 0 ? 0.00 : (static_cast<double>(Failed) / Sent) * 100.00;
+		AvgRtt = Successful == 0 ? 0.00 : TotalMilliseconds / Successful;
+		AvgJitter = Successful < 2 ? 0.00 : TotalJitter / (Successful - 1);
+		P50Rtt = RttHistogram.ValueAtPercentile(50.00);
+		P90Rtt = RttHistogram.ValueAtPercentile(90.00);
+		P99Rtt = RttHistogram.ValueAtPercentile(99.00);
+		P999Rtt = RttHistogram.ValueAtPercentile(99.90);
+	}
 
 
 	/*
@@ -69,20 +100,7 @@ namespace WindowsUtils::Core
 			case WriteOutputType::TcpingStatistics:
 			{
 				auto objData = reinterpret_cast<PTCPING_STATISTICS>(other.ObjectData.Object);
-				ObjectData.Object = new TCPING_STATISTICS(
-					objData->Sent,
-					objData->Successful,
-					objData->Failed,
-					objData->FailedPercent,
-					objData->MinRtt,
-					objData->MaxRtt,
-					objData->AvgRtt,
-					objData->MinJitter,
-					objData->MaxJitter,
-					objData->AvgJitter,
-					objData->TotalJitter,
-					objData->TotalMilliseconds
-				);
+				ObjectData.Object = new TCPING_STATISTICS(*objData);
 			} break;
 			}
 		} break;
@@ -222,7 +240,7 @@ namespace WindowsUtils::Core
 		bool outputFile,
 		const WWuString& filePath,
 		bool append
-	) : Destination(destination.Raw()), Port(port), Count(count), Timeout(timeout), SecondsInterval(secondsInterval),
+	) : CancelEvent{ CreateEvent(nullptr, TRUE, FALSE, nullptr), true }, Destination(destination.Raw()), Port(port), Count(count), Timeout(timeout), SecondsInterval(secondsInterval),
 		FailedCountThreshold(failedThreshold), IsContinuous(continuous), IncludeJitter(includeJitter), PrintFqdn(printFqdn),
 		IsForce(force), Single(single), OutputToFile(outputFile), Append(append)
 	{
@@ -233,6 +251,9 @@ namespace WindowsUtils::Core
 		if ((result = WSAStartup(reqVersion, &wsaData)) != 0)
 			throw result;
 
+		if (CancelEvent.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateEvent", WriteErrorCategory::ResourceUnavailable);
+
 		_ui64tow_s(Port, PortAsString, 6, 10);
 
 		if (outputFile) {
@@ -297,6 +318,7 @@ namespace WindowsUtils::Core
 
 				instance->_ctrlCHit = true;
 				instance->_ctrlCHitCount++;
+				SetEvent(instance->CancelEvent.Get());
 
 				return TRUE;
 			}
@@ -315,6 +337,11 @@ namespace WindowsUtils::Core
 		return instance->_ctrlCHit;
 	}
 
+	const bool TcpingForm::IsCancelled() const
+	{
+		return WaitForSingleObject(CancelEvent.Get(), 0) == WAIT_OBJECT_0;
+	}
+
 
 	/*
 	*	~ TestPortForm
@@ -358,57 +385,691 @@ namespace WindowsUtils::Core
 	void Network::StartTcpPing(TcpingForm& workForm, WuNativeContext* context)
 	{
 		// Creating notification queue and worker parameters.
-		std::queue<QUEUED_DATA> queue;
+		SpscRing<QUEUED_DATA> queue(TCPING_QUEUE_CAPACITY);
 		TCPING_WORKER_DATA threadArgs = {
 			&workForm,
-			&queue,
-			false
+			&queue
 		};
 
 		// Creating worker thread.
 		DWORD threadId;
-		HANDLE hWorker = CreateThread(NULL, 0, StartTcpingWorker, &threadArgs, 0, &threadId);
+		SafeObjectHandle worker{ CreateThread(NULL, 0, StartTcpingWorker, &threadArgs, 0, &threadId), true };
+		if (worker.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+
+		// da loop. Sleeps until there's output, the worker is done, or Ctrl+C.
+		bool isWorkerDone = false;
+		const HANDLE waitHandles[] = { worker.Get(), workForm.CancelEvent.Get() };
+		try {
+			while (!isWorkerDone && !workForm.IsCtrlCHit()) {
+				const DWORD waitResult = queue.Wait(waitHandles, 2);
+				if (waitResult == WAIT_FAILED)
+					_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WaitForMultipleObjects", WriteErrorCategory::InvalidResult);
+
+				if (waitResult == WAIT_OBJECT_0 + 1)
+					isWorkerDone = true;
+
+				// Printing from queue. Once the worker is done this also prints what's left.
+				PQUEUED_DATA data;
+				while (!workForm.IsCtrlCHit() && (data = queue.Front()) != nullptr) {
+					PrintQueueData(*data, context);
+					queue.Pop();
+				}
+			}
+		}
+		catch (...) {
+			// Stopping the worker instead of killing it. It leaves at its next wait or output.
+			if (!isWorkerDone) {
+				SetEvent(workForm.CancelEvent.Get());
+				queue.Cancel();
+				WaitForSingleObject(worker.Get(), INFINITE);
+			}
+
+			throw;
+		}
+
+		if (!isWorkerDone) {
+			SetEvent(workForm.CancelEvent.Get());
+			queue.Cancel();
+			WaitForSingleObject(worker.Get(), INFINITE);
+		}
+
+		DWORD workerExitCode;
+		GetExitCodeThread(worker.Get(), &workerExitCode);
+		if (workerExitCode != ERROR_SUCCESS && workerExitCode != ERROR_NO_MORE_ITEMS && workerExitCode != ERROR_CANCELLED)
+			_WU_RAISE_NATIVE_EXCEPTION(workerExitCode, L"StartTcpingWorker", WriteErrorCategory::InvalidResult);
+
+		// Process and print statistics.
+		if (!workForm.Single)
+			ProcessStatistics(&workForm, context);
+	}
+
+
+	void Network::StartParallelTcpPing(TcpingForm& workForm, const std::vector<WWuString>& destinations, const std::vector<DWORD>& ports, WuNativeContext* context)
+	{
+		if (workForm.Single)
+			workForm.Count = 1;
 
-		// da loop.
-		do {
-			// Checking the notification queue.
-			if (queue.size() > 0) {
+		ADDRINFOW hints{ };
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_protocol = IPPROTO_TCP;
+
+		// Resolving everything up front. A destination we can't resolve doesn't stop the others.
+		std::vector<TCPING_TARGET> targets;
+		targets.reserve(destinations.size() * ports.size());
+		for (const WWuString& destination : destinations) {
+			for (const DWORD port : ports) {
+				WCHAR portAsString[6] = { 0 };
+				_ui64tow_s(port, portAsString, 6, 10);
+
+				ADDRINFOW* addressInfo;
+				int intResult = GetAddrInfoW(destination.Raw(), portAsString, &hints, &addressInfo);
+				if (intResult != 0) {
+					context->NativeWriteWarning(WWuString::Format(L"Failed to resolve '%ws': %ws", destination.Raw(), WuException::GetErrorMessage(intResult).Raw()));
+					continue;
+				}
 
-				// Printing from queue.
-				QUEUED_DATA& data = queue.front();
-				PrintQueueData(data, context);
-				queue.pop();
+				TCPING_TARGET& target = targets.emplace_back();
+				target.Destination = destination;
+				target.Port = port;
+				target.AddressLength = static_cast<int>(min(addressInfo->ai_addrlen, sizeof(SOCKADDR_STORAGE)));
+				RtlCopyMemory(&target.Address, addressInfo->ai_addr, target.AddressLength);
+
+				WWuString ipString;
+				FormatIp(addressInfo, ipString);
+				FreeAddrInfoW(addressInfo);
+
+				if (workForm.PrintFqdn) {
+					if (target.Address.ss_family == AF_INET6)
+						ResolveIpv6ToDomainName(ipString, target.DisplayName);
+					else
+						ResolveIpToDomainName(ipString, target.DisplayName);
+				}
+
+				if (target.DisplayName.Length() == 0)
+					target.DisplayName = ipString;
+
+				target.Statistics.Destination = destination;
+				target.Statistics.Port = port;
 			}
+		}
+
+		if (targets.empty())
+			return;
+
+		TcpingEngine engine(workForm, targets);
+		engine.Run(context);
+	}
+
+
+	/*
+	*	~ Tcping engine ~
+	*/
+
+	// 'ConnectEx' is an extension, its pointer comes from the provider of the address family.
+	static LPFN_CONNECTEX LoadConnectEx(const int family)
+	{
+		SOCKET probeSocket = WSASocketW(family, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+		if (probeSocket == INVALID_SOCKET)
+			_WU_RAISE_NATIVE_EXCEPTION(WSAGetLastError(), L"WSASocket", WriteErrorCategory::ResourceUnavailable);
 
-			// Checking the cancel flag.
-			if (workForm.IsCtrlCHit()) {
-				if (!threadArgs.IsComplete)
-					TerminateThread(hWorker, ERROR_CANCELLED);
+		GUID connectExId = WSAID_CONNECTEX;
+		LPFN_CONNECTEX connectEx = nullptr;
+		DWORD bytesReturned;
+		int result = WSAIoctl(probeSocket, SIO_GET_EXTENSION_FUNCTION_POINTER, &connectExId, sizeof(connectExId), &connectEx, sizeof(connectEx), &bytesReturned, nullptr, nullptr);
+		int lastError = WSAGetLastError();
+		closesocket(probeSocket);
 
+		if (result == SOCKET_ERROR)
+			_WU_RAISE_NATIVE_EXCEPTION(lastError, L"WSAIoctl", WriteErrorCategory::NotImplemented);
+
+		return connectEx;
+	}
+
+	TcpingEngine::TcpingEngine(TcpingForm& workForm, std::vector<TCPING_TARGET>& targets)
+		: m_form(workForm), m_targets(targets), m_wheel(TCPING_WHEEL_SLOTS, TCPING_WHEEL_TICK), m_connectEx{ },
+		m_port{ CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 0), true },
+		m_stopEvent{ CreateEvent(nullptr, TRUE, FALSE, nullptr), true },
+		m_wakeEvent{ CreateEvent(nullptr, FALSE, FALSE, nullptr), true },
+		m_outputEvent{ CreateEvent(nullptr, FALSE, FALSE, nullptr), true },
+		m_doneEvent{ CreateEvent(nullptr, TRUE, FALSE, nullptr), true },
+		m_idleEvent{ CreateEvent(nullptr, TRUE, FALSE, nullptr), true },
+		m_timerThread(NULL), m_remaining(static_cast<LONG>(targets.size())), m_inFlight(0), m_isStopping(0)
+	{
+		InitializeSRWLock(&m_outputLock);
+
+		if (m_port.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateIoCompletionPort", WriteErrorCategory::ResourceUnavailable);
+
+		if (m_stopEvent.Get() == NULL || m_wakeEvent.Get() == NULL || m_outputEvent.Get() == NULL || m_doneEvent.Get() == NULL || m_idleEvent.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateEvent", WriteErrorCategory::ResourceUnavailable);
+
+		for (TCPING_TARGET& target : m_targets) {
+			const int familyIndex = target.Address.ss_family == AF_INET6 ? 1 : 0;
+			if (m_connectEx[familyIndex] == nullptr)
+				m_connectEx[familyIndex] = LoadConnectEx(target.Address.ss_family);
+
+			target.Socket = INVALID_SOCKET;
+			target.Sequence = 0;
+			target.IsTimedOut = false;
+			InitializeSRWLock(&target.Lock);
+		}
+
+		// Spreading the first probes over the interval, so they don't all go out at once.
+		const ULONGLONG now = GetTickCount64();
+		const ULONGLONG interval = static_cast<ULONGLONG>(m_form.SecondsInterval) * 1000;
+		for (size_t i = 0; i < m_targets.size(); i++)
+			Schedule(now + (interval * i) / m_targets.size(), i, TimerKind::Probe, 0);
+
+		for (DWORD i = 0; i < TCPING_COMPLETION_THREADS; i++) {
+			DWORD threadId;
+			HANDLE thread = CreateThread(NULL, 0, CompletionThread, this, 0, &threadId);
+			if (thread == NULL)
 				break;
+
+			m_completionThreads.push_back(thread);
+		}
+
+		if (m_completionThreads.empty())
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+
+		DWORD threadId;
+		m_timerThread = CreateThread(NULL, 0, TimerThread, this, 0, &threadId);
+		if (m_timerThread == NULL) {
+			DWORD lastError = GetLastError();
+			Stop();
+			_WU_RAISE_NATIVE_EXCEPTION(lastError, L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+		}
+	}
+
+	TcpingEngine::~TcpingEngine()
+	{
+		Stop();
+	}
+
+	void TcpingEngine::Run(WuNativeContext* context)
+	{
+		bool isDone = false;
+		const HANDLE waitHandles[] = { m_outputEvent.Get(), m_doneEvent.Get(), m_form.CancelEvent.Get() };
+		std::vector<TCPING_OUTPUT> outputs;
+		while (!isDone && !m_form.IsCtrlCHit()) {
+			const DWORD waitResult = WaitForMultipleObjects(3, waitHandles, FALSE, INFINITE);
+			if (waitResult == WAIT_FAILED)
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WaitForMultipleObjects", WriteErrorCategory::InvalidResult);
+
+			if (waitResult == WAIT_OBJECT_0 + 2)
+				break;
+
+			if (waitResult == WAIT_OBJECT_0 + 1)
+				isDone = true;
+
+			// Once every target is done this also writes what's left.
+			AcquireSRWLockExclusive(&m_outputLock);
+			outputs.swap(m_outputs);
+			ReleaseSRWLockExclusive(&m_outputLock);
+
+			for (TCPING_OUTPUT& output : outputs) {
+				if (m_form.IsCtrlCHit())
+					break;
+
+				context->NativeWriteObject(&output, WriteOutputType::TcpingOutput);
 			}
 
-			Sleep(1);
+			outputs.clear();
+		}
 
-		} while (!threadArgs.IsComplete);
+		// No thread touches the statistics after this.
+		Stop();
 
-		DWORD workerExitCode;
-		GetExitCodeThread(hWorker, &workerExitCode);
-		if (workerExitCode != ERROR_SUCCESS && workerExitCode != ERROR_NO_MORE_ITEMS && workerExitCode != ERROR_CANCELLED)
-			_WU_RAISE_NATIVE_EXCEPTION(workerExitCode, L"StartTcpingWorker", WriteErrorCategory::InvalidResult);
+		if (m_form.Single)
+			return;
+
+		for (TCPING_TARGET& target : m_targets) {
+			TCPING_STATISTICS& statistics = target.Statistics;
+			if (statistics.Sent == 0)
+				continue;
+
+			statistics.Summarize();
+			context->NativeWriteObject(&statistics, WriteOutputType::TcpingStatistics);
+		}
+	}
+
+	DWORD WINAPI TcpingEngine::TimerThread(LPVOID params)
+	{
+		auto engine = reinterpret_cast<TcpingEngine*>(params);
+		const HANDLE waitHandles[] = { engine->m_stopEvent.Get(), engine->m_wakeEvent.Get() };
+		std::vector<TIMER_WHEEL_ENTRY> expired;
+		while (true) {
+			const DWORD nextDue = engine->m_wheel.Advance(GetTickCount64(), expired);
+			for (const TIMER_WHEEL_ENTRY& entry : expired) {
+				if (static_cast<TimerKind>(entry.Kind) == TimerKind::Probe)
+					engine->StartProbe(entry.Key);
+				else
+					engine->TimeOutProbe(entry.Key, entry.Sequence);
+			}
 
-		// Printing remaining items on queue (if any).
-		if (!workForm.IsCtrlCHit()) {
-			while (queue.size() > 0) {
-				QUEUED_DATA& data = queue.front();
-				PrintQueueData(data, context);
-				queue.pop();
+			// Starting probes scheduled timeouts, the wheel has a new next timer.
+			if (!expired.empty()) {
+				expired.clear();
+				continue;
 			}
+
+			if (WaitForMultipleObjects(2, waitHandles, FALSE, nextDue) == WAIT_OBJECT_0)
+				break;
 		}
 
-		// Process and print statistics.
-		if (!workForm.Single)
-			ProcessStatistics(&workForm, context);
+		return ERROR_SUCCESS;
+	}
+
+	DWORD WINAPI TcpingEngine::CompletionThread(LPVOID params)
+	{
+		auto engine = reinterpret_cast<TcpingEngine*>(params);
+		while (true) {
+			DWORD bytesTransferred;
+			ULONG_PTR completionKey;
+			LPOVERLAPPED overlapped;
+			BOOL isSuccess = GetQueuedCompletionStatus(engine->m_port.Get(), &bytesTransferred, &completionKey, &overlapped, INFINITE);
+
+			// No overlapped is the packet 'Stop' posts to end the thread.
+			if (overlapped == nullptr)
+				break;
+
+			TCPING_TARGET& target = engine->m_targets[completionKey];
+			const double milliseconds = target.StopWatch.ElapsedMilliseconds();
+			DWORD error = ERROR_SUCCESS;
+			if (!isSuccess) {
+				DWORD flags;
+				error = ERROR_OPERATION_ABORTED;
+				if (!WSAGetOverlappedResult(target.Socket, overlapped, &bytesTransferred, FALSE, &flags))
+					error = WSAGetLastError();
+			}
+
+			engine->FinishProbe(completionKey, error, milliseconds);
+			if (InterlockedDecrement(&engine->m_inFlight) == 0 && ReadAcquire(&engine->m_isStopping))
+				SetEvent(engine->m_idleEvent.Get());
+		}
+
+		return ERROR_SUCCESS;
+	}
+
+	void TcpingEngine::StartProbe(const size_t index)
+	{
+		TCPING_TARGET& target = m_targets[index];
+		target.ProbeStart = GetTickCount64();
+
+		// Reset before anything can fail, 'FinishProbe' can't see what's left from the last probe.
+		AcquireSRWLockExclusive(&target.Lock);
+		target.IsTimedOut = false;
+		const DWORD sequence = ++target.Sequence;
+		ReleaseSRWLockExclusive(&target.Lock);
+
+		SOCKET probeSocket = WSASocketW(target.Address.ss_family, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+		if (probeSocket == INVALID_SOCKET) {
+			FinishProbe(index, WSAGetLastError(), 0.00);
+			return;
+		}
+
+		// 'ConnectEx' wants a bound socket.
+		SOCKADDR_STORAGE localAddress{ };
+		localAddress.ss_family = target.Address.ss_family;
+		if (bind(probeSocket, reinterpret_cast<SOCKADDR*>(&localAddress), target.AddressLength) == SOCKET_ERROR
+			|| CreateIoCompletionPort(reinterpret_cast<HANDLE>(probeSocket), m_port.Get(), index, 0) == NULL) {
+			const int error = WSAGetLastError();
+			closesocket(probeSocket);
+			FinishProbe(index, error, 0.00);
+			return;
+		}
+
+		AcquireSRWLockExclusive(&target.Lock);
+		target.Socket = probeSocket;
+		ReleaseSRWLockExclusive(&target.Lock);
+
+		RtlZeroMemory(&target.Overlapped, sizeof(WSAOVERLAPPED));
+		InterlockedIncrement(&m_inFlight);
+		target.StopWatch.Restart();
+
+		LPFN_CONNECTEX connectEx = m_connectEx[target.Address.ss_family == AF_INET6 ? 1 : 0];
+		char forceData[] = "tits";
+		if (!connectEx(probeSocket, reinterpret_cast<SOCKADDR*>(&target.Address), target.AddressLength, m_form.IsForce ? forceData : nullptr, m_form.IsForce ? 4 : 0, nullptr, &target.Overlapped)) {
+			const int error = WSAGetLastError();
+			if (error != ERROR_IO_PENDING) {
+
+				// Nothing gets queued to the port for this one.
+				InterlockedDecrement(&m_inFlight);
+				FinishProbe(index, error, 0.00);
+				return;
+			}
+		}
+
+		Schedule(target.ProbeStart + static_cast<ULONGLONG>(m_form.Timeout) * 1000, index, TimerKind::Timeout, sequence);
+	}
+
+	void TcpingEngine::TimeOutProbe(const size_t index, const DWORD sequence)
+	{
+		// The completion comes back aborted, and 'FinishProbe' counts it as a timeout.
+		TCPING_TARGET& target = m_targets[index];
+		AcquireSRWLockExclusive(&target.Lock);
+		if (target.Socket != INVALID_SOCKET && target.Sequence == sequence) {
+			target.IsTimedOut = true;
+			CancelIoEx(reinterpret_cast<HANDLE>(target.Socket), &target.Overlapped);
+		}
+
+		ReleaseSRWLockExclusive(&target.Lock);
+	}
+
+	void TcpingEngine::FinishProbe(const size_t index, const DWORD error, const double milliseconds)
+	{
+		TCPING_TARGET& target = m_targets[index];
+
+		AcquireSRWLockExclusive(&target.Lock);
+		const bool isTimedOut = target.IsTimedOut;
+		SOCKET probeSocket = target.Socket;
+		target.Socket = INVALID_SOCKET;
+		ReleaseSRWLockExclusive(&target.Lock);
+
+		if (probeSocket != INVALID_SOCKET) {
+			// A 'ConnectEx' socket needs its context updated before 'shutdown' works on it.
+			if (error == ERROR_SUCCESS) {
+				setsockopt(probeSocket, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0);
+				shutdown(probeSocket, SD_SEND);
+			}
+
+			closesocket(probeSocket);
+		}
+
+		// Cancelled by 'Stop', this one doesn't count.
+		if (error == ERROR_OPERATION_ABORTED && !isTimedOut)
+			return;
+
+		TCPING_STATISTICS& statistics = target.Statistics;
+		statistics.Sent++;
+
+		PortProbeStatus status;
+		double roundTripTime;
+		double jitter = -1.00;
+		if (error == ERROR_SUCCESS) {
+			status = PortProbeStatus::Open;
+			roundTripTime = milliseconds;
+
+			if (m_form.IncludeJitter && statistics.Successful >= 1) {
+				jitter = abs(roundTripTime - (statistics.TotalMilliseconds / statistics.Successful));
+				if (statistics.Successful == 1 || jitter < statistics.MinJitter)
+					statistics.MinJitter = jitter;
+
+				if (jitter > statistics.MaxJitter)
+					statistics.MaxJitter = jitter;
+
+				statistics.TotalJitter += jitter;
+			}
+
+			statistics.AddRoundTrip(roundTripTime);
+		}
+		else {
+			// A refused connection is an answer, anything else is no response.
+			status = error == WSAECONNREFUSED || error == ERROR_CONNECTION_REFUSED ? PortProbeStatus::Closed : PortProbeStatus::Timeout;
+			roundTripTime = status == PortProbeStatus::Closed ? milliseconds : static_cast<double>(m_form.Timeout * 1000);
+			statistics.Failed++;
+		}
+
+		::FILETIME timestamp;
+		GetSystemTimeAsFileTime(&timestamp);
+
+		AcquireSRWLockExclusive(&m_outputLock);
+		m_outputs.emplace_back(timestamp, target.Destination, target.DisplayName, target.Port, status, roundTripTime, jitter);
+		ReleaseSRWLockExclusive(&m_outputLock);
+		SetEvent(m_outputEvent.Get());
+
+		const bool hasMore = m_form.IsContinuous
+			|| (statistics.Sent < m_form.Count && static_cast<int>(statistics.Failed) < m_form.FailedCountThreshold);
+
+		if (hasMore && !ReadAcquire(&m_isStopping)) {
+			const ULONGLONG nextProbe = target.ProbeStart + static_cast<ULONGLONG>(m_form.SecondsInterval) * 1000;
+			Schedule(max(nextProbe, GetTickCount64()), index, TimerKind::Probe, 0);
+		}
+		else if (!hasMore && InterlockedDecrement(&m_remaining) == 0)
+			SetEvent(m_doneEvent.Get());
+	}
+
+	void TcpingEngine::Schedule(const ULONGLONG due, const size_t index, const TimerKind kind, const DWORD sequence)
+	{
+		if (m_wheel.Schedule(due, index, static_cast<DWORD>(kind), sequence))
+			SetEvent(m_wakeEvent.Get());
+	}
+
+	void TcpingEngine::Stop()
+	{
+		if (InterlockedExchange(&m_isStopping, 1) == 1)
+			return;
+
+		// No probe starts after the timer thread is gone.
+		SetEvent(m_stopEvent.Get());
+		if (m_timerThread != NULL) {
+			WaitForSingleObject(m_timerThread, INFINITE);
+			CloseHandle(m_timerThread);
+			m_timerThread = NULL;
+		}
+
+		for (TCPING_TARGET& target : m_targets) {
+			AcquireSRWLockExclusive(&target.Lock);
+			if (target.Socket != INVALID_SOCKET)
+				CancelIoEx(reinterpret_cast<HANDLE>(target.Socket), &target.Overlapped);
+
+			ReleaseSRWLockExclusive(&target.Lock);
+		}
+
+		// The overlapped structures live in the targets, every probe has to come back before we go.
+		if (ReadAcquire(&m_inFlight) > 0)
+			WaitForSingleObject(m_idleEvent.Get(), INFINITE);
+
+		for (size_t i = 0; i < m_completionThreads.size(); i++)
+			PostQueuedCompletionStatus(m_port.Get(), 0, 0, nullptr);
+
+		if (!m_completionThreads.empty()) {
+			WaitForMultipleObjects(static_cast<DWORD>(m_completionThreads.size()), m_completionThreads.data(), TRUE, INFINITE);
+			for (HANDLE thread : m_completionThreads)
+				CloseHandle(thread);
+
+			m_completionThreads.clear();
+		}
+	}
+
+
+	/*
+	*	~ Port scanner ~
+	*/
+
+	PortScanner::PortScanner(const std::vector<DWORD>& ports, const DWORD timeoutSec, const DWORD maxInFlight)
+		: m_ports(ports), m_timeout(timeoutSec * 1000), m_connectEx{ },
+		m_port{ CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1), true }, m_inFlight(0)
+	{
+		if (m_port.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateIoCompletionPort", WriteErrorCategory::ResourceUnavailable);
+
+		WSADATA wsaData;
+		int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+		if (result != ERROR_SUCCESS)
+			_WU_RAISE_NATIVE_EXCEPTION(result, L"WSAStartup", WriteErrorCategory::DeviceError);
+
+		m_probes.resize(max(maxInFlight, 1));
+		m_freeProbes.reserve(m_probes.size());
+		for (DWORD i = static_cast<DWORD>(m_probes.size()); i > 0; i--) {
+			m_probes[i - 1].Socket = INVALID_SOCKET;
+			m_probes[i - 1].Sequence = 0;
+			m_freeProbes.push_back(i - 1);
+		}
+	}
+
+	PortScanner::~PortScanner()
+	{
+		// Connections are only left in flight when 'Run' throws. The completions have to come before the probes go away.
+		for (PORT_SCAN_PROBE& probe : m_probes) {
+			if (probe.Socket != INVALID_SOCKET)
+				CancelIoEx(reinterpret_cast<HANDLE>(probe.Socket), &probe.Overlapped);
+		}
+
+		OVERLAPPED_ENTRY entries[TESTPORT_SCAN_BATCH];
+		while (m_inFlight > 0) {
+			ULONG count;
+			if (!GetQueuedCompletionStatusEx(m_port.Get(), entries, TESTPORT_SCAN_BATCH, &count, INFINITE, FALSE))
+				break;
+
+			m_inFlight -= min(count, m_inFlight);
+		}
+
+		for (PORT_SCAN_PROBE& probe : m_probes) {
+			if (probe.Socket != INVALID_SOCKET)
+				closesocket(probe.Socket);
+		}
+
+		WSACleanup();
+	}
+
+	void PortScanner::AddHost(const WWuString& destination, const WWuString& displayName, const SOCKADDR* address, const int addressLength)
+	{
+		const int familyIndex = address->sa_family == AF_INET6 ? 1 : 0;
+		if (m_connectEx[familyIndex] == nullptr)
+			m_connectEx[familyIndex] = LoadConnectEx(address->sa_family);
+
+		PORT_SCAN_HOST& host = m_hosts.emplace_back();
+		host.Destination = destination;
+		host.DisplayName = displayName;
+		host.AddressLength = min(addressLength, static_cast<int>(sizeof(SOCKADDR_STORAGE)));
+		RtlCopyMemory(&host.Address, address, host.AddressLength);
+	}
+
+	void PortScanner::Run(WuNativeContext* context)
+	{
+		const size_t total = m_hosts.size() * m_ports.size();
+		size_t next = 0;
+		OVERLAPPED_ENTRY entries[TESTPORT_SCAN_BATCH];
+		while (next < total || m_inFlight > 0) {
+			while (next < total && !m_freeProbes.empty()) {
+				StartProbe(next % m_hosts.size(), m_ports[next / m_hosts.size()], context);
+				next++;
+			}
+
+			// Cancelled connections still complete, as aborted.
+			const ULONGLONG now = GetTickCount64();
+			while (!m_deadlines.empty() && m_deadlines.front().Due <= now) {
+				const PORT_SCAN_DEADLINE deadline = m_deadlines.front();
+				m_deadlines.pop_front();
+
+				PORT_SCAN_PROBE& probe = m_probes[deadline.Probe];
+				if (probe.Socket != INVALID_SOCKET && probe.Sequence == deadline.Sequence)
+					CancelIoEx(reinterpret_cast<HANDLE>(probe.Socket), &probe.Overlapped);
+			}
+
+			if (m_inFlight == 0)
+				continue;
+
+			ULONG count;
+			const DWORD waitTime = m_deadlines.empty() ? INFINITE : static_cast<DWORD>(m_deadlines.front().Due - now);
+			if (!GetQueuedCompletionStatusEx(m_port.Get(), entries, TESTPORT_SCAN_BATCH, &count, waitTime, FALSE)) {
+				const DWORD lastError = GetLastError();
+				if (lastError == WAIT_TIMEOUT)
+					continue;
+
+				_WU_RAISE_NATIVE_EXCEPTION(lastError, L"GetQueuedCompletionStatusEx", WriteErrorCategory::InvalidResult);
+			}
+
+			// Counted before writing anything, writing can throw.
+			m_inFlight -= count;
+			for (ULONG i = 0; i < count; i++) {
+				const DWORD index = static_cast<DWORD>(entries[i].lpCompletionKey);
+				PORT_SCAN_PROBE& probe = m_probes[index];
+
+				DWORD error = ERROR_SUCCESS;
+				DWORD bytesTransferred, flags;
+				if (!WSAGetOverlappedResult(probe.Socket, &probe.Overlapped, &bytesTransferred, FALSE, &flags))
+					error = WSAGetLastError();
+
+				FinishProbe(index, error, context);
+			}
+		}
+	}
+
+	void PortScanner::StartProbe(const size_t host, const DWORD port, WuNativeContext* context)
+	{
+		const PORT_SCAN_HOST& target = m_hosts[host];
+		const DWORD index = m_freeProbes.back();
+		m_freeProbes.pop_back();
+
+		PORT_SCAN_PROBE& probe = m_probes[index];
+		probe.Host = host;
+		probe.Port = port;
+		probe.Sequence++;
+		RtlZeroMemory(&probe.Overlapped, sizeof(WSAOVERLAPPED));
+
+		// A probe we can't start is reported like the others, the rest of the scan goes on.
+		probe.Socket = WSASocketW(target.Address.ss_family, SOCK_STREAM, IPPROTO_TCP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+		if (probe.Socket == INVALID_SOCKET) {
+			FinishProbe(index, WSAGetLastError(), context);
+			return;
+		}
+
+		// 'ConnectEx' wants a bound socket.
+		SOCKADDR_STORAGE localAddress{ };
+		localAddress.ss_family = target.Address.ss_family;
+		if (bind(probe.Socket, reinterpret_cast<SOCKADDR*>(&localAddress), target.AddressLength) == SOCKET_ERROR) {
+			FinishProbe(index, WSAGetLastError(), context);
+			return;
+		}
+
+		if (CreateIoCompletionPort(reinterpret_cast<HANDLE>(probe.Socket), m_port.Get(), index, 0) == NULL) {
+			FinishProbe(index, GetLastError(), context);
+			return;
+		}
+
+		SOCKADDR_STORAGE address = target.Address;
+		if (address.ss_family == AF_INET6)
+			reinterpret_cast<SOCKADDR_IN6*>(&address)->sin6_port = htons(static_cast<USHORT>(port));
+		else
+			reinterpret_cast<SOCKADDR_IN*>(&address)->sin_port = htons(static_cast<USHORT>(port));
+
+		LPFN_CONNECTEX connectEx = m_connectEx[address.ss_family == AF_INET6 ? 1 : 0];
+		if (!connectEx(probe.Socket, reinterpret_cast<SOCKADDR*>(&address), target.AddressLength, nullptr, 0, nullptr, &probe.Overlapped)) {
+			const int error = WSAGetLastError();
+
+			// Nothing gets queued, unreachable networks and the like fail right here.
+			if (error != ERROR_IO_PENDING) {
+				FinishProbe(index, error, context);
+				return;
+			}
+		}
+
+		m_inFlight++;
+		m_deadlines.push_back({ GetTickCount64() + m_timeout, index, probe.Sequence });
+	}
+
+	void PortScanner::FinishProbe(const DWORD index, const DWORD error, WuNativeContext* context)
+	{
+		PORT_SCAN_PROBE& probe = m_probes[index];
+
+		// Aborted by the deadline, unreachable, or anything else, is a timeout. Same as the single probe.
+		PortProbeStatus status = PortProbeStatus::Timeout;
+		if (error == ERROR_SUCCESS) {
+			setsockopt(probe.Socket, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0);
+			status = PortProbeStatus::Open;
+		}
+		else if (error == WSAECONNREFUSED || error == ERROR_CONNECTION_REFUSED)
+			status = PortProbeStatus::Closed;
+
+		// Resetting instead of the graceful close, there's nothing to wait for.
+		if (probe.Socket != INVALID_SOCKET) {
+			LINGER linger = { 1, 0 };
+			setsockopt(probe.Socket, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&linger), sizeof(linger));
+			closesocket(probe.Socket);
+			probe.Socket = INVALID_SOCKET;
+		}
+		m_freeProbes.push_back(index);
+
+		::FILETIME timestamp;
+		GetSystemTimeAsFileTime(&timestamp);
+
+		const PORT_SCAN_HOST& host = m_hosts[probe.Host];
+		TESTPORT_OUTPUT output(timestamp, host.Destination, host.DisplayName, probe.Port, status);
+		context->NativeWriteObject(&output, WriteOutputType::TestportOutput);
 	}
 
 
@@ -680,6 +1341,39 @@ namespace WindowsUtils::Core
 		context->NativeWriteObject(&output, WriteOutputType::TestportOutput);
 	}
 
+	void Network::ScanNetworkPorts(const std::vector<WWuString>& destinations, const std::vector<DWORD>& ports, const DWORD timeoutSec, const DWORD maxInFlight, WuNativeContext* context)
+	{
+		// The scanner starts Winsock, so it comes before resolving.
+		PortScanner scanner(ports, timeoutSec, maxInFlight);
+
+		ADDRINFOW hints{ };
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_protocol = IPPROTO_TCP;
+
+		// A destination we can't resolve doesn't stop the others.
+		for (const WWuString& destination : destinations) {
+			ADDRINFOW* addressInfo;
+			int intResult = GetAddrInfoW(destination.Raw(), nullptr, &hints, &addressInfo);
+			if (intResult != 0) {
+				context->NativeWriteWarning(WWuString::Format(L"Failed to resolve '%ws': %ws", destination.Raw(), WuException::GetErrorMessage(intResult).Raw()));
+				continue;
+			}
+
+			SOCKADDR_STORAGE address{ };
+			const int addressLength = static_cast<int>(min(addressInfo->ai_addrlen, sizeof(SOCKADDR_STORAGE)));
+			RtlCopyMemory(&address, addressInfo->ai_addr, addressLength);
+
+			WWuString displayName;
+			FormatIp(addressInfo, displayName);
+			FreeAddrInfoW(addressInfo);
+
+			scanner.AddHost(destination, displayName, reinterpret_cast<SOCKADDR*>(&address), addressLength);
+		}
+
+		scanner.Run(context);
+	}
+
 
 	/*
 	*	~ Get-NetworkStatistics
@@ -1090,12 +1784,22 @@ namespace WindowsUtils::Core
 		}
 	}
 
+	// Answered probes wait for the rest of the interval, unanswered ones for the rest of the timeout.
+	// So a failure that comes back right away, like an unreachable host, doesn't turn into a tight loop.
+	static void WaitNextProbe(TcpingForm* workForm, const ULONGLONG probeStart, const DWORD testResult)
+	{
+		const ULONGLONG period = static_cast<ULONGLONG>(testResult == WSAETIMEDOUT ? workForm->Timeout : workForm->SecondsInterval) * 1000;
+		const ULONGLONG elapsed = GetTickCount64() - probeStart;
+		if (elapsed < period)
+			WaitForSingleObject(workForm->CancelEvent.Get(), static_cast<DWORD>(period - elapsed));
+	}
+
 	DWORD WINAPI Network::StartTcpingWorker(LPVOID params)
 	{
 		// Defining environment.
 		auto threadArgs = reinterpret_cast<PTCPING_WORKER_DATA>(params);
 		TcpingForm* workForm = threadArgs->WorkForm;
-		std::queue<QUEUED_DATA>* infoQueue = threadArgs->Queue;
+		SpscRing<QUEUED_DATA>* infoQueue = threadArgs->Queue;
 
 		int intResult;
 		ADDRINFOW hints = { 0 }, * addressInfo, * singleInfo;
@@ -1119,7 +1823,6 @@ namespace WindowsUtils::Core
 		WuString narrowDest = workForm->Destination.ToNarrow();
 		intResult = GetAddrInfoW(workForm->Destination.Raw(), workForm->PortAsString, &hints, &addressInfo);
 		if (intResult != 0) {
-			threadArgs->IsComplete = true;
 			return intResult;
 		}
 
@@ -1148,57 +1851,54 @@ namespace WindowsUtils::Core
 
 		// Main loop. Here the 'ping' will happen for 'count' times.
 		if (workForm->IsContinuous) {
-			while (!TcpingForm::IsCtrlCHit()) {
+			while (!workForm->IsCancelled()) {
 				DWORD testResult = ERROR_SUCCESS;
+				const ULONGLONG probeStart = GetTickCount64();
 				try {
 					PerformSingleTestProbe(singleInfo, workForm, workForm->DisplayName, &workForm->Statistics, infoQueue, testResult);
 				}
 				catch (const WuNativeException& ex) {
-					threadArgs->IsComplete = true;
 					return ex.ErrorCode();
 				}
 
-				if (testResult != ERROR_SUCCESS && testResult != WSAETIMEDOUT) {
+				if (testResult != ERROR_SUCCESS && testResult != WSAETIMEDOUT && testResult != WSAECONNREFUSED) {
 					if (testResult == ERROR_CANCELLED)
 						goto END;
 
-					threadArgs->IsComplete = true;
 					return testResult;
 				}
-				// We don't wanna sleep on the last one.
-				else if (testResult == ERROR_SUCCESS && (workForm->Statistics.Sent < workForm->Count || workForm->IsContinuous))
-					Sleep(workForm->SecondsInterval * 1000);
+				// We don't wanna sleep on the last one. Ctrl+C cuts the wait short.
+				else if (workForm->Statistics.Sent < workForm->Count || workForm->IsContinuous)
+					WaitNextProbe(workForm, probeStart, testResult);
 			}
 		}
 		else {
 			for (DWORD i = 0; i < workForm->Count; i++) {
-				if (static_cast<int>(workForm->Statistics.Failed) >= workForm->FailedCountThreshold)
+				if (static_cast<int>(workForm->Statistics.Failed) >= workForm->FailedCountThreshold || workForm->IsCancelled())
 					goto END;
 
 				DWORD testResult = ERROR_SUCCESS;
+				const ULONGLONG probeStart = GetTickCount64();
 				try {
 					PerformSingleTestProbe(singleInfo, workForm, workForm->DisplayName, &workForm->Statistics, infoQueue, testResult);
 				}
 				catch (const WuNativeException& ex) {
-					threadArgs->IsComplete = true;
 					return ex.ErrorCode();
 				}
 
-				if (testResult != ERROR_SUCCESS && testResult != WSAETIMEDOUT) {
+				if (testResult != ERROR_SUCCESS && testResult != WSAETIMEDOUT && testResult != WSAECONNREFUSED) {
 					if (testResult == ERROR_CANCELLED)
 						goto END;
 
-					threadArgs->IsComplete = true;
 					return testResult;
 				}
-				else if (testResult == ERROR_SUCCESS && (workForm->Statistics.Sent < workForm->Count || workForm->IsContinuous))
-					Sleep(workForm->SecondsInterval * 1000);
+				else if (workForm->Statistics.Sent < workForm->Count || workForm->IsContinuous)
+					WaitNextProbe(workForm, probeStart, testResult);
 			}
 		}
 
 	END:
 
-		threadArgs->IsComplete = true;
 		return ERROR_SUCCESS;
 	};
 
@@ -1215,70 +1915,91 @@ namespace WindowsUtils::Core
 	//////////////////////////////////////////////////////////////////////
 
 	void Network::PerformSingleTestProbe(ADDRINFOW* singleInfo, TcpingForm* workForm, const WWuString& displayName,
-		PTCPING_STATISTICS statistics, std::queue<QUEUED_DATA>* infoQueue, DWORD& result)
+		PTCPING_STATISTICS statistics, SpscRing<QUEUED_DATA>* infoQueue, DWORD& result)
 	{
 		DWORD finalResult = ERROR_SUCCESS;
-		DWORD sendResult = ERROR_SUCCESS;
 		WWuString outputText;
-		WuStopWatch timeoutSpw;
 		FILETIME timestamp;
 
-		workForm->StopWatch.Restart();
+		workForm->StopWatch.Reset();
 		bool timedOut = false;
+		bool isRefused = false;
 
-		// Creating an ephemeral socket.
 		try {
+			// Signaled when the connect completes, either way. It outlives the socket selecting it.
+			SafeObjectHandle connectEvent{ WSACreateEvent(), true };
+			if (connectEvent.Get() == WSA_INVALID_EVENT)
+				_WU_RAISE_NATIVE_EXCEPTION(WSAGetLastError(), L"WSACreateEvent", WriteErrorCategory::ResourceUnavailable);
+
+			// Creating an ephemeral socket.
 			EphemeralSocket ephSocket { singleInfo };
 
-			// Connecting.
+			if (WSAEventSelect(ephSocket.UnderlyingSocket, connectEvent.Get(), FD_CONNECT) == SOCKET_ERROR)
+				_WU_RAISE_NATIVE_EXCEPTION(WSAGetLastError(), L"WSAEventSelect", WriteErrorCategory::ConnectionError);
+
+			// Connecting. The time is from here to the completion, nothing else.
+			workForm->StopWatch.Start();
 			int connResult = connect(ephSocket.UnderlyingSocket, singleInfo->ai_addr, (int)singleInfo->ai_addrlen);
 			if (connResult == SOCKET_ERROR) {
 				connResult = WSAGetLastError();
-				if (connResult != ERROR_SUCCESS && connResult != WSAEWOULDBLOCK)
-					_WU_RAISE_NATIVE_EXCEPTION(WSAGetLastError(), L"connect", WriteErrorCategory::ConnectionError);
+				if (connResult != WSAEWOULDBLOCK)
+					_WU_RAISE_NATIVE_EXCEPTION(connResult, L"connect", WriteErrorCategory::ConnectionError);
 			}
 
-			// Trying to send until we succeed or timeout.
-			timeoutSpw.Start();
-			while (!TcpingForm::IsCtrlCHit()) {
-				try {
-					if (workForm->IsForce) {
-						connResult = send(ephSocket.UnderlyingSocket, "tits", 4, 0);
-						if (connResult == SOCKET_ERROR)
-							_WU_RAISE_NATIVE_EXCEPTION(WSAGetLastError(), L"send", WriteErrorCategory::ProtocolError);
-					}
-					else {
-						connResult = send(ephSocket.UnderlyingSocket, NULL, 0, 0);
-						if (connResult == SOCKET_ERROR)
-							_WU_RAISE_NATIVE_EXCEPTION(WSAGetLastError(), L"send", WriteErrorCategory::ProtocolError);
-					}
-					break;
-				}
-				catch (const WuNativeException&) { }
+			const HANDLE waitHandles[] = { connectEvent.Get(), workForm->CancelEvent.Get() };
+			const DWORD waitResult = WaitForMultipleObjects(2, waitHandles, FALSE, workForm->Timeout * 1000);
+			workForm->StopWatch.Stop();
+
+			switch (waitResult) {
+				case WAIT_OBJECT_0:
+				{
+					WSANETWORKEVENTS networkEvents;
+					if (WSAEnumNetworkEvents(ephSocket.UnderlyingSocket, connectEvent.Get(), &networkEvents) == SOCKET_ERROR)
+						_WU_RAISE_NATIVE_EXCEPTION(WSAGetLastError(), L"WSAEnumNetworkEvents", WriteErrorCategory::ConnectionError);
+
+					// A refused connection is an answer, anything else is no response.
+					const int connectError = networkEvents.iErrorCode[FD_CONNECT_BIT];
+					if (connectError == WSAECONNREFUSED)
+						isRefused = true;
+					else if (connectError != ERROR_SUCCESS)
+						timedOut = true;
+					else if (workForm->IsForce && send(ephSocket.UnderlyingSocket, "tits", 4, 0) == SOCKET_ERROR)
+						_WU_RAISE_NATIVE_EXCEPTION(WSAGetLastError(), L"send", WriteErrorCategory::ProtocolError);
+				} break;
 
-				if ((timeoutSpw.ElapsedMilliseconds() / 1000) >= workForm->Timeout) {
+				case WAIT_TIMEOUT:
 					timedOut = true;
 					break;
-				}
 
-				Sleep(1);
+				case WAIT_FAILED:
+					_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WaitForMultipleObjects", WriteErrorCategory::InvalidResult);
+
+				// Ctrl+C, checked below.
+				default:
+					break;
 			}
-			workForm->StopWatch.Stop();
 		}
 		catch (const WuNativeException& ex) {
-			sendResult = ex.ErrorCode();
+			// The probe went out and failed. The error goes back to the worker, that stops and reports it.
+			statistics->Sent++;
+			statistics->Failed++;
+			result = ex.ErrorCode();
 			return;
 		}
 
-		if (TcpingForm::IsCtrlCHit()) {
+		if (workForm->IsCancelled()) {
 			result = ERROR_CANCELLED;
 			return;
 		}
 
 		statistics->Sent++;
 
-		if (timedOut) {
-			outputText += WWuString::Format(L"%ws%ws - TCP:%d - No response - time=%dms", outputText.Raw(), displayName.Raw(), workForm->Port, (workForm->Timeout * 1000));
+		if (timedOut || isRefused) {
+			const PortProbeStatus failedStatus = isRefused ? PortProbeStatus::Closed : PortProbeStatus::Timeout;
+			const LPCWSTR failedText = isRefused ? L"Port is closed" : L"No response";
+			// The time measured. Unreachable hosts fail right away, and a timeout is as long as it took.
+			const double failedMilliseconds = workForm->StopWatch.ElapsedMilliseconds();
+			outputText += WWuString::Format(L"%ws%ws - TCP:%d - %ws - time=%.2fms", outputText.Raw(), displayName.Raw(), workForm->Port, failedText, failedMilliseconds);
 
 			if (workForm->OutputToFile) {
 				// Instead of printing the same output as the one in the file
@@ -1289,7 +2010,7 @@ namespace WindowsUtils::Core
 
 				MAPPED_PROGRESS_DATA progressRecord;
 				if (workForm->IsContinuous) {
-					status = WWuString::Format(L"TCP:%d - No response - time %dms - press Ctrl + C to stop.", workForm->Port, (workForm->Timeout * 1000));
+					status = WWuString::Format(L"TCP:%d - %ws - time %.2fms - press Ctrl + C to stop.", workForm->Port, failedText, failedMilliseconds);
 					progressRecord = MAPPED_PROGRESS_DATA(
 						action.Raw(),
 						0,
@@ -1301,11 +2022,10 @@ namespace WindowsUtils::Core
 						status.Raw()
 					);
 
-					QUEUED_DATA queueData(WriteDataType::Progress, &progressRecord, NULL);
-					infoQueue->push(queueData);
+					infoQueue->Emplace(WriteDataType::Progress, &progressRecord, nullptr);
 				}
 				else {
-					status = WWuString::Format(L"TCP:%d - No response - time %dms", workForm->Port, (workForm->Timeout * 1000));
+					status = WWuString::Format(L"TCP:%d - %ws - time %.2fms", workForm->Port, failedText, failedMilliseconds);
 					percentage = std::lround((static_cast<float>(statistics->Sent) / workForm->Count) * 100);
 					progressRecord = MAPPED_PROGRESS_DATA(
 						action.Raw(),
@@ -1318,8 +2038,7 @@ namespace WindowsUtils::Core
 						status.Raw()
 					);
 
-					QUEUED_DATA queueData(WriteDataType::Progress, &progressRecord, NULL);
-					infoQueue->push(queueData);
+					infoQueue->Emplace(WriteDataType::Progress, &progressRecord, nullptr);
 				}
 
 				IO::AppendTextToFile(workForm->File, WWuString::Format(L"%ws\n", outputText.Raw()));
@@ -1334,14 +2053,13 @@ namespace WindowsUtils::Core
 					(LPWSTR)workForm->Destination.Raw(),
 					(LPWSTR)displayName.Raw(),
 					workForm->Port,
-					PortProbeStatus::Timeout,
-					static_cast<double>(workForm->Timeout * 1000),
+					failedStatus,
+					failedMilliseconds,
 					-1.00
 				);
 
 				auto objType = WriteOutputType::TcpingOutput;
-				QUEUED_DATA queueData(WriteDataType::Object, &tcpingOut, &objType);
-				infoQueue->push(queueData);
+				infoQueue->Emplace(WriteDataType::Object, &tcpingOut, &objType);
 
 				/*LPWSTR tags[1] = { L"PSHOST" };
 				Notification::MAPPED_INFORMATION_DATA report(
@@ -1354,38 +2072,29 @@ namespace WindowsUtils::Core
 
 			statistics->Failed++;
 
-			result = WSAETIMEDOUT;
-			return;
-		}
-		if (sendResult == ERROR_CANCELLED) {
-			result = ERROR_CANCELLED;
+			result = isRefused ? WSAECONNREFUSED : WSAETIMEDOUT;
 			return;
 		}
 
 		double currentMilliseconds = workForm->StopWatch.ElapsedMilliseconds();
 		outputText = WWuString::Format(L"%ws%ws - TCP:%d - Port is open - time=%.2fms", outputText.Raw(), displayName.Raw(), workForm->Port, currentMilliseconds);
 
-		if (currentMilliseconds > statistics->MaxRtt)
-			statistics->MaxRtt = currentMilliseconds;
-		else if (currentMilliseconds < statistics->MinRtt || statistics->MinRtt == 0)
-			statistics->MinRtt = currentMilliseconds;
-
 		double currentJitter = -1.00;
 		if (workForm->IncludeJitter && statistics->Successful >= 1) {
 			currentJitter = currentMilliseconds - (statistics->TotalMilliseconds / statistics->Successful);
 			currentJitter = abs(currentJitter);
+			if (statistics->Successful == 1 || currentJitter < statistics->MinJitter)
+				statistics->MinJitter = currentJitter;
+
 			if (currentJitter > statistics->MaxJitter)
 				statistics->MaxJitter = currentJitter;
-			else if (currentJitter < statistics->MinJitter || statistics->MinJitter == 0)
-				statistics->MinJitter = currentJitter;
 
 			statistics->TotalJitter += currentJitter;
 
 			outputText = WWuString::Format(L"%ws jitter=%.2fms", outputText.Raw(), currentJitter);
 		}
 
-		statistics->Successful++;
-		statistics->TotalMilliseconds += currentMilliseconds;
+		statistics->AddRoundTrip(currentMilliseconds);
 
 		if (workForm->OutputToFile) {
 			// Instead of printing the same output as the one in the file
@@ -1411,8 +2120,7 @@ namespace WindowsUtils::Core
 					status.Raw()
 				);
 
-				QUEUED_DATA queueData(WriteDataType::Progress, &progressRecord, NULL);
-				infoQueue->push(queueData);
+				infoQueue->Emplace(WriteDataType::Progress, &progressRecord, nullptr);
 			}
 			else {
 				percentage = std::lround((static_cast<float>(statistics->Sent) / workForm->Count) * 100);
@@ -1427,8 +2135,7 @@ namespace WindowsUtils::Core
 					status.Raw()
 				);
 
-				QUEUED_DATA queueData(WriteDataType::Progress, &progressRecord, NULL);
-				infoQueue->push(queueData);
+				infoQueue->Emplace(WriteDataType::Progress, &progressRecord, nullptr);
 			}
 
 			IO::AppendTextToFile(workForm->File, WWuString::Format(L"%ws\n", outputText.Raw()));
@@ -1449,8 +2156,7 @@ namespace WindowsUtils::Core
 			);
 
 			auto objType = WriteOutputType::TcpingOutput;
-			QUEUED_DATA queueData(WriteDataType::Object, &tcpingOut, &objType);
-			infoQueue->push(queueData);
+			infoQueue->Emplace(WriteDataType::Object, &tcpingOut, &objType);
 
 			/*LPWSTR tags[1] = { L"PSHOST" };
 			Notification::MAPPED_INFORMATION_DATA report(
@@ -1466,12 +2172,9 @@ namespace WindowsUtils::Core
 
 	void Network::ProcessStatistics(TcpingForm* workForm, WuNativeContext* context)
 	{
-		workForm->Statistics.FailedPercent = (static_cast<double>(workForm->Statistics.Failed) / workForm->Statistics.Sent) * 100.00;
-
-		if (workForm->Statistics.TotalMilliseconds == 0)
-			workForm->Statistics.AvgRtt = 0.00;
-		else
-			workForm->Statistics.AvgRtt = workForm->Statistics.TotalMilliseconds / workForm->Statistics.Successful;
+		workForm->Statistics.Destination = workForm->Destination;
+		workForm->Statistics.Port = workForm->Port;
+		workForm->Statistics.Summarize();
 
 		// Yes, this can be done better, but my ADHD doesn't wanna think right now.
 		WWuString output = WWuString::Format(
@@ -1483,17 +2186,20 @@ namespace WindowsUtils::Core
 			workForm->Statistics.FailedPercent
 		);
 		output += WWuString::Format(
-			L"Approximate round trip times in milli-seconds:\n\tMinimum = %.2fms, Maximum = %.2fms, Average = %.2fms",
+			L"Approximate round trip times in milli-seconds:\n\tMinimum = %.2fms, Maximum = %.2fms, Average = %.2fms,\n",
 			workForm->Statistics.MinRtt,
 			workForm->Statistics.MaxRtt,
 			workForm->Statistics.AvgRtt
 		);
+		output += WWuString::Format(
+			L"\tp50 = %.2fms, p90 = %.2fms, p99 = %.2fms, p99.9 = %.2fms, Interarrival jitter = %.2fms",
+			workForm->Statistics.P50Rtt,
+			workForm->Statistics.P90Rtt,
+			workForm->Statistics.P99Rtt,
+			workForm->Statistics.P999Rtt,
+			workForm->Statistics.InterarrivalJitter
+		);
 		if (workForm->IncludeJitter) {
-			if (workForm->Statistics.TotalJitter == 0)
-				workForm->Statistics.AvgJitter = 0.00;
-			else
-				workForm->Statistics.AvgJitter = workForm->Statistics.TotalJitter / (workForm->Statistics.Successful - 1);
-
 			output += WWuString::Format(
 				L",\nApproximate jitter in milli-seconds:\n\tMinimum = %.2fms, Maximum = %.2fms, Average = %.2fms",
 				workForm->Statistics.MinJitter,
@@ -0,0 +1,94 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/BufferPool.h"
+
+namespace WindowsUtils::Core
+{
+	BufferPool::BufferPool(const __uint64 budget)
+		: m_budget(budget), m_inUseSize(0), m_freeSize(0), m_isCancelled(false)
+	{
+		InitializeSRWLock(&m_lock);
+		InitializeConditionVariable(&m_released);
+	}
+
+	BufferPool::~BufferPool() { }
+
+	std::unique_ptr<POOLED_BUFFER> BufferPool::Acquire(const __uint64 size, const bool canWait)
+	{
+		const __uint64 capacity = max(((size + BUFFER_POOL_GRANULARITY - 1) / BUFFER_POOL_GRANULARITY) * BUFFER_POOL_GRANULARITY, BUFFER_POOL_GRANULARITY);
+
+		AcquireSRWLockExclusive(&m_lock);
+		while (canWait && !m_isCancelled && m_inUseSize > 0 && m_inUseSize + capacity > m_budget)
+			SleepConditionVariableSRW(&m_released, &m_lock, INFINITE, 0);
+
+		if (m_isCancelled) {
+			ReleaseSRWLockExclusive(&m_lock);
+			return nullptr;
+		}
+
+		// Smallest free buffer that fits.
+		auto bestFit = m_free.end();
+		for (auto iterator = m_free.begin(); iterator != m_free.end(); iterator++) {
+			if ((*iterator)->Capacity >= capacity && (bestFit == m_free.end() || (*iterator)->Capacity < (*bestFit)->Capacity))
+				bestFit = iterator;
+		}
+
+		std::unique_ptr<POOLED_BUFFER> buffer;
+		if (bestFit != m_free.end()) {
+			buffer = std::move(*bestFit);
+			m_free.erase(bestFit);
+			m_freeSize -= buffer->Capacity;
+		}
+		else {
+			// Making room for the new one, oldest free buffers first.
+			while (!m_free.empty() && m_inUseSize + m_freeSize + capacity > m_budget) {
+				m_freeSize -= m_free.front()->Capacity;
+				m_free.erase(m_free.begin());
+			}
+		}
+
+		m_inUseSize += buffer ? buffer->Capacity : capacity;
+		ReleaseSRWLockExclusive(&m_lock);
+
+		// Allocating out of the lock, the size is already accounted for. Not zeroed, it's about to be overwritten.
+		if (!buffer) {
+			try {
+				buffer = std::make_unique<POOLED_BUFFER>(std::unique_ptr<BYTE[]>(new BYTE[capacity]), capacity);
+			}
+			catch (const std::bad_alloc&) {
+				AcquireSRWLockExclusive(&m_lock);
+				m_inUseSize -= capacity;
+				ReleaseSRWLockExclusive(&m_lock);
+				WakeAllConditionVariable(&m_released);
+
+				_WU_RAISE_NATIVE_EXCEPTION(ERROR_NOT_ENOUGH_MEMORY, L"BufferPool::Acquire", WriteErrorCategory::ResourceUnavailable);
+			}
+		}
+
+		return buffer;
+	}
+
+	void BufferPool::Release(std::unique_ptr<POOLED_BUFFER> buffer)
+	{
+		if (!buffer)
+			return;
+
+		AcquireSRWLockExclusive(&m_lock);
+		m_inUseSize -= buffer->Capacity;
+		if (m_inUseSize + m_freeSize + buffer->Capacity <= m_budget) {
+			m_freeSize += buffer->Capacity;
+			m_free.push_back(std::move(buffer));
+		}
+
+		ReleaseSRWLockExclusive(&m_lock);
+		WakeAllConditionVariable(&m_released);
+	}
+
+	void BufferPool::Cancel()
+	{
+		AcquireSRWLockExclusive(&m_lock);
+		m_isCancelled = true;
+		ReleaseSRWLockExclusive(&m_lock);
+		WakeAllConditionVariable(&m_released);
+	}
+}
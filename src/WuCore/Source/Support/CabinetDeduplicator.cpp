@@ -0,0 +1,138 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/Cabinet/CabinetDeduplicator.h"
+
+#include <algorithm>
+
+#pragma comment(lib, "Bcrypt.lib")
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Cabinet deduplicator ~
+	*/
+
+	std::vector<DWORD> CabinetDeduplicator::FindDuplicates(const AbstractPathTree& apt, const DWORD threadCount)
+	{
+		const auto& entries = apt.GetApt();
+		std::vector<DWORD> duplicates(entries.size(), NotDuplicate);
+
+		// Sizes first, a file with a size of its own can't have a copy.
+		std::vector<DEDUP_CANDIDATE> sized;
+		for (DWORD i = 0; i < static_cast<DWORD>(entries.size()); i++) {
+			if (entries[i].Type == FsObjectType::File && entries[i].Length > 0)
+				sized.push_back({ i, entries[i].Length });
+		}
+
+		std::stable_sort(sized.begin(), sized.end(), [](const DEDUP_CANDIDATE& left, const DEDUP_CANDIDATE& right) { return left.Size < right.Size; });
+
+		std::vector<DEDUP_CANDIDATE> candidates;
+		for (size_t i = 0; i < sized.size(); i++) {
+			if ((i > 0 && sized[i - 1].Size == sized[i].Size) || (i + 1 < sized.size() && sized[i + 1].Size == sized[i].Size))
+				candidates.push_back(sized[i]);
+		}
+
+		if (candidates.empty())
+			return duplicates;
+
+		DEDUP_DATA dedupData{ &apt, &candidates };
+		NTSTATUS status = BCryptOpenAlgorithmProvider(&dedupData.Algorithm, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
+		if (!BCRYPT_SUCCESS(status))
+			_WU_RAISE_NATIVE_NT_EXCEPTION(status, L"BCryptOpenAlgorithmProvider", WriteErrorCategory::NotImplemented);
+
+		// The calling thread hashes too.
+		const size_t workerCount = min(min(static_cast<size_t>(max(threadCount, 1)), candidates.size()), static_cast<size_t>(MAXIMUM_WAIT_OBJECTS)) - 1;
+
+		DWORD createdCount = 0;
+		HANDLE workers[MAXIMUM_WAIT_OBJECTS]{ };
+		for (; createdCount < workerCount; createdCount++) {
+			DWORD threadId;
+			workers[createdCount] = CreateThread(NULL, 0, HashWorker, &dedupData, 0, &threadId);
+			if (workers[createdCount] == NULL)
+				break;
+		}
+
+		HashWorker(&dedupData);
+		if (createdCount > 0) {
+			WaitForMultipleObjects(createdCount, workers, TRUE, INFINITE);
+			for (DWORD i = 0; i < createdCount; i++)
+				CloseHandle(workers[i]);
+		}
+
+		BCryptCloseAlgorithmProvider(dedupData.Algorithm, 0);
+
+		// Same size and hash are next to each other, and the lowest index goes first.
+		std::sort(candidates.begin(), candidates.end(), [](const DEDUP_CANDIDATE& left, const DEDUP_CANDIDATE& right) {
+			if (left.Size != right.Size)
+				return left.Size < right.Size;
+
+			const int hashOrder = memcmp(left.Hash, right.Hash, CAB_DEDUP_HASH_SIZE);
+			if (hashOrder != 0)
+				return hashOrder < 0;
+
+			return left.Index < right.Index;
+		});
+
+		size_t original = 0;
+		for (size_t i = 1; i < candidates.size(); i++) {
+			const DEDUP_CANDIDATE& current = candidates[i];
+			const DEDUP_CANDIDATE& first = candidates[original];
+			if (current.IsHashed && first.IsHashed && current.Size == first.Size && memcmp(current.Hash, first.Hash, CAB_DEDUP_HASH_SIZE) == 0)
+				duplicates[current.Index] = first.Index;
+			else
+				original = i;
+		}
+
+		return duplicates;
+	}
+
+	DWORD WINAPI CabinetDeduplicator::HashWorker(LPVOID params)
+	{
+		auto dedupData = reinterpret_cast<PDEDUP_DATA>(params);
+		auto& candidates = *dedupData->Candidates;
+		const LONG candidateCount = static_cast<LONG>(candidates.size());
+
+		// A failure leaves the rest unhashed, they're just not deduplicated.
+		try {
+			auto buffer = std::make_unique<BYTE[]>(CAB_DEDUP_READ_SIZE);
+
+			LONG next;
+			while ((next = InterlockedIncrement(&dedupData->NextCandidate) - 1) < candidateCount) {
+				DEDUP_CANDIDATE& candidate = candidates[next];
+				const WWuString fullPath = dedupData->Tree->GetFullPath(dedupData->Tree->GetApt()[candidate.Index]);
+				candidate.IsHashed = TryHashFile(fullPath, dedupData->Algorithm, buffer.get(), candidate.Hash);
+			}
+		}
+		catch (...) { }
+
+		return 0;
+	}
+
+	bool CabinetDeduplicator::TryHashFile(const WWuString& path, const BCRYPT_ALG_HANDLE algorithm, BYTE* buffer, BYTE* hash)
+	{
+		BCRYPT_HASH_HANDLE hashHandle;
+		if (!BCRYPT_SUCCESS(BCryptCreateHash(algorithm, &hashHandle, nullptr, 0, nullptr, 0, 0)))
+			return false;
+
+		bool isHashed = false;
+		try {
+			FileHandle handle(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+			DWORD bytesRead;
+			while (ReadFile(handle.Get(), buffer, CAB_DEDUP_READ_SIZE, &bytesRead, nullptr)) {
+				if (bytesRead == 0) {
+					isHashed = BCRYPT_SUCCESS(BCryptFinishHash(hashHandle, hash, CAB_DEDUP_HASH_SIZE, 0));
+					break;
+				}
+
+				if (!BCRYPT_SUCCESS(BCryptHashData(hashHandle, buffer, bytesRead, 0)))
+					break;
+			}
+		}
+		catch (const WuException&) { }
+
+		BCryptDestroyHash(hashHandle);
+
+		return isHashed;
+	}
+}
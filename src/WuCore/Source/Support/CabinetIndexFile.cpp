@@ -0,0 +1,216 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/Cabinet/CabinetIndexFile.h"
+
+#include <unordered_map>
+
+#include <PathCch.h>
+#include <Shlwapi.h>
+
+namespace WindowsUtils::Core
+{
+	std::unique_ptr<CabinetSet> CabinetIndexFile::OpenSet(const WWuString& path)
+	{
+		const WWuString indexPath = GetIndexPath(path);
+		auto cabinetSet = Load(indexPath, IO::RemoveFileSpec(path, true));
+		if (cabinetSet)
+			return cabinetSet;
+
+		cabinetSet = std::make_unique<CabinetSet>(path);
+
+		// If we can't write the index (e.g., read-only media) we just don't have one next time.
+		try {
+			Save(*cabinetSet, indexPath);
+		}
+		catch (const WuException&) {
+			DeleteFile(indexPath.Raw());
+		}
+
+		return cabinetSet;
+	}
+
+	std::unique_ptr<CabinetSet> CabinetIndexFile::Load(const WWuString& indexPath, const WWuString& directory)
+	{
+		if (!PathFileExists(indexPath.Raw()))
+			return nullptr;
+
+		// Anything wrong with the index, or with the volumes it points to, means we rebuild it.
+		// If the volumes are really broken, opening the set the regular way raises the proper error.
+		try {
+			MemoryMappedFile mappedFile(indexPath);
+			const BYTE* data = reinterpret_cast<const BYTE*>(mappedFile.data());
+			const __uint64 size = mappedFile.size();
+			if (size < sizeof(CAB_INDEX_HEADER) + sizeof(DWORD) || size > MAXDWORD)
+				return nullptr;
+
+			const DWORD contentSize = static_cast<DWORD>(size - sizeof(DWORD));
+			DWORD checksum;
+			RtlCopyMemory(&checksum, data + contentSize, sizeof(DWORD));
+			if (CabinetFolderReader::ComputeChecksum(data, contentSize, 0) != checksum)
+				return nullptr;
+
+			// Returns the next 'count' bytes, making sure they're inside the content.
+			DWORD offset = 0;
+			auto next = [&](const __uint64 count) {
+				if (count > contentSize - offset)
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetIndexFile::Load", WriteErrorCategory::InvalidData, L"Cabinet index is truncated.");
+
+				const BYTE* current = data + offset;
+				offset += static_cast<DWORD>(count);
+
+				return current;
+			};
+
+			CAB_INDEX_HEADER header;
+			RtlCopyMemory(&header, next(sizeof(CAB_INDEX_HEADER)), sizeof(CAB_INDEX_HEADER));
+			if (header.Signature != CAB_INDEX_SIGNATURE || header.Version != CAB_INDEX_VERSION || header.VolumeCount == 0)
+				return nullptr;
+
+			std::vector<std::unique_ptr<CabinetVolume>> volumes;
+			for (DWORD i = 0; i < header.VolumeCount; i++) {
+				CAB_INDEX_VOLUME stamp;
+				RtlCopyMemory(&stamp, next(sizeof(CAB_INDEX_VOLUME)), sizeof(CAB_INDEX_VOLUME));
+				WWuString name(reinterpret_cast<const WCHAR*>(next(static_cast<__uint64>(stamp.NameLength) * sizeof(WCHAR))), stamp.NameLength);
+
+				auto volume = std::make_unique<CabinetVolume>(CabinetSet::GetSiblingPath(directory, name));
+				CAB_INDEX_VOLUME current{ };
+				GetVolumeStamp(*volume, current);
+				if (current.Size != stamp.Size || CompareFileTime(&current.LastWriteTime, &stamp.LastWriteTime) != 0 || current.HeaderChecksum != stamp.HeaderChecksum)
+					return nullptr;
+
+				volumes.push_back(std::move(volume));
+			}
+
+			__uint64 folderOffset = 0;
+			WuList<CABINET_FOLDER> folders(header.FolderCount);
+			for (DWORD i = 0; i < header.FolderCount; i++) {
+				CAB_INDEX_FOLDER entry;
+				RtlCopyMemory(&entry, next(sizeof(CAB_INDEX_FOLDER)), sizeof(CAB_INDEX_FOLDER));
+				if (entry.Offset != folderOffset || entry.SegmentCount == 0)
+					return nullptr;
+
+				folderOffset += entry.UncompressedSize;
+
+				CABINET_FOLDER folder{ entry.CompressionType, entry.UncompressedSize };
+				for (WORD j = 0; j < entry.SegmentCount; j++) {
+					CAB_INDEX_SEGMENT segment;
+					RtlCopyMemory(&segment, next(sizeof(CAB_INDEX_SEGMENT)), sizeof(CAB_INDEX_SEGMENT));
+					if (segment.VolumeIndex >= volumes.size())
+						return nullptr;
+
+					const CabinetVolume* volume = volumes[segment.VolumeIndex].get();
+					if (volume->GetFolder(segment.FolderIndex).FirstDataOffset != segment.FirstDataOffset)
+						return nullptr;
+
+					folder.Segments.Add(CABINET_FOLDER_SEGMENT{ volume, segment.FolderIndex });
+				}
+
+				for (DWORD j = 0; j < entry.FileCount; j++) {
+					CAB_INDEX_FILE file;
+					RtlCopyMemory(&file, next(sizeof(CAB_INDEX_FILE)), sizeof(CAB_INDEX_FILE));
+
+					CABINET_FILE_INFO info{ WuString(reinterpret_cast<const char*>(next(file.NameLength)), file.NameLength),
+						file.Size, file.FolderOffset, file.FolderIndex, file.Date, file.Time, file.Attributes };
+
+					folder.Files.Add(info);
+				}
+
+				folders.Add(folder);
+			}
+
+			if (offset != contentSize)
+				return nullptr;
+
+			auto cabinetSet = std::make_unique<CabinetSet>(std::move(volumes), std::move(folders));
+			if (cabinetSet->FileCount() != header.FileCount || cabinetSet->TotalUncompressedSize() != header.TotalUncompressedSize)
+				return nullptr;
+
+			return cabinetSet;
+		}
+		catch (...) {
+			return nullptr;
+		}
+	}
+
+	void CabinetIndexFile::Save(const CabinetSet& cabinetSet, const WWuString& indexPath)
+	{
+		const auto& volumes = cabinetSet.Volumes();
+		const auto& folders = cabinetSet.Folders();
+
+		std::vector<BYTE> buffer;
+		auto append = [&buffer](const void* data, const size_t count) {
+			const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+			buffer.insert(buffer.end(), bytes, bytes + count);
+		};
+
+		CAB_INDEX_HEADER header{ CAB_INDEX_SIGNATURE, CAB_INDEX_VERSION, static_cast<DWORD>(volumes.size()), static_cast<DWORD>(folders.Count()), cabinetSet.FileCount(), cabinetSet.TotalUncompressedSize() };
+		append(&header, sizeof(CAB_INDEX_HEADER));
+
+		std::unordered_map<const CabinetVolume*, WORD> volumeIndexes(volumes.size());
+		for (size_t i = 0; i < volumes.size(); i++) {
+			const WWuString& name = volumes[i]->Name();
+
+			CAB_INDEX_VOLUME stamp{ };
+			GetVolumeStamp(*volumes[i], stamp);
+			stamp.NameLength = static_cast<WORD>(name.Length());
+			append(&stamp, sizeof(CAB_INDEX_VOLUME));
+			append(name.Raw(), name.Length() * sizeof(WCHAR));
+
+			volumeIndexes.emplace(volumes[i].get(), static_cast<WORD>(i));
+		}
+
+		__uint64 folderOffset = 0;
+		for (const CABINET_FOLDER& folder : folders) {
+			CAB_INDEX_FOLDER entry{ folder.UncompressedSize, folderOffset, static_cast<DWORD>(folder.Files.Count()), folder.CompressionType, static_cast<WORD>(folder.Segments.Count()) };
+			append(&entry, sizeof(CAB_INDEX_FOLDER));
+			folderOffset += folder.UncompressedSize;
+
+			for (const CABINET_FOLDER_SEGMENT& segment : folder.Segments) {
+				CAB_INDEX_SEGMENT indexSegment{ segment.Volume->GetFolder(segment.FolderIndex).FirstDataOffset, volumeIndexes[segment.Volume], segment.FolderIndex };
+				append(&indexSegment, sizeof(CAB_INDEX_SEGMENT));
+			}
+
+			for (const CABINET_FILE_INFO& info : folder.Files) {
+				CAB_INDEX_FILE file{ info.Size, info.FolderOffset, info.FolderIndex, info.Date, info.Time, info.Attributes, static_cast<WORD>(info.Name.Length()) };
+				append(&file, sizeof(CAB_INDEX_FILE));
+				append(info.Name.Raw(), info.Name.Length());
+			}
+		}
+
+		const DWORD checksum = CabinetFolderReader::ComputeChecksum(buffer.data(), static_cast<DWORD>(buffer.size()), 0);
+		append(&checksum, sizeof(DWORD));
+
+		FileHandle file(indexPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		DWORD bytesWritten;
+		if (!WriteFile(file.Get(), buffer.data(), static_cast<DWORD>(buffer.size()), &bytesWritten, nullptr) || bytesWritten != buffer.size())
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+	}
+
+	WWuString CabinetIndexFile::GetIndexPath(const WWuString& path)
+	{
+		// Path size + '.cabidx' + \0
+		size_t pathBufSize = path.Length() + 8;
+		auto pathBuffer = std::make_unique<WCHAR[]>(pathBufSize);
+		wcscpy_s(pathBuffer.get(), pathBufSize, path.Raw());
+
+		HRESULT result = PathCchRenameExtension(pathBuffer.get(), pathBufSize, L".cabidx");
+		if (result != S_OK)
+			_WU_RAISE_NATIVE_EXCEPTION(result, L"PathCchRenameExtension", WriteErrorCategory::InvalidResult);
+
+		return WWuString(pathBuffer.get());
+	}
+
+	void CabinetIndexFile::GetVolumeStamp(const CabinetVolume& volume, CAB_INDEX_VOLUME& stamp)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesEx(volume.Path().Raw(), GetFileExInfoStandard, &attributes))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"GetFileAttributesEx", WriteErrorCategory::ReadError);
+
+		const DWORD headerSize = volume.Header().FirstFileOffset;
+
+		stamp.Size            = (static_cast<__uint64>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		stamp.LastWriteTime   = attributes.ftLastWriteTime;
+		stamp.HeaderChecksum  = CabinetFolderReader::ComputeChecksum(volume.At(0, headerSize), headerSize, 0);
+	}
+}
@@ -0,0 +1,529 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/Cabinet/CabinetReader.h"
+#include "../../Headers/Support/Cabinet/MsZipDecoder.h"
+#include "../../Headers/Support/Cabinet/LzxDecoder.h"
+
+#include <intrin.h>
+#include <algorithm>
+
+#include <fdi.h>
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Cabinet file info ~
+	*/
+
+	WWuString _CABINET_FILE_INFO::GetRelativePath() const
+	{
+		DWORD codePage = (Attributes & _A_NAME_IS_UTF) ? CP_UTF8 : 1252;
+
+		return WuString::ToWide(Name.Raw(), codePage).Replace('/', '\\');
+	}
+
+	/*
+	*	~ Cabinet volume ~
+	*/
+
+	CabinetVolume::CabinetVolume(const WWuString& path)
+		: m_path(path), m_name(IO::StripPath(path)), m_header(nullptr), m_folderTableOffset(0), m_folderReserveSize(0), m_dataReserveSize(0)
+	{
+		m_mappedFile = std::make_unique<MemoryMappedFile>(path);
+		m_data = reinterpret_cast<const BYTE*>(m_mappedFile->data());
+		m_size = m_mappedFile->size();
+
+		Parse();
+	}
+
+	CabinetVolume::CabinetVolume(const BYTE* data, const __uint64 size, const WWuString& name)
+		: m_data(data), m_size(size), m_path(name), m_name(name), m_header(nullptr), m_folderTableOffset(0), m_folderReserveSize(0), m_dataReserveSize(0)
+	{
+		Parse();
+	}
+
+	CabinetVolume::~CabinetVolume() { }
+
+	const WWuString& CabinetVolume::Path() const { return m_path; }
+	const WWuString& CabinetVolume::Name() const { return m_name; }
+	const CAB_HEADER& CabinetVolume::Header() const { return *m_header; }
+	const WuString& CabinetVolume::PreviousCabinet() const { return m_previousCabinet; }
+	const WuString& CabinetVolume::NextCabinet() const { return m_nextCabinet; }
+	const BYTE CabinetVolume::DataReserveSize() const { return m_dataReserveSize; }
+	const BYTE* CabinetVolume::Data() const { return m_data; }
+	const __uint64 CabinetVolume::Size() const { return m_size; }
+
+	const CAB_FOLDER_ENTRY& CabinetVolume::GetFolder(const WORD index) const
+	{
+		if (index >= m_header->FolderCount)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetVolume::GetFolder", WriteErrorCategory::InvalidData, L"Cabinet folder index is out of range.");
+
+		const __uint64 entrySize = sizeof(CAB_FOLDER_ENTRY) + m_folderReserveSize;
+
+		return *reinterpret_cast<const CAB_FOLDER_ENTRY*>(At(m_folderTableOffset + (index * entrySize), sizeof(CAB_FOLDER_ENTRY)));
+	}
+
+	void CabinetVolume::ReadFileEntry(DWORD& offset, CABINET_FILE_INFO& info) const
+	{
+		const auto entry = reinterpret_cast<const CAB_FILE_ENTRY*>(At(offset, sizeof(CAB_FILE_ENTRY)));
+
+		info.Size          = entry->UncompressedSize;
+		info.FolderOffset  = entry->FolderOffset;
+		info.FolderIndex   = entry->FolderIndex;
+		info.Date          = entry->Date;
+		info.Time          = entry->Time;
+		info.Attributes    = entry->Attributes;
+
+		offset = ReadString(offset + sizeof(CAB_FILE_ENTRY), info.Name);
+	}
+
+	const BYTE* CabinetVolume::At(const __uint64 offset, const __uint64 count) const
+	{
+		if (offset > m_size || count > m_size - offset)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetVolume::At", WriteErrorCategory::InvalidData, L"Cabinet is truncated or corrupted.");
+
+		return m_data + offset;
+	}
+
+	void CabinetVolume::Parse()
+	{
+		if (m_size < sizeof(CAB_HEADER))
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetVolume::Parse", WriteErrorCategory::InvalidData, L"File is not a cabinet.");
+
+		m_header = reinterpret_cast<const CAB_HEADER*>(m_data);
+		if (m_header->Signature != CAB_SIGNATURE)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetVolume::Parse", WriteErrorCategory::InvalidData, L"File is not a cabinet.");
+
+		if (m_header->VersionMajor != 1)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetVolume::Parse", WriteErrorCategory::InvalidData, L"Unsupported cabinet version.");
+
+		if (m_header->CabinetSize > m_size)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetVolume::Parse", WriteErrorCategory::InvalidData, L"Cabinet is truncated.");
+
+		DWORD offset = sizeof(CAB_HEADER);
+		if ((m_header->Flags & cfhdrRESERVE_PRESENT) > 0) {
+			const auto reserve = reinterpret_cast<const CAB_HEADER_RESERVE*>(At(offset, sizeof(CAB_HEADER_RESERVE)));
+			m_folderReserveSize = reserve->FolderReserveSize;
+			m_dataReserveSize = reserve->DataReserveSize;
+
+			offset += sizeof(CAB_HEADER_RESERVE) + reserve->HeaderReserveSize;
+		}
+
+		// We don't use the disk names, but we need to skip them.
+		WuString diskName;
+		if ((m_header->Flags & cfhdrPREV_CABINET) > 0) {
+			offset = ReadString(offset, m_previousCabinet);
+			offset = ReadString(offset, diskName);
+		}
+
+		if ((m_header->Flags & cfhdrNEXT_CABINET) > 0) {
+			offset = ReadString(offset, m_nextCabinet);
+			offset = ReadString(offset, diskName);
+		}
+
+		// Validating the folder table is in the view, so 'GetFolder' can't go out of bounds.
+		m_folderTableOffset = offset;
+		At(m_folderTableOffset, static_cast<__uint64>(m_header->FolderCount) * (sizeof(CAB_FOLDER_ENTRY) + m_folderReserveSize));
+	}
+
+	DWORD CabinetVolume::ReadString(const DWORD offset, WuString& value) const
+	{
+		if (offset >= m_size)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetVolume::ReadString", WriteErrorCategory::InvalidData, L"Cabinet is truncated or corrupted.");
+
+		const size_t maxLength = static_cast<size_t>(min(m_size - offset, CAB_MAX_FILE_NAME + 1));
+		const auto start = reinterpret_cast<const char*>(m_data + offset);
+		const auto end = reinterpret_cast<const char*>(memchr(start, '\0', maxLength));
+		if (end == nullptr)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetVolume::ReadString", WriteErrorCategory::InvalidData, L"Cabinet string is not terminated.");
+
+		const size_t length = end - start;
+		value = WuString(start, length);
+
+		return offset + static_cast<DWORD>(length) + 1;
+	}
+
+	/*
+	*	~ Cabinet set ~
+	*/
+
+	CabinetSet::CabinetSet(const WWuString& path)
+		: m_fileCount(0), m_totalUncompressedSize(0)
+	{
+		WWuString directory = IO::RemoveFileSpec(path, true);
+
+		// 'Moving' to the first cabinet.
+		// The cabinet index is a WORD, a longer chain means the set is looping.
+		auto current = std::make_unique<CabinetVolume>(path);
+		while (!WuString::IsNullOrEmpty(current->PreviousCabinet())) {
+			if (m_volumes.size() > 0xFFFF)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetSet", WriteErrorCategory::InvalidData, L"Cabinet set chain is circular.");
+
+			auto previous = std::make_unique<CabinetVolume>(GetSiblingPath(directory, current->PreviousCabinet().ToWide()));
+			m_volumes.insert(m_volumes.begin(), std::move(current));
+			current = std::move(previous);
+		}
+
+		m_volumes.insert(m_volumes.begin(), std::move(current));
+
+		// Opening the volumes after the one we were given.
+		while (!WuString::IsNullOrEmpty(m_volumes.back()->NextCabinet())) {
+			if (m_volumes.size() > 0xFFFF)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetSet", WriteErrorCategory::InvalidData, L"Cabinet set chain is circular.");
+
+			m_volumes.push_back(std::make_unique<CabinetVolume>(GetSiblingPath(directory, m_volumes.back()->NextCabinet().ToWide())));
+		}
+
+		Build();
+	}
+
+	CabinetSet::CabinetSet(std::vector<std::unique_ptr<CabinetVolume>>&& volumes)
+		: m_volumes(std::move(volumes)), m_fileCount(0), m_totalUncompressedSize(0)
+	{
+		Build();
+	}
+
+	CabinetSet::CabinetSet(std::vector<std::unique_ptr<CabinetVolume>>&& volumes, WuList<CABINET_FOLDER>&& folders)
+		: m_volumes(std::move(volumes)), m_folders(std::move(folders)), m_fileCount(0), m_totalUncompressedSize(0)
+	{
+		for (const CABINET_FOLDER& folder : m_folders) {
+			for (const CABINET_FILE_INFO& info : folder.Files) {
+				m_fileCount++;
+				m_totalUncompressedSize += info.Size;
+			}
+		}
+	}
+
+	CabinetSet::~CabinetSet() { }
+
+	const std::vector<std::unique_ptr<CabinetVolume>>& CabinetSet::Volumes() const { return m_volumes; }
+	const WuList<CABINET_FOLDER>& CabinetSet::Folders() const { return m_folders; }
+	const DWORD CabinetSet::FileCount() const { return m_fileCount; }
+	const __uint64 CabinetSet::TotalUncompressedSize() const { return m_totalUncompressedSize; }
+
+	void CabinetSet::Build()
+	{
+		std::vector<size_t> folderMap;
+		for (const auto& volume : m_volumes) {
+			const CAB_HEADER& header = volume->Header();
+
+			// Files continued from the previous volume were already accounted for there,
+			// but they tell us this volume's first folder continues the previous volume's last one.
+			bool continuesPrevious = false;
+			WuList<CABINET_FILE_INFO> files(header.FileCount);
+			DWORD offset = header.FirstFileOffset;
+			for (WORD i = 0; i < header.FileCount; i++) {
+				CABINET_FILE_INFO info{ };
+				volume->ReadFileEntry(offset, info);
+				if (info.FolderIndex == cffileCONTINUED_FROM_PREV || info.FolderIndex == cffileCONTINUED_PREV_AND_NEXT) {
+					continuesPrevious = true;
+					continue;
+				}
+
+				files.Add(info);
+			}
+
+			if (continuesPrevious && (m_folders.Count() == 0 || header.FolderCount == 0))
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetSet::Build", WriteErrorCategory::InvalidData, L"Cabinet continues a folder from a missing cabinet.");
+
+			// Mapping the volume folder indexes to set folder indexes.
+			folderMap.clear();
+			for (WORD i = 0; i < header.FolderCount; i++) {
+				const CAB_FOLDER_ENTRY& entry = volume->GetFolder(i);
+				if (i == 0 && continuesPrevious) {
+					CABINET_FOLDER& previous = m_folders.Back();
+					if (previous.CompressionType != entry.CompressionType)
+						_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetSet::Build", WriteErrorCategory::InvalidData, L"Continued cabinet folder changes compression type.");
+
+					previous.Segments.Add(CABINET_FOLDER_SEGMENT{ volume.get(), i });
+					folderMap.push_back(m_folders.Count() - 1);
+				}
+				else {
+					CABINET_FOLDER folder{ entry.CompressionType, 0 };
+					folder.Segments.Add(CABINET_FOLDER_SEGMENT{ volume.get(), i });
+					m_folders.Add(folder);
+					folderMap.push_back(m_folders.Count() - 1);
+				}
+			}
+
+			for (CABINET_FILE_INFO& info : files) {
+				WORD localIndex = info.FolderIndex == cffileCONTINUED_TO_NEXT ? header.FolderCount - 1 : info.FolderIndex;
+				if (localIndex >= header.FolderCount)
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetSet::Build", WriteErrorCategory::InvalidData, L"Cabinet file entry points to an invalid folder.");
+
+				CABINET_FOLDER& folder = m_folders[folderMap[localIndex]];
+				folder.UncompressedSize = max(folder.UncompressedSize, static_cast<__uint64>(info.FolderOffset) + info.Size);
+				folder.Files.Add(info);
+
+				m_fileCount++;
+				m_totalUncompressedSize += info.Size;
+			}
+		}
+
+		// Files are usually stored in order already, but nothing requires it.
+		for (CABINET_FOLDER& folder : m_folders) {
+			std::stable_sort(folder.Files.begin(), folder.Files.end(), [](const CABINET_FILE_INFO& left, const CABINET_FILE_INFO& right) {
+				return left.FolderOffset < right.FolderOffset;
+			});
+		}
+	}
+
+	WWuString CabinetSet::GetSiblingPath(const WWuString& directory, const WWuString& name)
+	{
+		// Dir size + file name size + possible '\' + \0
+		size_t pathBufSize = directory.Length() + name.Length() + 2;
+		auto pathBuffer = std::make_unique<WCHAR[]>(pathBufSize);
+		HRESULT result = PathCchCombine(pathBuffer.get(), pathBufSize, directory.Raw(), name.Raw());
+		if (result != S_OK)
+			_WU_RAISE_NATIVE_EXCEPTION(result, L"PathCchCombine", WriteErrorCategory::InvalidResult);
+
+		return WWuString(pathBuffer.get());
+	}
+
+	/*
+	*	~ Cabinet set index ~
+	*/
+
+	CabinetSetIndex::CabinetSetIndex(const CabinetSet& cabinetSet)
+		: m_totalUncompressedSize(0)
+	{
+		const auto& volumes = cabinetSet.Volumes();
+		const auto& folders = cabinetSet.Folders();
+
+		std::unordered_map<const CabinetVolume*, DWORD> volumeIndexes(volumes.size());
+		m_volumes.reserve(volumes.size());
+		for (size_t i = 0; i < volumes.size(); i++) {
+			volumeIndexes.emplace(volumes[i].get(), static_cast<DWORD>(i + 1));
+			m_volumes.emplace(volumes[i]->Name(), volumes[i].get());
+		}
+
+		__uint64 folderOffset = 0;
+		m_files.reserve(cabinetSet.FileCount());
+		m_folderVolumes.reserve(folders.Count());
+		m_folderOffsets.reserve(folders.Count());
+		for (const CABINET_FOLDER& folder : folders) {
+			m_folderVolumes.push_back(volumeIndexes[folder.Segments[0].Volume]);
+			m_folderOffsets.push_back(folderOffset);
+			folderOffset += folder.UncompressedSize;
+
+			for (const CABINET_FILE_INFO& info : folder.Files) {
+				if (m_files.emplace(info.Name, &info).second)
+					m_totalUncompressedSize += info.Size;
+			}
+		}
+	}
+
+	CabinetSetIndex::~CabinetSetIndex() { }
+
+	const DWORD CabinetSetIndex::FileCount() const { return static_cast<DWORD>(m_files.size()); }
+	const __uint64 CabinetSetIndex::TotalUncompressedSize() const { return m_totalUncompressedSize; }
+	const DWORD CabinetSetIndex::GetFolderVolumeIndex(const size_t folderIndex) const { return m_folderVolumes[folderIndex]; }
+	const __uint64 CabinetSetIndex::GetFolderOffset(const size_t folderIndex) const { return m_folderOffsets[folderIndex]; }
+
+	const CABINET_FILE_INFO* CabinetSetIndex::FindFile(const WuString& name) const
+	{
+		const auto iterator = m_files.find(name);
+
+		return iterator == m_files.end() ? nullptr : iterator->second;
+	}
+
+	const CabinetVolume* CabinetSetIndex::FindVolume(const WWuString& name) const
+	{
+		const auto iterator = m_volumes.find(name);
+
+		return iterator == m_volumes.end() ? nullptr : iterator->second;
+	}
+
+	/*
+	*	~ Decompressors ~
+	*/
+
+	bool CabinetDecompressor::IsSupported(const WORD compressionType)
+	{
+		switch (compressionType & cffoldCOMPTYPE_MASK) {
+			case tcompTYPE_NONE:
+			case tcompTYPE_MSZIP:
+				return true;
+
+			case tcompTYPE_LZX:
+				return LzxDecoder::IsValidWindow((compressionType & tcompMASK_LZX_WINDOW) >> tcompSHIFT_LZX_WINDOW);
+
+			default:
+				return false;
+		}
+	}
+
+	std::unique_ptr<CabinetDecompressor> CabinetDecompressor::Create(const WORD compressionType)
+	{
+		switch (compressionType & cffoldCOMPTYPE_MASK) {
+			case tcompTYPE_NONE:
+				return std::make_unique<StoredDecompressor>();
+
+			case tcompTYPE_MSZIP:
+				return std::make_unique<MsZipDecoder>();
+
+			case tcompTYPE_LZX:
+				return std::make_unique<LzxDecoder>((compressionType & tcompMASK_LZX_WINDOW) >> tcompSHIFT_LZX_WINDOW);
+
+			default:
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_NOT_SUPPORTED, L"CabinetDecompressor::Create", WriteErrorCategory::NotImplemented, L"Cabinet compression type not supported.");
+		}
+	}
+
+	void StoredDecompressor::Reset() { }
+
+	const BYTE* StoredDecompressor::Decompress(const BYTE* input, const DWORD inputSize, BYTE* output, const DWORD outputSize)
+	{
+		UNREFERENCED_PARAMETER(output);
+
+		if (inputSize != outputSize)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"StoredDecompressor::Decompress", WriteErrorCategory::InvalidData, L"Stored cabinet block size mismatch.");
+
+		return input;
+	}
+
+	/*
+	*	~ Cabinet folder reader ~
+	*/
+
+	CabinetFolderReader::CabinetFolderReader(const CABINET_FOLDER& folder)
+		: m_folder(folder), m_segment(0), m_block(0), m_blockOffset(0), m_position(0)
+	{
+		m_decompressor = CabinetDecompressor::Create(folder.CompressionType);
+		m_output = std::make_unique<BYTE[]>(CAB_MAX_BLOCK_UNCOMPRESSED);
+	}
+
+	CabinetFolderReader::~CabinetFolderReader() { }
+
+	const __uint64 CabinetFolderReader::Position() const { return m_position; }
+
+	bool CabinetFolderReader::Read(const BYTE** data, DWORD* size)
+	{
+		const BYTE* payload;
+		const CAB_DATA_BLOCK* block = NextRawBlock(&payload);
+		if (block == nullptr)
+			return false;
+
+		DWORD compressedSize = block->CompressedSize;
+		DWORD uncompressedSize = block->UncompressedSize;
+
+		// A block with no uncompressed size is split at the end of the volume.
+		// The rest is the first block of the folder's next segment.
+		if (uncompressedSize == 0) {
+			const size_t segment = m_segment;
+
+			if (!m_joinBuffer)
+				m_joinBuffer = std::make_unique<BYTE[]>(CAB_MAX_BLOCK_COMPRESSED);
+
+			if (compressedSize > CAB_MAX_BLOCK_COMPRESSED)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetFolderReader::Read", WriteErrorCategory::InvalidData, L"Cabinet data block is too big.");
+
+			RtlCopyMemory(m_joinBuffer.get(), payload, compressedSize);
+
+			const BYTE* nextPayload;
+			const CAB_DATA_BLOCK* next = NextRawBlock(&nextPayload);
+			if (next == nullptr || m_segment == segment || next->UncompressedSize == 0)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetFolderReader::Read", WriteErrorCategory::InvalidData, L"Cabinet split data block has no continuation.");
+
+			if (compressedSize + next->CompressedSize > CAB_MAX_BLOCK_COMPRESSED)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetFolderReader::Read", WriteErrorCategory::InvalidData, L"Cabinet data block is too big.");
+
+			RtlCopyMemory(m_joinBuffer.get() + compressedSize, nextPayload, next->CompressedSize);
+
+			payload = m_joinBuffer.get();
+			compressedSize += next->CompressedSize;
+			uncompressedSize = next->UncompressedSize;
+		}
+
+		if (uncompressedSize > CAB_MAX_BLOCK_UNCOMPRESSED)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetFolderReader::Read", WriteErrorCategory::InvalidData, L"Cabinet data block is too big.");
+
+		*data = m_decompressor->Decompress(payload, compressedSize, m_output.get(), uncompressedSize);
+		*size = uncompressedSize;
+		m_position += uncompressedSize;
+
+		return true;
+	}
+
+	const CAB_DATA_BLOCK* CabinetFolderReader::NextRawBlock(const BYTE** payload)
+	{
+		while (m_segment < m_folder.Segments.Count()) {
+			const CABINET_FOLDER_SEGMENT& segment = m_folder.Segments[m_segment];
+			const CAB_FOLDER_ENTRY& entry = segment.Volume->GetFolder(segment.FolderIndex);
+			if (m_block < entry.DataBlockCount) {
+				if (m_block == 0)
+					m_blockOffset = entry.FirstDataOffset;
+
+				const DWORD headerSize = sizeof(CAB_DATA_BLOCK) + segment.Volume->DataReserveSize();
+				const auto block = reinterpret_cast<const CAB_DATA_BLOCK*>(segment.Volume->At(m_blockOffset, headerSize));
+				*payload = segment.Volume->At(static_cast<__uint64>(m_blockOffset) + headerSize, block->CompressedSize);
+
+				// The checksum covers the payload, then 'cbData' and 'cbUncomp'. Zero means it wasn't computed.
+				if (block->Checksum != 0) {
+					DWORD checksum = ComputeChecksum(*payload, block->CompressedSize, 0);
+					checksum = ComputeChecksum(reinterpret_cast<const BYTE*>(&block->CompressedSize), sizeof(WORD) * 2, checksum);
+					if (checksum != block->Checksum)
+						_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_CRC, L"CabinetFolderReader::Read", WriteErrorCategory::InvalidData, L"Cabinet data block checksum mismatch.");
+				}
+
+				m_blockOffset += headerSize + block->CompressedSize;
+				m_block++;
+
+				return block;
+			}
+
+			m_segment++;
+			m_block = 0;
+		}
+
+		return nullptr;
+	}
+
+	const CABINET_FOLDER_SEGMENT& CabinetFolderReader::CurrentSegment() const
+	{
+		return m_folder.Segments[min(m_segment, m_folder.Segments.Count() - 1)];
+	}
+
+	DWORD CabinetFolderReader::ComputeChecksum(const BYTE* data, const DWORD size, DWORD seed)
+	{
+		// The checksum XORs the data as little-endian DWORDs, so the order doesn't matter.
+		// We XOR 64 bytes at a time in four lanes, and fold them at the end.
+		const BYTE* current = data;
+		DWORD remaining = size;
+		if (remaining >= 16) {
+			__m128i lane0 = _mm_setzero_si128();
+			__m128i lane1 = _mm_setzero_si128();
+			__m128i lane2 = _mm_setzero_si128();
+			__m128i lane3 = _mm_setzero_si128();
+			for (; remaining >= 64; remaining -= 64, current += 64) {
+				lane0 = _mm_xor_si128(lane0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(current)));
+				lane1 = _mm_xor_si128(lane1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + 16)));
+				lane2 = _mm_xor_si128(lane2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + 32)));
+				lane3 = _mm_xor_si128(lane3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(current + 48)));
+			}
+
+			for (; remaining >= 16; remaining -= 16, current += 16)
+				lane0 = _mm_xor_si128(lane0, _mm_loadu_si128(reinterpret_cast<const __m128i*>(current)));
+
+			lane0 = _mm_xor_si128(_mm_xor_si128(lane0, lane1), _mm_xor_si128(lane2, lane3));
+			lane0 = _mm_xor_si128(lane0, _mm_srli_si128(lane0, 8));
+			lane0 = _mm_xor_si128(lane0, _mm_srli_si128(lane0, 4));
+			seed ^= static_cast<DWORD>(_mm_cvtsi128_si32(lane0));
+		}
+
+		for (; remaining >= 4; remaining -= 4) {
+			seed ^= static_cast<DWORD>(current[0]) | (static_cast<DWORD>(current[1]) << 8) | (static_cast<DWORD>(current[2]) << 16) | (static_cast<DWORD>(current[3]) << 24);
+			current += 4;
+		}
+
+		// The remaining bytes are folded in big-endian order.
+		DWORD remainder = 0;
+		switch (remaining) {
+			case 3: remainder |= static_cast<DWORD>(*current++) << 16;
+			case 2: remainder |= static_cast<DWORD>(*current++) << 8;
+			case 1: remainder |= *current;
+		}
+
+		return seed ^ remainder;
+	}
+}
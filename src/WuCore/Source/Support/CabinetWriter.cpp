@@ -0,0 +1,520 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/Cabinet/CabinetWriter.h"
+
+#include <algorithm>
+
+#include <fci.h>
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Folder compressor ~
+	*/
+
+	CabinetFolderCompressor::CabinetFolderCompressor(const WORD compressionType)
+		: m_compressionType(compressionType)
+	{
+		if (!IsSupported(compressionType))
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_NOT_SUPPORTED, L"CabinetFolderCompressor", WriteErrorCategory::NotImplemented, L"Compression type not supported by the native encoder.");
+
+		m_block = std::make_unique<BYTE[]>(CAB_MAX_BLOCK_UNCOMPRESSED);
+		if ((compressionType & cffoldCOMPTYPE_MASK) == tcompTYPE_MSZIP) {
+			m_encoder = std::make_unique<MsZipEncoder>();
+			m_output = std::make_unique<BYTE[]>(CAB_MAX_BLOCK_COMPRESSED);
+		}
+	}
+
+	CabinetFolderCompressor::~CabinetFolderCompressor() { }
+
+	bool CabinetFolderCompressor::Compress(CABINET_PLANNED_FOLDER& folder, volatile LONG* isCancelled, volatile LONG64* completedSize)
+	{
+		if (m_encoder)
+			m_encoder->Reset();
+
+		// Files are packed back to back, a block can have the end of one file and the start of the next.
+		DWORD blockSize = 0;
+		folder.BlockCount = 0;
+		for (CABINET_PLANNED_FILE& file : folder.Files) {
+			const WWuString fullPath = file.Tree->GetFullPath(*file.Entry);
+
+			// Copies only need their dates and attributes, the data is the original's.
+			if (file.IsDuplicate) {
+				FileHandle handle(fullPath, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				GetFileInformation(handle.Get(), file);
+				InterlockedAdd64(completedSize, file.Size);
+				continue;
+			}
+
+			FileHandle handle(fullPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			GetFileInformation(handle.Get(), file);
+
+			DWORD remaining = file.Size;
+			while (remaining > 0) {
+				if (*isCancelled)
+					return false;
+
+				DWORD bytesRead;
+				const DWORD count = min(remaining, CAB_MAX_BLOCK_UNCOMPRESSED - blockSize);
+				if (!ReadFile(handle.Get(), m_block.get() + blockSize, count, &bytesRead, nullptr))
+					_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"ReadFile", WriteErrorCategory::ReadError);
+
+				if (bytesRead == 0)
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_HANDLE_EOF, L"ReadFile", WriteErrorCategory::ReadError, WWuString::Format(L"File '%ws' changed while being compressed.", fullPath.Raw()));
+
+				blockSize += bytesRead;
+				remaining -= bytesRead;
+				if (blockSize == CAB_MAX_BLOCK_UNCOMPRESSED) {
+					WriteBlock(folder, blockSize);
+					InterlockedAdd64(completedSize, blockSize);
+					blockSize = 0;
+				}
+			}
+		}
+
+		if (blockSize > 0) {
+			WriteBlock(folder, blockSize);
+			InterlockedAdd64(completedSize, blockSize);
+		}
+
+		return true;
+	}
+
+	bool CabinetFolderCompressor::IsSupported(const WORD compressionType)
+	{
+		switch (compressionType & cffoldCOMPTYPE_MASK) {
+			case tcompTYPE_NONE:
+			case tcompTYPE_MSZIP:
+				return true;
+
+			default:
+				return false;
+		}
+	}
+
+	__uint64 CabinetFolderCompressor::GetWorstCaseSize(const WORD compressionType, const __uint64 uncompressedSize)
+	{
+		// MSZIP falls back to a stored deflate block, the 'CK' signature plus 5 bytes of header.
+		const __uint64 blockCount = (uncompressedSize + CAB_MAX_BLOCK_UNCOMPRESSED - 1) / CAB_MAX_BLOCK_UNCOMPRESSED;
+		const __uint64 blockOverhead = sizeof(CAB_DATA_BLOCK) + ((compressionType & cffoldCOMPTYPE_MASK) == tcompTYPE_MSZIP ? 7 : 0);
+
+		return uncompressedSize + (blockCount * blockOverhead);
+	}
+
+	void CabinetFolderCompressor::WriteBlock(CABINET_PLANNED_FOLDER& folder, const DWORD size)
+	{
+		const BYTE* payload = m_block.get();
+		DWORD payloadSize = size;
+		if (m_encoder) {
+			payloadSize = m_encoder->Compress(m_block.get(), size, m_output.get());
+			payload = m_output.get();
+		}
+
+		CAB_DATA_BLOCK header{ };
+		header.CompressedSize = static_cast<WORD>(payloadSize);
+		header.UncompressedSize = static_cast<WORD>(size);
+		header.Checksum = CabinetFolderReader::ComputeChecksum(payload, payloadSize, 0);
+		header.Checksum = CabinetFolderReader::ComputeChecksum(reinterpret_cast<const BYTE*>(&header.CompressedSize), sizeof(WORD) * 2, header.Checksum);
+
+		folder.Data->Write(&header, sizeof(header));
+		folder.Data->Write(payload, payloadSize);
+		folder.BlockCount++;
+	}
+
+	void CabinetFolderCompressor::GetFileInformation(const HANDLE file, CABINET_PLANNED_FILE& info)
+	{
+		// Same as FCI, creation time in local time.
+		FILETIME fileTime;
+		BY_HANDLE_FILE_INFORMATION fileInfo;
+		if (!GetFileInformationByHandle(file, &fileInfo))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"GetFileInformationByHandle", WriteErrorCategory::ReadError);
+
+		if (!FileTimeToLocalFileTime(&fileInfo.ftCreationTime, &fileTime) || !FileTimeToDosDateTime(&fileTime, &info.Date, &info.Time))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"FileTimeToDosDateTime", WriteErrorCategory::InvalidResult);
+
+		info.Attributes |= static_cast<WORD>(fileInfo.dwFileAttributes & (_A_RDONLY | _A_HIDDEN | _A_SYSTEM | _A_ARCH));
+	}
+
+	/*
+	*	~ Cabinet writer ~
+	*/
+
+	CabinetWriter::CabinetWriter(const WWuString& destination, const WWuString& nameTemplate, const WORD compressionType, const ULONG splitSize)
+		: m_destination(destination), m_nameTemplate(nameTemplate), m_compressionType(compressionType), m_splitSize(splitSize),
+		m_volumeIndex(0), m_fileCount(0), m_fileTableSize(0), m_dataSize(0)
+	{
+		if (!m_destination.EndsWith(L"\\"))
+			m_destination += L"\\";
+
+		m_volumeName = GetVolumeName(0);
+	}
+
+	CabinetWriter::~CabinetWriter() { }
+
+	void CabinetWriter::PlanFolders(AbstractPathTree& apt, const __uint64 threshold, std::vector<CABINET_PLANNED_FOLDER>& folders,
+		const std::vector<DWORD>* duplicates, const std::vector<bool>* selected)
+	{
+		// Where each file was planned, by entry index. Only kept when deduplicating.
+		typedef struct _PLANNED_LOCATION
+		{
+			size_t  Folder;
+			DWORD   FolderOffset;
+
+		} PLANNED_LOCATION;
+
+		const auto& entries = apt.GetApt();
+		std::vector<PLANNED_LOCATION> locations(duplicates ? entries.size() : 0);
+
+		CABINET_PLANNED_FOLDER current{ };
+		for (DWORD i = 0; i < static_cast<DWORD>(entries.size()); i++) {
+			const AbstractPathTree::AptEntry& entry = entries[i];
+			if (entry.Type != FsObjectType::File || (selected && !(*selected)[i]))
+				continue;
+
+			CABINET_PLANNED_FILE file{ &apt, &entry };
+			file.Size = static_cast<DWORD>(entry.Length);
+
+			const WWuString relativePath = apt.GetRelativePath(entry);
+			if (std::all_of(relativePath.begin(), relativePath.end(), [](const WCHAR character) { return character < 0x80; })) {
+				file.Name = relativePath.ToNarrow();
+			}
+			else {
+				file.Name = relativePath.ToMb(CP_UTF8);
+				file.Attributes = _A_NAME_IS_UTF;
+			}
+
+			if (file.Name.Length() >= CAB_MAX_FILE_NAME)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_FILENAME_EXCED_RANGE, L"PlanFolders", WriteErrorCategory::InvalidArgument, WWuString::Format(L"File name '%ws' is too long for a cabinet.", relativePath.Raw()));
+
+			// The original was planned before, it comes first in the tree.
+			if (duplicates && (*duplicates)[i] != CabinetDeduplicator::NotDuplicate) {
+				const PLANNED_LOCATION& original = locations[(*duplicates)[i]];
+				CABINET_PLANNED_FOLDER& target = original.Folder < folders.size() ? folders[original.Folder] : current;
+				if (target.Files.size() < MAXWORD) {
+					file.FolderOffset = original.FolderOffset;
+					file.IsDuplicate = true;
+					target.Files.push_back(std::move(file));
+					continue;
+				}
+			}
+
+			if (!current.Files.empty() && (current.UncompressedSize + entry.Length > threshold || current.Files.size() >= CAB_WRITER_MAX_FOLDER_FILES)) {
+				folders.push_back(std::move(current));
+				current = CABINET_PLANNED_FOLDER{ };
+			}
+
+			file.FolderOffset = static_cast<DWORD>(current.UncompressedSize);
+			if (duplicates)
+				locations[i] = { folders.size(), file.FolderOffset };
+
+			current.UncompressedSize += file.Size;
+			current.Files.push_back(std::move(file));
+		}
+
+		if (!current.Files.empty())
+			folders.push_back(std::move(current));
+
+		// Copies go right after their original, so the file table stays sorted by offset.
+		if (duplicates) {
+			for (CABINET_PLANNED_FOLDER& folder : folders) {
+				std::stable_sort(folder.Files.begin(), folder.Files.end(), [](const CABINET_PLANNED_FILE& left, const CABINET_PLANNED_FILE& right) {
+					return left.FolderOffset < right.FolderOffset;
+				});
+			}
+		}
+	}
+
+	bool CabinetWriter::CanWrite(const CABINET_PLANNED_FOLDER& folder) const
+	{
+		const __uint64 blockCount = (folder.UncompressedSize + CAB_MAX_BLOCK_UNCOMPRESSED - 1) / CAB_MAX_BLOCK_UNCOMPRESSED;
+		if (blockCount > MAXWORD || folder.Files.size() > MAXWORD)
+			return false;
+
+		// Names are the longest at the last possible volume.
+		const __uint64 worstCase = GetHeaderSize(MAXWORD - 1, true, 1, GetFileTableSize(folder)) + CabinetFolderCompressor::GetWorstCaseSize(m_compressionType, folder.UncompressedSize);
+
+		return worstCase <= m_splitSize;
+	}
+
+	void CabinetWriter::AddFolder(CABINET_PLANNED_FOLDER& folder)
+	{
+		const DWORD fileTableSize = GetFileTableSize(folder);
+		if (!m_folders.empty()) {
+			const __uint64 volumeSize = GetHeaderSize(m_volumeIndex, true, m_folders.size() + 1, m_fileTableSize + fileTableSize) + m_dataSize + folder.Data->Size();
+			if (volumeSize > m_splitSize || m_fileCount + folder.Files.size() > MAXWORD) {
+				WriteVolume(true);
+				m_volumeName = GetVolumeName(++m_volumeIndex);
+			}
+		}
+
+		m_folders.push_back(&folder);
+		m_fileCount += static_cast<DWORD>(folder.Files.size());
+		m_fileTableSize += fileTableSize;
+		m_dataSize += folder.Data->Size();
+	}
+
+	void CabinetWriter::Close()
+	{
+		if (!m_folders.empty())
+			WriteVolume(false);
+	}
+
+	const WWuString& CabinetWriter::CurrentVolumeName() const { return m_volumeName; }
+
+	void CabinetWriter::WriteVolume(const bool hasNext)
+	{
+		const DWORD headerSize = GetHeaderSize(m_volumeIndex, hasNext, m_folders.size(), m_fileTableSize);
+		std::vector<BYTE> header(headerSize);
+
+		CAB_HEADER* fixedHeader = reinterpret_cast<CAB_HEADER*>(header.data());
+		fixedHeader->Signature = CAB_SIGNATURE;
+		fixedHeader->CabinetSize = static_cast<DWORD>(headerSize + m_dataSize);
+		fixedHeader->FirstFileOffset = headerSize - m_fileTableSize;
+		fixedHeader->VersionMinor = 3;
+		fixedHeader->VersionMajor = 1;
+		fixedHeader->FolderCount = static_cast<WORD>(m_folders.size());
+		fixedHeader->FileCount = static_cast<WORD>(m_fileCount);
+		fixedHeader->Flags = (m_volumeIndex > 0 ? cfhdrPREV_CABINET : 0) | (hasNext ? cfhdrNEXT_CABINET : 0);
+		fixedHeader->SetId = CAB_WRITER_SET_ID;
+		fixedHeader->CabinetIndex = m_volumeIndex;
+
+		// Cabinet names followed by empty disk names.
+		DWORD offset = sizeof(CAB_HEADER);
+		if (m_volumeIndex > 0) {
+			const WuString previousName = GetVolumeName(m_volumeIndex - 1).ToMb(CP_UTF8);
+			memcpy(header.data() + offset, previousName.Raw(), previousName.Length());
+			offset += static_cast<DWORD>(previousName.Length()) + 2;
+		}
+
+		if (hasNext) {
+			const WuString nextName = GetVolumeName(m_volumeIndex + 1).ToMb(CP_UTF8);
+			memcpy(header.data() + offset, nextName.Raw(), nextName.Length());
+			offset += static_cast<DWORD>(nextName.Length()) + 2;
+		}
+
+		DWORD dataOffset = headerSize;
+		for (const CABINET_PLANNED_FOLDER* folder : m_folders) {
+			CAB_FOLDER_ENTRY* entry = reinterpret_cast<CAB_FOLDER_ENTRY*>(header.data() + offset);
+			entry->FirstDataOffset = dataOffset;
+			entry->DataBlockCount = static_cast<WORD>(folder->BlockCount);
+			entry->CompressionType = m_compressionType;
+
+			offset += sizeof(CAB_FOLDER_ENTRY);
+			dataOffset += static_cast<DWORD>(folder->Data->Size());
+		}
+
+		for (size_t i = 0; i < m_folders.size(); i++) {
+			for (const CABINET_PLANNED_FILE& file : m_folders[i]->Files) {
+				CAB_FILE_ENTRY* entry = reinterpret_cast<CAB_FILE_ENTRY*>(header.data() + offset);
+				entry->UncompressedSize = file.Size;
+				entry->FolderOffset = file.FolderOffset;
+				entry->FolderIndex = static_cast<WORD>(i);
+				entry->Date = file.Date;
+				entry->Time = file.Time;
+				entry->Attributes = file.Attributes;
+
+				offset += sizeof(CAB_FILE_ENTRY);
+				memcpy(header.data() + offset, file.Name.Raw(), file.Name.Length());
+				offset += static_cast<DWORD>(file.Name.Length()) + 1;
+			}
+		}
+
+		FileHandle volume(m_destination + m_volumeName, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		DWORD bytesWritten;
+		if (!WriteFile(volume.Get(), header.data(), headerSize, &bytesWritten, nullptr) || bytesWritten != headerSize)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+
+		// Releasing each folder as soon as it's written, giving the memory back to the workers.
+		for (CABINET_PLANNED_FOLDER* folder : m_folders) {
+			folder->Data->CopyTo(volume.Get());
+			folder->Data.reset();
+		}
+
+		m_folders.clear();
+		m_fileCount = 0;
+		m_fileTableSize = 0;
+		m_dataSize = 0;
+	}
+
+	DWORD CabinetWriter::GetHeaderSize(const WORD volumeIndex, const bool hasNext, const size_t folderCount, const DWORD fileTableSize) const
+	{
+		DWORD size = sizeof(CAB_HEADER) + static_cast<DWORD>(folderCount * sizeof(CAB_FOLDER_ENTRY)) + fileTableSize;
+		if (volumeIndex > 0)
+			size += static_cast<DWORD>(GetVolumeName(volumeIndex - 1).ToMb(CP_UTF8).Length()) + 2;
+
+		if (hasNext)
+			size += static_cast<DWORD>(GetVolumeName(volumeIndex + 1).ToMb(CP_UTF8).Length()) + 2;
+
+		return size;
+	}
+
+	WWuString CabinetWriter::GetVolumeName(const WORD volumeIndex) const
+	{
+		return WWuString::Format(L"%ws%02d.cab", m_nameTemplate.Raw(), volumeIndex + 1);
+	}
+
+	DWORD CabinetWriter::GetFileTableSize(const CABINET_PLANNED_FOLDER& folder)
+	{
+		DWORD size = 0;
+		for (const CABINET_PLANNED_FILE& file : folder.Files)
+			size += sizeof(CAB_FILE_ENTRY) + static_cast<DWORD>(file.Name.Length()) + 1;
+
+		return size;
+	}
+
+	/*
+	*	~ Cabinet appender ~
+	*/
+
+	CabinetAppender::CabinetAppender(const WWuString& path, const WORD compressionType)
+		: m_compressionType(compressionType), m_existingFolderCount(0), m_dataStart(0), m_appendOffset(0)
+	{
+		// Only reading the tables, the data stays where it is.
+		{
+			CabinetVolume volume(path);
+			const CAB_HEADER& header = volume.Header();
+			if ((header.Flags & (cfhdrPREV_CABINET | cfhdrNEXT_CABINET)) > 0)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_NOT_SUPPORTED, L"CabinetAppender", WriteErrorCategory::NotImplemented, L"Only single volume cabinets can be updated.");
+
+			if ((header.Flags & cfhdrRESERVE_PRESENT) > 0)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_NOT_SUPPORTED, L"CabinetAppender", WriteErrorCategory::NotImplemented, L"Cabinets with reserved areas, like signed cabinets, can't be updated.");
+
+			m_name = volume.Name();
+			m_header = header;
+			m_existingFolderCount = header.FolderCount;
+			m_dataStart = header.CabinetSize;
+			for (WORD i = 0; i < header.FolderCount; i++) {
+				m_folderEntries.push_back(volume.GetFolder(i));
+				m_dataStart = min(m_dataStart, m_folderEntries.back().FirstDataOffset);
+			}
+
+			m_files.resize(header.FileCount);
+			DWORD offset = header.FirstFileOffset;
+			for (CABINET_FILE_INFO& info : m_files)
+				volume.ReadFileEntry(offset, info);
+		}
+
+		if (sizeof(CAB_HEADER) + (m_folderEntries.size() * sizeof(CAB_FOLDER_ENTRY)) > m_dataStart)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"CabinetAppender", WriteErrorCategory::InvalidData, L"Cabinet folder table overlaps its data.");
+
+		m_isDropped.resize(m_files.size());
+		m_file = std::make_unique<FileHandle>(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (!GetFileTime(m_file->Get(), nullptr, nullptr, &m_lastWriteTime))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"GetFileTime", WriteErrorCategory::ReadError);
+
+		// Anything past the cabinet size is not ours, it's overwritten.
+		m_appendOffset = m_header.CabinetSize;
+		LARGE_INTEGER filePointer;
+		filePointer.QuadPart = static_cast<LONGLONG>(m_appendOffset);
+		if (!SetFilePointerEx(m_file->Get(), filePointer, nullptr, FILE_BEGIN))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"SetFilePointerEx", WriteErrorCategory::WriteError);
+	}
+
+	CabinetAppender::~CabinetAppender() { }
+
+	const std::vector<CABINET_FILE_INFO>& CabinetAppender::Files() const { return m_files; }
+	const FILETIME& CabinetAppender::LastWriteTime() const { return m_lastWriteTime; }
+
+	void CabinetAppender::DropFile(const size_t index) { m_isDropped[index] = true; }
+
+	size_t CabinetAppender::GetFolderRoom() const
+	{
+		const size_t tableCapacity = (m_dataStart - sizeof(CAB_HEADER)) / sizeof(CAB_FOLDER_ENTRY);
+
+		return min(tableCapacity, static_cast<size_t>(MAXWORD)) - m_folderEntries.size();
+	}
+
+	void CabinetAppender::AddFolder(CABINET_PLANNED_FOLDER& folder)
+	{
+		if (GetFolderRoom() == 0)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_INSUFFICIENT_BUFFER, L"CabinetAppender::AddFolder", WriteErrorCategory::LimitsExceeded, L"There's no room for more folders in the cabinet.");
+
+		if (folder.BlockCount > MAXWORD || m_appendOffset + folder.Data->Size() > MAXLONG)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_FILE_TOO_LARGE, L"CabinetAppender::AddFolder", WriteErrorCategory::LimitsExceeded, L"The cabinet would be bigger than 2Gb.");
+
+		folder.Data->CopyTo(m_file->Get());
+		m_folderEntries.push_back({ static_cast<DWORD>(m_appendOffset), static_cast<WORD>(folder.BlockCount), m_compressionType });
+		m_folders.push_back(&folder);
+
+		m_appendOffset += folder.Data->Size();
+		folder.Data.reset();
+	}
+
+	void CabinetAppender::Close()
+	{
+		// Files kept first, in the order they were, then the new ones.
+		DWORD fileCount = 0;
+		std::vector<BYTE> fileTable;
+		for (size_t i = 0; i < m_files.size(); i++) {
+			if (m_isDropped[i])
+				continue;
+
+			const CABINET_FILE_INFO& info = m_files[i];
+			AppendFileEntry(fileTable, info.Name, info.Size, info.FolderOffset, info.FolderIndex, info.Date, info.Time, info.Attributes);
+			fileCount++;
+		}
+
+		for (size_t i = 0; i < m_folders.size(); i++) {
+			for (const CABINET_PLANNED_FILE& file : m_folders[i]->Files) {
+				AppendFileEntry(fileTable, file.Name, file.Size, file.FolderOffset, static_cast<WORD>(m_existingFolderCount + i), file.Date, file.Time, file.Attributes);
+				fileCount++;
+			}
+		}
+
+		if (fileCount > MAXWORD)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_FILE_TOO_LARGE, L"CabinetAppender::Close", WriteErrorCategory::LimitsExceeded, L"A cabinet can't have more than 65535 files.");
+
+		if (m_appendOffset + fileTable.size() > MAXLONG)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_FILE_TOO_LARGE, L"CabinetAppender::Close", WriteErrorCategory::LimitsExceeded, L"The cabinet would be bigger than 2Gb.");
+
+		DWORD bytesWritten;
+		const DWORD tableSize = static_cast<DWORD>(fileTable.size());
+		if (tableSize > 0 && (!WriteFile(m_file->Get(), fileTable.data(), tableSize, &bytesWritten, nullptr) || bytesWritten != tableSize))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+
+		if (!SetEndOfFile(m_file->Get()))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"SetEndOfFile", WriteErrorCategory::WriteError);
+
+		// Everything the new header points to must be on disk before the header is.
+		if (!FlushFileBuffers(m_file->Get()))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"FlushFileBuffers", WriteErrorCategory::WriteError);
+
+		m_header.CabinetSize = static_cast<DWORD>(m_appendOffset) + tableSize;
+		m_header.FirstFileOffset = static_cast<DWORD>(m_appendOffset);
+		m_header.FolderCount = static_cast<WORD>(m_folderEntries.size());
+		m_header.FileCount = static_cast<WORD>(fileCount);
+
+		const DWORD headerSize = static_cast<DWORD>(sizeof(CAB_HEADER) + (m_folderEntries.size() * sizeof(CAB_FOLDER_ENTRY)));
+		std::vector<BYTE> header(headerSize);
+		memcpy(header.data(), &m_header, sizeof(CAB_HEADER));
+		if (!m_folderEntries.empty())
+			memcpy(header.data() + sizeof(CAB_HEADER), m_folderEntries.data(), m_folderEntries.size() * sizeof(CAB_FOLDER_ENTRY));
+
+		LARGE_INTEGER start{ };
+		if (!SetFilePointerEx(m_file->Get(), start, nullptr, FILE_BEGIN))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"SetFilePointerEx", WriteErrorCategory::WriteError);
+
+		if (!WriteFile(m_file->Get(), header.data(), headerSize, &bytesWritten, nullptr) || bytesWritten != headerSize)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+	}
+
+	const WWuString& CabinetAppender::CurrentVolumeName() const { return m_name; }
+
+	void CabinetAppender::AppendFileEntry(std::vector<BYTE>& table, const WuString& name, const DWORD size, const DWORD folderOffset,
+		const WORD folderIndex, const WORD date, const WORD time, const WORD attributes)
+	{
+		const size_t offset = table.size();
+		table.resize(offset + sizeof(CAB_FILE_ENTRY) + name.Length() + 1);
+
+		CAB_FILE_ENTRY* entry = reinterpret_cast<CAB_FILE_ENTRY*>(table.data() + offset);
+		entry->UncompressedSize = size;
+		entry->FolderOffset = folderOffset;
+		entry->FolderIndex = folderIndex;
+		entry->Date = date;
+		entry->Time = time;
+		entry->Attributes = attributes;
+
+		memcpy(table.data() + offset + sizeof(CAB_FILE_ENTRY), name.Raw(), name.Length());
+	}
+}
@@ -0,0 +1,92 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/DirectoryCache.h"
+
+namespace WindowsUtils::Core
+{
+	DirectoryCache::DirectoryCache(const WWuString& root)
+		: m_root(root)
+	{
+		InitializeSRWLock(&m_lock);
+	}
+
+	DirectoryCache::~DirectoryCache() { }
+
+	const WWuString& DirectoryCache::Root() const { return m_root; }
+
+	void DirectoryCache::CreateTree(const WuList<WWuString>& components)
+	{
+		// Most files go to a directory we've seen already, and these only need the shared lock.
+		AcquireSRWLockShared(&m_lock);
+		const bool isKnown = IsKnown(components);
+		ReleaseSRWLockShared(&m_lock);
+		if (isKnown)
+			return;
+
+		AcquireSRWLockExclusive(&m_lock);
+		try {
+			CreateMissing(components);
+		}
+		catch (...) {
+			ReleaseSRWLockExclusive(&m_lock);
+			throw;
+		}
+
+		ReleaseSRWLockExclusive(&m_lock);
+	}
+
+	bool DirectoryCache::IsKnown(const WuList<WWuString>& components) const
+	{
+		const Node* node = &m_rootNode;
+		for (const WWuString& component : components) {
+			if (component.Length() == 0)
+				continue;
+
+			auto child = node->Children.find(GetKey(component));
+			if (child == node->Children.end())
+				return false;
+
+			node = child->second.get();
+		}
+
+		return true;
+	}
+
+	void DirectoryCache::CreateMissing(const WuList<WWuString>& components)
+	{
+		// Another thread might have created some of them between the locks, so we walk from the root again.
+		Node* node = &m_rootNode;
+		WWuString path(m_root);
+		for (const WWuString& component : components) {
+			if (component.Length() == 0)
+				continue;
+
+			if (!path.EndsWith('\\'))
+				path += L"\\";
+
+			path += component;
+
+			WWuString key = GetKey(component);
+			auto child = node->Children.find(key);
+			if (child == node->Children.end()) {
+				if (!CreateDirectoryW(path.Raw(), NULL)) {
+					DWORD dwResult = GetLastError();
+					if (dwResult != ERROR_ALREADY_EXISTS)
+						_WU_RAISE_NATIVE_EXCEPTION(dwResult, L"CreateDirectory", WriteErrorCategory::InvalidResult);
+				}
+
+				child = node->Children.emplace(std::move(key), std::make_unique<Node>()).first;
+			}
+
+			node = child->second.get();
+		}
+	}
+
+	WWuString DirectoryCache::GetKey(const WWuString& name)
+	{
+		WWuString key(name);
+		key.ToUpper();
+
+		return key;
+	}
+}
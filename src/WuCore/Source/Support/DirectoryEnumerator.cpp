@@ -0,0 +1,251 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/DirectoryEnumerator.h"
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Directory enumerator ~
+	*/
+
+	DirectoryEnumerator::DirectoryEnumerator(const DWORD threadCount)
+		: m_threadCount(threadCount), m_pending(0), m_queued(0), m_idleCount(0), m_isCancelled(0), m_entryCount(0)
+	{
+		if (m_threadCount == 0)
+			m_threadCount = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+
+		m_threadCount = min(max(m_threadCount, 1), static_cast<DWORD>(MAXIMUM_WAIT_OBJECTS));
+		m_queues = std::make_unique<WORKER_QUEUE[]>(m_threadCount);
+		for (DWORD i = 0; i < m_threadCount; i++)
+			InitializeSRWLock(&m_queues[i].Lock);
+
+		InitializeSRWLock(&m_idleLock);
+		InitializeSRWLock(&m_errorLock);
+		InitializeConditionVariable(&m_workAvailable);
+	}
+
+	DirectoryEnumerator::~DirectoryEnumerator() { }
+
+	WuList<FS_INFO> DirectoryEnumerator::Enumerate(const WWuString& path)
+	{
+		DIRECTORY_NODE root{ path };
+		m_pending      = 1;
+		m_queued       = 1;
+		m_isCancelled  = 0;
+		m_entryCount   = 0;
+		m_queues[0].Nodes.push_back(&root);
+
+		// The calling thread is worker zero, the others start stealing from it right away.
+		DWORD createdCount = 0;
+		std::vector<WORKER_PARAMS> params(m_threadCount);
+		HANDLE workers[MAXIMUM_WAIT_OBJECTS]{ };
+		for (DWORD i = 1; i < m_threadCount; i++) {
+			params[i] = { this, i };
+
+			DWORD threadId;
+			workers[createdCount] = CreateThread(NULL, 0, WorkerThread, &params[i], 0, &threadId);
+			if (workers[createdCount] == NULL)
+				break;
+
+			createdCount++;
+		}
+
+		// If some workers weren't created we go with what we have, their queues stay empty.
+		RunWorker(0);
+
+		if (createdCount > 0) {
+			WaitForMultipleObjects(createdCount, workers, TRUE, INFINITE);
+			for (DWORD i = 0; i < createdCount; i++)
+				CloseHandle(workers[i]);
+		}
+
+		if (m_error)
+			throw WuException(*m_error);
+
+		WuList<FS_INFO> output(static_cast<size_t>(max(m_entryCount, 1)));
+		Merge(root, output);
+
+		return output;
+	}
+
+	void DirectoryEnumerator::Push(const DWORD index, PDIRECTORY_NODE node)
+	{
+		InterlockedIncrement(&m_pending);
+
+		WORKER_QUEUE& queue = m_queues[index];
+		AcquireSRWLockExclusive(&queue.Lock);
+		queue.Nodes.push_back(node);
+		ReleaseSRWLockExclusive(&queue.Lock);
+
+		// Paired with 'WaitForWork', one of us sees the other.
+		InterlockedIncrement(&m_queued);
+		if (InterlockedCompareExchange(&m_idleCount, 0, 0) > 0)
+			WakeWorkers(false);
+	}
+
+	PDIRECTORY_NODE DirectoryEnumerator::Take(const DWORD index)
+	{
+		// Our own queue from the back, the others from the front.
+		for (DWORD i = 0; i < m_threadCount; i++) {
+			const DWORD current = (index + i) % m_threadCount;
+			WORKER_QUEUE& queue = m_queues[current];
+
+			PDIRECTORY_NODE node = nullptr;
+			AcquireSRWLockExclusive(&queue.Lock);
+			if (!queue.Nodes.empty()) {
+				if (current == index) {
+					node = queue.Nodes.back();
+					queue.Nodes.pop_back();
+				}
+				else {
+					node = queue.Nodes.front();
+					queue.Nodes.pop_front();
+				}
+			}
+			ReleaseSRWLockExclusive(&queue.Lock);
+
+			if (node != nullptr) {
+				InterlockedDecrement(&m_queued);
+				return node;
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool DirectoryEnumerator::WaitForWork()
+	{
+		AcquireSRWLockExclusive(&m_idleLock);
+		InterlockedIncrement(&m_idleCount);
+		while (InterlockedCompareExchange(&m_queued, 0, 0) == 0 && InterlockedCompareExchange(&m_pending, 0, 0) > 0 && !m_isCancelled)
+			SleepConditionVariableSRW(&m_workAvailable, &m_idleLock, INFINITE, 0);
+
+		InterlockedDecrement(&m_idleCount);
+		const bool hasWork = InterlockedCompareExchange(&m_pending, 0, 0) > 0 && !m_isCancelled;
+		ReleaseSRWLockExclusive(&m_idleLock);
+
+		return hasWork;
+	}
+
+	void DirectoryEnumerator::WakeWorkers(const bool all)
+	{
+		// Taking the lock makes sure a worker about to sleep is either sleeping, or will see the change.
+		AcquireSRWLockExclusive(&m_idleLock);
+		ReleaseSRWLockExclusive(&m_idleLock);
+
+		if (all)
+			WakeAllConditionVariable(&m_workAvailable);
+		else
+			WakeConditionVariable(&m_workAvailable);
+	}
+
+	void DirectoryEnumerator::RunWorker(const DWORD index)
+	{
+		std::unique_ptr<WuException> error;
+		try {
+			do {
+				PDIRECTORY_NODE node;
+				while (!m_isCancelled && (node = Take(index)) != nullptr) {
+					EnumerateDirectory(index, *node);
+
+					// The last directory wakes everyone up to leave.
+					if (InterlockedDecrement(&m_pending) == 0)
+						WakeWorkers(true);
+				}
+			} while (WaitForWork());
+		}
+		catch (const WuException& ex) {
+			error = std::make_unique<WuException>(ex);
+		}
+		catch (...) {
+			error = std::make_unique<WuNativeException>(_WU_NEW_NATIVE_EXCEPTION(ERROR_UNHANDLED_EXCEPTION, L"EnumerateDirectory", WriteErrorCategory::NotSpecified));
+		}
+
+		// First error wins, the other workers stop at the next directory.
+		if (error) {
+			AcquireSRWLockExclusive(&m_errorLock);
+			if (!m_error)
+				m_error = std::move(error);
+
+			ReleaseSRWLockExclusive(&m_errorLock);
+			InterlockedExchange(&m_isCancelled, 1);
+			WakeWorkers(true);
+		}
+	}
+
+	void DirectoryEnumerator::EnumerateDirectory(const DWORD index, DIRECTORY_NODE& node)
+	{
+		WIN32_FIND_DATA data;
+		WWuString globbedPath = node.Path + L"*";
+
+		// 'FIND_FIRST_EX_LARGE_FETCH' gets more entries per call to the file system, which counts with remote shares.
+		HANDLE hFind = FindFirstFileEx(globbedPath.Raw(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+		if (hFind == INVALID_HANDLE_VALUE)
+			return;
+
+		LONG64 count = 0;
+		do {
+			if (data.cFileName[0] == L'.' && (data.cFileName[1] == L'\0' || (data.cFileName[1] == L'.' && data.cFileName[2] == L'\0')))
+				continue;
+
+			WWuString name(data.cFileName);
+			WWuString fullPath = node.Path + name;
+			if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) > 0) {
+				node.Entries.Add(FsObjectType::Directory, name, fullPath, 0);
+				node.Children.push_back(std::make_unique<DIRECTORY_NODE>(fullPath + L"\\"));
+				Push(index, node.Children.back().get());
+			}
+			else {
+				node.Entries.Add(FsObjectType::File,
+					name,
+					fullPath,
+					(static_cast<__uint64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow
+				);
+			}
+
+			count++;
+
+		} while (!m_isCancelled && FindNextFile(hFind, &data));
+
+		FindClose(hFind);
+		InterlockedAdd64(&m_entryCount, count);
+	}
+
+	void DirectoryEnumerator::Merge(DIRECTORY_NODE& root, WuList<FS_INFO>& output)
+	{
+		typedef struct _MERGE_FRAME
+		{
+			PDIRECTORY_NODE  Node;
+			size_t           NextEntry;
+			size_t           NextChild;
+
+		} MERGE_FRAME;
+
+		// Each directory entry is followed by its subtree. Iterative, deep trees don't blow the stack.
+		std::vector<MERGE_FRAME> stack{ { &root, 0, 0 } };
+		while (!stack.empty()) {
+			MERGE_FRAME& frame = stack.back();
+			if (frame.NextEntry == frame.Node->Entries.Count()) {
+				frame.Node->Entries.Clear();
+				stack.pop_back();
+				continue;
+			}
+
+			FS_INFO& info = frame.Node->Entries[frame.NextEntry++];
+			const bool isDirectory = info.Type == FsObjectType::Directory;
+			output.Add(std::move(info));
+			if (isDirectory) {
+				PDIRECTORY_NODE child = frame.Node->Children[frame.NextChild++].get();
+				stack.push_back({ child, 0, 0 });
+			}
+		}
+	}
+
+	DWORD WINAPI DirectoryEnumerator::WorkerThread(LPVOID params)
+	{
+		auto workerParams = reinterpret_cast<PWORKER_PARAMS>(params);
+		workerParams->Enumerator->RunWorker(workerParams->Index);
+
+		return 0;
+	}
+}
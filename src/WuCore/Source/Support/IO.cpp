@@ -1,6 +1,7 @@
 #include "../../pch.h"
 
 #include "../../Headers/Support/IO.h"
+#include "../../Headers/Support/DirectoryEnumerator.h"
 
 namespace WindowsUtils::Core
 {
@@ -163,13 +164,13 @@ namespace WindowsUtils::Core
 		return size.QuadPart;
 	}
 
-	WuList<FS_INFO> IO::EnumerateFileSystemInfo(WWuString& path)
+	WuList<FS_INFO> IO::EnumerateFileSystemInfo(WWuString& path, const DWORD threadCount)
 	{
-		WuList<FS_INFO> output(20);
 		WIN32_FIND_DATA data;
 
 		HANDLE hFind = FindFirstFile(path.Raw(), &data);
 		if (hFind != INVALID_HANDLE_VALUE && (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+			WuList<FS_INFO> output(1);
 			WWuString name = path;
 			PathStripPath(name.Raw());
 
@@ -180,53 +181,21 @@ namespace WindowsUtils::Core
 			);
 
 			FindClose(hFind);
+
+			return output;
 		}
-		else {
-			WWuString globbedPath;
-			if (path.EndsWith(L"\\"))
-				globbedPath = path + L"*";
-			else {
-				globbedPath = path + L"\\*";
-				path += L"\\";
-			}
 
-			// 'FindFirstFileEx' have a slight better performance than 'FindFirstFile' when used with 'FindExInfoBasic'.
-			// It mapped the whole C: drive in 24 sec, in oppose of 45 from 'FindFirstFile'.
-			hFind = FindFirstFileEx(globbedPath.Raw(), FindExInfoBasic, &data, FindExSearchNameMatch, NULL, 0);
-			if (hFind == INVALID_HANDLE_VALUE)
-				return output;
-
-			do {
-				WWuString name = WWuString(data.cFileName);
-				if (name == L"." || name == L"..")
-					continue;
-
-				bool isDir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) > 0;
-				WWuString fullPath = path + name;
-				if (isDir) {
-					output.Add(FsObjectType::Directory,
-						name,
-						fullPath,
-						0
-					);
-
-					auto recVec = EnumerateFileSystemInfo(fullPath);
-					output.InsertRange(output.end(), recVec.begin(), recVec.end());
-				}
-				else {
-					output.Add(FsObjectType::File,
-						name,
-						fullPath,
-						(static_cast<__uint64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow
-					);
-				}
+		if (hFind != INVALID_HANDLE_VALUE)
+			FindClose(hFind);
 
-			} while (FindNextFile(hFind, &data));
+		if (!path.EndsWith(L"\\"))
+			path += L"\\";
 
-			FindClose(hFind);
-		}
+		// The serial recursion mapped the whole C: drive in 24 sec, with 'FindFirstFileEx' and 'FindExInfoBasic'.
+		// Directories are now spread between workers, see 'Measure-DirectoryEnumeration.ps1'.
+		DirectoryEnumerator enumerator(threadCount);
 
-		return output;
+		return enumerator.Enumerate(path);
 	}
 
 	bool IO::FileExists(const WWuString& filePath)
@@ -359,36 +328,33 @@ namespace WindowsUtils::Core
 	*	~ Native Abstract Path Tree
 	*/
 
-	AbstractPathTree::AbstractPathTree(const AbstractPathTree& other)
-	{
-		for (AptEntry entry : other.m_apt) {
-			if (entry.Type == FsObjectType::Directory)
-				DirectoryCount++;
-			else
-				FileCount++;
+	AbstractPathTree::AbstractPathTree()
+		: FileCount(0), DirectoryCount(0), TotalLength(0)
+	{ }
 
-			TotalLength += entry.Length;
-			m_apt.push_back(entry);
-		}
-	}
+	AbstractPathTree::~AbstractPathTree() { }
+	const std::vector<AbstractPathTree::AptEntry>& AbstractPathTree::GetApt() const { return m_apt; }
 
-	AbstractPathTree& AbstractPathTree::operator=(const AbstractPathTree& other)
+	void AbstractPathTree::PushEntry(const FS_INFO& info)
 	{
-		for (AptEntry entry : other.m_apt) {
-			if (entry.Type == FsObjectType::Directory)
-				DirectoryCount++;
+		// If the root is a single file paths are relative to its directory.
+		if (m_apt.empty()) {
+			if (info.FullName == RootPath)
+				m_basePath = WWuString(RootPath.Raw(), RootPath.Length() - info.Name.Length());
+			else if (RootPath.EndsWith('\\'))
+				m_basePath = RootPath;
 			else
-				FileCount++;
-
-			TotalLength += entry.Length;
-			m_apt.push_back(entry);
+				m_basePath = RootPath + L"\\";
 		}
 
-		return *this;
-	}
+		const DWORD nameLength = static_cast<DWORD>(info.Name.Length());
+		const DWORD pathLength = static_cast<DWORD>(info.FullName.Length() - m_basePath.Length());
+		AptEntry entry{ info.Type, info.Length, NoParent, static_cast<DWORD>(m_names.size()), nameLength, pathLength };
+		if (pathLength > nameLength)
+			entry.Parent = FindParent(pathLength - nameLength - 1);
+
+		m_names.insert(m_names.end(), info.Name.Raw(), info.Name.Raw() + nameLength);
 
-	void AbstractPathTree::PushEntry(const AbstractPathTree::AptEntry& entry)
-	{
 		if (entry.Type == FsObjectType::Directory)
 			DirectoryCount++;
 		else
@@ -398,47 +364,55 @@ namespace WindowsUtils::Core
 		m_apt.push_back(entry);
 	}
 
-	AbstractPathTree::AbstractPathTree()
-		: FileCount(0), DirectoryCount(0), TotalLength(0)
-	{ }
-
-	AbstractPathTree::~AbstractPathTree() { }
-	std::vector<AbstractPathTree::AptEntry>& AbstractPathTree::GetApt() { return m_apt; }
+	WWuString AbstractPathTree::GetName(const AptEntry& entry) const
+	{
+		return WWuString(m_names.data() + entry.NameOffset, entry.NameLength);
+	}
 
-	AbstractPathTree::_AptEntry::_AptEntry(const WWuString& name, const WWuString& filePath, const WWuString& rootPath, __uint64 length, FsObjectType type)
+	WWuString AbstractPathTree::GetRelativePath(const AptEntry& entry) const
 	{
-		WWuString relPath;
-		WWuString finalRoot;
-		WuList<WWuString> fpSplit;
-		WuList<WWuString> rpSplit;
-
-		// It's a file.
-		if (filePath == rootPath) {
-			relPath = L"\\" + name;
-			goto END;
-		}
+		WWuString path(static_cast<size_t>(entry.PathLength));
+		CopyRelativePath(entry, path.Raw() + entry.PathLength);
 
-		if (!rootPath.EndsWith('\\'))
-			finalRoot = WWuString::Format(L"%ws\\", rootPath.Raw());
-		else
-			finalRoot = rootPath;
+		return path;
+	}
 
-		fpSplit = filePath.Split('\\');
-		rpSplit = finalRoot.Split('\\');
+	WWuString AbstractPathTree::GetFullPath(const AptEntry& entry) const
+	{
+		const size_t baseLength = m_basePath.Length();
+		WWuString path(baseLength + entry.PathLength);
+		wmemcpy(path.Raw(), m_basePath.Raw(), baseLength);
+		CopyRelativePath(entry, path.Raw() + baseLength + entry.PathLength);
 
-		for (size_t i = 0; i < fpSplit.Count(); i++) {
-			if (i >= rpSplit.Count())
-				relPath = WWuString::Format(L"%ws\\%ws", relPath.Raw(), fpSplit[i].Raw());
-		}
+		return path;
+	}
 
-	END:
+	DWORD AbstractPathTree::FindParent(const DWORD parentPathLength) const
+	{
+		// In depth-first order the parent is the previous entry or one of its ancestors, and path lengths
+		// grow down the chain. Walking up from the previous entry keeps building the tree linear.
+		DWORD index = m_apt.empty() ? NoParent : static_cast<DWORD>(m_apt.size() - 1);
+		while (index != NoParent && (m_apt[index].Type != FsObjectType::Directory || m_apt[index].PathLength != parentPathLength))
+			index = m_apt[index].Parent;
+
+		if (index == NoParent)
+			_WU_RAISE_NATIVE_EXCEPTION(ERROR_INVALID_DATA, L"AbstractPathTree::PushEntry", WriteErrorCategory::InvalidArgument);
 
-		Name = name;
-		FullPath = filePath;
-		RelativePath = relPath.Remove(0);
-		Type = type;
-		Length = length;
+		return index;
 	}
 
-	AbstractPathTree::_AptEntry::~_AptEntry() { }
+	void AbstractPathTree::CopyRelativePath(const AptEntry& entry, WCHAR* end) const
+	{
+		// Written backwards, from the entry up to the root.
+		const AptEntry* current = &entry;
+		while (true) {
+			end -= current->NameLength;
+			wmemcpy(end, m_names.data() + current->NameOffset, current->NameLength);
+			if (current->Parent == NoParent)
+				break;
+
+			*--end = L'\\';
+			current = &m_apt[current->Parent];
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/LatencyHistogram.h"
+
+#include <intrin.h>
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Latency histogram ~
+	*/
+
+	LatencyHistogram::LatencyHistogram()
+		: m_counts{ }, m_count(0), m_maxValue(0) { }
+
+	void LatencyHistogram::Record(const double milliseconds)
+	{
+		const ULONGLONG value = milliseconds <= 0 ? 0 : static_cast<ULONGLONG>(min(milliseconds * 1000 + 0.5, static_cast<double>(LATENCY_MAX_VALUE)));
+		m_counts[IndexOf(value)]++;
+		m_count++;
+		if (value > m_maxValue)
+			m_maxValue = value;
+	}
+
+	double LatencyHistogram::ValueAtPercentile(const double percentile) const
+	{
+		if (m_count == 0)
+			return 0.00;
+
+		// The smallest value with at least this many at or below it.
+		const double clamped = min(max(percentile, 0.00), 100.00);
+		const ULONGLONG target = max(static_cast<ULONGLONG>((clamped / 100.00) * m_count + 0.5), 1ULL);
+
+		ULONGLONG seen = 0;
+		for (DWORD index = 0; index < LATENCY_COUNTS_LENGTH; index++) {
+			seen += m_counts[index];
+			if (seen >= target)
+				return static_cast<double>(min(HighestValueAt(index), m_maxValue)) / 1000.00;
+		}
+
+		return static_cast<double>(m_maxValue) / 1000.00;
+	}
+
+	const ULONGLONG LatencyHistogram::Count() const { return m_count; }
+
+	DWORD LatencyHistogram::IndexOf(const ULONGLONG value)
+	{
+		// Or'ing the mask puts everything under 128 in the first bucket.
+		unsigned long highBit;
+		_BitScanReverse64(&highBit, value | ((1ULL << LATENCY_SUB_BUCKET_BITS) - 1));
+
+		const DWORD bucket = highBit - (LATENCY_SUB_BUCKET_BITS - 1);
+		const DWORD subBucket = static_cast<DWORD>(value >> bucket);
+
+		return (bucket * LATENCY_HALF_SUB_BUCKETS) + subBucket;
+	}
+
+	ULONGLONG LatencyHistogram::HighestValueAt(const DWORD index)
+	{
+		if (index < 2 * LATENCY_HALF_SUB_BUCKETS)
+			return index;
+
+		const DWORD bucket = (index / LATENCY_HALF_SUB_BUCKETS) - 1;
+		const ULONGLONG subBucket = (index % LATENCY_HALF_SUB_BUCKETS) + LATENCY_HALF_SUB_BUCKETS;
+
+		return ((subBucket + 1) << bucket) - 1;
+	}
+}
@@ -0,0 +1,599 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/Cabinet/LzxDecoder.h"
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Table entries ~
+	*
+	*	Bits  0-4: Code length, consumed after the lookup.
+	*	Bit     5: Sub-table link.
+	*	Bit     6: No code reaches this entry.
+	*	Bits 8-15: For sub-table links, the sub-table bit count.
+	*	Bits 16-31: Symbol or sub-table offset.
+	*/
+
+	constexpr DWORD LZX_ENTRY_SUBTABLE  = 0x20;
+	constexpr DWORD LZX_ENTRY_INVALID   = 0x40;
+
+	static constexpr DWORD MakeLzxEntry(const DWORD flags, const DWORD length, const DWORD value) { return (value << 16) | flags | length; }
+	static constexpr DWORD LzxEntryLength(const DWORD entry) { return entry & 0x1F; }
+	static constexpr DWORD LzxEntrySubtableBits(const DWORD entry) { return (entry >> 8) & 0xFF; }
+	static constexpr DWORD LzxEntryValue(const DWORD entry) { return entry >> 16; }
+
+	constexpr DWORD LZX_BLOCKTYPE_VERBATIM      = 1;
+	constexpr DWORD LZX_BLOCKTYPE_ALIGNED       = 2;
+	constexpr DWORD LZX_BLOCKTYPE_UNCOMPRESSED  = 3;
+
+	constexpr DWORD LZX_MIN_MATCH               = 2;
+	constexpr DWORD LZX_NUM_PRIMARY_LENGTHS     = 7;
+
+	// Translation is only done on the first 32768 frames, and never on the last 10 bytes of a frame.
+	constexpr DWORD LZX_E8_MAX_FRAMES           = 32768;
+	constexpr DWORD LZX_E8_FRAME_TAIL           = 10;
+
+	// Extra bits and base offset for each position slot.
+	struct LzxPositionSlots
+	{
+		BYTE ExtraBits[LZX_MAX_POSITION_SLOTS];
+		DWORD Base[LZX_MAX_POSITION_SLOTS];
+
+		constexpr LzxPositionSlots()
+			: ExtraBits(), Base()
+		{
+			for (DWORD i = 0; i < LZX_MAX_POSITION_SLOTS; i++) {
+				const DWORD extra = i < 4 ? 0 : (i - 2) >> 1;
+				ExtraBits[i] = static_cast<BYTE>(extra < 17 ? extra : 17);
+				Base[i] = i == 0 ? 0 : Base[i - 1] + (1 << ExtraBits[i - 1]);
+			}
+		}
+	};
+
+	constexpr LzxPositionSlots s_positionSlots;
+
+	static __forceinline unsigned __int64 LoadLzxWord(const BYTE* source)
+	{
+		unsigned __int64 value;
+		memcpy(&value, source, sizeof(value));
+
+		return value;
+	}
+
+	static __forceinline void StoreLzxWord(BYTE* destination, const unsigned __int64 value)
+	{
+		memcpy(destination, &value, sizeof(value));
+	}
+
+	/*
+	*	~ LZX decoder ~
+	*/
+
+	LzxDecoder::LzxDecoder(const DWORD windowBits)
+	{
+		if (!IsValidWindow(windowBits))
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_NOT_SUPPORTED, L"LzxDecoder", WriteErrorCategory::NotImplemented, L"LZX window size is not supported.");
+
+		m_windowSize = 1 << windowBits;
+		m_window = std::make_unique<BYTE[]>(m_windowSize);
+
+		// 2 slots per window bit, except for the two biggest windows.
+		switch (windowBits) {
+			case 20:
+				m_positionSlots = 42;
+				break;
+
+			case 21:
+				m_positionSlots = 50;
+				break;
+
+			default:
+				m_positionSlots = windowBits << 1;
+				break;
+		}
+
+		m_mainTable = std::make_unique<DWORD[]>(LZX_MAIN_TABLE_SIZE);
+		m_lengthTable = std::make_unique<DWORD[]>(LZX_LENGTH_TABLE_SIZE);
+		m_pretreeTable = std::make_unique<DWORD[]>(LZX_PRETREE_TABLE_SIZE);
+
+		m_input = nullptr;
+		m_inputEnd = nullptr;
+		m_bitBuffer = 0;
+		m_bitCount = 0;
+		m_overread = 0;
+
+		Reset();
+	}
+
+	LzxDecoder::~LzxDecoder() { }
+
+	bool LzxDecoder::IsValidWindow(const DWORD windowBits)
+	{
+		return windowBits >= LZX_MIN_WINDOW_BITS && windowBits <= LZX_MAX_WINDOW_BITS;
+	}
+
+	void LzxDecoder::Reset()
+	{
+		m_windowPosition = 0;
+		m_decodedSize = 0;
+
+		m_isHeaderRead = false;
+		m_blockType = 0;
+		m_blockSize = 0;
+		m_blockRemaining = 0;
+		m_repeatedOffsets[0] = m_repeatedOffsets[1] = m_repeatedOffsets[2] = 1;
+
+		m_isE8Started = false;
+		m_e8FileSize = 0;
+		m_e8Position = 0;
+		m_frameCount = 0;
+
+		memset(m_mainLengths, 0, sizeof(m_mainLengths));
+		memset(m_lengthLengths, 0, sizeof(m_lengthLengths));
+	}
+
+	const BYTE* LzxDecoder::Decompress(const BYTE* input, const DWORD inputSize, BYTE* output, const DWORD outputSize)
+	{
+		if (outputSize > LZX_FRAME_SIZE)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::Decompress", WriteErrorCategory::InvalidData, L"LZX frame is bigger than 32 KiB.");
+
+		// Frames are 32 KiB and windows a multiple of it, so only a short last frame could get here.
+		if (m_windowPosition + outputSize > m_windowSize)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::Decompress", WriteErrorCategory::InvalidData, L"LZX frame crosses the end of the window.");
+
+		// Each frame starts on a fresh bit stream.
+		m_input = input;
+		m_inputEnd = input + inputSize;
+		m_bitBuffer = 0;
+		m_bitCount = 0;
+		m_overread = 0;
+
+		if (!m_isHeaderRead) {
+			Refill();
+			if (GetBits(1) == 1) {
+				const DWORD high = GetBits(16);
+				m_e8FileSize = static_cast<LONG>((high << 16) | GetBits(16));
+			}
+
+			m_isHeaderRead = true;
+		}
+
+		const DWORD frameStart = m_windowPosition;
+		const DWORD frameEnd = frameStart + outputSize;
+		DWORD position = frameStart;
+		while (position < frameEnd) {
+			if (m_blockRemaining == 0)
+				ReadBlockHeader();
+
+			const DWORD run = m_blockRemaining < frameEnd - position ? m_blockRemaining : frameEnd - position;
+			const DWORD runEnd = position + run;
+			if (m_blockType == LZX_BLOCKTYPE_UNCOMPRESSED)
+				CopyUncompressed(position, runEnd);
+			else
+				DecodeCompressed(position, runEnd);
+
+			// Matches can't cross blocks nor frames.
+			if (position != runEnd)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::Decompress", WriteErrorCategory::InvalidData, L"LZX match overruns the block.");
+
+			m_blockRemaining -= run;
+
+			// Uncompressed blocks with an odd size are padded to 16 bits.
+			if (m_blockRemaining == 0 && m_blockType == LZX_BLOCKTYPE_UNCOMPRESSED && (m_blockSize & 1) && m_input < m_inputEnd)
+				m_input++;
+		}
+
+		// Zeroes we made up past the end of the input can't have been used.
+		if (m_bitCount < m_overread * 16)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::Decompress", WriteErrorCategory::InvalidData, L"LZX frame is truncated.");
+
+		memcpy(output, m_window.get() + frameStart, outputSize);
+		if (m_isE8Started && m_e8FileSize != 0 && m_frameCount < LZX_E8_MAX_FRAMES && outputSize > LZX_E8_FRAME_TAIL)
+			UndoE8Translation(output, outputSize);
+
+		m_e8Position += outputSize;
+		m_frameCount++;
+		m_decodedSize += outputSize;
+		m_windowPosition = frameEnd == m_windowSize ? 0 : frameEnd;
+
+		return output;
+	}
+
+	__forceinline void LzxDecoder::Refill()
+	{
+		// Leaves at least 49 bits in the buffer.
+		while (m_bitCount <= 48) {
+			DWORD word;
+			if (m_inputEnd - m_input >= 2) {
+				word = m_input[0] | (static_cast<DWORD>(m_input[1]) << 8);
+				m_input += 2;
+			}
+			else {
+				// Past the end we feed zeroes. A valid stream never consumes them, which we check at the end.
+				if (++m_overread > 4)
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::Refill", WriteErrorCategory::InvalidData, L"LZX frame is truncated.");
+
+				word = 0;
+			}
+
+			m_bitBuffer |= static_cast<unsigned __int64>(word) << (48 - m_bitCount);
+			m_bitCount += 16;
+		}
+	}
+
+	__forceinline DWORD LzxDecoder::GetBits(const DWORD count)
+	{
+		// Shifting in two steps so 'count' can be zero.
+		const DWORD value = static_cast<DWORD>((m_bitBuffer >> 1) >> (63 - count));
+		m_bitBuffer <<= count;
+		m_bitCount -= count;
+
+		return value;
+	}
+
+	__forceinline DWORD LzxDecoder::DecodeSymbol(const DWORD* table, const DWORD tableBits)
+	{
+		DWORD entry = table[m_bitBuffer >> (64 - tableBits)];
+		if (entry & LZX_ENTRY_SUBTABLE) {
+			const DWORD subtableBits = LzxEntrySubtableBits(entry);
+			entry = table[LzxEntryValue(entry) + ((m_bitBuffer << tableBits) >> (64 - subtableBits))];
+		}
+
+		if (entry & LZX_ENTRY_INVALID)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::DecodeSymbol", WriteErrorCategory::InvalidData, L"LZX Huffman code is invalid.");
+
+		const DWORD length = LzxEntryLength(entry);
+		m_bitBuffer <<= length;
+		m_bitCount -= length;
+
+		return LzxEntryValue(entry);
+	}
+
+	void LzxDecoder::AlignToBytes()
+	{
+		// Skips to the next 16-bit boundary, or a whole word when already on one.
+		Refill();
+		GetBits((m_bitCount & 15) == 0 ? 16 : m_bitCount & 15);
+
+		// What's left in the buffer is whole words, so we give them back to the input.
+		if (m_bitCount < m_overread * 16)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::AlignToBytes", WriteErrorCategory::InvalidData, L"LZX frame is truncated.");
+
+		m_input -= (m_bitCount >> 3) - (m_overread << 1);
+		m_bitBuffer = 0;
+		m_bitCount = 0;
+		m_overread = 0;
+	}
+
+	void LzxDecoder::ReadBlockHeader()
+	{
+		// Coming out of an uncompressed block the bit buffer is empty, and 'm_input' is where the header starts.
+		Refill();
+		m_blockType = GetBits(3);
+		const DWORD high = GetBits(16);
+		m_blockSize = (high << 8) | GetBits(8);
+		m_blockRemaining = m_blockSize;
+
+		switch (m_blockType) {
+			case LZX_BLOCKTYPE_ALIGNED:
+			{
+				BYTE alignedLengths[LZX_ALIGNED_TREE_SIZE];
+				Refill();
+				for (DWORD i = 0; i < LZX_ALIGNED_TREE_SIZE; i++)
+					alignedLengths[i] = static_cast<BYTE>(GetBits(3));
+
+				BuildTable(alignedLengths, LZX_ALIGNED_TREE_SIZE, LZX_ALIGNED_TABLE_BITS, m_alignedTable, LZX_ALIGNED_TABLE_SIZE);
+			}
+			[[fallthrough]];
+
+			case LZX_BLOCKTYPE_VERBATIM:
+			{
+				const DWORD mainTreeSize = 256 + (m_positionSlots << 3);
+				ReadLengths(m_mainLengths, 0, 256);
+				ReadLengths(m_mainLengths, 256, mainTreeSize);
+				BuildTable(m_mainLengths, mainTreeSize, LZX_MAIN_TABLE_BITS, m_mainTable.get(), LZX_MAIN_TABLE_SIZE);
+
+				// Translation starts with the first block that can produce an E8.
+				if (m_mainLengths[0xE8] != 0)
+					m_isE8Started = true;
+
+				ReadLengths(m_lengthLengths, 0, LZX_LENGTH_TREE_SIZE);
+				BuildTable(m_lengthLengths, LZX_LENGTH_TREE_SIZE, LZX_LENGTH_TABLE_BITS, m_lengthTable.get(), LZX_LENGTH_TABLE_SIZE);
+			} break;
+
+			case LZX_BLOCKTYPE_UNCOMPRESSED:
+			{
+				m_isE8Started = true;
+
+				AlignToBytes();
+				if (m_inputEnd - m_input < 12)
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::ReadBlockHeader", WriteErrorCategory::InvalidData, L"LZX uncompressed block header is truncated.");
+
+				for (DWORD i = 0; i < 3; i++) {
+					memcpy(&m_repeatedOffsets[i], m_input, sizeof(DWORD));
+					m_input += sizeof(DWORD);
+				}
+			} break;
+
+			default:
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::ReadBlockHeader", WriteErrorCategory::InvalidData, L"LZX block type is invalid.");
+		}
+
+		if (m_blockSize == 0)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::ReadBlockHeader", WriteErrorCategory::InvalidData, L"LZX block is empty.");
+	}
+
+	void LzxDecoder::ReadLengths(BYTE* lengths, const DWORD first, const DWORD last)
+	{
+		// Each run of lengths has its own pretree, 4 bits per length.
+		BYTE pretreeLengths[LZX_PRETREE_SIZE];
+		Refill();
+		for (DWORD i = 0; i < LZX_PRETREE_SIZE; i++) {
+			if (i == 12)
+				Refill();
+
+			pretreeLengths[i] = static_cast<BYTE>(GetBits(4));
+		}
+
+		BuildTable(pretreeLengths, LZX_PRETREE_SIZE, LZX_PRETREE_TABLE_BITS, m_pretreeTable.get(), LZX_PRETREE_TABLE_SIZE);
+
+		// Lengths are coded as a difference from the previous block's, modulo 17.
+		DWORD index = first;
+		while (index < last) {
+			Refill();
+			DWORD symbol = DecodeSymbol(m_pretreeTable.get(), LZX_PRETREE_TABLE_BITS);
+			DWORD repeat;
+			switch (symbol) {
+				case 17:
+				case 18:
+				{
+					repeat = symbol == 17 ? GetBits(4) + 4 : GetBits(5) + 20;
+					if (repeat > last - index)
+						_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::ReadLengths", WriteErrorCategory::InvalidData, L"LZX code length run overflows the tree.");
+
+					memset(lengths + index, 0, repeat);
+					index += repeat;
+				} break;
+
+				case 19:
+				{
+					repeat = GetBits(1) + 4;
+					if (repeat > last - index)
+						_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::ReadLengths", WriteErrorCategory::InvalidData, L"LZX code length run overflows the tree.");
+
+					symbol = DecodeSymbol(m_pretreeTable.get(), LZX_PRETREE_TABLE_BITS);
+					if (symbol > 16)
+						_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::ReadLengths", WriteErrorCategory::InvalidData, L"LZX code length run is invalid.");
+
+					const BYTE value = static_cast<BYTE>((lengths[index] + 17 - symbol) % 17);
+					memset(lengths + index, value, repeat);
+					index += repeat;
+				} break;
+
+				default:
+					lengths[index] = static_cast<BYTE>((lengths[index] + 17 - symbol) % 17);
+					index++;
+					break;
+			}
+		}
+	}
+
+	void LzxDecoder::DecodeCompressed(DWORD& position, const DWORD runEnd)
+	{
+		BYTE* const window = m_window.get();
+		const bool isAligned = m_blockType == LZX_BLOCKTYPE_ALIGNED;
+
+		// Folder bytes decoded before window position zero of this pass.
+		const __uint64 decodedBase = m_decodedSize - m_windowPosition;
+
+		DWORD current = position;
+		while (current < runEnd) {
+			Refill();
+			DWORD symbol = DecodeSymbol(m_mainTable.get(), LZX_MAIN_TABLE_BITS);
+			if (symbol < 256) {
+				window[current++] = static_cast<BYTE>(symbol);
+				continue;
+			}
+
+			symbol -= 256;
+			DWORD length = symbol & 7;
+			if (length == LZX_NUM_PRIMARY_LENGTHS)
+				length += DecodeSymbol(m_lengthTable.get(), LZX_LENGTH_TABLE_BITS);
+
+			length += LZX_MIN_MATCH;
+
+			// 17 extra bits plus a 7 bit aligned code at most.
+			Refill();
+			DWORD offset;
+			const DWORD slot = symbol >> 3;
+			switch (slot) {
+				case 0:
+					offset = m_repeatedOffsets[0];
+					break;
+
+				case 1:
+					offset = m_repeatedOffsets[1];
+					m_repeatedOffsets[1] = m_repeatedOffsets[0];
+					m_repeatedOffsets[0] = offset;
+					break;
+
+				case 2:
+					offset = m_repeatedOffsets[2];
+					m_repeatedOffsets[2] = m_repeatedOffsets[0];
+					m_repeatedOffsets[0] = offset;
+					break;
+
+				default:
+				{
+					const DWORD extraBits = s_positionSlots.ExtraBits[slot];
+					offset = s_positionSlots.Base[slot] - 2;
+					if (isAligned && extraBits >= 3) {
+						// The low 3 bits come from the aligned offset tree.
+						offset += GetBits(extraBits - 3) << 3;
+						offset += DecodeSymbol(m_alignedTable, LZX_ALIGNED_TABLE_BITS);
+					}
+					else {
+						offset += GetBits(extraBits);
+					}
+
+					m_repeatedOffsets[2] = m_repeatedOffsets[1];
+					m_repeatedOffsets[1] = m_repeatedOffsets[0];
+					m_repeatedOffsets[0] = offset;
+				} break;
+			}
+
+			if (offset == 0 || offset > decodedBase + current || offset > m_windowSize)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::DecodeCompressed", WriteErrorCategory::InvalidData, L"LZX match distance is too far back.");
+
+			if (length > runEnd - current)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::DecodeCompressed", WriteErrorCategory::InvalidData, L"LZX match overruns the block.");
+
+			BYTE* destination = window + current;
+			current += length;
+			if (offset > static_cast<DWORD>(destination - window)) {
+				// The source wraps around the end of the window. It's ahead of the
+				// destination, so a forward copy of the part before the end is safe.
+				const DWORD source = static_cast<DWORD>(destination - window) + m_windowSize - offset;
+				const DWORD tailSize = m_windowSize - source < length ? m_windowSize - source : length;
+				memmove(destination, window + source, tailSize);
+				destination += tailSize;
+				length -= tailSize;
+			}
+
+			// Word copies never write past the match, the window ahead of it is still history.
+			const BYTE* source = destination - offset;
+			if (offset >= sizeof(unsigned __int64)) {
+				while (length >= sizeof(unsigned __int64)) {
+					StoreLzxWord(destination, LoadLzxWord(source));
+					destination += sizeof(unsigned __int64);
+					source += sizeof(unsigned __int64);
+					length -= sizeof(unsigned __int64);
+				}
+			}
+
+			while (length > 0) {
+				*destination++ = *source++;
+				length--;
+			}
+		}
+
+		position = current;
+	}
+
+	void LzxDecoder::CopyUncompressed(DWORD& position, const DWORD runEnd)
+	{
+		// The frame ends where the CFDATA block ends, so the whole run must be here.
+		const DWORD size = runEnd - position;
+		if (static_cast<DWORD>(m_inputEnd - m_input) < size)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::CopyUncompressed", WriteErrorCategory::InvalidData, L"LZX uncompressed block is truncated.");
+
+		memcpy(m_window.get() + position, m_input, size);
+		m_input += size;
+		position = runEnd;
+	}
+
+	void LzxDecoder::UndoE8Translation(BYTE* data, const DWORD size) const
+	{
+		// E8 (CALL) operands were turned into absolute offsets when compressing.
+		const LONG fileSize = m_e8FileSize;
+		const BYTE* const end = data + size - LZX_E8_FRAME_TAIL;
+		LONG current = static_cast<LONG>(m_e8Position);
+		while (data < end) {
+			if (*data++ != 0xE8) {
+				current++;
+				continue;
+			}
+
+			LONG absolute;
+			memcpy(&absolute, data, sizeof(LONG));
+			if (absolute >= -current && absolute < fileSize) {
+				const LONG relative = absolute >= 0 ? absolute - current : absolute + fileSize;
+				memcpy(data, &relative, sizeof(LONG));
+			}
+
+			data += 4;
+			current += 5;
+		}
+	}
+
+	void LzxDecoder::BuildTable(const BYTE* lengths, const DWORD count, const DWORD tableBits, DWORD* table, const DWORD tableSize)
+	{
+		DWORD lengthCount[17]{ };
+		for (DWORD i = 0; i < count; i++)
+			lengthCount[lengths[i]]++;
+
+		// Over-subscribed codes are invalid. Incomplete ones are allowed, an empty
+		// length tree is common, the entries no code reaches are left invalid.
+		lengthCount[0] = 0;
+		int left = 1;
+		DWORD nextCode[17]{ };
+		for (DWORD length = 1; length < 17; length++) {
+			left = (left << 1) - static_cast<int>(lengthCount[length]);
+			if (left < 0)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::BuildTable", WriteErrorCategory::InvalidData, L"LZX Huffman code is over-subscribed.");
+
+			nextCode[length] = (nextCode[length - 1] + lengthCount[length - 1]) << 1;
+		}
+
+		const DWORD primarySize = 1 << tableBits;
+		const DWORD invalid = MakeLzxEntry(LZX_ENTRY_INVALID, 0, 0);
+		for (DWORD i = 0; i < primarySize; i++)
+			table[i] = invalid;
+
+		// LZX codes are read most significant bit first, so tables are indexed by the code itself.
+		DWORD codes[LZX_MAIN_TREE_MAX_SIZE];
+		BYTE longest[1 << LZX_MAIN_TABLE_BITS]{ };
+		for (DWORD symbol = 0; symbol < count; symbol++) {
+			const DWORD length = lengths[symbol];
+			if (length == 0)
+				continue;
+
+			codes[symbol] = nextCode[length]++;
+			if (length > tableBits) {
+				const DWORD prefix = codes[symbol] >> (length - tableBits);
+				if (length > longest[prefix])
+					longest[prefix] = static_cast<BYTE>(length);
+			}
+		}
+
+		// Codes longer than the primary table go to a sub-table sized for the longest code sharing the prefix.
+		DWORD nextSubtable = primarySize;
+		for (DWORD prefix = 0; prefix < primarySize; prefix++) {
+			if (longest[prefix] == 0)
+				continue;
+
+			const DWORD subtableBits = longest[prefix] - tableBits;
+			const DWORD subtableSize = 1 << subtableBits;
+			if (nextSubtable + subtableSize > tableSize)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"LzxDecoder::BuildTable", WriteErrorCategory::InvalidData, L"LZX Huffman table overflow.");
+
+			table[prefix] = MakeLzxEntry(LZX_ENTRY_SUBTABLE, 0, nextSubtable) | (subtableBits << 8);
+			for (DWORD i = 0; i < subtableSize; i++)
+				table[nextSubtable + i] = invalid;
+
+			nextSubtable += subtableSize;
+		}
+
+		// Sub-table entries hold the whole code length, it's consumed in one go.
+		for (DWORD symbol = 0; symbol < count; symbol++) {
+			const DWORD length = lengths[symbol];
+			if (length == 0)
+				continue;
+
+			const DWORD entry = MakeLzxEntry(0, length, symbol);
+			if (length <= tableBits) {
+				const DWORD first = codes[symbol] << (tableBits - length);
+				for (DWORD i = 0; i < (1UL << (tableBits - length)); i++)
+					table[first + i] = entry;
+			}
+			else {
+				const DWORD link = table[codes[symbol] >> (length - tableBits)];
+				const DWORD subtableBits = LzxEntrySubtableBits(link);
+				const DWORD suffixBits = length - tableBits;
+				const DWORD first = LzxEntryValue(link) + ((codes[symbol] & ((1 << suffixBits) - 1)) << (subtableBits - suffixBits));
+				for (DWORD i = 0; i < (1UL << (subtableBits - suffixBits)); i++)
+					table[first + i] = entry;
+			}
+		}
+	}
+}
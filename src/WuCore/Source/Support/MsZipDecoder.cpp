@@ -0,0 +1,491 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/Cabinet/MsZipDecoder.h"
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Table entries ~
+	*
+	*	Bits  0-3: Code length, consumed after the lookup.
+	*	Bits  4-7: Entry type.
+	*	Bits 8-15: Extra bits count. For sub-table links, the sub-table bit count.
+	*	Bits 16-31: Literal, length base, distance base or sub-table offset.
+	*/
+
+	// Distance and code length symbols use the literal type, their value is what we need.
+	constexpr DWORD ENTRY_LITERAL   = 0;
+	constexpr DWORD ENTRY_LENGTH    = 1;
+	constexpr DWORD ENTRY_END       = 2;
+	constexpr DWORD ENTRY_SUBTABLE  = 3;
+	constexpr DWORD ENTRY_INVALID   = 4;
+
+	constexpr DWORD MakeEntry(const DWORD type, const DWORD extra, const DWORD value) { return (value << 16) | (extra << 8) | (type << 4); }
+	constexpr DWORD EntryLength(const DWORD entry) { return entry & 0xF; }
+	constexpr DWORD EntryType(const DWORD entry) { return (entry >> 4) & 0xF; }
+	constexpr DWORD EntryExtra(const DWORD entry) { return (entry >> 8) & 0xFF; }
+	constexpr DWORD EntryValue(const DWORD entry) { return entry >> 16; }
+
+	constexpr WORD s_lengthBase[] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+
+	constexpr BYTE s_lengthExtra[] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+
+	constexpr WORD s_distanceBase[] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+
+	constexpr BYTE s_distanceExtra[] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	// Order the code length code lengths are stored in the dynamic block header.
+	constexpr BYTE s_codeLengthOrder[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// What each symbol of each alphabet decodes to, without the code length.
+	struct MsZipSymbols
+	{
+		DWORD Literal[288];
+		DWORD Distance[32];
+		DWORD CodeLength[19];
+
+		constexpr MsZipSymbols()
+			: Literal(), Distance(), CodeLength()
+		{
+			for (DWORD i = 0; i < 256; i++)
+				Literal[i] = MakeEntry(ENTRY_LITERAL, 0, i);
+
+			Literal[256] = MakeEntry(ENTRY_END, 0, 0);
+			for (DWORD i = 0; i < 29; i++)
+				Literal[257 + i] = MakeEntry(ENTRY_LENGTH, s_lengthExtra[i], s_lengthBase[i]);
+
+			Literal[286] = Literal[287] = MakeEntry(ENTRY_INVALID, 0, 0);
+
+			for (DWORD i = 0; i < 30; i++)
+				Distance[i] = MakeEntry(ENTRY_LITERAL, s_distanceExtra[i], s_distanceBase[i]);
+
+			Distance[30] = Distance[31] = MakeEntry(ENTRY_INVALID, 0, 0);
+
+			for (DWORD i = 0; i < 19; i++)
+				CodeLength[i] = MakeEntry(ENTRY_LITERAL, 0, i);
+		}
+	};
+
+	constexpr MsZipSymbols s_symbols;
+
+	static __forceinline unsigned __int64 LoadWord(const BYTE* source)
+	{
+		unsigned __int64 value;
+		memcpy(&value, source, sizeof(value));
+
+		return value;
+	}
+
+	static __forceinline void StoreWord(BYTE* destination, const unsigned __int64 value)
+	{
+		memcpy(destination, &value, sizeof(value));
+	}
+
+	/*
+	*	~ MSZIP decoder ~
+	*/
+
+	MsZipDecoder::MsZipDecoder()
+		: m_historySize(0), m_input(nullptr), m_inputEnd(nullptr), m_bitBuffer(0), m_bitCount(0), m_overread(0)
+	{
+		// Up to 7 bytes can be written past the block end by the wide copies.
+		m_window = std::make_unique<BYTE[]>(MSZIP_WINDOW_SIZE + CAB_MAX_BLOCK_UNCOMPRESSED + sizeof(unsigned __int64));
+
+		m_literalTable = std::make_unique<DWORD[]>(MSZIP_LITERAL_TABLE_SIZE);
+		m_distanceTable = std::make_unique<DWORD[]>(MSZIP_DISTANCE_TABLE_SIZE);
+
+		// Fixed Huffman codes, from RFC 1951 3.2.6.
+		BYTE lengths[288];
+		memset(lengths, 8, 144);
+		memset(lengths + 144, 9, 112);
+		memset(lengths + 256, 7, 24);
+		memset(lengths + 280, 8, 8);
+
+		m_fixedLiteralTable = std::make_unique<DWORD[]>(MSZIP_LITERAL_TABLE_SIZE);
+		BuildTable(lengths, 288, s_symbols.Literal, MSZIP_LITERAL_TABLE_BITS, m_fixedLiteralTable.get(), MSZIP_LITERAL_TABLE_SIZE);
+
+		memset(lengths, 5, 32);
+		m_fixedDistanceTable = std::make_unique<DWORD[]>(MSZIP_DISTANCE_TABLE_SIZE);
+		BuildTable(lengths, 32, s_symbols.Distance, MSZIP_DISTANCE_TABLE_BITS, m_fixedDistanceTable.get(), MSZIP_DISTANCE_TABLE_SIZE);
+	}
+
+	MsZipDecoder::~MsZipDecoder() { }
+
+	void MsZipDecoder::Reset()
+	{
+		m_historySize = 0;
+	}
+
+	const BYTE* MsZipDecoder::Decompress(const BYTE* input, const DWORD inputSize, BYTE* output, const DWORD outputSize)
+	{
+		UNREFERENCED_PARAMETER(output);
+
+		if (inputSize < 2 || input[0] != 'C' || input[1] != 'K')
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::Decompress", WriteErrorCategory::InvalidData, L"MSZIP block signature not found.");
+
+		m_input = input + 2;
+		m_inputEnd = input + inputSize;
+		m_bitBuffer = 0;
+		m_bitCount = 0;
+		m_overread = 0;
+
+		BYTE* const blockStart = m_window.get() + MSZIP_WINDOW_SIZE;
+		const BYTE* const blockEnd = blockStart + outputSize;
+		BYTE* current = blockStart;
+
+		bool isFinal;
+		do {
+			Refill();
+			isFinal = GetBits(1) == 1;
+			switch (GetBits(2)) {
+				case 0:
+					InflateStored(current, blockEnd);
+					break;
+
+				case 1:
+					InflateHuffman(m_fixedLiteralTable.get(), m_fixedDistanceTable.get(), current, blockEnd);
+					break;
+
+				case 2:
+					ReadDynamicTables();
+					InflateHuffman(m_literalTable.get(), m_distanceTable.get(), current, blockEnd);
+					break;
+
+				default:
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::Decompress", WriteErrorCategory::InvalidData, L"MSZIP block type is invalid.");
+			}
+		} while (!isFinal);
+
+		// Zeroes we made up past the end of the input can't have been used.
+		if (current != blockEnd || m_bitCount < m_overread * 8)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::Decompress", WriteErrorCategory::InvalidData, L"MSZIP block size mismatch.");
+
+		// Keeping the last 32 KiB as history for the next block. This
+		// only touches the history area, so the block stays where it is.
+		const DWORD totalSize = m_historySize + outputSize;
+		const DWORD newHistorySize = totalSize < MSZIP_WINDOW_SIZE ? totalSize : MSZIP_WINDOW_SIZE;
+		memmove(blockStart - newHistorySize, blockEnd - newHistorySize, newHistorySize);
+		m_historySize = newHistorySize;
+
+		return blockStart;
+	}
+
+	__forceinline void MsZipDecoder::Refill()
+	{
+		if (m_inputEnd - m_input >= 8) {
+			// Branchless refill, leaves between 56 and 63 bits in the buffer.
+			m_bitBuffer |= LoadWord(m_input) << m_bitCount;
+			m_input += (63 - m_bitCount) >> 3;
+			m_bitCount |= 56;
+		}
+		else {
+			// Close to the end we go byte by byte, and past the end we feed zeroes.
+			// A valid stream never consumes them, which we check at the end.
+			while (m_bitCount <= 56) {
+				if (m_input < m_inputEnd)
+					m_bitBuffer |= static_cast<unsigned __int64>(*m_input++) << m_bitCount;
+				else if (++m_overread > 8)
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::Refill", WriteErrorCategory::InvalidData, L"MSZIP block is truncated.");
+
+				m_bitCount += 8;
+			}
+		}
+	}
+
+	__forceinline DWORD MsZipDecoder::GetBits(const DWORD count)
+	{
+		const DWORD value = static_cast<DWORD>(m_bitBuffer & ((1ULL << count) - 1));
+		m_bitBuffer >>= count;
+		m_bitCount -= count;
+
+		return value;
+	}
+
+	__forceinline DWORD MsZipDecoder::DecodeSymbol(const DWORD* table, const DWORD tableBits)
+	{
+		DWORD entry = table[m_bitBuffer & ((1ULL << tableBits) - 1)];
+		if (EntryType(entry) == ENTRY_SUBTABLE) {
+			m_bitBuffer >>= tableBits;
+			m_bitCount -= tableBits;
+			entry = table[EntryValue(entry) + (m_bitBuffer & ((1ULL << EntryExtra(entry)) - 1))];
+		}
+
+		const DWORD length = EntryLength(entry);
+		m_bitBuffer >>= length;
+		m_bitCount -= length;
+
+		return entry;
+	}
+
+	void MsZipDecoder::ReadDynamicTables()
+	{
+		BYTE lengths[288 + 32]{ };
+
+		Refill();
+		const DWORD literalCount = GetBits(5) + 257;
+		const DWORD distanceCount = GetBits(5) + 1;
+		const DWORD codeLengthCount = GetBits(4) + 4;
+		if (literalCount > 286 || distanceCount > 30)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::ReadDynamicTables", WriteErrorCategory::InvalidData, L"MSZIP dynamic block header is invalid.");
+
+		// Code length code lengths, 3 bits each.
+		BYTE codeLengths[19]{ };
+		for (DWORD i = 0; i < codeLengthCount; i++) {
+			Refill();
+			codeLengths[s_codeLengthOrder[i]] = static_cast<BYTE>(GetBits(3));
+		}
+
+		DWORD codeTable[MSZIP_CODE_TABLE_SIZE];
+		BuildTable(codeLengths, 19, s_symbols.CodeLength, MSZIP_CODE_TABLE_BITS, codeTable, MSZIP_CODE_TABLE_SIZE);
+
+		// Literal/length and distance code lengths, run-length encoded as one sequence.
+		const DWORD totalCount = literalCount + distanceCount;
+		DWORD index = 0;
+		while (index < totalCount) {
+			Refill();
+			const DWORD entry = DecodeSymbol(codeTable, MSZIP_CODE_TABLE_BITS);
+			if (EntryType(entry) != ENTRY_LITERAL)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::ReadDynamicTables", WriteErrorCategory::InvalidData, L"MSZIP code length code is invalid.");
+
+			const DWORD symbol = EntryValue(entry);
+			if (symbol < 16) {
+				lengths[index++] = static_cast<BYTE>(symbol);
+				continue;
+			}
+
+			BYTE value = 0;
+			DWORD repeat;
+			switch (symbol) {
+				case 16:
+					if (index == 0)
+						_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::ReadDynamicTables", WriteErrorCategory::InvalidData, L"MSZIP code length repeat has no previous length.");
+
+					value = lengths[index - 1];
+					repeat = 3 + GetBits(2);
+					break;
+
+				case 17:
+					repeat = 3 + GetBits(3);
+					break;
+
+				default:
+					repeat = 11 + GetBits(7);
+					break;
+			}
+
+			if (repeat > totalCount - index)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::ReadDynamicTables", WriteErrorCategory::InvalidData, L"MSZIP code length repeat overflows the header.");
+
+			memset(lengths + index, value, repeat);
+			index += repeat;
+		}
+
+		if (lengths[256] == 0)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::ReadDynamicTables", WriteErrorCategory::InvalidData, L"MSZIP block has no end of block code.");
+
+		BuildTable(lengths, literalCount, s_symbols.Literal, MSZIP_LITERAL_TABLE_BITS, m_literalTable.get(), MSZIP_LITERAL_TABLE_SIZE);
+		BuildTable(lengths + literalCount, distanceCount, s_symbols.Distance, MSZIP_DISTANCE_TABLE_BITS, m_distanceTable.get(), MSZIP_DISTANCE_TABLE_SIZE);
+	}
+
+	void MsZipDecoder::InflateStored(BYTE*& output, const BYTE* outputEnd)
+	{
+		// Skipping to the byte boundary.
+		GetBits(m_bitCount & 7);
+
+		Refill();
+		const DWORD length = GetBits(16);
+		const DWORD complement = GetBits(16);
+		if ((length ^ 0xFFFF) != complement)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::InflateStored", WriteErrorCategory::InvalidData, L"MSZIP stored block length is invalid.");
+
+		if (m_bitCount < m_overread * 8)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::InflateStored", WriteErrorCategory::InvalidData, L"MSZIP block is truncated.");
+
+		const DWORD bufferedBytes = (m_bitCount / 8) - m_overread;
+		if (length > static_cast<DWORD>(outputEnd - output) || length > bufferedBytes + static_cast<DWORD>(m_inputEnd - m_input))
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::InflateStored", WriteErrorCategory::InvalidData, L"MSZIP stored block length is invalid.");
+
+		// Whole bytes still in the bit buffer come first.
+		DWORD remaining = length;
+		while (remaining > 0 && m_bitCount / 8 > m_overread) {
+			*output++ = static_cast<BYTE>(GetBits(8));
+			remaining--;
+		}
+
+		if (remaining > 0) {
+			// The buffer has at most made up zeroes at this point.
+			m_bitBuffer = 0;
+			m_bitCount = 0;
+			m_overread = 0;
+
+			memcpy(output, m_input, remaining);
+			output += remaining;
+			m_input += remaining;
+		}
+	}
+
+	void MsZipDecoder::InflateHuffman(const DWORD* literalTable, const DWORD* distanceTable, BYTE*& output, const BYTE* outputEnd)
+	{
+		const BYTE* const windowStart = m_window.get() + MSZIP_WINDOW_SIZE - m_historySize;
+		BYTE* current = output;
+
+		for (;;) {
+			// Longest case is 15 + 5 bits for the length and 15 + 13 for the distance.
+			Refill();
+
+			DWORD entry = DecodeSymbol(literalTable, MSZIP_LITERAL_TABLE_BITS);
+			const DWORD type = EntryType(entry);
+			if (type == ENTRY_LITERAL) {
+				if (current >= outputEnd)
+					_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::InflateHuffman", WriteErrorCategory::InvalidData, L"MSZIP data overflows the block.");
+
+				*current++ = static_cast<BYTE>(EntryValue(entry));
+				continue;
+			}
+
+			if (type == ENTRY_END)
+				break;
+
+			if (type != ENTRY_LENGTH)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::InflateHuffman", WriteErrorCategory::InvalidData, L"MSZIP literal/length code is invalid.");
+
+			const DWORD length = EntryValue(entry) + GetBits(EntryExtra(entry));
+
+			entry = DecodeSymbol(distanceTable, MSZIP_DISTANCE_TABLE_BITS);
+			if (EntryType(entry) != ENTRY_LITERAL)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::InflateHuffman", WriteErrorCategory::InvalidData, L"MSZIP distance code is invalid.");
+
+			const DWORD distance = EntryValue(entry) + GetBits(EntryExtra(entry));
+			if (distance > static_cast<DWORD>(current - windowStart))
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::InflateHuffman", WriteErrorCategory::InvalidData, L"MSZIP match distance is too far back.");
+
+			if (length > static_cast<DWORD>(outputEnd - current))
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::InflateHuffman", WriteErrorCategory::InvalidData, L"MSZIP data overflows the block.");
+
+			const BYTE* source = current - distance;
+			BYTE* const matchEnd = current + length;
+			if (distance >= sizeof(unsigned __int64)) {
+				// Each word only reads bytes already written. May write up to 7 bytes past the match, into the slack.
+				do {
+					StoreWord(current, LoadWord(source));
+					current += sizeof(unsigned __int64);
+					source += sizeof(unsigned __int64);
+				} while (current < matchEnd);
+			}
+			else if (distance == 1) {
+				const unsigned __int64 pattern = 0x0101010101010101ULL * *source;
+				do {
+					StoreWord(current, pattern);
+					current += sizeof(unsigned __int64);
+				} while (current < matchEnd);
+			}
+			else {
+				do {
+					*current++ = *source++;
+				} while (current < matchEnd);
+			}
+
+			current = matchEnd;
+		}
+
+		output = current;
+	}
+
+	void MsZipDecoder::BuildTable(const BYTE* lengths, const DWORD count, const DWORD* symbols, const DWORD tableBits, DWORD* table, const DWORD tableSize)
+	{
+		DWORD lengthCount[16]{ };
+		for (DWORD i = 0; i < count; i++)
+			lengthCount[lengths[i]]++;
+
+		// Over-subscribed codes are invalid. Incomplete ones are allowed,
+		// the entries no code reaches are left invalid.
+		lengthCount[0] = 0;
+		int left = 1;
+		DWORD nextCode[16]{ };
+		for (DWORD length = 1; length < 16; length++) {
+			left = (left << 1) - static_cast<int>(lengthCount[length]);
+			if (left < 0)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::BuildTable", WriteErrorCategory::InvalidData, L"MSZIP Huffman code is over-subscribed.");
+
+			nextCode[length] = (nextCode[length - 1] + lengthCount[length - 1]) << 1;
+		}
+
+		const DWORD primarySize = 1 << tableBits;
+		const DWORD invalid = MakeEntry(ENTRY_INVALID, 0, 0);
+		for (DWORD i = 0; i < primarySize; i++)
+			table[i] = invalid;
+
+		// Deflate codes are packed starting with the most significant bit,
+		// so tables are indexed by the bit-reversed code.
+		DWORD reversedCodes[288];
+		BYTE longest[1 << MSZIP_LITERAL_TABLE_BITS]{ };
+		for (DWORD symbol = 0; symbol < count; symbol++) {
+			const DWORD length = lengths[symbol];
+			if (length == 0)
+				continue;
+
+			DWORD code = nextCode[length]++;
+			DWORD reversed = 0;
+			for (DWORD i = 0; i < length; i++) {
+				reversed = (reversed << 1) | (code & 1);
+				code >>= 1;
+			}
+
+			reversedCodes[symbol] = reversed;
+			if (length > tableBits) {
+				const DWORD prefix = reversed & (primarySize - 1);
+				if (length > longest[prefix])
+					longest[prefix] = static_cast<BYTE>(length);
+			}
+		}
+
+		// Codes longer than the primary table go to a sub-table sized for the longest code sharing the prefix.
+		DWORD nextSubtable = primarySize;
+		for (DWORD prefix = 0; prefix < primarySize; prefix++) {
+			if (longest[prefix] == 0)
+				continue;
+
+			const DWORD subtableBits = longest[prefix] - tableBits;
+			const DWORD subtableSize = 1 << subtableBits;
+			if (nextSubtable + subtableSize > tableSize)
+				_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_BAD_FORMAT, L"MsZipDecoder::BuildTable", WriteErrorCategory::InvalidData, L"MSZIP Huffman table overflow.");
+
+			table[prefix] = MakeEntry(ENTRY_SUBTABLE, subtableBits, nextSubtable);
+			for (DWORD i = 0; i < subtableSize; i++)
+				table[nextSubtable + i] = invalid;
+
+			nextSubtable += subtableSize;
+		}
+
+		for (DWORD symbol = 0; symbol < count; symbol++) {
+			const DWORD length = lengths[symbol];
+			if (length == 0)
+				continue;
+
+			const DWORD reversed = reversedCodes[symbol];
+			if (length <= tableBits) {
+				for (DWORD i = reversed; i < primarySize; i += 1 << length)
+					table[i] = symbols[symbol] | length;
+			}
+			else {
+				const DWORD link = table[reversed & (primarySize - 1)];
+				const DWORD subtableBits = EntryExtra(link);
+				const DWORD subtableLength = length - tableBits;
+				for (DWORD i = reversed >> tableBits; i < (1UL << subtableBits); i += 1 << subtableLength)
+					table[EntryValue(link) + i] = symbols[symbol] | subtableLength;
+			}
+		}
+	}
+}
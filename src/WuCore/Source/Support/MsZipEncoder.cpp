@@ -0,0 +1,599 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/Cabinet/MsZipEncoder.h"
+
+#include <intrin.h>
+#include <algorithm>
+
+namespace WindowsUtils::Core
+{
+	constexpr DWORD MSZIP_ENCODER_WINDOW_SIZE   = CAB_MAX_BLOCK_UNCOMPRESSED;
+	constexpr DWORD MSZIP_ENCODER_CHAIN_MASK    = (MSZIP_ENCODER_WINDOW_SIZE << 1) - 1;
+	constexpr DWORD MSZIP_ENCODER_MIN_MATCH     = 3;
+	constexpr DWORD MSZIP_ENCODER_MAX_MATCH     = 258;
+	constexpr DWORD MSZIP_ENCODER_TOO_FAR       = 4096;    // Shortest matches this far back cost more than the literals.
+
+	constexpr BYTE s_encoderLengthExtra[] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+
+	constexpr WORD s_encoderLengthBase[] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+
+	constexpr BYTE s_encoderDistanceExtra[] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	constexpr WORD s_encoderDistanceBase[] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+
+	constexpr BYTE s_encoderCodeLengthOrder[] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// Length code for each match length.
+	struct MsZipLengthCodes
+	{
+		BYTE Code[MSZIP_ENCODER_MAX_MATCH + 1];
+
+		constexpr MsZipLengthCodes()
+			: Code()
+		{
+			for (DWORD code = 0; code < 29; code++) {
+				const DWORD last = code == 28 ? MSZIP_ENCODER_MAX_MATCH : s_encoderLengthBase[code + 1] - 1;
+				for (DWORD length = s_encoderLengthBase[code]; length <= last; length++)
+					Code[length] = static_cast<BYTE>(code);
+			}
+
+			// 258 has its own code, 284 with 5 extra bits could also encode it.
+			Code[MSZIP_ENCODER_MAX_MATCH] = 28;
+		}
+	};
+
+	constexpr MsZipLengthCodes s_lengthCodes;
+
+	static __forceinline DWORD GetDistanceCode(const DWORD distance)
+	{
+		const DWORD value = distance - 1;
+		if (value < 4)
+			return value;
+
+		unsigned long highBit;
+		_BitScanReverse(&highBit, value);
+
+		return (highBit << 1) | ((value >> (highBit - 1)) & 1);
+	}
+
+	static __forceinline DWORD HashBytes(const BYTE* data)
+	{
+		DWORD value;
+		memcpy(&value, data, sizeof(value));
+
+		return ((value & 0xFFFFFF) * 0x9E3779B1) >> (32 - MSZIP_ENCODER_HASH_BITS);
+	}
+
+	/*
+	*	~ MSZIP encoder ~
+	*/
+
+	MsZipEncoder::MsZipEncoder()
+		: m_historySize(0), m_position(0), m_tokenCount(0), m_literalFrequencies(), m_distanceFrequencies(),
+		m_output(nullptr), m_bitBuffer(0), m_bitCount(0)
+	{
+		// The wide compares read up to 8 bytes past the block.
+		m_window = std::make_unique<BYTE[]>(MSZIP_ENCODER_WINDOW_SIZE + CAB_MAX_BLOCK_UNCOMPRESSED + sizeof(unsigned __int64));
+		m_head = std::make_unique<DWORD[]>(1 << MSZIP_ENCODER_HASH_BITS);
+		m_chain = std::make_unique<DWORD[]>(MSZIP_ENCODER_CHAIN_MASK + 1);
+
+		// A block can't have more tokens than bytes, plus the end of block.
+		m_tokenLengths = std::make_unique<WORD[]>(CAB_MAX_BLOCK_UNCOMPRESSED + 1);
+		m_tokenDistances = std::make_unique<WORD[]>(CAB_MAX_BLOCK_UNCOMPRESSED + 1);
+
+		Reset();
+	}
+
+	MsZipEncoder::~MsZipEncoder() { }
+
+	void MsZipEncoder::Reset()
+	{
+		m_historySize = 0;
+		m_position = 0;
+		memset(m_head.get(), 0, sizeof(DWORD) << MSZIP_ENCODER_HASH_BITS);
+	}
+
+	DWORD MsZipEncoder::Compress(const BYTE* input, const DWORD inputSize, BYTE* output)
+	{
+		if (inputSize == 0 || inputSize > CAB_MAX_BLOCK_UNCOMPRESSED)
+			_WU_RAISE_NATIVE_EXCEPTION_WMESS(ERROR_INVALID_PARAMETER, L"MsZipEncoder::Compress", WriteErrorCategory::InvalidArgument, L"MSZIP block size is invalid.");
+
+		BYTE* const block = m_window.get() + MSZIP_ENCODER_WINDOW_SIZE;
+		memcpy(block, input, inputSize);
+		memset(block + inputSize, 0, sizeof(unsigned __int64));
+
+		m_tokenCount = 0;
+		memset(m_literalFrequencies, 0, sizeof(m_literalFrequencies));
+		memset(m_distanceFrequencies, 0, sizeof(m_distanceFrequencies));
+		FindMatches(inputSize);
+		m_literalFrequencies[256] = 1;
+
+		BYTE literalLengths[286];
+		BYTE distanceLengths[30];
+		BuildLengths(m_literalFrequencies, 286, 15, literalLengths);
+		BuildLengths(m_distanceFrequencies, 30, 15, distanceLengths);
+
+		// Decoders want at least one distance code, even if unused.
+		if (std::all_of(distanceLengths, distanceLengths + 30, [](const BYTE length) { return length == 0; }))
+			distanceLengths[0] = 1;
+
+		DWORD literalCount = 286;
+		while (literalCount > 257 && literalLengths[literalCount - 1] == 0)
+			literalCount--;
+
+		DWORD distanceCount = 30;
+		while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0)
+			distanceCount--;
+
+		// Run-length encoding the code lengths. Symbol in the low byte, extra bits value in the high.
+		BYTE allLengths[286 + 30];
+		memcpy(allLengths, literalLengths, literalCount);
+		memcpy(allLengths + literalCount, distanceLengths, distanceCount);
+		const DWORD allCount = literalCount + distanceCount;
+
+		WORD runs[286 + 30];
+		DWORD runCount = 0;
+		DWORD codeLengthFrequencies[19]{ };
+		for (DWORD i = 0; i < allCount;) {
+			const BYTE length = allLengths[i];
+			DWORD run = 1;
+			while (i + run < allCount && allLengths[i + run] == length)
+				run++;
+
+			i += run;
+			if (length == 0) {
+				while (run >= 11) {
+					const DWORD count = min(run, 138UL);
+					runs[runCount++] = static_cast<WORD>(18 | ((count - 11) << 8));
+					run -= count;
+				}
+
+				if (run >= 3) {
+					runs[runCount++] = static_cast<WORD>(17 | ((run - 3) << 8));
+					run = 0;
+				}
+			}
+			else {
+				runs[runCount++] = length;
+				run--;
+				while (run >= 3) {
+					const DWORD count = min(run, 6UL);
+					runs[runCount++] = static_cast<WORD>(16 | ((count - 3) << 8));
+					run -= count;
+				}
+			}
+
+			while (run-- > 0)
+				runs[runCount++] = length;
+		}
+
+		for (DWORD i = 0; i < runCount; i++)
+			codeLengthFrequencies[runs[i] & 0xFF]++;
+
+		BYTE codeLengthLengths[19];
+		BuildLengths(codeLengthFrequencies, 19, 7, codeLengthLengths);
+
+		// Unlike the other two, the code length code must be complete.
+		if (std::count_if(codeLengthLengths, codeLengthLengths + 19, [](const BYTE length) { return length != 0; }) == 1)
+			codeLengthLengths[codeLengthLengths[0] == 0 ? 0 : 1] = 1;
+
+		DWORD codeLengthCount = 19;
+		while (codeLengthCount > 4 && codeLengthLengths[s_encoderCodeLengthOrder[codeLengthCount - 1]] == 0)
+			codeLengthCount--;
+
+		// Picking the smallest of the three block types, in bits.
+		__uint64 dynamicSize = 3 + 5 + 5 + 4 + (3 * codeLengthCount);
+		for (DWORD i = 0; i < 19; i++)
+			dynamicSize += static_cast<__uint64>(codeLengthFrequencies[i]) * codeLengthLengths[i];
+
+		dynamicSize += (static_cast<__uint64>(codeLengthFrequencies[16]) * 2) + (codeLengthFrequencies[17] * 3) + (codeLengthFrequencies[18] * 7);
+
+		__uint64 fixedSize = 3;
+		for (DWORD i = 0; i < 286; i++) {
+			const DWORD extra = i > 256 ? s_encoderLengthExtra[i - 257] : 0;
+			const DWORD fixedLength = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+			dynamicSize += static_cast<__uint64>(m_literalFrequencies[i]) * (literalLengths[i] + extra);
+			fixedSize += static_cast<__uint64>(m_literalFrequencies[i]) * (fixedLength + extra);
+		}
+
+		for (DWORD i = 0; i < 30; i++) {
+			dynamicSize += static_cast<__uint64>(m_distanceFrequencies[i]) * (distanceLengths[i] + s_encoderDistanceExtra[i]);
+			fixedSize += static_cast<__uint64>(m_distanceFrequencies[i]) * (5 + s_encoderDistanceExtra[i]);
+		}
+
+		// Header bits, padding to the byte, then LEN and NLEN.
+		const __uint64 storedSize = 8 + 32 + (static_cast<__uint64>(inputSize) * 8);
+
+		output[0] = 'C';
+		output[1] = 'K';
+		m_output = output + 2;
+		m_bitBuffer = 0;
+		m_bitCount = 0;
+
+		if (storedSize <= dynamicSize && storedSize <= fixedSize) {
+			WriteStored(block, inputSize);
+		}
+		else if (fixedSize <= dynamicSize) {
+			BYTE fixedLiteralLengths[288];
+			BYTE fixedDistanceLengths[30];
+			memset(fixedLiteralLengths, 8, 144);
+			memset(fixedLiteralLengths + 144, 9, 112);
+			memset(fixedLiteralLengths + 256, 7, 24);
+			memset(fixedLiteralLengths + 280, 8, 8);
+			memset(fixedDistanceLengths, 5, 30);
+
+			WORD literalCodes[288];
+			WORD distanceCodes[30];
+			BuildCodes(fixedLiteralLengths, 288, literalCodes);
+			BuildCodes(fixedDistanceLengths, 30, distanceCodes);
+
+			WriteBits(1, 1);
+			WriteBits(1, 2);
+			WriteTokens(fixedLiteralLengths, literalCodes, fixedDistanceLengths, distanceCodes);
+		}
+		else {
+			WORD literalCodes[286];
+			WORD distanceCodes[30];
+			WORD codeLengthCodes[19];
+			BuildCodes(literalLengths, 286, literalCodes);
+			BuildCodes(distanceLengths, 30, distanceCodes);
+			BuildCodes(codeLengthLengths, 19, codeLengthCodes);
+
+			WriteBits(1, 1);
+			WriteBits(2, 2);
+			WriteBits(literalCount - 257, 5);
+			WriteBits(distanceCount - 1, 5);
+			WriteBits(codeLengthCount - 4, 4);
+			for (DWORD i = 0; i < codeLengthCount; i++)
+				WriteBits(codeLengthLengths[s_encoderCodeLengthOrder[i]], 3);
+
+			for (DWORD i = 0; i < runCount; i++) {
+				const DWORD symbol = runs[i] & 0xFF;
+				WriteBits(codeLengthCodes[symbol], codeLengthLengths[symbol]);
+				switch (symbol) {
+					case 16: WriteBits(runs[i] >> 8, 2); break;
+					case 17: WriteBits(runs[i] >> 8, 3); break;
+					case 18: WriteBits(runs[i] >> 8, 7); break;
+				}
+			}
+
+			WriteTokens(literalLengths, literalCodes, distanceLengths, distanceCodes);
+		}
+
+		FlushBits();
+		const DWORD compressedSize = static_cast<DWORD>(m_output - output);
+
+		// Keeping the last 32 KiB as history for the next block.
+		const DWORD totalSize = m_historySize + inputSize;
+		const DWORD newHistorySize = min(totalSize, MSZIP_ENCODER_WINDOW_SIZE);
+		memmove(block - newHistorySize, block + inputSize - newHistorySize, newHistorySize);
+		m_historySize = newHistorySize;
+		m_position += inputSize;
+
+		return compressedSize;
+	}
+
+	void MsZipEncoder::FindMatches(const DWORD blockSize)
+	{
+		// Greedy parsing with one byte of lazy evaluation, like zlib.
+		const BYTE* const window = m_window.get();
+		const DWORD end = MSZIP_ENCODER_WINDOW_SIZE + blockSize;
+		DWORD index = MSZIP_ENCODER_WINDOW_SIZE;
+		DWORD previousLength = 0;
+		DWORD previousDistance = 0;
+		bool hasPending = false;
+		while (index < end) {
+			DWORD length = 0;
+			DWORD distance = 0;
+			const DWORD remaining = end - index;
+			if (remaining >= MSZIP_ENCODER_MIN_MATCH) {
+				const DWORD candidate = InsertHash(index);
+				if (candidate != 0 && previousLength < MSZIP_ENCODER_LAZY_LENGTH) {
+					length = FindLongestMatch(index, candidate, min(remaining, MSZIP_ENCODER_MAX_MATCH), previousLength, distance);
+					if (length == MSZIP_ENCODER_MIN_MATCH && distance > MSZIP_ENCODER_TOO_FAR)
+						length = 0;
+				}
+			}
+
+			if (hasPending && previousLength >= MSZIP_ENCODER_MIN_MATCH && length <= previousLength) {
+				// The match at the previous byte is at least as good, we take it.
+				AddMatch(previousLength, previousDistance);
+				const DWORD matchEnd = index - 1 + previousLength;
+				for (DWORD i = index + 1; i < matchEnd; i++) {
+					if (end - i >= MSZIP_ENCODER_MIN_MATCH)
+						InsertHash(i);
+				}
+
+				index = matchEnd;
+				hasPending = false;
+				previousLength = 0;
+				continue;
+			}
+
+			if (hasPending)
+				AddLiteral(window[index - 1]);
+
+			hasPending = true;
+			previousLength = length;
+			previousDistance = distance;
+			index++;
+		}
+
+		// A match can't start this close to the end, so it's a literal.
+		if (hasPending)
+			AddLiteral(window[end - 1]);
+	}
+
+	__forceinline DWORD MsZipEncoder::InsertHash(const DWORD index)
+	{
+		const DWORD hash = HashBytes(m_window.get() + index);
+		const DWORD position = m_position + index - MSZIP_ENCODER_WINDOW_SIZE;
+		const DWORD candidate = m_head[hash];
+		m_chain[position & MSZIP_ENCODER_CHAIN_MASK] = candidate;
+		m_head[hash] = position + 1;
+
+		return candidate;
+	}
+
+	DWORD MsZipEncoder::FindLongestMatch(const DWORD index, DWORD candidate, const DWORD maxLength, const DWORD previousLength, DWORD& distance) const
+	{
+		const BYTE* const window = m_window.get();
+		const BYTE* const current = window + index;
+		const DWORD position = m_position + index - MSZIP_ENCODER_WINDOW_SIZE;
+
+		DWORD bestLength = previousLength;
+		DWORD chainLength = previousLength >= MSZIP_ENCODER_GOOD_LENGTH ? MSZIP_ENCODER_MAX_CHAIN >> 2 : MSZIP_ENCODER_MAX_CHAIN;
+		while (candidate != 0 && chainLength-- > 0) {
+			const DWORD candidateDistance = position - (candidate - 1);
+			if (candidateDistance > m_historySize + index - MSZIP_ENCODER_WINDOW_SIZE || candidateDistance > MSZIP_ENCODER_WINDOW_SIZE)
+				break;
+
+			const BYTE* const match = current - candidateDistance;
+
+			// Can only be better if it matches up to one byte past the best so far.
+			if (bestLength < maxLength && match[bestLength] == current[bestLength] && match[0] == current[0]) {
+				DWORD length = 0;
+				while (length < maxLength) {
+					unsigned __int64 left, right;
+					memcpy(&left, match + length, sizeof(left));
+					memcpy(&right, current + length, sizeof(right));
+					const unsigned __int64 difference = left ^ right;
+					if (difference != 0) {
+						unsigned long lowBit;
+						_BitScanForward64(&lowBit, difference);
+						length += lowBit >> 3;
+						break;
+					}
+
+					length += sizeof(unsigned __int64);
+				}
+
+				length = min(length, maxLength);
+				if (length > bestLength) {
+					bestLength = length;
+					distance = candidateDistance;
+					if (length >= MSZIP_ENCODER_NICE_LENGTH || length == maxLength)
+						break;
+				}
+			}
+
+			candidate = m_chain[(candidate - 1) & MSZIP_ENCODER_CHAIN_MASK];
+		}
+
+		return bestLength > previousLength && bestLength >= MSZIP_ENCODER_MIN_MATCH ? bestLength : 0;
+	}
+
+	__forceinline void MsZipEncoder::AddLiteral(const BYTE literal)
+	{
+		m_tokenLengths[m_tokenCount] = literal;
+		m_tokenDistances[m_tokenCount++] = 0;
+		m_literalFrequencies[literal]++;
+	}
+
+	__forceinline void MsZipEncoder::AddMatch(const DWORD length, const DWORD distance)
+	{
+		m_tokenLengths[m_tokenCount] = static_cast<WORD>(length);
+		m_tokenDistances[m_tokenCount++] = static_cast<WORD>(distance);
+		m_literalFrequencies[257 + s_lengthCodes.Code[length]]++;
+		m_distanceFrequencies[GetDistanceCode(distance)]++;
+	}
+
+	__forceinline void MsZipEncoder::WriteBits(const DWORD value, const DWORD count)
+	{
+		m_bitBuffer |= static_cast<unsigned __int64>(value) << m_bitCount;
+		m_bitCount += count;
+		if (m_bitCount >= 32) {
+			const DWORD word = static_cast<DWORD>(m_bitBuffer);
+			memcpy(m_output, &word, sizeof(word));
+			m_output += sizeof(word);
+			m_bitBuffer >>= 32;
+			m_bitCount -= 32;
+		}
+	}
+
+	void MsZipEncoder::FlushBits()
+	{
+		while (m_bitCount > 0) {
+			*m_output++ = static_cast<BYTE>(m_bitBuffer);
+			m_bitBuffer >>= 8;
+			m_bitCount = m_bitCount > 8 ? m_bitCount - 8 : 0;
+		}
+
+		m_bitBuffer = 0;
+	}
+
+	void MsZipEncoder::WriteStored(const BYTE* block, const DWORD size)
+	{
+		WriteBits(1, 1);
+		WriteBits(0, 2);
+		FlushBits();
+
+		const WORD length = static_cast<WORD>(size);
+		const WORD complement = static_cast<WORD>(~length);
+		memcpy(m_output, &length, sizeof(WORD));
+		memcpy(m_output + sizeof(WORD), &complement, sizeof(WORD));
+		memcpy(m_output + (sizeof(WORD) * 2), block, size);
+		m_output += (sizeof(WORD) * 2) + size;
+	}
+
+	void MsZipEncoder::WriteTokens(const BYTE* literalLengths, const WORD* literalCodes, const BYTE* distanceLengths, const WORD* distanceCodes)
+	{
+		for (DWORD i = 0; i < m_tokenCount; i++) {
+			const DWORD distance = m_tokenDistances[i];
+			if (distance == 0) {
+				const DWORD literal = m_tokenLengths[i];
+				WriteBits(literalCodes[literal], literalLengths[literal]);
+				continue;
+			}
+
+			const DWORD length = m_tokenLengths[i];
+			const DWORD lengthCode = s_lengthCodes.Code[length];
+			WriteBits(literalCodes[257 + lengthCode], literalLengths[257 + lengthCode]);
+			WriteBits(length - s_encoderLengthBase[lengthCode], s_encoderLengthExtra[lengthCode]);
+
+			const DWORD distanceCode = GetDistanceCode(distance);
+			WriteBits(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+			WriteBits(distance - s_encoderDistanceBase[distanceCode], s_encoderDistanceExtra[distanceCode]);
+		}
+
+		WriteBits(literalCodes[256], literalLengths[256]);
+	}
+
+	void MsZipEncoder::BuildLengths(const DWORD* frequencies, const DWORD count, const DWORD maxLength, BYTE* lengths)
+	{
+		memset(lengths, 0, count);
+
+		// Used symbols, by ascending frequency.
+		DWORD symbols[286];
+		DWORD values[286];
+		DWORD used = 0;
+		for (DWORD i = 0; i < count; i++) {
+			if (frequencies[i] > 0)
+				symbols[used++] = i;
+		}
+
+		if (used == 0)
+			return;
+
+		if (used == 1) {
+			lengths[symbols[0]] = 1;
+			return;
+		}
+
+		std::stable_sort(symbols, symbols + used, [frequencies](const DWORD left, const DWORD right) { return frequencies[left] < frequencies[right]; });
+		for (DWORD i = 0; i < used; i++)
+			values[i] = frequencies[symbols[i]];
+
+		// In-place minimum redundancy code lengths, Moffat and Katajainen.
+		// Leaves the length of the i-th least frequent symbol in 'values[i]'.
+		values[0] += values[1];
+		DWORD root = 0;
+		DWORD leaf = 2;
+		for (DWORD next = 1; next < used - 1; next++) {
+			if (leaf >= used || values[root] < values[leaf]) {
+				values[next] = values[root];
+				values[root++] = next;
+			}
+			else
+				values[next] = values[leaf++];
+
+			if (leaf >= used || (root < next && values[root] < values[leaf])) {
+				values[next] += values[root];
+				values[root++] = next;
+			}
+			else
+				values[next] += values[leaf++];
+		}
+
+		values[used - 2] = 0;
+		for (int next = static_cast<int>(used) - 3; next >= 0; next--)
+			values[next] = values[values[next]] + 1;
+
+		int available = 1;
+		int usedNodes = 0;
+		DWORD depth = 0;
+		int rootIndex = static_cast<int>(used) - 2;
+		int nextIndex = static_cast<int>(used) - 1;
+		while (available > 0) {
+			while (rootIndex >= 0 && values[rootIndex] == depth) {
+				usedNodes++;
+				rootIndex--;
+			}
+
+			while (available > usedNodes) {
+				values[nextIndex--] = depth;
+				available--;
+			}
+
+			available = usedNodes << 1;
+			depth++;
+			usedNodes = 0;
+		}
+
+		// Limiting the lengths, keeping the code complete. Each step moves a pair of
+		// codes up from the deepest level and gives a shorter code a longer sibling.
+		DWORD lengthCount[32]{ };
+		for (DWORD i = 0; i < used; i++)
+			lengthCount[values[i]]++;
+
+		for (DWORD length = 31; length > maxLength; length--) {
+			while (lengthCount[length] > 0) {
+				DWORD shorter = length - 2;
+				while (lengthCount[shorter] == 0)
+					shorter--;
+
+				lengthCount[length] -= 2;
+				lengthCount[length - 1]++;
+				lengthCount[shorter + 1] += 2;
+				lengthCount[shorter]--;
+			}
+		}
+
+		// Longest codes go to the least frequent symbols.
+		DWORD symbol = 0;
+		for (DWORD length = maxLength; length > 0; length--) {
+			for (DWORD i = 0; i < lengthCount[length]; i++)
+				lengths[symbols[symbol++]] = static_cast<BYTE>(length);
+		}
+	}
+
+	void MsZipEncoder::BuildCodes(const BYTE* lengths, const DWORD count, WORD* codes)
+	{
+		DWORD lengthCount[16]{ };
+		for (DWORD i = 0; i < count; i++)
+			lengthCount[lengths[i]]++;
+
+		lengthCount[0] = 0;
+		DWORD nextCode[16]{ };
+		for (DWORD length = 1; length < 16; length++)
+			nextCode[length] = (nextCode[length - 1] + lengthCount[length - 1]) << 1;
+
+		// Deflate writes codes starting with the most significant bit, we write bits starting with the least.
+		for (DWORD symbol = 0; symbol < count; symbol++) {
+			const DWORD length = lengths[symbol];
+			if (length == 0)
+				continue;
+
+			DWORD code = nextCode[length]++;
+			DWORD reversed = 0;
+			for (DWORD i = 0; i < length; i++) {
+				reversed = (reversed << 1) | (code & 1);
+				code >>= 1;
+			}
+
+			codes[symbol] = static_cast<WORD>(reversed);
+		}
+	}
+}
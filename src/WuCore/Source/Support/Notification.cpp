@@ -88,4 +88,84 @@ namespace WindowsUtils::Core
 	void WuNativeContext::NativeWriteInformation(const PMAPPED_INFORMATION_DATA infoData) const { m_writeInformationHook(infoData); }
 	void WuNativeContext::NativeWriteError(const WuException& exception) const { m_writeExHook(exception); }
 	void WuNativeContext::NativeWriteObject(const PVOID obj, const WriteOutputType type) const { m_writeObjectHook(obj, type); }
+
+	/*
+	*	~ Progress aggregator
+	*/
+
+	ProgressAggregator::ProgressAggregator(const WuNativeContext* context, const __uint64 totalSize, const DWORD totalItems, const DWORD containerCount, const DWORD interval)
+		: m_context(context), m_interval(interval), m_lastEmit(0), m_completedSize(0), m_completedItems(0), m_changeCount(0), m_emittedChangeCount(0),
+		m_state{ 0, totalSize, 0, totalItems, 0, containerCount }
+	{
+		InitializeSRWLock(&m_lock);
+	}
+
+	ProgressAggregator::~ProgressAggregator() { }
+
+	void ProgressAggregator::AddCompleted(const __uint64 size, const DWORD items)
+	{
+		InterlockedAdd64(&m_completedSize, static_cast<LONG64>(size));
+		InterlockedAdd(&m_completedItems, static_cast<LONG>(items));
+		InterlockedIncrement(&m_changeCount);
+	}
+
+	void ProgressAggregator::SetCompletedSize(const __uint64 size)
+	{
+		InterlockedExchange64(&m_completedSize, static_cast<LONG64>(size));
+		InterlockedIncrement(&m_changeCount);
+	}
+
+	void ProgressAggregator::SetCurrentItem(const WWuString& item)
+	{
+		AcquireSRWLockExclusive(&m_lock);
+		m_state.CurrentItem = item;
+		ReleaseSRWLockExclusive(&m_lock);
+
+		InterlockedIncrement(&m_changeCount);
+	}
+
+	void ProgressAggregator::SetContainer(const WWuString& container, const DWORD index)
+	{
+		AcquireSRWLockExclusive(&m_lock);
+		m_state.Container = container;
+		m_state.ContainerIndex = index;
+		ReleaseSRWLockExclusive(&m_lock);
+
+		InterlockedIncrement(&m_changeCount);
+	}
+
+	void ProgressAggregator::Emit()
+	{
+		if (InterlockedCompareExchange(&m_changeCount, 0, 0) == m_emittedChangeCount)
+			return;
+
+		if (m_lastEmit != 0 && GetTickCount64() - m_lastEmit < m_interval)
+			return;
+
+		Write();
+	}
+
+	void ProgressAggregator::Complete()
+	{
+		if (InterlockedCompareExchange(&m_changeCount, 0, 0) != m_emittedChangeCount)
+			Write();
+	}
+
+	void ProgressAggregator::Write()
+	{
+		// Reading the change count first, anything changing after it is written next time.
+		m_emittedChangeCount = InterlockedCompareExchange(&m_changeCount, 0, 0);
+
+		AcquireSRWLockShared(&m_lock);
+		PROGRESS_STATE state = m_state;
+		ReleaseSRWLockShared(&m_lock);
+
+		state.CompletedSize = static_cast<__uint64>(InterlockedCompareExchange64(&m_completedSize, 0, 0));
+		state.CompletedItems = static_cast<DWORD>(InterlockedCompareExchange(&m_completedItems, 0, 0));
+
+		// Building and writing outside the lock so producers don't wait on the host.
+		MAPPED_PROGRESS_DATA progressData = GetProgressData(state);
+		m_context->NativeWriteProgress(&progressData);
+		m_lastEmit = GetTickCount64();
+	}
 }
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/Cabinet/SourcePrefetcher.h"
+
+#include <io.h>
+#include <stdio.h>
+
+namespace WindowsUtils::Core
+{
+	SourcePrefetcher::SourcePrefetcher(std::vector<WWuString>&& paths)
+		: m_nextToRead(0), m_nextToOpen(0), m_closedCount(0), m_isCancelled(false), m_pool(static_cast<__uint64>(CAB_PREFETCH_WINDOW) * CAB_PREFETCH_MAX_READ)
+	{
+		InitializeSRWLock(&m_lock);
+		InitializeConditionVariable(&m_entryReady);
+		InitializeConditionVariable(&m_windowMoved);
+
+		m_entries.resize(paths.size());
+		for (size_t i = 0; i < paths.size(); i++) {
+			m_entries[i].Path = std::move(paths[i]);
+			m_entries[i].State = PrefetchState::Pending;
+		}
+
+		const size_t workerCount = min(static_cast<size_t>(CAB_PREFETCH_THREADS), m_entries.size());
+		for (size_t i = 0; i < workerCount; i++) {
+			DWORD threadId;
+			HANDLE worker = CreateThread(NULL, 0, PrefetchWorker, this, 0, &threadId);
+			if (worker == NULL)
+				break;
+
+			m_workers.push_back(worker);
+		}
+
+		// With at least one worker every file gets read, just with less ahead.
+		if (workerCount > 0 && m_workers.empty())
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+	}
+
+	SourcePrefetcher::~SourcePrefetcher()
+	{
+		AcquireSRWLockExclusive(&m_lock);
+		m_isCancelled = true;
+		ReleaseSRWLockExclusive(&m_lock);
+		WakeAllConditionVariable(&m_windowMoved);
+
+		if (!m_workers.empty()) {
+			WaitForMultipleObjects(static_cast<DWORD>(m_workers.size()), m_workers.data(), TRUE, INFINITE);
+			for (HANDLE worker : m_workers)
+				CloseHandle(worker);
+		}
+	}
+
+	bool SourcePrefetcher::IsPrefetchHandle(const INT_PTR handle) { return (handle & 3) == 2; }
+
+	INT_PTR SourcePrefetcher::OpenNext(USHORT* date, USHORT* time, USHORT* attributes, int* error)
+	{
+		if (m_nextToOpen >= m_entries.size()) {
+			*error = ERROR_NO_MORE_FILES;
+			return -1;
+		}
+
+		PREFETCH_ENTRY& entry = m_entries[m_nextToOpen++];
+
+		AcquireSRWLockExclusive(&m_lock);
+		while (entry.State == PrefetchState::Pending)
+			SleepConditionVariableSRW(&m_entryReady, &m_lock, INFINITE, 0);
+
+		ReleaseSRWLockExclusive(&m_lock);
+
+		if (entry.State == PrefetchState::Failed) {
+			*error = entry.ErrorCode;
+			MoveWindow();
+
+			return -1;
+		}
+
+		*date = entry.Date;
+		*time = entry.Time;
+		*attributes = entry.Attributes;
+
+		return reinterpret_cast<INT_PTR>(&entry) | 2;
+	}
+
+	UINT SourcePrefetcher::Read(const INT_PTR handle, void* buffer, const UINT count)
+	{
+		PPREFETCH_ENTRY entry = FromHandle(handle);
+
+		UINT copied = 0;
+		if (entry->Position < entry->PrefixSize) {
+			copied = static_cast<UINT>(min(static_cast<__uint64>(count), entry->PrefixSize - entry->Position));
+			RtlCopyMemory(buffer, entry->Buffer->Data.get() + entry->Position, copied);
+			entry->Position += copied;
+		}
+
+		if (copied < count && entry->Handle) {
+			DWORD bytesRead;
+			if (!ReadFile(entry->Handle->Get(), reinterpret_cast<BYTE*>(buffer) + copied, count - copied, &bytesRead, nullptr))
+				return copied > 0 ? copied : static_cast<UINT>(-1);
+
+			entry->Position += bytesRead;
+			copied += bytesRead;
+		}
+
+		return copied;
+	}
+
+	long SourcePrefetcher::Seek(const INT_PTR handle, const long distance, const int origin)
+	{
+		PPREFETCH_ENTRY entry = FromHandle(handle);
+
+		__int64 target;
+		switch (origin) {
+			case SEEK_SET:
+				target = distance;
+				break;
+
+			case SEEK_CUR:
+				target = static_cast<__int64>(entry->Position) + distance;
+				break;
+
+			case SEEK_END:
+				target = static_cast<__int64>(entry->Size) + distance;
+				break;
+
+			default:
+				return -1;
+		}
+
+		if (target < 0 || target > MAXLONG)
+			return -1;
+
+		// The handle stays past the prefix, reads before it come from the buffer.
+		if (entry->Handle) {
+			LARGE_INTEGER filePointer;
+			filePointer.QuadPart = max(target, static_cast<__int64>(entry->PrefixSize));
+			if (!SetFilePointerEx(entry->Handle->Get(), filePointer, nullptr, FILE_BEGIN))
+				return -1;
+		}
+
+		entry->Position = static_cast<__uint64>(target);
+
+		return static_cast<long>(target);
+	}
+
+	int SourcePrefetcher::Close(const INT_PTR handle)
+	{
+		PPREFETCH_ENTRY entry = FromHandle(handle);
+		m_pool.Release(std::move(entry->Buffer));
+		entry->Handle.reset();
+		MoveWindow();
+
+		return 0;
+	}
+
+	DWORD WINAPI SourcePrefetcher::PrefetchWorker(LPVOID params)
+	{
+		auto prefetcher = reinterpret_cast<SourcePrefetcher*>(params);
+		while (true) {
+			AcquireSRWLockExclusive(&prefetcher->m_lock);
+			while (!prefetcher->m_isCancelled && prefetcher->m_nextToRead < prefetcher->m_entries.size()
+				&& prefetcher->m_nextToRead >= prefetcher->m_closedCount + CAB_PREFETCH_WINDOW)
+				SleepConditionVariableSRW(&prefetcher->m_windowMoved, &prefetcher->m_lock, INFINITE, 0);
+
+			if (prefetcher->m_isCancelled || prefetcher->m_nextToRead >= prefetcher->m_entries.size()) {
+				ReleaseSRWLockExclusive(&prefetcher->m_lock);
+				break;
+			}
+
+			PREFETCH_ENTRY& entry = prefetcher->m_entries[prefetcher->m_nextToRead++];
+			ReleaseSRWLockExclusive(&prefetcher->m_lock);
+
+			// Errors are reported when the file is opened, FCI says which one it was.
+			PrefetchState state = PrefetchState::Ready;
+			try {
+				prefetcher->Prefetch(entry);
+			}
+			catch (const WuException& ex) {
+				entry.ErrorCode = ex.ErrorCode();
+				state = PrefetchState::Failed;
+			}
+			catch (...) {
+				entry.ErrorCode = ERROR_UNHANDLED_EXCEPTION;
+				state = PrefetchState::Failed;
+			}
+
+			if (state == PrefetchState::Failed) {
+				prefetcher->m_pool.Release(std::move(entry.Buffer));
+				entry.Handle.reset();
+			}
+
+			AcquireSRWLockExclusive(&prefetcher->m_lock);
+			entry.State = state;
+			ReleaseSRWLockExclusive(&prefetcher->m_lock);
+			WakeAllConditionVariable(&prefetcher->m_entryReady);
+		}
+
+		return 0;
+	}
+
+	void SourcePrefetcher::Prefetch(PREFETCH_ENTRY& entry)
+	{
+		entry.Handle = std::make_unique<FileHandle>(entry.Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		// Same as 'FciGetOpenInfo' used to, creation time in local time.
+		FILETIME fileTime;
+		BY_HANDLE_FILE_INFORMATION fileInfo;
+		if (!GetFileInformationByHandle(entry.Handle->Get(), &fileInfo))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"GetFileInformationByHandle", WriteErrorCategory::ReadError);
+
+		if (!FileTimeToLocalFileTime(&fileInfo.ftCreationTime, &fileTime) || !FileTimeToDosDateTime(&fileTime, &entry.Date, &entry.Time))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"FileTimeToDosDateTime", WriteErrorCategory::InvalidResult);
+
+		entry.Attributes = static_cast<USHORT>(fileInfo.dwFileAttributes & (_A_RDONLY | _A_HIDDEN | _A_SYSTEM | _A_ARCH));
+		entry.Size = (static_cast<__uint64>(fileInfo.nFileSizeHigh) << 32) | fileInfo.nFileSizeLow;
+
+		const DWORD prefixSize = static_cast<DWORD>(min(entry.Size, static_cast<__uint64>(CAB_PREFETCH_MAX_READ)));
+		if (prefixSize > 0) {
+			entry.Buffer = m_pool.Acquire(prefixSize, false);
+			if (!entry.Buffer)
+				_WU_RAISE_NATIVE_EXCEPTION(ERROR_CANCELLED, L"SourcePrefetcher::Prefetch", WriteErrorCategory::OperationStopped);
+
+			while (entry.PrefixSize < prefixSize) {
+				DWORD bytesRead;
+				if (!ReadFile(entry.Handle->Get(), entry.Buffer->Data.get() + entry.PrefixSize, prefixSize - entry.PrefixSize, &bytesRead, nullptr))
+					_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"ReadFile", WriteErrorCategory::ReadError);
+
+				if (bytesRead == 0)
+					break;
+
+				entry.PrefixSize += bytesRead;
+			}
+		}
+
+		// Read whole, the handle isn't needed anymore.
+		if (entry.Size <= CAB_PREFETCH_MAX_READ)
+			entry.Handle.reset();
+	}
+
+	void SourcePrefetcher::MoveWindow()
+	{
+		AcquireSRWLockExclusive(&m_lock);
+		m_closedCount++;
+		ReleaseSRWLockExclusive(&m_lock);
+		WakeAllConditionVariable(&m_windowMoved);
+	}
+
+	SourcePrefetcher::PPREFETCH_ENTRY SourcePrefetcher::FromHandle(const INT_PTR handle)
+	{
+		return reinterpret_cast<PPREFETCH_ENTRY>(handle & ~static_cast<INT_PTR>(3));
+	}
+}
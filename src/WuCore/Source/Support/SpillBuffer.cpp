@@ -0,0 +1,112 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/SpillBuffer.h"
+
+namespace WindowsUtils::Core
+{
+	SpillBuffer::SpillBuffer(const WWuString& directory, volatile LONG64* memoryBudget)
+		: m_directory(directory), m_memoryBudget(memoryBudget), m_lastChunkSize(SPILL_BUFFER_CHUNK_SIZE), m_size(0) { }
+
+	SpillBuffer::~SpillBuffer()
+	{
+		if (!m_chunks.empty())
+			InterlockedAdd64(m_memoryBudget, static_cast<LONG64>(m_chunks.size()) * SPILL_BUFFER_CHUNK_SIZE);
+	}
+
+	void SpillBuffer::Write(const void* data, DWORD size)
+	{
+		auto source = reinterpret_cast<const BYTE*>(data);
+		m_size += size;
+		while (size > 0 && !m_spillFile) {
+			if (m_lastChunkSize == SPILL_BUFFER_CHUNK_SIZE && !TryAddChunk()) {
+				CreateSpillFile();
+				break;
+			}
+
+			const DWORD count = min(size, SPILL_BUFFER_CHUNK_SIZE - m_lastChunkSize);
+			memcpy(m_chunks.back().get() + m_lastChunkSize, source, count);
+			m_lastChunkSize += count;
+			source += count;
+			size -= count;
+		}
+
+		if (size > 0) {
+			DWORD bytesWritten;
+			if (!WriteFile(m_spillFile->Get(), source, size, &bytesWritten, nullptr) || bytesWritten != size)
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+		}
+	}
+
+	const __uint64 SpillBuffer::Size() const { return m_size; }
+	const bool SpillBuffer::IsSpilled() const { return static_cast<bool>(m_spillFile); }
+
+	void SpillBuffer::CopyTo(const HANDLE file)
+	{
+		DWORD bytesWritten;
+		for (size_t i = 0; i < m_chunks.size(); i++) {
+			const DWORD count = i == m_chunks.size() - 1 ? m_lastChunkSize : SPILL_BUFFER_CHUNK_SIZE;
+			if (!WriteFile(file, m_chunks[i].get(), count, &bytesWritten, nullptr) || bytesWritten != count)
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+		}
+
+		if (!m_spillFile)
+			return;
+
+		LARGE_INTEGER start{ };
+		if (!SetFilePointerEx(m_spillFile->Get(), start, nullptr, FILE_BEGIN))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"SetFilePointerEx", WriteErrorCategory::ReadError);
+
+		// Not taken from the budget, it only lives during the copy.
+		auto buffer = std::make_unique<BYTE[]>(SPILL_BUFFER_CHUNK_SIZE);
+		DWORD bytesRead;
+		do {
+			if (!ReadFile(m_spillFile->Get(), buffer.get(), SPILL_BUFFER_CHUNK_SIZE, &bytesRead, nullptr))
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"ReadFile", WriteErrorCategory::ReadError);
+
+			if (bytesRead > 0 && (!WriteFile(file, buffer.get(), bytesRead, &bytesWritten, nullptr) || bytesWritten != bytesRead))
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+
+		} while (bytesRead > 0);
+
+		// Leaving it where it was, so we can keep writing to it.
+		if (!SetFilePointerEx(m_spillFile->Get(), start, nullptr, FILE_END))
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"SetFilePointerEx", WriteErrorCategory::ReadError);
+	}
+
+	bool SpillBuffer::TryAddChunk()
+	{
+		if (InterlockedAdd64(m_memoryBudget, -static_cast<LONG64>(SPILL_BUFFER_CHUNK_SIZE)) < 0) {
+			InterlockedAdd64(m_memoryBudget, SPILL_BUFFER_CHUNK_SIZE);
+			return false;
+		}
+
+		try {
+			m_chunks.push_back(std::make_unique<BYTE[]>(SPILL_BUFFER_CHUNK_SIZE));
+		}
+		catch (const std::bad_alloc&) {
+			InterlockedAdd64(m_memoryBudget, SPILL_BUFFER_CHUNK_SIZE);
+			return false;
+		}
+
+		m_lastChunkSize = 0;
+
+		return true;
+	}
+
+	void SpillBuffer::CreateSpillFile()
+	{
+		WCHAR tempFileName[MAX_PATH + 1];
+		if (GetTempFileName(m_directory.Raw(), L"WuS", 0, tempFileName) == 0)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"GetTempFileName", WriteErrorCategory::OpenError);
+
+		// 'GetTempFileName' creates the file, we open it again to be deleted on close.
+		try {
+			m_spillFile = std::make_unique<FileHandle>(WWuString(tempFileName), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS,
+				FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		}
+		catch (...) {
+			DeleteFile(tempFileName);
+			throw;
+		}
+	}
+}
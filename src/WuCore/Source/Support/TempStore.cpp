@@ -0,0 +1,291 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/TempStore.h"
+
+namespace WindowsUtils::Core
+{
+	// A ':' can't be part of a file name, so these never reach the file system by accident.
+	static constexpr char s_namePrefix[] = "WuTemp:";
+
+	TempStore::TempStore(const WWuString& spillDirectory, const __uint64 memoryBudget)
+		: m_spillDirectory(spillDirectory), m_memoryBudget(memoryBudget), m_allocatedSize(0), m_nextId(0) { }
+
+	TempStore::~TempStore() { }
+
+	WuString TempStore::CreateName()
+	{
+		const DWORD id = m_nextId++;
+		m_streams.emplace(id, std::make_unique<TEMP_STORE_STREAM>());
+
+		return WuString::Format("%s%u", s_namePrefix, id);
+	}
+
+	bool TempStore::IsStoreName(const char* name) const
+	{
+		DWORD id;
+		return TryGetId(name, id);
+	}
+
+	bool TempStore::IsStoreHandle(const INT_PTR handle) { return (handle & 1) != 0; }
+
+	INT_PTR TempStore::Open(const char* name, const bool create)
+	{
+		DWORD id;
+		if (!TryGetId(name, id))
+			return -1;
+
+		auto stream = m_streams.find(id);
+		if (stream == m_streams.end()) {
+			if (!create)
+				return -1;
+
+			stream = m_streams.emplace(id, std::make_unique<TEMP_STORE_STREAM>()).first;
+		}
+
+		auto handle = new TEMP_STORE_HANDLE{ stream->second.get(), 0 };
+
+		return reinterpret_cast<INT_PTR>(handle) | 1;
+	}
+
+	UINT TempStore::Read(const INT_PTR handle, void* buffer, const UINT count)
+	{
+		PTEMP_STORE_HANDLE storeHandle = FromHandle(handle);
+		try {
+			const UINT bytesRead = ReadAt(*storeHandle->Stream, storeHandle->Position, buffer, count);
+			storeHandle->Position += bytesRead;
+
+			return bytesRead;
+		}
+		catch (const WuException&) {
+			return static_cast<UINT>(-1);
+		}
+	}
+
+	UINT TempStore::Write(const INT_PTR handle, const void* buffer, const UINT count)
+	{
+		PTEMP_STORE_HANDLE storeHandle = FromHandle(handle);
+		try {
+			WriteAt(*storeHandle->Stream, storeHandle->Position, buffer, count);
+			storeHandle->Position += count;
+
+			return count;
+		}
+		catch (const WuException&) {
+			return static_cast<UINT>(-1);
+		}
+	}
+
+	long TempStore::Seek(const INT_PTR handle, const long distance, const int origin)
+	{
+		PTEMP_STORE_HANDLE storeHandle = FromHandle(handle);
+
+		LONG64 position;
+		switch (origin) {
+			case SEEK_SET:
+				position = distance;
+				break;
+
+			case SEEK_CUR:
+				position = static_cast<LONG64>(storeHandle->Position) + distance;
+				break;
+
+			case SEEK_END:
+				position = static_cast<LONG64>(storeHandle->Stream->Size) + distance;
+				break;
+
+			default:
+				return -1;
+		}
+
+		// FCI works with 'long' offsets, it never gets past that.
+		if (position < 0 || position > MAXLONG)
+			return -1;
+
+		storeHandle->Position = static_cast<__uint64>(position);
+
+		return static_cast<long>(position);
+	}
+
+	int TempStore::Close(const INT_PTR handle)
+	{
+		delete FromHandle(handle);
+
+		return 0;
+	}
+
+	int TempStore::Delete(const char* name)
+	{
+		DWORD id;
+		if (!TryGetId(name, id))
+			return -1;
+
+		auto stream = m_streams.find(id);
+		if (stream == m_streams.end())
+			return -1;
+
+		ReleaseChunks(*stream->second);
+		m_streams.erase(stream);
+
+		return 0;
+	}
+
+	bool TempStore::TryGetId(const char* name, DWORD& id) const
+	{
+		const size_t prefixLength = ARRAYSIZE(s_namePrefix) - 1;
+		if (name == nullptr || strncmp(name, s_namePrefix, prefixLength) != 0)
+			return false;
+
+		char* end;
+		const char* digits = name + prefixLength;
+		const unsigned long value = strtoul(digits, &end, 10);
+		if (end == digits || *end != '\0')
+			return false;
+
+		id = static_cast<DWORD>(value);
+
+		return true;
+	}
+
+	bool TempStore::TryReserve(TEMP_STORE_STREAM& stream, const __uint64 size)
+	{
+		const size_t chunkCount = static_cast<size_t>((size + TEMP_STORE_CHUNK_SIZE - 1) / TEMP_STORE_CHUNK_SIZE);
+		while (stream.Chunks.size() < chunkCount) {
+			std::unique_ptr<BYTE[]> chunk;
+			if (!m_pool.empty()) {
+				chunk = std::move(m_pool.back());
+				m_pool.pop_back();
+			}
+			else {
+				if (m_allocatedSize + TEMP_STORE_CHUNK_SIZE > m_memoryBudget)
+					return false;
+
+				try {
+					chunk = std::make_unique<BYTE[]>(TEMP_STORE_CHUNK_SIZE);
+				}
+				catch (const std::bad_alloc&) {
+					return false;
+				}
+
+				m_allocatedSize += TEMP_STORE_CHUNK_SIZE;
+			}
+
+			// Pooled chunks have data from other streams, and seeking past the end leaves a gap that must read as zeros.
+			RtlZeroMemory(chunk.get(), TEMP_STORE_CHUNK_SIZE);
+			stream.Chunks.push_back(std::move(chunk));
+		}
+
+		return true;
+	}
+
+	void TempStore::Spill(TEMP_STORE_STREAM& stream)
+	{
+		WCHAR tempFileName[MAX_PATH + 1];
+		if (GetTempFileName(m_spillDirectory.Raw(), L"WuC", 0, tempFileName) == 0)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"GetTempFileName", WriteErrorCategory::OpenError);
+
+		// 'GetTempFileName' creates the file, we open it again to be deleted on close.
+		try {
+			stream.SpillFile = std::make_unique<FileHandle>(WWuString(tempFileName), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS,
+				FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+		}
+		catch (...) {
+			DeleteFile(tempFileName);
+			throw;
+		}
+
+		DWORD bytesWritten;
+		__uint64 remaining = stream.Size;
+		for (const auto& chunk : stream.Chunks) {
+			if (remaining == 0)
+				break;
+
+			const DWORD count = static_cast<DWORD>(min(remaining, static_cast<__uint64>(TEMP_STORE_CHUNK_SIZE)));
+			if (!WriteFile(stream.SpillFile->Get(), chunk.get(), count, &bytesWritten, nullptr) || bytesWritten != count)
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+
+			remaining -= count;
+		}
+
+		ReleaseChunks(stream);
+	}
+
+	void TempStore::ReleaseChunks(TEMP_STORE_STREAM& stream)
+	{
+		for (auto& chunk : stream.Chunks)
+			m_pool.push_back(std::move(chunk));
+
+		stream.Chunks.clear();
+	}
+
+	UINT TempStore::ReadAt(TEMP_STORE_STREAM& stream, const __uint64 position, void* buffer, const UINT count)
+	{
+		if (position >= stream.Size || count == 0)
+			return 0;
+
+		const UINT available = static_cast<UINT>(min(static_cast<__uint64>(count), stream.Size - position));
+		if (stream.SpillFile) {
+			OVERLAPPED overlapped{ };
+			overlapped.Offset = static_cast<DWORD>(position);
+			overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+			DWORD bytesRead;
+			if (!ReadFile(stream.SpillFile->Get(), buffer, available, &bytesRead, &overlapped))
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"ReadFile", WriteErrorCategory::ReadError);
+
+			return bytesRead;
+		}
+
+		auto destination = reinterpret_cast<BYTE*>(buffer);
+		__uint64 current = position;
+		UINT remaining = available;
+		while (remaining > 0) {
+			const DWORD chunkOffset = static_cast<DWORD>(current % TEMP_STORE_CHUNK_SIZE);
+			const UINT chunkCount = min(remaining, TEMP_STORE_CHUNK_SIZE - chunkOffset);
+			memcpy(destination, stream.Chunks[static_cast<size_t>(current / TEMP_STORE_CHUNK_SIZE)].get() + chunkOffset, chunkCount);
+			destination += chunkCount;
+			current += chunkCount;
+			remaining -= chunkCount;
+		}
+
+		return available;
+	}
+
+	void TempStore::WriteAt(TEMP_STORE_STREAM& stream, const __uint64 position, const void* buffer, const UINT count)
+	{
+		const __uint64 end = position + count;
+		if (!stream.SpillFile && !TryReserve(stream, end))
+			Spill(stream);
+
+		if (stream.SpillFile) {
+			OVERLAPPED overlapped{ };
+			overlapped.Offset = static_cast<DWORD>(position);
+			overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+			DWORD bytesWritten;
+			if (!WriteFile(stream.SpillFile->Get(), buffer, count, &bytesWritten, &overlapped) || bytesWritten != count)
+				_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"WriteFile", WriteErrorCategory::WriteError);
+
+			stream.Size = max(stream.Size, end);
+			return;
+		}
+
+		auto source = reinterpret_cast<const BYTE*>(buffer);
+		__uint64 current = position;
+		UINT remaining = count;
+		while (remaining > 0) {
+			const DWORD chunkOffset = static_cast<DWORD>(current % TEMP_STORE_CHUNK_SIZE);
+			const UINT chunkCount = min(remaining, TEMP_STORE_CHUNK_SIZE - chunkOffset);
+			memcpy(stream.Chunks[static_cast<size_t>(current / TEMP_STORE_CHUNK_SIZE)].get() + chunkOffset, source, chunkCount);
+			source += chunkCount;
+			current += chunkCount;
+			remaining -= chunkCount;
+		}
+
+		stream.Size = max(stream.Size, end);
+	}
+
+	TempStore::PTEMP_STORE_HANDLE TempStore::FromHandle(const INT_PTR handle)
+	{
+		return reinterpret_cast<PTEMP_STORE_HANDLE>(handle & ~static_cast<INT_PTR>(1));
+	}
+}
@@ -0,0 +1,77 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/TimerWheel.h"
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Timer wheel ~
+	*/
+
+	TimerWheel::TimerWheel(const DWORD slotCount, const DWORD tickMilliseconds)
+		: m_slots(max(slotCount, 1)), m_tick(max(tickMilliseconds, 1)), m_currentTick(GetTickCount64() / max(tickMilliseconds, 1)), m_nextDue(MAXULONGLONG), m_count(0)
+	{
+		InitializeSRWLock(&m_lock);
+	}
+
+	bool TimerWheel::Schedule(const ULONGLONG due, const ULONG_PTR key, const DWORD kind, const DWORD sequence)
+	{
+		AcquireSRWLockExclusive(&m_lock);
+
+		// Timers already due go in the current slot, the next 'Advance' fires them.
+		const ULONGLONG dueTick = max(due / m_tick, m_currentTick);
+		m_slots[dueTick % m_slots.size()].push_back({ due, key, kind, sequence });
+		m_count++;
+
+		const bool isNext = due < m_nextDue;
+		if (isNext)
+			m_nextDue = due;
+
+		ReleaseSRWLockExclusive(&m_lock);
+
+		return isNext;
+	}
+
+	DWORD TimerWheel::Advance(const ULONGLONG now, std::vector<TIMER_WHEEL_ENTRY>& expired)
+	{
+		AcquireSRWLockExclusive(&m_lock);
+
+		// Past one turn every slot has been through, we just look at all of them once.
+		const ULONGLONG nowTick = now / m_tick;
+		const ULONGLONG lastTick = min(nowTick, m_currentTick + m_slots.size() - 1);
+		for (ULONGLONG tick = m_currentTick; tick <= lastTick && m_count > 0; tick++) {
+			auto& slot = m_slots[tick % m_slots.size()];
+			for (size_t i = 0; i < slot.size();) {
+				if (slot[i].Due <= now) {
+					expired.push_back(slot[i]);
+					slot[i] = slot.back();
+					slot.pop_back();
+					m_count--;
+				}
+				else
+					i++;
+			}
+		}
+
+		m_currentTick = nowTick;
+
+		// The first slot ahead with a timer due in this turn has the next one. Otherwise it's the earliest of all.
+		m_nextDue = MAXULONGLONG;
+		for (ULONGLONG tick = nowTick; tick < nowTick + m_slots.size() && m_count > 0; tick++) {
+			const auto& slot = m_slots[tick % m_slots.size()];
+			for (const TIMER_WHEEL_ENTRY& entry : slot)
+				m_nextDue = min(m_nextDue, entry.Due);
+
+			if (m_nextDue / m_tick <= tick)
+				break;
+		}
+
+		const ULONGLONG nextDue = m_nextDue;
+		ReleaseSRWLockExclusive(&m_lock);
+
+		if (nextDue == MAXULONGLONG)
+			return INFINITE;
+
+		return nextDue > now ? static_cast<DWORD>(min(nextDue - now, static_cast<ULONGLONG>(INFINITE - 1))) : 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "../../pch.h"
+
+#include "../../Headers/Support/WriteBackQueue.h"
+
+namespace WindowsUtils::Core
+{
+	/*
+	*	~ Write-back queue ~
+	*/
+
+	WriteBackQueue::WriteBackQueue(const DWORD bufferCount, const DWORD bufferSize)
+		: m_bufferSize(bufferSize), m_fillingCount(0), m_isStopping(false),
+		m_freeSemaphore{ CreateSemaphore(nullptr, 0, MAXLONG, nullptr), true },
+		m_queuedEvent{ CreateEvent(nullptr, FALSE, FALSE, nullptr), true },
+		m_writtenEvent{ CreateEvent(nullptr, FALSE, FALSE, nullptr), true },
+		m_error(ERROR_SUCCESS), m_writer(nullptr)
+	{
+		InitializeSRWLock(&m_lock);
+
+		if (m_freeSemaphore.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateSemaphore", WriteErrorCategory::ResourceUnavailable);
+
+		if (m_queuedEvent.Get() == NULL || m_writtenEvent.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateEvent", WriteErrorCategory::ResourceUnavailable);
+
+		for (DWORD i = 0; i < max(bufferCount, 1); i++)
+			ReleaseBuffer(CreateBuffer());
+
+		DWORD threadId;
+		m_writer = CreateThread(nullptr, 0, WriterThread, this, 0, &threadId);
+		if (m_writer == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateThread", WriteErrorCategory::ResourceUnavailable);
+	}
+
+	WriteBackQueue::~WriteBackQueue()
+	{
+		// The writer drains the queue before leaving.
+		AcquireSRWLockExclusive(&m_lock);
+		m_isStopping = true;
+		ReleaseSRWLockExclusive(&m_lock);
+
+		SetEvent(m_queuedEvent.Get());
+		WaitForSingleObject(m_writer, INFINITE);
+		CloseHandle(m_writer);
+	}
+
+	void WriteBackQueue::Write(WriteBackFile& file, const BYTE* data, DWORD size)
+	{
+		ThrowIfFailed();
+
+		while (size > 0) {
+			if (file.m_current == nullptr) {
+				file.m_current = AcquireBuffer();
+				file.m_current->File = &file;
+				file.m_current->Size = 0;
+			}
+
+			PWRITE_BACK_BUFFER buffer = file.m_current;
+			const DWORD count = min(size, m_bufferSize - buffer->Size);
+			memcpy(buffer->Data.get() + buffer->Size, data, count);
+			buffer->Size += count;
+			data += count;
+			size -= count;
+
+			if (buffer->Size == m_bufferSize)
+				Submit(file);
+		}
+	}
+
+	void WriteBackQueue::Flush(WriteBackFile& file)
+	{
+		if (file.m_current != nullptr)
+			Submit(file);
+
+		WaitFile(file);
+		ThrowIfFailed();
+	}
+
+	PWRITE_BACK_BUFFER WriteBackQueue::CreateBuffer()
+	{
+		auto buffer = std::make_unique<WRITE_BACK_BUFFER>();
+		*(&buffer->Event) = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+		if (buffer->Event.Get() == NULL)
+			_WU_RAISE_NATIVE_EXCEPTION(GetLastError(), L"CreateEvent", WriteErrorCategory::ResourceUnavailable);
+
+		buffer->Data = std::make_unique<BYTE[]>(m_bufferSize);
+		m_buffers.push_back(std::move(buffer));
+
+		return m_buffers.back().get();
+	}
+
+	PWRITE_BACK_BUFFER WriteBackQueue::AcquireBuffer()
+	{
+		// Every buffer is being filled by an open file, so none is coming back.
+		// This only happens with files sharing ranges of the source, and the pool grows by one.
+		if (m_fillingCount == m_buffers.size()) {
+			m_fillingCount++;
+			return CreateBuffer();
+		}
+
+		WaitForSingleObject(m_freeSemaphore.Get(), INFINITE);
+
+		AcquireSRWLockExclusive(&m_lock);
+		PWRITE_BACK_BUFFER buffer = m_free.front();
+		m_free.pop_front();
+		ReleaseSRWLockExclusive(&m_lock);
+
+		m_fillingCount++;
+
+		return buffer;
+	}
+
+	void WriteBackQueue::ReleaseBuffer(PWRITE_BACK_BUFFER buffer)
+	{
+		AcquireSRWLockExclusive(&m_lock);
+		m_free.push_back(buffer);
+		ReleaseSRWLockExclusive(&m_lock);
+
+		ReleaseSemaphore(m_freeSemaphore.Get(), 1, nullptr);
+	}
+
+	void WriteBackQueue::Submit(WriteBackFile& file)
+	{
+		PWRITE_BACK_BUFFER buffer = file.m_current;
+		file.m_current = nullptr;
+		m_fillingCount--;
+
+		ULARGE_INTEGER offset;
+		offset.QuadPart = file.m_offset;
+		RtlZeroMemory(&buffer->Overlapped, sizeof(OVERLAPPED));
+		buffer->Overlapped.Offset      = offset.LowPart;
+		buffer->Overlapped.OffsetHigh  = offset.HighPart;
+		buffer->Overlapped.hEvent      = buffer->Event.Get();
+		file.m_offset += buffer->Size;
+
+		InterlockedIncrement(&file.m_pending);
+
+		AcquireSRWLockExclusive(&m_lock);
+		m_queued.push_back(buffer);
+		ReleaseSRWLockExclusive(&m_lock);
+
+		SetEvent(m_queuedEvent.Get());
+	}
+
+	void WriteBackQueue::WaitFile(WriteBackFile& file)
+	{
+		while (InterlockedCompareExchange(&file.m_pending, 0, 0) > 0)
+			WaitForSingleObject(m_writtenEvent.Get(), INFINITE);
+	}
+
+	void WriteBackQueue::ThrowIfFailed()
+	{
+		const LONG error = InterlockedCompareExchange(&m_error, 0, 0);
+		if (error != ERROR_SUCCESS)
+			_WU_RAISE_NATIVE_EXCEPTION(static_cast<DWORD>(error), L"WriteFile", WriteErrorCategory::WriteError);
+	}
+
+	void WriteBackQueue::IssueWrite(PWRITE_BACK_BUFFER buffer, std::deque<PWRITE_BACK_BUFFER>& inFlight)
+	{
+		// Once a write fails, the files being extracted are going away, so we don't bother writing the rest.
+		if (InterlockedCompareExchange(&m_error, 0, 0) != ERROR_SUCCESS) {
+			CompleteWrite(buffer, ERROR_SUCCESS);
+			return;
+		}
+
+		// Writes completing synchronously also signal the event, we get the result the same way.
+		if (!WriteFile(buffer->File->m_handle.Get(), buffer->Data.get(), buffer->Size, nullptr, &buffer->Overlapped)) {
+			const DWORD error = GetLastError();
+			if (error != ERROR_IO_PENDING) {
+				CompleteWrite(buffer, error);
+				return;
+			}
+		}
+
+		inFlight.push_back(buffer);
+	}
+
+	void WriteBackQueue::CompleteWrite(PWRITE_BACK_BUFFER buffer, DWORD error)
+	{
+		if (error != ERROR_SUCCESS)
+			InterlockedCompareExchange(&m_error, static_cast<LONG>(error), ERROR_SUCCESS);
+
+		// The file can be destroyed as soon as its pending count reaches zero.
+		WriteBackFile* file = buffer->File;
+		ReleaseBuffer(buffer);
+		InterlockedDecrement(&file->m_pending);
+		SetEvent(m_writtenEvent.Get());
+	}
+
+	DWORD WINAPI WriteBackQueue::WriterThread(LPVOID params)
+	{
+		auto queue = reinterpret_cast<WriteBackQueue*>(params);
+
+		// Writes are issued as soon as buffers are queued, and completed in order.
+		std::deque<PWRITE_BACK_BUFFER> inFlight;
+		while (true) {
+			PWRITE_BACK_BUFFER buffer = nullptr;
+			AcquireSRWLockExclusive(&queue->m_lock);
+			if (!queue->m_queued.empty()) {
+				buffer = queue->m_queued.front();
+				queue->m_queued.pop_front();
+			}
+
+			const bool isStopping = queue->m_isStopping;
+			ReleaseSRWLockExclusive(&queue->m_lock);
+
+			if (buffer != nullptr) {
+				queue->IssueWrite(buffer, inFlight);
+				continue;
+			}
+
+			if (inFlight.empty()) {
+				if (isStopping)
+					break;
+
+				WaitForSingleObject(queue->m_queuedEvent.Get(), INFINITE);
+				continue;
+			}
+
+			// Waiting for the oldest write, or for a new buffer to issue.
+			PWRITE_BACK_BUFFER oldest = inFlight.front();
+			HANDLE waitHandles[2] = { oldest->Overlapped.hEvent, queue->m_queuedEvent.Get() };
+			if (WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1)
+				continue;
+
+			inFlight.pop_front();
+
+			DWORD error = ERROR_SUCCESS;
+			DWORD bytesWritten;
+			if (!GetOverlappedResult(oldest->File->m_handle.Get(), &oldest->Overlapped, &bytesWritten, TRUE))
+				error = GetLastError();
+			else if (bytesWritten != oldest->Size)
+				error = ERROR_WRITE_FAULT;
+
+			queue->CompleteWrite(oldest, error);
+		}
+
+		return 0;
+	}
+
+
+	/*
+	*	~ Write-back file ~
+	*/
+
+	WriteBackFile::WriteBackFile(WriteBackQueue& queue, const WWuString& path, const __uint64 size)
+		: m_queue(queue), m_handle(path, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr),
+		m_offset(0), m_current(nullptr), m_pending(0)
+	{
+		// Reserving the clusters up front keeps the file contiguous. It's only a hint, the file grows as written either way.
+		if (size > 0) {
+			FILE_ALLOCATION_INFO allocationInfo{ };
+			allocationInfo.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+			SetFileInformationByHandle(m_handle.Get(), FileAllocationInfo, &allocationInfo, sizeof(FILE_ALLOCATION_INFO));
+		}
+	}
+
+	WriteBackFile::~WriteBackFile()
+	{
+		if (m_current != nullptr) {
+			m_queue.m_fillingCount--;
+			m_queue.ReleaseBuffer(m_current);
+			m_current = nullptr;
+		}
+
+		m_queue.WaitFile(*this);
+	}
+}
@@ -11,16 +11,85 @@
 namespace WindowsUtils::Wrappers
 {
 	// Expand-Cabinet
-	void ContainersWrapper::ExpandArchiveFile(String^ path, String^ destination, ArchiveFileType type)
+	void ContainersWrapper::ExpandArchiveFile(String^ path, String^ destination, array<String^>^ include, array<String^>^ exclude, int throttleLimit, bool useIndex, ArchiveFileType type)
 	{
 		WWuString wrappedPath = UtilitiesWrapper::GetWideStringFromSystemString(path);
 		WWuString wrappedDest = UtilitiesWrapper::GetWideStringFromSystemString(destination);
 
+		Core::CabinetFileFilter filter = GetFileFilter(include, exclude);
+
+		switch (type) {
+		case ArchiveFileType::Cabinet:
+		{
+			try {
+				Stubs::Containers::Dispatch<ContainersOperation::Expand>(wrappedPath, wrappedDest, filter, static_cast<DWORD>(throttleLimit), useIndex, Context->GetUnderlyingContext());
+			}
+			catch (NativeException^ ex) {
+				Context->WriteError(ex->Record);
+				throw;
+			}
+		} break;
+
+		default:
+			throw gcnew NotSupportedException();
+		}
+	}
+
+	// Expand-Cabinet -InMemory
+	void ContainersWrapper::ExpandArchiveFileToMemory(String^ path, array<String^>^ include, array<String^>^ exclude, int throttleLimit, bool useIndex, ArchiveFileType type)
+	{
+		WWuString wrappedPath = UtilitiesWrapper::GetWideStringFromSystemString(path);
+		Core::CabinetFileFilter filter = GetFileFilter(include, exclude);
+
+		switch (type) {
+		case ArchiveFileType::Cabinet:
+		{
+			try {
+				Stubs::Containers::Dispatch<ContainersOperation::ExpandToMemory>(wrappedPath, filter, static_cast<DWORD>(throttleLimit), useIndex, Context->GetUnderlyingContext());
+			}
+			catch (NativeException^ ex) {
+				Context->WriteError(ex->Record);
+				throw;
+			}
+		} break;
+
+		default:
+			throw gcnew NotSupportedException();
+		}
+	}
+
+	// Get-CabinetContent
+	void ContainersWrapper::GetArchiveFileContent(String^ path, ArchiveFileType type)
+	{
+		WWuString wrappedPath = UtilitiesWrapper::GetWideStringFromSystemString(path);
+
 		switch (type) {
 		case ArchiveFileType::Cabinet:
 		{
 			try {
-				Stubs::Containers::Dispatch<ContainersOperation::Expand>(wrappedPath, wrappedDest, Context->GetUnderlyingContext());
+				Stubs::Containers::Dispatch<ContainersOperation::List>(wrappedPath, Context->GetUnderlyingContext());
+			}
+			catch (NativeException^ ex) {
+				Context->WriteError(ex->Record);
+				throw;
+			}
+		} break;
+
+		default:
+			throw gcnew NotSupportedException();
+		}
+	}
+
+	// Test-Cabinet
+	void ContainersWrapper::TestArchiveFile(String^ path, int throttleLimit, ArchiveFileType type)
+	{
+		WWuString wrappedPath = UtilitiesWrapper::GetWideStringFromSystemString(path);
+
+		switch (type) {
+		case ArchiveFileType::Cabinet:
+		{
+			try {
+				Stubs::Containers::Dispatch<ContainersOperation::Test>(wrappedPath, static_cast<DWORD>(throttleLimit), Context->GetUnderlyingContext());
 			}
 			catch (NativeException^ ex) {
 				Context->WriteError(ex->Record);
@@ -34,7 +103,7 @@ namespace WindowsUtils::Wrappers
 	}
 
 	// Compress-ArchiveFile
-	void ContainersWrapper::CompressArchiveFile(String^ path, String^ destination, String^ namePrefix, int maxCabSize, CabinetCompressionType compressionType, ArchiveFileType type)
+	void ContainersWrapper::CompressArchiveFile(String^ path, String^ destination, String^ namePrefix, int maxCabSize, CabinetCompressionType compressionType, int throttleLimit, bool deduplicate, ArchiveFileType type)
 	{
 		WWuString wrappedDest     = UtilitiesWrapper::GetWideStringFromSystemString(destination);
 		WWuString wrappedNamPref  = UtilitiesWrapper::GetWideStringFromSystemString(namePrefix);
@@ -46,7 +115,7 @@ namespace WindowsUtils::Wrappers
 
 				try {
 					Stubs::Containers::Dispatch<ContainersOperation::Compress>(apt, wrappedDest, wrappedNamPref,
-						maxCabSize, static_cast<const Core::CabinetCompressionType>(compressionType), Context->GetUnderlyingContext());
+						maxCabSize, static_cast<const Core::CabinetCompressionType>(compressionType), static_cast<DWORD>(throttleLimit), deduplicate, Context->GetUnderlyingContext());
 				}
 				catch (NativeException^ ex) {
 					Context->WriteError(ex->Record);
@@ -58,4 +127,45 @@ namespace WindowsUtils::Wrappers
 				throw gcnew NotSupportedException();
 		}
 	}
+
+	void ContainersWrapper::UpdateArchiveFile(String^ path, String^ destination, String^ namePrefix, CabinetCompressionType compressionType, int throttleLimit, ArchiveFileType type)
+	{
+		WWuString wrappedDest     = UtilitiesWrapper::GetWideStringFromSystemString(destination);
+		WWuString wrappedNamPref  = UtilitiesWrapper::GetWideStringFromSystemString(namePrefix);
+		switch (type) {
+			case ArchiveFileType::Cabinet:
+			{
+				Core::AbstractPathTree apt;
+				UtilitiesWrapper::GetAptFromPath(path, &apt);
+
+				try {
+					Stubs::Containers::Dispatch<ContainersOperation::Update>(apt, wrappedDest, wrappedNamPref,
+						static_cast<const Core::CabinetCompressionType>(compressionType), static_cast<DWORD>(throttleLimit), Context->GetUnderlyingContext());
+				}
+				catch (NativeException^ ex) {
+					Context->WriteError(ex->Record);
+					throw;
+				}
+			} break;
+
+			default:
+				throw gcnew NotSupportedException();
+		}
+	}
+
+	Core::CabinetFileFilter ContainersWrapper::GetFileFilter(array<String^>^ include, array<String^>^ exclude)
+	{
+		Core::CabinetFileFilter filter;
+		if (include != nullptr) {
+			for each (String^ pattern in include)
+				filter.Include.Add(UtilitiesWrapper::GetWideStringFromSystemString(pattern));
+		}
+
+		if (exclude != nullptr) {
+			for each (String^ pattern in exclude)
+				filter.Exclude.Add(UtilitiesWrapper::GetWideStringFromSystemString(pattern));
+		}
+
+		return filter;
+	}
 }
\ No newline at end of file
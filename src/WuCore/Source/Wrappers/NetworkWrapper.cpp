@@ -38,6 +38,34 @@ namespace WindowsUtils::Wrappers
 		isCancel = form.IsCtrlCHit();
 	}
 
+	void NetworkWrapper::StartTcpPingParallel(array<String^>^ destination, array<Int32>^ port, Int32 count, Int32 timeout, Int32 interval, Int32 failThreshold, bool continuous,
+		bool jitter, bool fqdn, bool force, bool single, [Out] bool% isCancel)
+	{
+		std::vector<WWuString> wrappedDest;
+		for each (String^ singleDest in destination)
+			wrappedDest.push_back(UtilitiesWrapper::GetWideStringFromSystemString(singleDest));
+
+		std::vector<DWORD> wrappedPorts;
+		for each (Int32 singlePort in port)
+			wrappedPorts.push_back(static_cast<DWORD>(singlePort));
+
+		// The form carries the options and the Ctrl+C handler, the engine has its own targets.
+		Core::TcpingForm form { wrappedDest[0], wrappedPorts[0], static_cast<DWORD>(count), static_cast<DWORD>(timeout), static_cast<DWORD>(interval), static_cast<DWORD>(failThreshold),
+			continuous, jitter, fqdn, force, single, false, WWuString(), false };
+
+		try {
+			Stubs::Network::Dispatch<NetworkOperation::TcpingParallel>(Context->GetUnderlyingContext(), form, wrappedDest, wrappedPorts);
+		}
+		catch (NativeException^ ex) {
+			if (ex->ErrorCode != ERROR_CANCELLED) {
+				Context->WriteError(ex->Record);
+				throw;
+			}
+		}
+
+		isCancel = form.IsCtrlCHit();
+	}
+
 	// Get-NetworkFile
 	List<NetworkFileInfo^>^ NetworkWrapper::GetNetworkFile(String^ computerName, String^ basePath, String^ userName, bool includeSessionName)
 	{
@@ -102,6 +130,21 @@ namespace WindowsUtils::Wrappers
 		_WU_MANAGED_CATCH
 	}
 
+	void NetworkWrapper::ScanNetworkPorts(array<String^>^ destination, array<Int32>^ port, UInt32 timeout, Int32 throttleLimit)
+	{
+		std::vector<WWuString> wrappedDest;
+		for each (String^ singleDest in destination)
+			wrappedDest.push_back(UtilitiesWrapper::GetWideStringFromSystemString(singleDest));
+
+		std::vector<DWORD> wrappedPorts;
+		for each (Int32 singlePort in port)
+			wrappedPorts.push_back(static_cast<DWORD>(singlePort));
+
+		_WU_START_TRY
+			Stubs::Network::Dispatch<NetworkOperation::ScanPorts>(Context->GetUnderlyingContext(), wrappedDest, wrappedPorts, static_cast<DWORD>(timeout), static_cast<DWORD>(throttleLimit));
+		_WU_MANAGED_CATCH
+	}
+
 	// Get-NetworkStatistics
 	void NetworkWrapper::GetTransportTables(bool all, bool includeModuleName)
 	{
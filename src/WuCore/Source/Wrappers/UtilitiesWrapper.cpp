@@ -136,15 +136,23 @@ namespace WindowsUtils::Wrappers
 		WWuString wrappedPath = GetWideStringFromSystemString(path);
 
 		WuList<Core::FS_INFO> fsInfo = Core::IO::EnumerateFileSystemInfo(wrappedPath);
+		apt->RootPath = wrappedPath;
 		for (Core::FS_INFO& info : fsInfo) {
 			if (info.Length > 0x7FFFFFFF)
 				throw gcnew ArgumentException("Cabinet does not support files bigger than 2Gb.");
 
-			apt->PushEntry(Core::AbstractPathTree::AptEntry(info.Name, info.FullName, wrappedPath, info.Length, info.Type));
+			apt->PushEntry(info);
 		}
 
 	}
 
+	Int64 UtilitiesWrapper::CountFileSystemEntries(String^ path, Int32 threadCount)
+	{
+		WWuString wrappedPath = GetWideStringFromSystemString(path);
+
+		return static_cast<Int64>(Core::IO::EnumerateFileSystemInfo(wrappedPath, static_cast<DWORD>(threadCount)).Count());
+	}
+
 	WWuString UtilitiesWrapper::GetWideStringFromSystemString(String^ string)
 	{
 		pin_ptr<const wchar_t> pinnedString = PtrToStringChars(string);